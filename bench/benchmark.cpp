@@ -0,0 +1,135 @@
+#include "benchmark.hpp"
+
+namespace bench {
+
+namespace {
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+BenchmarkResult summarize(const std::string& name, uint64_t itemsPerIteration, std::vector<double> samples) {
+    BenchmarkResult result;
+    result.name = name;
+    result.itemsPerIteration = itemsPerIteration;
+    result.iterations = samples.size();
+    if (samples.empty()) {
+        return result;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+    result.minMilliseconds = samples.front();
+    result.maxMilliseconds = samples.back();
+    result.medianMilliseconds = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) * 0.5;
+    result.meanMilliseconds = std::accumulate(samples.begin(), samples.end(), 0.0) / count;
+    double variance = 0.0;
+    for (double sample : samples) {
+        variance += (sample - result.meanMilliseconds) * (sample - result.meanMilliseconds);
+    }
+    result.stddevMilliseconds = std::sqrt(variance / count);
+    return result;
+}
+
+bool Runner::add(std::string name, uint64_t itemsPerIteration, std::function<void()> body) {
+    return add(std::move(name), itemsPerIteration, nullptr, std::move(body));
+}
+
+bool Runner::add(std::string name, uint64_t itemsPerIteration, std::function<void()> setup, std::function<void()> body) {
+    if (!matches(name)) {
+        return false;
+    }
+    std::cerr << name << " ..." << std::flush;
+
+    for (uint32_t i = 0; i < options.warmupIterations; i++) {
+        if (setup) {
+            setup();
+        }
+        body();
+    }
+
+    std::vector<double> samples;
+    double totalSeconds = 0.0;
+    while (samples.size() < options.maxIterations && (samples.size() < options.minIterations || totalSeconds < options.minSeconds)) {
+        if (setup) {
+            setup();
+        }
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        samples.push_back(milliseconds);
+        totalSeconds += milliseconds / 1000.0;
+    }
+
+    results.push_back(summarize(name, itemsPerIteration, std::move(samples)));
+    std::cerr << " " << results.back().medianMilliseconds << " ms" << std::endl;
+    return true;
+}
+
+void Runner::printSummary(std::ostream& out) const {
+    out << std::left << std::setw(44) << "name" << std::right
+        << std::setw(10) << "iters" << std::setw(14) << "median ms" << std::setw(14) << "min ms" << std::setw(14) << "items/s" << std::endl;
+    for (const BenchmarkResult& result : results) {
+        out << std::left << std::setw(44) << result.name << std::right;
+        if (result.iterations == 0) {
+            out << "  skipped: " << result.note << std::endl;
+            continue;
+        }
+        double itemsPerSecond = result.medianMilliseconds > 0.0 ? result.itemsPerIteration / (result.medianMilliseconds / 1000.0) : 0.0;
+        out << std::setw(10) << result.iterations
+            << std::setw(14) << std::fixed << std::setprecision(4) << result.medianMilliseconds
+            << std::setw(14) << result.minMilliseconds
+            << std::setw(14) << std::setprecision(0) << itemsPerSecond << std::defaultfloat << std::setprecision(6) << std::endl;
+        if (!result.note.empty()) {
+            out << "  " << result.note << std::endl;
+        }
+    }
+}
+
+// 回帰の追跡用のJSON（結果名は実行ごとに同じになる）
+void Runner::writeJson(std::ostream& out) const {
+    out << "{\n  \"context\": {";
+    for (size_t i = 0; i < context.size(); i++) {
+        out << (i ? ",\n" : "\n") << "    \"" << escapeJson(context[i].first) << "\": \"" << escapeJson(context[i].second) << "\"";
+    }
+    out << "\n  },\n  \"benchmarks\": [";
+    out << std::setprecision(9);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        out << (i ? ",\n" : "\n") << "    {"
+            << "\"name\": \"" << escapeJson(result.name) << "\", "
+            << "\"iterations\": " << result.iterations << ", "
+            << "\"items_per_iteration\": " << result.itemsPerIteration << ", "
+            << "\"min_ms\": " << result.minMilliseconds << ", "
+            << "\"median_ms\": " << result.medianMilliseconds << ", "
+            << "\"mean_ms\": " << result.meanMilliseconds << ", "
+            << "\"max_ms\": " << result.maxMilliseconds << ", "
+            << "\"stddev_ms\": " << result.stddevMilliseconds;
+        if (!result.note.empty()) {
+            out << ", \"note\": \"" << escapeJson(result.note) << "\"";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
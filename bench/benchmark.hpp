@@ -0,0 +1,97 @@
+#pragma once
+#include "header.hpp"
+
+namespace bench {
+
+// 計測結果（時間はすべて1反復あたりのミリ秒）
+struct BenchmarkResult {
+    std::string name;
+    uint64_t iterations = 0;
+    uint64_t itemsPerIteration = 0;//頂点数・ノード数など（スループットの計算用）
+    double minMilliseconds = 0.0;
+    double medianMilliseconds = 0.0;
+    double meanMilliseconds = 0.0;
+    double maxMilliseconds = 0.0;
+    double stddevMilliseconds = 0.0;
+    std::string note;//スキップ理由など
+};
+
+// 反復ごとの計測値から統計を求める
+BenchmarkResult summarize(const std::string& name, uint64_t itemsPerIteration, std::vector<double> samples);
+
+// 計算結果が最適化で消されないようにする
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+    const volatile void* sink = &value;
+    (void)sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+// 計測中の標準出力を捨てる（読み込み時のダンプ等）
+class ScopedSilence {
+    public:
+        ScopedSilence() : previous(std::cout.rdbuf(nullptr)) {}
+        ~ScopedSilence() {
+            std::cout.rdbuf(previous);
+            std::cout.clear();//バッファが無い間に立ったbadbitを戻す
+        }
+
+        ScopedSilence(const ScopedSilence&) = delete;
+        ScopedSilence& operator=(const ScopedSilence&) = delete;
+
+    private:
+        std::streambuf* previous;
+};
+
+class Runner {
+    public:
+        struct Options {
+            std::string filter;//名前にこの文字列を含むものだけ実行する
+            double minSeconds = 0.5;//これ以上の時間になるまで反復する
+            uint32_t minIterations = 5;
+            uint32_t maxIterations = 1000;
+            uint32_t warmupIterations = 1;
+        };
+
+        // setupは各反復の前に呼び、計測に含めない
+        // フィルタで除外された場合はfalseを返す
+        bool add(std::string name, uint64_t itemsPerIteration, std::function<void()> body);
+        bool add(std::string name, uint64_t itemsPerIteration, std::function<void()> setup, std::function<void()> body);
+
+        // 直前にadd()した結果にnoteを付ける
+        void setLastNote(std::string note) {
+            results.back().note = std::move(note);
+        }
+
+        // 外部で計測した結果を追加する（フレーム時間など）
+        void addResult(BenchmarkResult result) {
+            results.push_back(std::move(result));
+        }
+
+        bool matches(const std::string& name) const {
+            return options.filter.empty() || name.find(options.filter) != std::string::npos;
+        }
+
+        void setOptions(const Options& newOptions) { options = newOptions; }
+        const Options& getOptions() const { return options; }
+
+        void setContext(const std::string& key, const std::string& value) {
+            context.emplace_back(key, value);
+        }
+
+        const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+        void printSummary(std::ostream& out) const;
+        void writeJson(std::ostream& out) const;
+
+    private:
+        Options options;
+        std::vector<BenchmarkResult> results;
+        std::vector<std::pair<std::string, std::string>> context;
+};
+
+}
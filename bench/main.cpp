@@ -0,0 +1,1327 @@
+#include "benchmark.hpp"
+#include "syntheticGltf.hpp"
+#include "vulkanContext.hpp"
+#include "geometry.hpp"
+#include "morphTarget.hpp"
+#include "meshLod.hpp"
+#include "gpuScene.hpp"
+#include "drawList.hpp"
+#include "sceneBvh.hpp"
+#include "profiler.hpp"
+#include "jobSystem.hpp"
+
+namespace {
+
+struct SizeCase {
+    const char* name;
+    bench::SyntheticGltfParams params;
+};
+
+// 合成glTFの大きさ（small: 1メッシュ, medium: 16メッシュ・256ノード, large: 32メッシュ・4096ノード）
+const SizeCase kSizeCases[] = {
+    {"small", {1, 32, 1, 4, false}},
+    {"medium", {16, 64, 256, 4, false}},
+    {"large", {32, 96, 4096, 8, false}},
+};
+
+struct CommandLine {
+    std::string jsonPath = "vkrenderkit_bench.json";
+    std::string tracePath;//空でなければヘッドレスのフレーム計測のタイムラインを書き出す
+    std::filesystem::path workDirectory = std::filesystem::temp_directory_path() / "vkrenderkit_bench";
+    bench::Runner::Options options;
+    uint32_t frames = 300;
+    bool quick = false;
+};
+
+CommandLine parseCommandLine(int argc, char** argv) {
+    CommandLine commandLine;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(arg + " には値が必要です");
+            }
+            return argv[++i];
+        };
+        if (arg == "--json") {
+            commandLine.jsonPath = next();
+        } else if (arg == "--filter") {
+            commandLine.options.filter = next();
+        } else if (arg == "--min-time") {
+            commandLine.options.minSeconds = std::stod(next());
+        } else if (arg == "--frames") {
+            commandLine.frames = static_cast<uint32_t>(std::stoul(next()));
+        } else if (arg == "--work-dir") {
+            commandLine.workDirectory = next();
+        } else if (arg == "--trace") {
+            commandLine.tracePath = next();
+        } else if (arg == "--quick") {
+            commandLine.quick = true;
+        } else {
+            std::cout << "使い方: vkrenderkit_bench [--json path] [--filter text] [--min-time seconds] [--frames count] [--work-dir dir] [--trace path] [--quick]" << std::endl;
+            std::cout << "  --frames 0 でヘッドレスのフレーム計測を省略（lavapipeはVK_DRIVER_FILESで指定する）" << std::endl;
+            std::exit(arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    return commandLine;
+}
+
+tinygltf::Model loadTinyGltf(const std::filesystem::path& path) {
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    if (!loader.LoadASCIIFromFile(&model, &err, &warn, path.string())) {
+        throw std::runtime_error("合成glTFの読み込みに失敗しました: " + err);
+    }
+    return model;
+}
+
+uint64_t countVertices(const tinygltf::Model& gltf) {
+    uint64_t count = 0;
+    for (const auto& mesh : gltf.meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            count += gltf.accessors[primitive.attributes.at("POSITION")].count;
+        }
+    }
+    return count;
+}
+
+// glTFの読み込み（ファイル全体と、ノード・メッシュ・プリミティブ単位）
+void addGltfBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    for (const SizeCase& sizeCase : kSizeCases) {
+        if (commandLine.quick && std::string(sizeCase.name) == "large") {
+            continue;
+        }
+        std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, sizeCase.name, sizeCase.params);
+        tinygltf::Model gltf = loadTinyGltf(path);
+        uint64_t vertexCount = countVertices(gltf);
+        std::string suffix = std::string("/") + sizeCase.name;
+
+        runner.add("gltf/parse" + suffix, vertexCount, [&]() {
+            tinygltf::Model parsed = loadTinyGltf(path);
+            bench::doNotOptimize(parsed.accessors.size());
+        });
+
+        // 最適化・LOD・メッシュレットの構築を含む
+        runner.add("gltf/readGLTF" + suffix, vertexCount, [&]() {
+            bench::ScopedSilence silence;
+            geometry::Model model;
+            model.readGLTF(path.string());
+            bench::doNotOptimize(model.meshes.size());
+        });
+
+        std::unique_ptr<geometry::Model> model;
+        runner.add("gltf/readNode" + suffix, gltf.nodes.size(),
+            [&]() { model = std::make_unique<geometry::Model>(); },
+            [&]() {
+                for (int root : gltf.scenes[0].nodes) {
+                    model->readNode(gltf, root, -1);
+                }
+                bench::doNotOptimize(model->nodes.size());
+            });
+        runner.add("gltf/readMesh" + suffix, vertexCount,
+            [&]() { model = std::make_unique<geometry::Model>(); },
+            [&]() {
+                for (size_t i = 0; i < gltf.meshes.size(); i++) {
+                    model->readMesh(gltf, static_cast<uint32_t>(i));
+                }
+                bench::doNotOptimize(model->meshes.size());
+            });
+    }
+}
+
+// 頂点の展開（float と 正規化整数）
+void addDecodeBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    for (bool quantized : {false, true}) {
+        std::string name = quantized ? "decode_quantized" : "decode_float";
+        std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, name, {1, 256, 1, 4, quantized});
+        tinygltf::Model gltf = loadTinyGltf(path);
+        geometry::Model model;
+        geometry::Primitive primitive;
+        runner.add("decode/readPrimitive/" + std::string(quantized ? "quantized" : "float"), countVertices(gltf),
+            [&]() { primitive = {}; },
+            [&]() {
+                primitive = model.readPrimitive(gltf, gltf.meshes[0].primitives[0]);
+                bench::doNotOptimize(primitive.vertices.data());
+            });
+    }
+}
+
+// ノード階層のワールド行列の計算
+void addTransformBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    for (uint32_t nodeCount : {1024u, 65536u}) {
+        std::string name = "transform_" + std::to_string(nodeCount);
+        std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, name, {1, 1, nodeCount, 4, false});
+        tinygltf::Model gltf = loadTinyGltf(path);
+        geometry::Model model;
+        model.readNode(gltf, gltf.scenes[0].nodes[0], -1);
+        runner.add("transform/updateGlobalMatrices/" + std::to_string(nodeCount), nodeCount, [&]() {
+            model.updateGlobalMatrices();
+            bench::doNotOptimize(model.nodes.back().globalMatrix);
+        });
+    }
+}
+
+// モーフターゲットの合成（疎な差分で重みが0でないものだけ vs 全ターゲットの密な差分）
+// 32ターゲットのうち既定の重みを持つのは4つで、各ターゲットが動かす頂点は全体の約5%
+void addMorphBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "morph", {1, 256, 1, 4, false, 0.0f, false, 32});
+    geometry::Model model;
+    {
+        bench::ScopedSilence silence;
+        model.readGLTF(path.string());
+    }
+    const geometry::Primitive& primitive = model.meshes[0].primitives[0];
+    const std::vector<float>& weights = model.meshes[0].morphWeights;
+    std::vector<float> allWeights(primitive.morphTargets.size(), 0.5f);
+    std::vector<glm::vec3> denseDeltas = geometry::expandMorphTargets(primitive);
+    std::vector<geometry::DynamicVertexAttributes> positions;
+    uint64_t vertexCount = primitive.vertices.size();
+
+    runner.add("morph/sparse/activeOnly", vertexCount, [&]() {
+        geometry::blendMorphTargets(primitive, weights, positions);
+        bench::doNotOptimize(positions.data());
+    });
+    runner.add("morph/sparse/allTargets", vertexCount, [&]() {
+        geometry::blendMorphTargets(primitive, allWeights, positions);
+        bench::doNotOptimize(positions.data());
+    });
+    runner.add("morph/dense/allTargets", vertexCount, [&]() {
+        geometry::blendMorphTargetsDense(primitive, denseDeltas, weights, positions);
+        bench::doNotOptimize(positions.data());
+    });
+}
+
+// 群衆（32×32体）に対するLODの選択と描画三角形数
+// 選択器が落ち着くまでの16フレームを除いた60フレームの平均を、noteにLOD有効/無効の三角形数として記録する
+void addLodBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "lod", {1, 128, 1, 4, false});
+    geometry::Model model;
+    {
+        bench::ScopedSilence silence;
+        model.readGLTF(path.string());
+        // 読み込み時には作らないため、ここで明示的に生成する
+        geometry::LodSettings lodSettings;
+        lodSettings.enabled = true;
+        model.generateLods(lodSettings);
+    }
+
+    geometry::LodSelectionParams params;
+    params.projectionScale = 1.0f / std::tan(glm::radians(60.0f) * 0.5f);
+    params.viewportHeight = 600.0f;
+    constexpr uint32_t gridSize = 32;
+    constexpr uint32_t warmupFrames = 16;
+    constexpr uint32_t frameCount = 60;
+
+    geometry::LodCrowdStatistics stats;
+    bool ran = runner.add("lod/crowd/" + std::to_string(gridSize * gridSize), static_cast<uint64_t>(gridSize) * gridSize * frameCount, [&]() {
+        stats = geometry::measureCrowdTriangles(model, gridSize, params, warmupFrames, frameCount);
+        bench::doNotOptimize(stats.trianglesWithLod);
+    });
+    if (ran) {
+        std::ostringstream note;
+        note << "triangles_without_lod=" << stats.trianglesWithoutLod
+             << " triangles_with_lod=" << stats.trianglesWithLod
+             << " instances_per_level=";
+        for (size_t level = 0; level < stats.instancesPerLevel.size(); level++) {
+            note << (level == 0 ? "" : "/") << stats.instancesPerLevel[level];
+        }
+        runner.setLastNote(note.str());
+    }
+}
+
+// 常駐するシーンの表の差分書き込み（インスタンスの0.1%・1%・100%が毎フレーム動く場合）
+// 書き込み先はホストのメモリで代用し、noteに1フレームあたりの書き込み量と範囲の数を記録する
+void addGpuSceneBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    constexpr uint32_t instanceCount = 100000;
+    for (double movingRatio : {0.001, 0.01, 1.0}) {
+        uint32_t movingCount = std::max(static_cast<uint32_t>(instanceCount * movingRatio), 1u);
+        std::vector<uint32_t> moving(instanceCount);
+        std::iota(moving.begin(), moving.end(), 0u);
+        std::shuffle(moving.begin(), moving.end(), std::mt19937(12345));
+        moving.resize(movingCount);
+
+        render::GpuScene scene;
+        scene.transforms.assign(std::vector<glm::mat4>(instanceCount, glm::mat4(1.0f)));
+        scene.instances.assign(std::vector<render::GpuInstance>(instanceCount, render::GpuInstance{}));
+        scene.materials.assign(std::vector<render::GpuMaterial>(1, render::GpuMaterial{glm::vec4(1.0f), 1.0f, 1.0f, 0.0f, 0.0f}));
+        std::vector<std::byte> transformData(scene.transforms.byteSize());
+        std::vector<std::byte> instanceData(scene.instances.byteSize());
+        std::vector<std::byte> materialData(scene.materials.byteSize());
+        render::SceneUploadStatistics total = scene.flush(transformData.data(), instanceData.data(), materialData.data());
+        uint64_t fullBytes = total.bytes;
+        total = render::SceneUploadStatistics{};
+        uint64_t frames = 0;
+        float time = 0.0f;
+
+        std::ostringstream name;
+        name << "gpuScene/upload/" << movingRatio * 100.0 << "%";
+        bool ran = runner.add(name.str(), movingCount, [&]() {
+            time += 1.0f;
+            for (uint32_t index : moving) {
+                scene.transforms.set(index, glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(index), time, 0.0f)));
+            }
+            total.add(scene.flush(transformData.data(), instanceData.data(), materialData.data()));
+            frames++;
+            bench::doNotOptimize(transformData.data());
+        });
+        if (ran) {
+            std::ostringstream note;
+            note << "bytes_per_frame=" << total.bytes / frames
+                 << " ranges_per_frame=" << total.ranges / frames
+                 << " full_upload_bytes=" << fullBytes;
+            runner.setLastNote(note.str());
+        }
+    }
+}
+
+// 描画リストのキー作成とソート
+void addDrawListBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "drawlist", {16, 8, 64, 4, false});
+    geometry::Model model;
+    {
+        bench::ScopedSilence silence;
+        model.readGLTF(path.string());
+    }
+
+    for (uint32_t drawCount : {16384u, 131072u}) {
+        // モデルを格子状に並べて描画数を揃える
+        std::vector<render::DrawRecord> records;
+        for (uint32_t copy = 0; records.size() < drawCount; copy++) {
+            glm::mat4 root = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(copy % 64) * 4.0f, 0.0f, static_cast<float>(copy / 64) * 4.0f));
+            render::collectDrawRecords(model, root, copy % 4 * 16, records);
+        }
+        records.resize(drawCount);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, -10.0f), glm::vec3(128.0f, 0.0f, 128.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        render::DrawList drawList;
+        std::string suffix = "/" + std::to_string(drawCount);
+        runner.add("drawList/build" + suffix, drawCount, [&]() {
+            drawList.build(records, view);
+            bench::doNotOptimize(drawList.getKeys().data());
+        });
+        drawList.build(records, view);
+        render::DrawListStatistics unsorted = drawList.computeStatistics();
+        bool ran = runner.add("drawList/sort" + suffix, drawCount,
+            [&]() { drawList.build(records, view); },
+            [&]() {
+                drawList.sort();
+                bench::doNotOptimize(drawList.getKeys().data());
+            });
+        if (ran) {
+            // ソート前後のステート切り替え回数
+            render::DrawListStatistics sorted = drawList.computeStatistics();
+            std::ostringstream note;
+            note << "pipeline_changes=" << unsorted.pipelineChanges << "->" << sorted.pipelineChanges
+                 << " material_changes=" << unsorted.materialChanges << "->" << sorted.materialChanges;
+            runner.setLastNote(note.str());
+        }
+        runner.add("drawList/sort/1thread" + suffix, drawCount,
+            [&]() { drawList.build(records, view); },
+            [&]() {
+                drawList.sort(1);
+                bench::doNotOptimize(drawList.getKeys().data());
+            });
+        // 比較用のstd::sort
+        std::vector<render::DrawKey> keys;
+        runner.add("drawList/stdSort" + suffix, drawCount,
+            [&]() {
+                drawList.build(records, view);
+                keys = drawList.getKeys();
+            },
+            [&]() {
+                std::sort(keys.begin(), keys.end(), [](const render::DrawKey& a, const render::DrawKey& b) { return a.key < b.key; });
+                bench::doNotOptimize(keys.data());
+            });
+    }
+}
+
+// シーンBVHの構築とリフィット
+void addSceneBvhBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    for (uint32_t instanceCount : {10000u, 1000000u}) {
+        if (commandLine.quick && instanceCount > 10000) {
+            continue;
+        }
+        std::mt19937 random(12345);
+        float extent = std::cbrt(static_cast<float>(instanceCount)) * 4.0f;
+        std::uniform_real_distribution<float> position(0.0f, extent);
+        std::vector<geometry::Aabb> bounds(instanceCount);
+        for (geometry::Aabb& box : bounds) {
+            glm::vec3 center(position(random), position(random), position(random));
+            box = {center - glm::vec3(0.5f), center + glm::vec3(0.5f)};
+        }
+
+        geometry::SceneBvh bvh;
+        std::string suffix = "/" + std::to_string(instanceCount);
+        runner.add("sceneBvh/build" + suffix, instanceCount, [&]() {
+            bvh.build(bounds);
+            bench::doNotOptimize(bvh.getNodeCount());
+        });
+        runner.add("sceneBvh/refit" + suffix, instanceCount, [&]() {
+            bvh.refit(bounds);
+            bench::doNotOptimize(bvh.getNodeCount());
+        });
+
+        // 問い合わせ（立方体の手前から中心を見る視錐台、奥へ向かうレイ1000本、AABB1000個）
+        auto ensureBuilt = [&]() {
+            if (bvh.empty()) {
+                bvh.build(bounds);
+            }
+        };
+        glm::vec3 center(extent * 0.5f);
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, extent * 2.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(center.x, center.y, -extent * 0.25f), center, glm::vec3(0.0f, 1.0f, 0.0f));
+        geometry::Frustum frustum = geometry::Frustum::fromMatrix(projection * view);
+        std::vector<uint32_t> visible;
+        runner.add("sceneBvh/frustum" + suffix, instanceCount, ensureBuilt, [&]() {
+            visible.clear();
+            bvh.queryFrustum(frustum, visible);
+            bench::doNotOptimize(visible.size());
+        });
+
+        constexpr uint32_t queryCount = 1000;
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        std::vector<geometry::Ray> rays(queryCount);
+        std::vector<geometry::Aabb> boxes(queryCount);
+        for (uint32_t i = 0; i < queryCount; i++) {
+            rays[i] = {glm::vec3(position(random), position(random), -1.0f), glm::normalize(glm::vec3(direction(random) * 0.5f, direction(random) * 0.5f, 1.0f))};
+            glm::vec3 boxCenter(position(random), position(random), position(random));
+            boxes[i] = {boxCenter - glm::vec3(2.0f), boxCenter + glm::vec3(2.0f)};
+        }
+        runner.add("sceneBvh/raycast" + suffix, queryCount, ensureBuilt, [&]() {
+            for (const geometry::Ray& ray : rays) {
+                float t;
+                bench::doNotOptimize(bvh.raycast(ray, t));
+            }
+        });
+        std::vector<uint32_t> overlaps;
+        runner.add("sceneBvh/overlap" + suffix, queryCount, ensureBuilt, [&]() {
+            for (const geometry::Aabb& box : boxes) {
+                overlaps.clear();
+                bvh.queryOverlap(box, overlaps);
+                bench::doNotOptimize(overlaps.size());
+            }
+        });
+    }
+}
+
+// ジョブシステムのスレッド数によるスケーリング（1〜64スレッド）と、同じ分割をstd::asyncで行った場合の比較
+// forkJoinは小さなジョブを再帰的に投入する（スケジューラ自体のコスト）
+void addJobSystemBenchmarks(bench::Runner& runner, const CommandLine& commandLine) {
+    constexpr size_t itemCount = 1 << 20;
+    constexpr size_t grain = 1024;
+    std::vector<glm::vec4> input(itemCount);
+    std::vector<glm::vec4> output(itemCount);
+    for (size_t i = 0; i < itemCount; i++) {
+        input[i] = glm::vec4(static_cast<float>(i % 97), static_cast<float>(i % 89), static_cast<float>(i % 83), 1.0f);
+    }
+    auto work = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec4 value = input[i];
+            for (int k = 0; k < 8; k++) {
+                value = glm::normalize(value * 1.01f + glm::vec4(0.5f));
+            }
+            output[i] = value;
+        }
+    };
+
+    render::JobSystem& jobs = render::JobSystem::instance();
+    for (uint32_t threadCount : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        if (commandLine.quick && threadCount > 8) {
+            continue;
+        }
+        std::string suffix = "/" + std::to_string(threadCount);
+        jobs.setThreadCount(threadCount);
+        runner.add("jobs/parallelFor" + suffix, itemCount, [&]() {
+            jobs.parallelFor(itemCount, grain, work);
+            bench::doNotOptimize(output.data());
+        });
+
+        std::function<void(size_t, size_t)> forkJoin = [&](size_t begin, size_t end) {
+            if (end - begin <= grain) {
+                work(begin, end);
+                return;
+            }
+            // キャプチャを小さくしてstd::functionの確保を避ける
+            std::pair<size_t, size_t> left(begin, begin + (end - begin) / 2);
+            render::JobCounter counter;
+            render::Job leftJob([&forkJoin, &left]() { forkJoin(left.first, left.second); });
+            jobs.run(leftJob, counter);
+            forkJoin(left.second, end);
+            jobs.wait(counter);
+        };
+        runner.add("jobs/forkJoin" + suffix, itemCount, [&]() {
+            forkJoin(0, itemCount);
+            bench::doNotOptimize(output.data());
+        });
+
+        // スレッド数と同じ数に等分し、呼び出したスレッドも1つを担当する
+        runner.add("jobs/stdAsync" + suffix, itemCount, [&]() {
+            std::vector<std::future<void>> futures;
+            for (uint32_t t = 1; t < threadCount; t++) {
+                futures.push_back(std::async(std::launch::async, work, itemCount * t / threadCount, itemCount * (t + 1) / threadCount));
+            }
+            work(0, itemCount / threadCount);
+            for (auto& future : futures) {
+                future.get();
+            }
+            bench::doNotOptimize(output.data());
+        });
+    }
+    jobs.setThreadCount(0);
+}
+
+// ヘッドレスサーフェスでの1フレームの時間（acquireからpresent完了まで）
+void addFrameBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/medium";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "frame", kSizeCases[1].params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        if (!commandLine.tracePath.empty()) {
+            render::profiler::setThreadName("main");
+            render::profiler::setEnabled(true);
+        }
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.loadModels({&model});
+            context.setFramePacing(false);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            glm::vec3 cameraPosition(0.0f, 6.0f, -6.0f);
+            context.setCamera(glm::lookAt(cameraPosition, glm::vec3(2.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+
+            constexpr uint32_t warmupFrames = 30;
+            for (uint32_t i = 0; i < warmupFrames + commandLine.frames; i++) {
+                auto start = std::chrono::steady_clock::now();
+                context.pollEvents();
+                context.draw();
+                if (i >= warmupFrames) {
+                    samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+            }
+        }
+        if (!commandLine.tracePath.empty()) {
+            render::profiler::setEnabled(false);
+            render::profiler::writeChromeTrace(commandLine.tracePath);
+            std::cout << "トレース: " << commandLine.tracePath << std::endl;
+        }
+        runner.setContext("vulkan_device", context.getDeviceName());
+        runner.addResult(bench::summarize(name, 1, std::move(samples)));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 10万個のオブジェクト定数をリングバッファ（永続的にマップしたバッファ）へ書き込む時間
+void addFrameRingBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    constexpr uint32_t objectCount = 100000;
+    const std::string name = "frameRing/writeObjects/" + std::to_string(objectCount);
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        VulkanContext context;
+        std::vector<double> samples;
+        {
+            bench::ScopedSilence silence;
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            samples = context.measureObjectUpload(objectCount, 64);
+        }
+        if (samples.empty()) {
+            skipped.note = "リングバッファの1フレームの領域を超えるため省略";
+            runner.addResult(skipped);
+        } else {
+            runner.addResult(bench::summarize(name, objectCount, std::move(samples)));
+        }
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 予算を全ジオメトリの1/4にして、一列に並んだ別々のメッシュの上を往復するカメラで常駐管理を計測する
+// 結果のnoteにヒット率・1秒あたりの退避数・最大使用量を記録する
+void addResidencyBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/residency";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    constexpr uint32_t meshCount = 128;
+    constexpr float rowSpacing = 1.5f;
+    bench::SyntheticGltfParams params{meshCount, 32, meshCount, meshCount, false, rowSpacing};
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "residency", params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        uint64_t totalBytes = 0;
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.setResidencyBudget(UINT64_MAX);
+            context.initVulkan();
+            context.loadModels({&model});
+            context.setFramePacing(false);
+            totalBytes = context.getResidency().getResidentBytes();
+            context.setResidencyBudget(totalBytes / 4);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            const float rowLength = meshCount * rowSpacing;
+            auto flyTo = [&](uint32_t frame, uint32_t frameCount) {
+                // 列の上空を見下ろしながら往復する
+                float t = static_cast<float>(frame) / std::max(frameCount - 1, 1u);
+                float x = (t < 0.5f ? t * 2.0f : 2.0f - t * 2.0f) * rowLength;
+                glm::vec3 cameraPosition(x, 2.0f, -0.5f);
+                context.setCamera(glm::lookAt(cameraPosition, glm::vec3(x, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)), projection, cameraPosition);
+            };
+
+            constexpr uint32_t warmupFrames = 30;
+            for (uint32_t i = 0; i < warmupFrames; i++) {
+                flyTo(0, 1);
+                context.pollEvents();
+                context.draw();
+            }
+            context.resetResidencyStatistics();
+            for (uint32_t i = 0; i < commandLine.frames; i++) {
+                auto start = std::chrono::steady_clock::now();
+                flyTo(i, commandLine.frames);
+                context.pollEvents();
+                context.draw();
+                samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+        }
+        const render::ResidencyStatistics& stats = context.getResidency().getStatistics();
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3)
+             << "hit_rate=" << stats.hitRate()
+             << " evictions_per_second=" << stats.evictionsPerSecond()
+             << " stream_ins=" << stats.streamIns
+             << " peak_bytes=" << stats.peakResidentBytes
+             << " budget_bytes=" << context.getResidency().getBudget()
+             << " total_bytes=" << totalBytes;
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 奥へ並んだ壁を正面から見るカメラで、遮蔽カリングの有無による描画時間を比較する
+// 結果のnoteに遮蔽されたメッシュレットの割合と、グラフィックスキューの時間の差を記録する
+void addOcclusionBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/occlusion";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    constexpr uint32_t meshCount = 128;
+    bench::SyntheticGltfParams params{meshCount, 32, meshCount, meshCount, false, 1.5f, true};
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "occlusion", params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        VulkanContext::CullStatistics withoutOcclusion;
+        VulkanContext::CullStatistics withOcclusion;
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.loadModels({&model});
+            context.setFramePacing(false);
+            context.setMeshletCulling(true);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            auto lookAtWalls = [&](uint32_t frame) {
+                // 先頭の壁の手前で少し揺らす（前のフレームの可視性が毎フレーム少しずつ変わる）
+                glm::vec3 cameraPosition(-1.2f, 0.05f * std::sin(frame * 0.1f), 0.05f * std::cos(frame * 0.07f));
+                context.setCamera(glm::lookAt(cameraPosition, cameraPosition + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+            };
+            auto run = [&](bool occlusion, bool measure) {
+                context.setOcclusionCulling(occlusion);
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    lookAtWalls(i);
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetCullStatistics();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    lookAtWalls(i);
+                    context.pollEvents();
+                    context.draw();
+                    if (measure) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                return context.getCullStatistics();
+            };
+            withoutOcclusion = run(false, false);
+            withOcclusion = run(true, true);
+        }
+        auto averageDraw = [](const VulkanContext::CullStatistics& stats) {
+            return stats.frames == 0 ? 0.0 : stats.drawMilliseconds / stats.frames;
+        };
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3)
+             << "occluded_ratio=" << withOcclusion.occludedRatio()
+             << " draw_ms_off=" << averageDraw(withoutOcclusion)
+             << " draw_ms_on=" << averageDraw(withOcclusion)
+             << " saved_ms=" << averageDraw(withoutOcclusion) - averageDraw(withOcclusion);
+        if (withOcclusion.testedMeshlets == 0) {
+            note << " (遮蔽カリング非対応)";
+        }
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 固定機能の頂点入力と頂点プル（バッファデバイスアドレスでシェーダが頂点を読む）の描画時間を比較する
+// 頂点の処理量を揃えるためメッシュレットカリングを無効にし、結果のnoteにグラフィックスキューの時間を記録する
+void addVertexPullingBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/vertexPulling";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "frame", kSizeCases[1].params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        VulkanContext::CullStatistics fixedFunction;
+        VulkanContext::CullStatistics pulling;
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.loadModels({&model});
+            context.setFramePacing(false);
+            context.setMeshletCulling(false);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            glm::vec3 cameraPosition(0.0f, 6.0f, -6.0f);
+            context.setCamera(glm::lookAt(cameraPosition, glm::vec3(2.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+
+            auto run = [&](bool pull, bool measure) {
+                context.setVertexPulling(pull);
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetCullStatistics();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    context.pollEvents();
+                    context.draw();
+                    if (measure) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                return context.getCullStatistics();
+            };
+            fixedFunction = run(false, false);
+            pulling = run(true, true);
+        }
+        auto averageDraw = [](const VulkanContext::CullStatistics& stats) {
+            return stats.frames == 0 ? 0.0 : stats.drawMilliseconds / stats.frames;
+        };
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3)
+             << "draw_ms_fixed=" << averageDraw(fixedFunction)
+             << " draw_ms_pull=" << averageDraw(pulling)
+             << " triangles=" << (pulling.frames == 0 ? 0 : pulling.visibleTriangles / pulling.frames);
+        if (!context.isVertexPullingSupported()) {
+            note << " (頂点プル非対応)";
+        }
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 深度のみの描画で、インターリーブされた頂点（全属性）・位置ストリーム（単精度・半精度）から位置を読む場合のGPU時間を比較する
+// 頂点の処理量を揃えるためメッシュレットカリングを無効にし、結果のnoteに頂点1つあたりの読み込み量とグラフィックスキューの時間を記録する
+void addDepthOnlyBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/depthOnly";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "frame", kSizeCases[1].params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        struct LayoutCase {
+            const char* label;
+            VulkanContext::DepthOnlyLayout layout;
+            bool quantized;
+            vk::DeviceSize bytesPerVertex = 0;
+            double drawMilliseconds = 0.0;
+        };
+        std::vector<LayoutCase> cases = {
+            {"interleaved", VulkanContext::DepthOnlyLayout::Interleaved, false},
+            {"split", VulkanContext::DepthOnlyLayout::Split, false},
+            {"split_half", VulkanContext::DepthOnlyLayout::Split, true},
+        };
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.setFramePacing(false);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            glm::vec3 cameraPosition(0.0f, 6.0f, -6.0f);
+
+            for (LayoutCase& layoutCase : cases) {
+                // 位置ストリームの形式は読み込み時に決まる
+                context.setQuantizedPositions(layoutCase.quantized);
+                context.loadModels({&model});
+                context.setMeshletCulling(false);
+                context.setDepthOnlyLayout(layoutCase.layout);
+                context.setCamera(glm::lookAt(cameraPosition, glm::vec3(2.0f, 0.0f, 2.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+                layoutCase.bytesPerVertex = layoutCase.layout == VulkanContext::DepthOnlyLayout::Split
+                    ? context.getPositionStride() : sizeof(geometry::StaticVertexAttributes);
+
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetCullStatistics();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    context.pollEvents();
+                    context.draw();
+                    if (layoutCase.layout == VulkanContext::DepthOnlyLayout::Split && !layoutCase.quantized) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                const VulkanContext::CullStatistics& stats = context.getCullStatistics();
+                layoutCase.drawMilliseconds = stats.frames == 0 ? 0.0 : stats.drawMilliseconds / stats.frames;
+            }
+        }
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3);
+        for (const LayoutCase& layoutCase : cases) {
+            note << layoutCase.label << "_bytes_per_vertex=" << layoutCase.bytesPerVertex
+                 << " " << layoutCase.label << "_draw_ms=" << layoutCase.drawMilliseconds << " ";
+        }
+        if (!context.isDepthOnlySupported()) {
+            note << "(深度のみの描画は間接描画の経路のみ)";
+        }
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// カメラをゆっくり動かしながら、影のページをキャッシュする場合としない場合の描画数・GPU時間を比べる
+// 標本はキャッシュ有効時のフレーム時間
+void addShadowBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/shadows";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "frame", kSizeCases[1].params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        struct CachingCase {
+            const char* label;
+            bool caching;
+            VulkanContext::ShadowStatistics statistics;
+        };
+        std::vector<CachingCase> cases = {
+            {"cached", true, {}},
+            {"uncached", false, {}},
+        };
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.setFramePacing(false);
+            context.loadModels({&model});
+            context.setShadows(true);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            constexpr float kCameraSpeed = 0.02f;//1フレームあたりの移動量
+
+            for (CachingCase& cachingCase : cases) {
+                context.setShadowCaching(cachingCase.caching);
+                auto moveCamera = [&](uint32_t frame) {
+                    glm::vec3 cameraPosition(frame * kCameraSpeed, 6.0f, -6.0f);
+                    glm::vec3 target = cameraPosition + glm::vec3(2.0f, -6.0f, 8.0f);
+                    context.setCamera(glm::lookAt(cameraPosition, target, glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+                };
+
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    moveCamera(0);
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetShadowStatistics();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    moveCamera(i);
+                    auto start = std::chrono::steady_clock::now();
+                    context.pollEvents();
+                    context.draw();
+                    if (cachingCase.caching) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                cachingCase.statistics = context.getShadowStatistics();
+            }
+        }
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3);
+        for (const CachingCase& cachingCase : cases) {
+            const VulkanContext::ShadowStatistics& stats = cachingCase.statistics;
+            double frames = stats.frames == 0 ? 1.0 : static_cast<double>(stats.frames);
+            note << cachingCase.label << "_draws_per_frame=" << stats.draws() / frames
+                 << " " << cachingCase.label << "_page_updates_per_frame=" << stats.pageUpdates / frames
+                 << " " << cachingCase.label << "_gpu_ms=" << stats.gpuMilliseconds / frames << " ";
+        }
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// ライト数を変えたときのクラスタへの割り当てと描画の時間（サンプルは最も多いケースのフレーム時間）
+void addLightBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/lights";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "frame", kSizeCases[1].params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        struct LightCase {
+            uint32_t lightCount;
+            VulkanContext::LightStatistics lightStatistics;
+            VulkanContext::CullStatistics cullStatistics;
+        };
+        std::vector<LightCase> cases = {{16, {}, {}}, {256, {}, {}}, {render::kMaxLights, {}, {}}};
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.setFramePacing(false);
+            context.loadModels({&model});
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            glm::vec3 cameraPosition(0.0f, 6.0f, -6.0f);
+            context.setCamera(glm::lookAt(cameraPosition, cameraPosition + glm::vec3(2.0f, -6.0f, 8.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+
+            for (LightCase& lightCase : cases) {
+                // 合成シーンの上に点光源とスポット（4個に1個）を散らす（ケースごとに同じ乱数列）
+                std::mt19937 random(12345);
+                std::uniform_real_distribution<float> horizontal(-4.0f, 12.0f);
+                std::uniform_real_distribution<float> height(0.5f, 4.0f);
+                std::uniform_real_distribution<float> range(1.5f, 4.0f);
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+                std::vector<render::SceneLight> lights(lightCase.lightCount);
+                for (uint32_t i = 0; i < lightCase.lightCount; i++) {
+                    render::SceneLight& light = lights[i];
+                    light.type = i % 4 == 3 ? geometry::LightType::Spot : geometry::LightType::Point;
+                    light.position = glm::vec3(horizontal(random), height(random), horizontal(random));
+                    light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+                    light.color = glm::vec3(unit(random), unit(random), unit(random));
+                    light.intensity = 4.0f;
+                    light.range = range(random);
+                }
+                context.setLights(lights);
+
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetLightStatistics();
+                context.resetCullStatistics();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    context.pollEvents();
+                    context.draw();
+                    if (lightCase.lightCount == cases.back().lightCount) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                lightCase.lightStatistics = context.getLightStatistics();
+                lightCase.cullStatistics = context.getCullStatistics();
+            }
+        }
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3);
+        for (const LightCase& lightCase : cases) {
+            const VulkanContext::LightStatistics& lightStats = lightCase.lightStatistics;
+            const VulkanContext::CullStatistics& cullStats = lightCase.cullStatistics;
+            double lightFrames = lightStats.frames == 0 ? 1.0 : static_cast<double>(lightStats.frames);
+            double cullFrames = cullStats.frames == 0 ? 1.0 : static_cast<double>(cullStats.frames);
+            note << "lights_" << lightCase.lightCount << "_per_cluster=" << lightStats.lightsPerCluster()
+                 << " lights_" << lightCase.lightCount << "_max_per_cluster=" << lightStats.maxClusterLights
+                 << " lights_" << lightCase.lightCount << "_cluster_ms=" << lightStats.clusterMilliseconds / lightFrames
+                 << " lights_" << lightCase.lightCount << "_draw_ms=" << cullStats.drawMilliseconds / cullFrames << " ";
+        }
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 重い設定（1920×1080・4096ライト）で固定解像度のGPU時間を測り、その6割を目標にして動的解像度で描く
+// 倍率とGPU時間のトレースは作業ディレクトリへCSVで書き出す（サンプルは動的解像度のフレーム時間）
+void addDynamicResolutionBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/dynamicResolution";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "frame", kSizeCases[1].params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        std::vector<render::ResolutionSample> fixedTrace;
+        std::vector<render::ResolutionSample> dynamicTrace;
+        float targetMilliseconds = 0.0f;
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1920, 1080);
+            context.initVulkan();
+            context.setFramePacing(false);
+            context.loadModels({&model});
+            if (!context.isDynamicResolutionSupported()) {
+                throw std::runtime_error("動的解像度に対応していません");
+            }
+
+            std::mt19937 random(12345);
+            std::uniform_real_distribution<float> horizontal(-4.0f, 12.0f);
+            std::uniform_real_distribution<float> height(0.5f, 4.0f);
+            std::vector<render::SceneLight> lights(render::kMaxLights);
+            for (render::SceneLight& light : lights) {
+                light.position = glm::vec3(horizontal(random), height(random), horizontal(random));
+                light.intensity = 4.0f;
+                light.range = 4.0f;
+            }
+            context.setLights(lights);
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            glm::vec3 cameraPosition(0.0f, 6.0f, -6.0f);
+            context.setCamera(glm::lookAt(cameraPosition, cameraPosition + glm::vec3(2.0f, -6.0f, 8.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+
+            auto runFrames = [&](bool measure) {
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetResolutionTrace();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    context.pollEvents();
+                    context.draw();
+                    if (measure) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                return context.getResolutionTrace();
+            };
+
+            context.setDynamicResolution(false);
+            fixedTrace = runFrames(false);
+            double fixedMilliseconds = 0.0;
+            for (const render::ResolutionSample& sample : fixedTrace) {
+                fixedMilliseconds += sample.gpuMilliseconds;
+            }
+            fixedMilliseconds /= std::max<size_t>(fixedTrace.size(), 1);
+
+            render::DynamicResolutionSettings settings;
+            targetMilliseconds = static_cast<float>(fixedMilliseconds * 0.6);
+            settings.targetMilliseconds = targetMilliseconds;
+            context.setDynamicResolutionSettings(settings);
+            context.setDynamicResolution(true);
+            dynamicTrace = runFrames(true);
+        }
+
+        auto summarizeTrace = [&](const std::vector<render::ResolutionSample>& trace, const char* label, std::ostringstream& note) {
+            double milliseconds = 0.0;
+            double scale = 0.0;
+            float minScale = 1.0f;
+            size_t overTarget = 0;
+            for (const render::ResolutionSample& sample : trace) {
+                milliseconds += sample.gpuMilliseconds;
+                scale += sample.scale;
+                minScale = std::min(minScale, sample.scale);
+                if (sample.gpuMilliseconds > targetMilliseconds) {
+                    overTarget++;
+                }
+            }
+            double frames = trace.empty() ? 1.0 : static_cast<double>(trace.size());
+            note << label << "_gpu_ms=" << milliseconds / frames
+                 << " " << label << "_scale=" << scale / frames
+                 << " " << label << "_min_scale=" << minScale
+                 << " " << label << "_over_target=" << overTarget / frames << " ";
+        };
+
+        std::filesystem::path tracePath = commandLine.workDirectory / "dynamic_resolution_trace.csv";
+        std::ofstream traceFile(tracePath);
+        traceFile << "mode,frame,scale,gpu_ms\n";
+        for (const render::ResolutionSample& sample : fixedTrace) {
+            traceFile << "fixed," << sample.frame << "," << sample.scale << "," << sample.gpuMilliseconds << "\n";
+        }
+        for (const render::ResolutionSample& sample : dynamicTrace) {
+            traceFile << "dynamic," << sample.frame << "," << sample.scale << "," << sample.gpuMilliseconds << "\n";
+        }
+
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3);
+        note << "target_ms=" << targetMilliseconds << " ";
+        summarizeTrace(fixedTrace, "fixed", note);
+        summarizeTrace(dynamicTrace, "dynamic", note);
+        note << "trace=" << tracePath.string();
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+// 数千の半透明インスタンスを、奥から手前へのソートと重み付きOITで描いたときのCPU・GPU時間（サンプルはOITのフレーム時間）
+// 8種類のメッシュのうち6種類を半透明にし、ノードがメッシュを順に参照するため、深度順ではジオメトリがほぼ毎回変わる
+void addTransparencyBenchmark(bench::Runner& runner, const CommandLine& commandLine) {
+    const std::string name = "frame/headless/transparency";
+    if (commandLine.frames == 0 || !runner.matches(name)) {
+        return;
+    }
+
+    bench::SyntheticGltfParams params;
+    params.meshCount = 8;
+    params.gridSize = 8;
+    params.nodeCount = 4096;
+    params.branching = 8;
+    params.transparentMeshes = 6;
+    std::filesystem::path path = bench::writeSyntheticGltf(commandLine.workDirectory, "transparency", params);
+    bench::BenchmarkResult skipped;
+    skipped.name = name;
+    try {
+        geometry::Model model;
+        VulkanContext context;
+        std::vector<double> samples;
+        struct TransparencyCase {
+            const char* label;
+            bool orderIndependent;
+            VulkanContext::TransparencyStatistics statistics;
+        };
+        std::vector<TransparencyCase> cases = {
+            {"sorted", false, {}},
+            {"oit", true, {}},
+        };
+        {
+            bench::ScopedSilence silence;
+            model.readGLTF(path.string());
+            context.initHeadless(1280, 720);
+            context.initVulkan();
+            context.setFramePacing(false);
+            context.loadModels({&model});
+
+            glm::mat4 projection = glm::perspective(glm::radians(60.0f), context.getAspectRatio(), 0.1f, 1000.0f);
+            projection[1][1] *= -1.0f;
+            constexpr float kCameraSpeed = 0.02f;//1フレームあたりの移動量（ソートの結果を毎フレーム変える）
+
+            for (TransparencyCase& transparencyCase : cases) {
+                context.setOrderIndependentTransparency(transparencyCase.orderIndependent);
+                auto moveCamera = [&](uint32_t frame) {
+                    glm::vec3 cameraPosition(frame * kCameraSpeed, 6.0f, -6.0f);
+                    glm::vec3 target = cameraPosition + glm::vec3(2.0f, -6.0f, 8.0f);
+                    context.setCamera(glm::lookAt(cameraPosition, target, glm::vec3(0.0f, 1.0f, 0.0f)), projection, cameraPosition);
+                };
+
+                constexpr uint32_t warmupFrames = 30;
+                for (uint32_t i = 0; i < warmupFrames; i++) {
+                    moveCamera(0);
+                    context.pollEvents();
+                    context.draw();
+                }
+                context.resetTransparencyStatistics();
+                for (uint32_t i = 0; i < commandLine.frames; i++) {
+                    moveCamera(i);
+                    auto start = std::chrono::steady_clock::now();
+                    context.pollEvents();
+                    context.draw();
+                    if (transparencyCase.orderIndependent) {
+                        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                transparencyCase.statistics = context.getTransparencyStatistics();
+            }
+        }
+        bench::BenchmarkResult result = bench::summarize(name, 1, std::move(samples));
+        std::ostringstream note;
+        note << std::fixed << std::setprecision(3);
+        for (const TransparencyCase& transparencyCase : cases) {
+            const VulkanContext::TransparencyStatistics& stats = transparencyCase.statistics;
+            double frames = stats.frames == 0 ? 1.0 : static_cast<double>(stats.frames);
+            note << transparencyCase.label << "_instances_per_frame=" << stats.instances / frames
+                 << " " << transparencyCase.label << "_draws_per_frame=" << stats.draws / frames
+                 << " " << transparencyCase.label << "_cpu_ms=" << stats.cpuMilliseconds / frames
+                 << " " << transparencyCase.label << "_gpu_ms=" << stats.gpuMilliseconds / frames << " ";
+        }
+        result.note = note.str();
+        runner.addResult(std::move(result));
+        context.cleanup();
+    } catch (const std::exception& e) {
+        skipped.note = e.what();
+        runner.addResult(skipped);
+    }
+}
+
+std::string currentTimestamp() {
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buffer;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+
+    try {
+        CommandLine commandLine = parseCommandLine(argc, argv);
+        bench::Runner runner;
+        runner.setOptions(commandLine.options);
+        runner.setContext("timestamp", currentTimestamp());
+#if defined(_MSC_VER)
+        runner.setContext("compiler", "MSVC " + std::to_string(_MSC_VER));
+#else
+        runner.setContext("compiler", __VERSION__);
+#endif
+#ifdef NDEBUG
+        runner.setContext("build", "release");
+#else
+        runner.setContext("build", "debug");
+#endif
+        runner.setContext("hardware_concurrency", std::to_string(std::thread::hardware_concurrency()));
+        // メインスレッドをジョブシステムに登録する
+        render::JobSystem::instance();
+
+        addGltfBenchmarks(runner, commandLine);
+        addDecodeBenchmarks(runner, commandLine);
+        addTransformBenchmarks(runner, commandLine);
+        addMorphBenchmarks(runner, commandLine);
+        addLodBenchmarks(runner, commandLine);
+        addGpuSceneBenchmarks(runner, commandLine);
+        addDrawListBenchmarks(runner, commandLine);
+        addSceneBvhBenchmarks(runner, commandLine);
+        addJobSystemBenchmarks(runner, commandLine);
+        addFrameBenchmark(runner, commandLine);
+        addFrameRingBenchmark(runner, commandLine);
+        addResidencyBenchmark(runner, commandLine);
+        addOcclusionBenchmark(runner, commandLine);
+        addVertexPullingBenchmark(runner, commandLine);
+        addDepthOnlyBenchmark(runner, commandLine);
+        addShadowBenchmark(runner, commandLine);
+        addLightBenchmark(runner, commandLine);
+        addDynamicResolutionBenchmark(runner, commandLine);
+        addTransparencyBenchmark(runner, commandLine);
+
+        runner.printSummary(std::cout);
+        std::ofstream json(commandLine.jsonPath);
+        runner.writeJson(json);
+        if (!json) {
+            throw std::runtime_error("結果の書き込みに失敗しました: " + commandLine.jsonPath);
+        }
+        std::cout << "結果: " << commandLine.jsonPath << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "エラーが発生しました: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+#include "syntheticGltf.hpp"
+
+namespace bench {
+
+namespace {
+
+constexpr int kComponentByte = 5120;
+constexpr int kComponentUnsignedShort = 5123;
+constexpr int kComponentUnsignedInt = 5125;
+constexpr int kComponentFloat = 5126;
+
+// バイナリバッファとbufferView/accessorの記述をまとめて組み立てる
+class GltfBuilder {
+    public:
+        template <typename T>
+        uint32_t addAccessor(const std::vector<T>& data, int componentType, const char* type, size_t count, uint32_t byteStride, bool normalized, const std::string& bounds = "") {
+            while (binary.size() % 4 != 0) {
+                binary.push_back(0);
+            }
+            size_t byteOffset = binary.size();
+            size_t byteLength = data.size() * sizeof(T);
+            binary.resize(byteOffset + byteLength);
+            std::memcpy(binary.data() + byteOffset, data.data(), byteLength);
+
+            std::ostringstream view;
+            view << "{\"buffer\":0,\"byteOffset\":" << byteOffset << ",\"byteLength\":" << byteLength;
+            if (byteStride != 0) {
+                view << ",\"byteStride\":" << byteStride;
+            }
+            view << "}";
+            bufferViews.push_back(view.str());
+
+            std::ostringstream accessor;
+            accessor << "{\"bufferView\":" << bufferViews.size() - 1 << ",\"componentType\":" << componentType
+                     << ",\"count\":" << count << ",\"type\":\"" << type << "\"";
+            if (normalized) {
+                accessor << ",\"normalized\":true";
+            }
+            accessor << bounds << "}";
+            accessors.push_back(accessor.str());
+            return static_cast<uint32_t>(accessors.size() - 1);
+        }
+
+        std::vector<unsigned char> binary;
+        std::vector<std::string> bufferViews;
+        std::vector<std::string> accessors;
+};
+
+std::string joinJson(const std::vector<std::string>& items) {
+    std::string joined;
+    for (size_t i = 0; i < items.size(); i++) {
+        joined += (i ? "," : "") + items[i];
+    }
+    return joined;
+}
+
+} // namespace
+
+std::filesystem::path writeSyntheticGltf(const std::filesystem::path& directory, const std::string& name, const SyntheticGltfParams& params) {
+    GltfBuilder builder;
+    std::vector<std::string> meshes;
+    std::vector<std::string> materials;
+    const uint32_t side = params.gridSize + 1;
+    const size_t vertexCount = static_cast<size_t>(side) * side;
+
+    for (uint32_t meshIndex = 0; meshIndex < params.meshCount; meshIndex++) {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texCoords;
+        std::vector<int8_t> quantizedNormals;
+        std::vector<uint16_t> quantizedTexCoords;
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+
+        for (uint32_t y = 0; y < side; y++) {
+            for (uint32_t x = 0; x < side; x++) {
+                float u = static_cast<float>(x) / params.gridSize;
+                float v = static_cast<float>(y) / params.gridSize;
+                // メッシュごとに波の位相を変えて内容を区別する
+                float height = 0.05f * std::sin(u * 12.0f + meshIndex) * std::cos(v * 9.0f);
+                glm::vec3 position(u - 0.5f, height, v - 0.5f);
+                glm::vec3 normal = glm::normalize(glm::vec3(-0.6f * std::cos(u * 12.0f + meshIndex) * std::cos(v * 9.0f), 1.0f, 0.45f * std::sin(u * 12.0f + meshIndex) * std::sin(v * 9.0f)));
+                if (params.standing) {
+                    // z軸まわりに90度回転する（巻き順は変わらない）
+                    position = glm::vec3(-position.y, position.x, position.z);
+                    normal = glm::vec3(-normal.y, normal.x, normal.z);
+                }
+                positions.insert(positions.end(), {position.x, position.y, position.z});
+                boundsMin = glm::min(boundsMin, position);
+                boundsMax = glm::max(boundsMax, position);
+
+                if (params.quantized) {
+                    quantizedNormals.insert(quantizedNormals.end(), {
+                        static_cast<int8_t>(std::lround(normal.x * 127.0f)),
+                        static_cast<int8_t>(std::lround(normal.y * 127.0f)),
+                        static_cast<int8_t>(std::lround(normal.z * 127.0f)),
+                        0
+                    });
+                    quantizedTexCoords.insert(quantizedTexCoords.end(), {
+                        static_cast<uint16_t>(std::lround(u * 65535.0f)),
+                        static_cast<uint16_t>(std::lround(v * 65535.0f))
+                    });
+                } else {
+                    normals.insert(normals.end(), {normal.x, normal.y, normal.z});
+                    texCoords.insert(texCoords.end(), {u, v});
+                }
+            }
+        }
+
+        std::ostringstream bounds;
+        bounds << ",\"min\":[" << boundsMin.x << "," << boundsMin.y << "," << boundsMin.z << "]"
+               << ",\"max\":[" << boundsMax.x << "," << boundsMax.y << "," << boundsMax.z << "]";
+        uint32_t positionAccessor = builder.addAccessor(positions, kComponentFloat, "VEC3", vertexCount, 0, false, bounds.str());
+        uint32_t normalAccessor = params.quantized
+            ? builder.addAccessor(quantizedNormals, kComponentByte, "VEC3", vertexCount, 4, true)
+            : builder.addAccessor(normals, kComponentFloat, "VEC3", vertexCount, 0, false);
+        uint32_t texCoordAccessor = params.quantized
+            ? builder.addAccessor(quantizedTexCoords, kComponentUnsignedShort, "VEC2", vertexCount, 0, true)
+            : builder.addAccessor(texCoords, kComponentFloat, "VEC2", vertexCount, 0, false);
+
+        std::vector<uint32_t> indices;
+        for (uint32_t y = 0; y < params.gridSize; y++) {
+            for (uint32_t x = 0; x < params.gridSize; x++) {
+                uint32_t a = y * side + x;
+                indices.insert(indices.end(), {a, a + side, a + 1, a + 1, a + side, a + side + 1});
+            }
+        }
+        uint32_t indexAccessor;
+        if (vertexCount <= 65535) {
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            indexAccessor = builder.addAccessor(shortIndices, kComponentUnsignedShort, "SCALAR", indices.size(), 0, false);
+        } else {
+            indexAccessor = builder.addAccessor(indices, kComponentUnsignedInt, "SCALAR", indices.size(), 0, false);
+        }
+
+        // モーフターゲットは全頂点分の差分を持つ（動かない頂点は0。読み込み時に疎な形へ詰める）
+        // ターゲットtは格子上の点を中心とした半径 gridSize / 8 の範囲を法線方向へ盛り上げる
+        std::vector<uint32_t> targetAccessors;
+        std::vector<float> weights;
+        for (uint32_t t = 0; t < params.morphTargets; t++) {
+            float centerX = static_cast<float>((t * 7 + 3) % side);
+            float centerY = static_cast<float>((t * 13 + 5) % side);
+            float radius = std::max(params.gridSize / 8.0f, 1.0f);
+            std::vector<float> deltas(vertexCount * 3, 0.0f);
+            for (uint32_t y = 0; y < side; y++) {
+                for (uint32_t x = 0; x < side; x++) {
+                    float distance = glm::length(glm::vec2(x - centerX, y - centerY));
+                    if (distance >= radius) {
+                        continue;
+                    }
+                    glm::vec3 delta(0.0f, 0.1f * (1.0f - distance / radius), 0.0f);
+                    if (params.standing) {
+                        delta = glm::vec3(-delta.y, delta.x, delta.z);
+                    }
+                    size_t vertex = static_cast<size_t>(y) * side + x;
+                    deltas[vertex * 3] = delta.x;
+                    deltas[vertex * 3 + 1] = delta.y;
+                    deltas[vertex * 3 + 2] = delta.z;
+                }
+            }
+            targetAccessors.push_back(builder.addAccessor(deltas, kComponentFloat, "VEC3", vertexCount, 0, false));
+            weights.push_back(t % 8 == 0 ? 0.5f : 0.0f);
+        }
+
+        std::ostringstream mesh;
+        mesh << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << positionAccessor << ",\"NORMAL\":" << normalAccessor
+             << ",\"TEXCOORD_0\":" << texCoordAccessor << "},\"indices\":" << indexAccessor;
+        if (meshIndex < params.transparentMeshes) {
+            float hue = static_cast<float>(meshIndex) / params.transparentMeshes;
+            std::ostringstream material;
+            material << "{\"alphaMode\":\"BLEND\",\"pbrMetallicRoughness\":{\"baseColorFactor\":["
+                     << 0.5f + 0.5f * std::cos(6.2831853f * hue) << "," << 0.5f + 0.5f * std::cos(6.2831853f * (hue - 0.333f)) << ","
+                     << 0.5f + 0.5f * std::cos(6.2831853f * (hue - 0.667f)) << ",0.4],\"metallicFactor\":0,\"roughnessFactor\":0.5}}";
+            materials.push_back(material.str());
+            mesh << ",\"material\":" << materials.size() - 1;
+        }
+        if (!targetAccessors.empty()) {
+            mesh << ",\"targets\":[";
+            for (size_t t = 0; t < targetAccessors.size(); t++) {
+                mesh << (t ? "," : "") << "{\"POSITION\":" << targetAccessors[t] << "}";
+            }
+            mesh << "]";
+        }
+        mesh << "}]";
+        if (!weights.empty()) {
+            mesh << ",\"weights\":[";
+            for (size_t t = 0; t < weights.size(); t++) {
+                mesh << (t ? "," : "") << weights[t];
+            }
+            mesh << "]";
+        }
+        mesh << "}";
+        meshes.push_back(mesh.str());
+    }
+
+    // branching分木（ノードiの親は (i - 1) / branching）
+    std::vector<std::vector<uint32_t>> children(params.nodeCount);
+    for (uint32_t i = 1; i < params.nodeCount; i++) {
+        children[(i - 1) / params.branching].push_back(i);
+    }
+    std::vector<std::string> nodes;
+    for (uint32_t i = 0; i < params.nodeCount; i++) {
+        std::ostringstream node;
+        node << "{\"mesh\":" << i % params.meshCount;
+        if (params.rowSpacing > 0.0f) {
+            node << ",\"translation\":[" << i * params.rowSpacing << ",0,0]";
+        } else {
+            node << ",\"translation\":[" << (i % 7) * 0.5f << "," << (i % 3) * 0.1f << "," << (i % 5) * 0.5f << "]"
+                 << ",\"rotation\":[0,0.0998334,0,0.9950042]";
+        }
+        if (!children[i].empty()) {
+            node << ",\"children\":[";
+            for (size_t c = 0; c < children[i].size(); c++) {
+                node << (c ? "," : "") << children[i][c];
+            }
+            node << "]";
+        }
+        node << "}";
+        nodes.push_back(node.str());
+    }
+
+    std::filesystem::create_directories(directory);
+    std::filesystem::path gltfPath = directory / (name + ".gltf");
+    std::filesystem::path binaryPath = directory / (name + ".bin");
+
+    std::ofstream binaryFile(binaryPath, std::ios::binary);
+    binaryFile.write(reinterpret_cast<const char*>(builder.binary.data()), static_cast<std::streamsize>(builder.binary.size()));
+    if (!binaryFile) {
+        throw std::runtime_error("ベンチマーク用バッファの書き込みに失敗しました: " + binaryPath.string());
+    }
+
+    std::string materialsJson = materials.empty() ? "" : "\"materials\":[" + joinJson(materials) + "],";
+    std::ofstream gltfFile(gltfPath);
+    gltfFile << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"vkrenderkit_bench\"},"
+             << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+             << "\"nodes\":[" << joinJson(nodes) << "],"
+             << "\"meshes\":[" << joinJson(meshes) << "],"
+             << materialsJson
+             << "\"buffers\":[{\"uri\":\"" << binaryPath.filename().string() << "\",\"byteLength\":" << builder.binary.size() << "}],"
+             << "\"bufferViews\":[" << joinJson(builder.bufferViews) << "],"
+             << "\"accessors\":[" << joinJson(builder.accessors) << "]}";
+    if (!gltfFile) {
+        throw std::runtime_error("ベンチマーク用glTFの書き込みに失敗しました: " + gltfPath.string());
+    }
+    return gltfPath;
+}
+
+}
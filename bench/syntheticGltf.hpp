@@ -0,0 +1,24 @@
+#pragma once
+#include "header.hpp"
+
+namespace bench {
+
+// ベンチマーク用に生成するglTFの構成
+// 各メッシュは gridSize × gridSize の格子（メッシュごとに高さを変えて内容を区別する）
+// ノードは branching 分木で、ノードiはメッシュ i % meshCount を参照する
+struct SyntheticGltfParams {
+    uint32_t meshCount = 1;
+    uint32_t gridSize = 32;
+    uint32_t nodeCount = 1;
+    uint32_t branching = 4;
+    bool quantized = false;//法線をint8、UVをuint16の正規化整数で格納する（KHR_mesh_quantization相当）
+    float rowSpacing = 0.0f;//0より大きければ回転を付けず、ノードiを親からx方向に i × rowSpacing だけ離す
+    bool standing = false;//格子をyz平面に立てて表面を-x方向へ向ける（rowSpacingと合わせると奥へ並ぶ壁になる）
+    uint32_t morphTargets = 0;//各メッシュのモーフターゲット数（ターゲットごとに格子の一部を盛り上げる。8個に1個だけ既定の重みを持つ）
+    uint32_t transparentMeshes = 0;//先頭からこの数のメッシュに半透明（BLEND、メッシュごとに色を変えたα0.4）のマテリアルを付ける
+};
+
+// .gltfと同名の.binを書き出し、.gltfのパスを返す
+std::filesystem::path writeSyntheticGltf(const std::filesystem::path& directory, const std::string& name, const SyntheticGltfParams& params);
+
+}
@@ -0,0 +1,90 @@
+#include "allocationCounter.hpp"
+
+#ifdef VKRENDERKIT_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+
+void* countedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* countedAllocateAligned(size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+#ifdef _MSC_VER
+    void* pointer = _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    void* pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+#endif
+    if (pointer) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void freeAligned(void* pointer) {
+#ifdef _MSC_VER
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+}
+
+// 配列版・nothrow版は標準ライブラリの既定の実装がこれらを呼ぶ
+void* operator new(size_t size) {
+    return countedAllocate(size);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAllocateAligned(size, alignment);
+}
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    freeAligned(pointer);
+}
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    freeAligned(pointer);
+}
+
+namespace render {
+
+bool isAllocationCountingEnabled() {
+    return true;
+}
+
+uint64_t getAllocationCount() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+}
+
+#else
+
+namespace render {
+
+bool isAllocationCountingEnabled() {
+    return false;
+}
+
+uint64_t getAllocationCount() {
+    return 0;
+}
+
+}
+
+#endif
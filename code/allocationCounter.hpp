@@ -0,0 +1,11 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// グローバルなoperator newの呼び出し回数
+// VKRENDERKIT_COUNT_ALLOCATIONSを定義してビルドした場合のみ計測し、それ以外は常に0を返す
+bool isAllocationCountingEnabled();
+uint64_t getAllocationCount();
+
+}
@@ -1,26 +1,358 @@
-#pragma once
-#include "vulkanContext.hpp"
-#include "geometry.hpp"
-//#include "pipelineBuilder.hpp"
-
-class Application {
-
-    public:
-        void run() {
-            geometry::Model fox;
-            fox.readGLTF("./Resource/Fox.glb");
-            geometry::Model damagedHelmet;
-            damagedHelmet.readGLTF("./Resource/DamagedHelmet.glb");
-
-            vulkanContext.initWindow(800, 600);
-            vulkanContext.initVulkan();
-            while(!vulkanContext.windowShouldClose()) {
-                glfwPollEvents();
-                vulkanContext.draw();
-            }
-            vulkanContext.cleanup();
-        }
-
-    private:
-        VulkanContext vulkanContext;
+#pragma once
+#include "vulkanContext.hpp"
+#include "geometry.hpp"
+#include "drawList.hpp"
+#include "profiler.hpp"
+//#include "pipelineBuilder.hpp"
+
+class Application {
+
+    public:
+        struct Options {
+            bool statisticsOutput = false;//120フレームごとの統計と選択結果を標準出力へ出す（--stats）
+        };
+
+        explicit Application(const Options& options = {}) : options(options) {}
+
+        void run() {
+            // 起動（読み込み〜デバイス初期化）のタイムラインを記録する
+            render::profiler::setThreadName("main");
+            render::profiler::setEnabled(true);
+
+            geometry::Model fox;
+            fox.readGLTF("./Resource/Fox.glb");
+            geometry::Model damagedHelmet;
+            damagedHelmet.readGLTF("./Resource/DamagedHelmet.glb");
+
+            vulkanContext.initWindow(800, 600);
+            vulkanContext.initVulkan();
+            vulkanContext.setStatisticsOutput(options.statisticsOutput);
+            vulkanContext.loadModels({&fox, &damagedHelmet}, 0);
+            writeTrace("trace_startup.json");
+
+            // メインスレッドは入力のみを扱い、更新と描画は別スレッドで回す
+            // 更新スレッドが作ったスナップショットを、描画スレッドが三重バッファから最新のものだけ取り出す
+            input.aspectRatio = vulkanContext.getAspectRatio();
+            input.meshletCulling = vulkanContext.getMeshletCulling();
+            input.occlusionCulling = vulkanContext.getOcclusionCulling();
+            input.vertexPulling = vulkanContext.getVertexPulling();
+            input.shadowCaching = vulkanContext.getShadowCaching();
+            input.clusteredLighting = vulkanContext.getClusteredLighting();
+            input.dynamicResolution = vulkanContext.getDynamicResolution();
+            input.orderIndependentTransparency = vulkanContext.getOrderIndependentTransparency();
+            input.framePacing = vulkanContext.getFramePacing();
+            input.frameArena = vulkanContext.getFrameArena();
+            input.presentPolicy = vulkanContext.getPresentPolicy();
+            std::thread simulationThread(&Application::runFrameThread, this, &Application::simulationLoop);
+            std::thread renderThread(&Application::runFrameThread, this, &Application::renderLoop);
+
+            auto keyPressed = [&](int key, bool& keyDown) {
+                bool pressed = vulkanContext.isKeyPressed(key);
+                bool edge = pressed && !keyDown;
+                keyDown = pressed;
+                return edge;
+            };
+            bool cullKeyDown = false;
+            bool occlusionKeyDown = false;
+            bool pullKeyDown = false;
+            bool shadowKeyDown = false;
+            bool lightKeyDown = false;
+            bool resolutionKeyDown = false;
+            bool transparencyKeyDown = false;
+            bool presentKeyDown = false;
+            bool pacingKeyDown = false;
+            bool arenaKeyDown = false;
+            bool pickButtonDown = false;
+            bool traceKeyDown = false;
+            while (!vulkanContext.windowShouldClose() && !stopFrameThreads.load()) {
+                vulkanContext.waitEvents(0.005);
+
+                float aspectRatio = vulkanContext.getFramebufferAspectRatio();
+                bool pickButton = vulkanContext.isMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT);
+                glm::vec2 cursor;
+                bool pick = pickButton && !pickButtonDown && vulkanContext.getCursorPosition(cursor);
+                pickButtonDown = pickButton;
+
+                std::lock_guard<std::mutex> lock(inputMutex);
+                // リサイズに合わせてアスペクト比を更新（最小化中は前の値のまま）
+                if (aspectRatio > 0.0f) {
+                    input.aspectRatio = aspectRatio;
+                }
+
+                // Cキーでメッシュレットカリングを切り替え（GPU時間の比較用）
+                if (keyPressed(GLFW_KEY_C, cullKeyDown)) {
+                    input.meshletCulling = !input.meshletCulling;
+                }
+                // Oキーで遮蔽カリングを切り替え（Cキーのカリングが有効なときのみ効く）
+                if (keyPressed(GLFW_KEY_O, occlusionKeyDown)) {
+                    input.occlusionCulling = !input.occlusionCulling;
+                }
+                // Vキーで頂点プルと固定機能の頂点入力を切り替え（間接描画の経路のみ）
+                if (keyPressed(GLFW_KEY_V, pullKeyDown)) {
+                    input.vertexPulling = !input.vertexPulling;
+                }
+                // Hキーで影のページのキャッシュを切り替え（影の描画数・GPU時間の比較用）
+                if (keyPressed(GLFW_KEY_H, shadowKeyDown)) {
+                    input.shadowCaching = !input.shadowCaching;
+                }
+                // Lキーでクラスタライティングを切り替え（無効なら平行光源のみ）
+                if (keyPressed(GLFW_KEY_L, lightKeyDown)) {
+                    input.clusteredLighting = !input.clusteredLighting;
+                }
+                // Rキーで動的解像度を切り替え（GPU時間が目標を超えないよう描画の大きさを変える）
+                if (keyPressed(GLFW_KEY_R, resolutionKeyDown)) {
+                    input.dynamicResolution = !input.dynamicResolution;
+                }
+                // Bキーで半透明の描き方を切り替え（ソートと重み付きOITのCPU・GPU時間の比較用）
+                if (keyPressed(GLFW_KEY_B, transparencyKeyDown)) {
+                    input.orderIndependentTransparency = !input.orderIndependentTransparency;
+                }
+                // Pキーで表示方式、Fキーでフレームペーシングを切り替え（遅延の比較用）
+                if (keyPressed(GLFW_KEY_P, presentKeyDown)) {
+                    size_t next = (static_cast<size_t>(input.presentPolicy) + 1) % static_cast<size_t>(render::PresentPolicy::Count);
+                    input.presentPolicy = static_cast<render::PresentPolicy>(next);
+                }
+                if (keyPressed(GLFW_KEY_F, pacingKeyDown)) {
+                    input.framePacing = !input.framePacing;
+                }
+                // Mキーでフレームアリーナを切り替え（フレームあたりの確保回数の比較用）
+                if (keyPressed(GLFW_KEY_M, arenaKeyDown)) {
+                    input.frameArena = !input.frameArena;
+                }
+                // 左クリックでカーソル下の描画レコードを選択（判定は更新スレッドのカメラで行う）
+                if (pick) {
+                    input.pickRequest++;
+                    input.pickCursor = cursor;
+                }
+                // Tキーで続く120フレームのタイムラインを記録
+                if (keyPressed(GLFW_KEY_T, traceKeyDown)) {
+                    input.traceRequest++;
+                }
+            }
+
+            stopFrameThreads = true;
+            simulationThread.join();
+            renderThread.join();
+            vulkanContext.cleanup();
+            if (frameThreadError) {
+                std::rethrow_exception(frameThreadError);
+            }
+        }
+
+    private:
+        Options options;
+        VulkanContext vulkanContext;
+
+        // 更新スレッドの刻み（描画より速く回し、描画スレッドは表示直前に最新のものを取り出す）
+        static constexpr std::chrono::microseconds kSimulationStep{8333};
+        // 狐（最初のモデル）をその場で回す速さ（ラジアン/秒）
+        static constexpr float kSpinSpeed = 0.5f;
+
+        // メインスレッドで取得した入力（切り替えは押した回数ではなく状態で渡す）
+        struct InputState {
+            float aspectRatio = 1.0f;
+            bool meshletCulling = true;
+            bool occlusionCulling = true;
+            bool vertexPulling = false;
+            bool shadowCaching = true;
+            bool clusteredLighting = true;
+            bool dynamicResolution = false;
+            bool orderIndependentTransparency = false;
+            bool framePacing = true;
+            bool frameArena = true;
+            render::PresentPolicy presentPolicy = render::PresentPolicy::LowLatency;
+            uint32_t traceRequest = 0;
+            uint32_t pickRequest = 0;//左クリックのたびに増える
+            glm::vec2 pickCursor = glm::vec2(0.0f);
+        };
+        std::mutex inputMutex;
+        InputState input;
+
+        render::TripleBuffer<render::SceneSnapshot> snapshots;
+        std::atomic<bool> stopFrameThreads{false};
+        std::exception_ptr frameThreadError;//最初に失敗したスレッドの例外（メインスレッドで投げ直す）
+        std::mutex frameThreadErrorMutex;
+
+        void runFrameThread(void (Application::*loop)()) {
+            try {
+                (this->*loop)();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(frameThreadErrorMutex);
+                if (!frameThreadError) {
+                    frameThreadError = std::current_exception();
+                }
+            }
+            stopFrameThreads = true;
+        }
+
+        // 一定の刻みで入力を取り込み、カメラ・可視判定・描画リストのソートを済ませたスナップショットを公開する
+        void simulationLoop() {
+            render::profiler::setThreadName("simulation");
+            // 描画のフレームアリーナとは解放の時期が違うため、専用のアリーナを使う
+            render::LinearArena arena;
+            glm::vec3 cameraPosition(0.0f, 1.0f, 4.0f);
+            uint32_t pickRequestHandled = 0;
+            uint64_t sequence = 0;
+
+            auto nextStep = std::chrono::steady_clock::now();
+            while (!stopFrameThreads.load()) {
+                PROFILE_ZONE("simulation");
+                InputState sampled;
+                {
+                    std::lock_guard<std::mutex> lock(inputMutex);
+                    sampled = input;
+                }
+                render::SceneSnapshot& snapshot = snapshots.getWriteBuffer();
+                snapshot.sampledAt = std::chrono::steady_clock::now();
+
+                // カメラの設定（Vulkanのクリップ空間に合わせてYを反転）
+                glm::mat4 projection = glm::perspective(glm::radians(60.0f), sampled.aspectRatio, 0.1f, 1000.0f);
+                projection[1][1] *= -1.0f;
+                snapshot.viewMatrix = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                snapshot.projectionMatrix = projection;
+                snapshot.cameraPosition = cameraPosition;
+
+                arena.reset();
+                vulkanContext.buildSnapshot(snapshot, &arena);
+                float seconds = std::chrono::duration<float>(kSimulationStep * sequence).count();
+                vulkanContext.spinModel(seconds * kSpinSpeed, snapshot);
+
+                snapshot.meshletCulling = sampled.meshletCulling;
+                snapshot.occlusionCulling = sampled.occlusionCulling;
+                snapshot.vertexPulling = sampled.vertexPulling;
+                snapshot.shadowCaching = sampled.shadowCaching;
+                snapshot.clusteredLighting = sampled.clusteredLighting;
+                snapshot.dynamicResolution = sampled.dynamicResolution;
+                snapshot.orderIndependentTransparency = sampled.orderIndependentTransparency;
+                snapshot.framePacing = sampled.framePacing;
+                snapshot.frameArena = sampled.frameArena;
+                snapshot.presentPolicy = sampled.presentPolicy;
+                snapshot.traceRequest = sampled.traceRequest;
+
+                if (sampled.pickRequest != pickRequestHandled) {
+                    pickRequestHandled = sampled.pickRequest;
+                    // 選択結果は出力するときだけ求める
+                    if (options.statisticsOutput) {
+                        float distance;
+                        uint32_t picked = vulkanContext.pickDrawRecord(sampled.pickCursor, snapshot.projectionMatrix * snapshot.viewMatrix, distance);
+                        if (picked != UINT32_MAX) {
+                            const render::DrawRecord& record = vulkanContext.getDrawRecord(picked);
+                            std::cout << "選択: 描画レコード " << picked << " (マテリアル " << record.materialIndex
+                                      << ", パイプライン " << record.pipelineIndex << ", 距離 " << distance << ")" << std::endl;
+                        } else {
+                            std::cout << "選択: なし" << std::endl;
+                        }
+                    }
+                }
+
+                snapshot.sequence = ++sequence;
+                snapshots.publish();
+
+                // 遅れた場合は追いつこうとせず、次の刻みから数え直す
+                nextStep += kSimulationStep;
+                auto now = std::chrono::steady_clock::now();
+                if (nextStep < now) {
+                    nextStep = now;
+                }
+                std::this_thread::sleep_until(nextStep);
+            }
+        }
+
+        // 最新のスナップショットを取り出して描画する（Vulkanの呼び出しはこのスレッドのみ）
+        void renderLoop() {
+            render::profiler::setThreadName("render");
+            uint32_t traceRequestHandled = 0;
+            uint32_t traceFramesLeft = 0;
+
+            // スナップショットの入力から表示までの遅延と、読まれずに破棄された数・同じものを描き直した数
+            uint64_t lastSequence = 0;
+            uint64_t droppedBefore = snapshots.getDroppedCount();
+            uint32_t frames = 0;
+            uint32_t repeatedFrames = 0;
+            double totalLatency = 0.0;
+            double maxLatency = 0.0;
+
+            while (!stopFrameThreads.load()) {
+                vulkanContext.waitForNextFrame();
+                snapshots.acquire();
+                const render::SceneSnapshot& snapshot = snapshots.getReadBuffer();
+                if (snapshot.sequence == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+
+                // 設定は値が変わったときだけ反映する（表示方式・ペーシングの変更は予測をやり直すため）
+                if (snapshot.meshletCulling != vulkanContext.getMeshletCulling()) {
+                    vulkanContext.setMeshletCulling(snapshot.meshletCulling);
+                }
+                if (snapshot.occlusionCulling != vulkanContext.getOcclusionCulling()) {
+                    vulkanContext.setOcclusionCulling(snapshot.occlusionCulling);
+                }
+                if (snapshot.vertexPulling != vulkanContext.getVertexPulling()) {
+                    vulkanContext.setVertexPulling(snapshot.vertexPulling);
+                }
+                if (snapshot.shadowCaching != vulkanContext.getShadowCaching()) {
+                    vulkanContext.setShadowCaching(snapshot.shadowCaching);
+                }
+                if (snapshot.clusteredLighting != vulkanContext.getClusteredLighting()) {
+                    vulkanContext.setClusteredLighting(snapshot.clusteredLighting);
+                }
+                if (snapshot.dynamicResolution != vulkanContext.getDynamicResolution()) {
+                    vulkanContext.setDynamicResolution(snapshot.dynamicResolution);
+                }
+                if (snapshot.orderIndependentTransparency != vulkanContext.getOrderIndependentTransparency()) {
+                    vulkanContext.setOrderIndependentTransparency(snapshot.orderIndependentTransparency);
+                }
+                if (snapshot.presentPolicy != vulkanContext.getPresentPolicy()) {
+                    vulkanContext.setPresentPolicy(snapshot.presentPolicy);
+                }
+                if (snapshot.framePacing != vulkanContext.getFramePacing()) {
+                    vulkanContext.setFramePacing(snapshot.framePacing);
+                }
+                if (snapshot.frameArena != vulkanContext.getFrameArena()) {
+                    vulkanContext.setFrameArena(snapshot.frameArena);
+                }
+                if (snapshot.traceRequest != traceRequestHandled) {
+                    traceRequestHandled = snapshot.traceRequest;
+                    if (traceFramesLeft == 0) {
+                        render::profiler::clear();
+                        render::profiler::setEnabled(true);
+                        traceFramesLeft = 120;
+                    }
+                }
+
+                vulkanContext.draw(snapshot);
+
+                double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - snapshot.sampledAt).count();
+                totalLatency += latency;
+                maxLatency = std::max(maxLatency, latency);
+                repeatedFrames += snapshot.sequence == lastSequence ? 1 : 0;
+                lastSequence = snapshot.sequence;
+                if (++frames == 120) {
+                    uint64_t dropped = snapshots.getDroppedCount();
+                    if (options.statisticsOutput) {
+                        std::cout << "スナップショット: 入力から表示まで 平均 " << totalLatency / frames << " ms, 最大 " << maxLatency << " ms, "
+                                  << "破棄 " << dropped - droppedBefore << " 件, 描き直し " << repeatedFrames << " フレーム" << std::endl;
+                    }
+                    droppedBefore = dropped;
+                    frames = 0;
+                    repeatedFrames = 0;
+                    totalLatency = 0.0;
+                    maxLatency = 0.0;
+                }
+
+                if (traceFramesLeft > 0 && --traceFramesLeft == 0) {
+                    writeTrace("trace_frames.json");
+                }
+            }
+        }
+
+        // 書き出し後は記録を止めて破棄する
+        void writeTrace(const std::string& path) {
+            render::profiler::setEnabled(false);
+            size_t zoneCount = render::profiler::getZoneCount();
+            render::profiler::writeChromeTrace(path);
+            render::profiler::clear();
+            std::cout << "トレース: " << path << " (" << zoneCount << " ゾーン, Perfettoで開く)" << std::endl;
+        }
 };
\ No newline at end of file
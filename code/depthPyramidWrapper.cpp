@@ -0,0 +1,244 @@
+#include "vulkanContext.hpp"
+
+namespace {
+
+// シェーダ側（shader/depthPyramid.comp）と同じレイアウト
+struct PyramidParams {
+    glm::uvec2 depthSize;
+    uint32_t levelCount;
+    uint32_t pad0;
+};
+
+constexpr uint32_t kGroupTexels = 32;//1ワークグループが作るミップ0のテクセル（一辺）
+
+} // namespace
+
+//階層Zの生成パイプラインを作成し、深度バッファと階層Zを作る
+//対応していないデバイスでは階層Zを1テクセルにする（カリングのディスクリプタを埋めるためだけに使う）
+void VulkanContext::DeviceWrapper::DepthPyramidWrapper::initDepthPyramid(vk::Extent2D extent) {
+    PROFILE_ZONE("initDepthPyramid");
+    supported = deviceWrapper.context.capabilities.depthPyramid;
+
+    // texelFetchで読むため補間はしない
+    vk::SamplerCreateInfo samplerCreateInfo(
+        {},//flags
+        vk::Filter::eNearest,//magFilter
+        vk::Filter::eNearest,//minFilter
+        vk::SamplerMipmapMode::eNearest,//mipmapMode
+        vk::SamplerAddressMode::eClampToEdge,//addressModeU
+        vk::SamplerAddressMode::eClampToEdge,//addressModeV
+        vk::SamplerAddressMode::eClampToEdge,//addressModeW
+        0.0f,//mipLodBias
+        VK_FALSE,//anisotropyEnable
+        1.0f,//maxAnisotropy
+        VK_FALSE,//compareEnable
+        vk::CompareOp::eAlways,//compareOp
+        0.0f,//minLod
+        VK_LOD_CLAMP_NONE//maxLod
+    );
+    sampler = deviceWrapper.device->createSamplerUnique(samplerCreateInfo);
+
+    if (supported) {
+        counterBuffer = deviceWrapper.createBuffer(sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        std::memset(counterBuffer.mapped, 0, sizeof(uint32_t));
+
+        // binding 0: 深度, 1: ミップごとのストレージイメージ, 2: 終わったワークグループの数
+        std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+            vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute),
+            vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, kMaxLevels, vk::ShaderStageFlagBits::eCompute),
+            vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+        };
+        descriptorSetLayout = deviceWrapper.device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+
+        std::vector<vk::DescriptorPoolSize> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, kMaxLevels),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1)
+        };
+        descriptorPool = deviceWrapper.device->createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, 1, poolSizes));
+        descriptorSet = deviceWrapper.device->allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), 1, &descriptorSetLayout.get())).front();
+
+        vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PyramidParams));
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+            {},//flags
+            1,//setLayoutCount
+            &descriptorSetLayout.get(),//pSetLayouts
+            1,//pushConstantRangeCount
+            &pushConstantRange//pPushConstantRanges
+        );
+        pipelineLayout = deviceWrapper.device->createPipelineLayoutUnique(pipelineLayoutInfo);
+
+        vk::UniqueShaderModule shaderModule = deviceWrapper.pipelineWrapper.initShaderModule("./shader/compiled/depthPyramid.comp.spv");
+        vk::ComputePipelineCreateInfo computeCreateInfo(
+            {},//flags
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModule.get(), "main"),//stage
+            pipelineLayout.get()//layout
+        );
+        pipeline = deviceWrapper.device->createComputePipelineUnique(VK_NULL_HANDLE, computeCreateInfo).value;
+    }
+    createImages(extent);
+}
+
+bool VulkanContext::DeviceWrapper::DepthPyramidWrapper::resize(vk::Extent2D extent) {
+    if (extent == depthImage.extent) {
+        return false;
+    }
+    createImages(extent);
+    return true;
+}
+
+void VulkanContext::DeviceWrapper::DepthPyramidWrapper::setRenderExtent(vk::Extent2D extent) {
+    renderExtent = vk::Extent2D(std::min(extent.width, depthImage.extent.width), std::min(extent.height, depthImage.extent.height));
+}
+
+//ミップ0は深度の半分（切り上げ）を2のべき乗に切り上げた大きさにする
+//各ミップはちょうど半分になるため、テクセルが覆う深度のピクセルは 2^(level+1) 四方に揃う
+//有効なのは深度の範囲に掛かるテクセルのみで、シェーダは範囲外を読まない
+void VulkanContext::DeviceWrapper::DepthPyramidWrapper::createImages(vk::Extent2D extent) {
+    // 古いビューを先に破棄する
+    levelViews.clear();
+    vk::ImageUsageFlags depthUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    if (supported) {
+        depthUsage |= vk::ImageUsageFlagBits::eSampled;
+    }
+    depthImage = deviceWrapper.createImage(extent, 1, kDepthFormat, depthUsage, vk::ImageAspectFlagBits::eDepth);
+    renderExtent = extent;
+
+    uint32_t largest = std::max(extent.width, extent.height);
+    uint32_t levelCount = supported ? std::clamp<uint32_t>(std::bit_width(largest - 1), 1, kMaxLevels) : 1;
+    vk::Extent2D pyramidExtent = supported ? vk::Extent2D(std::bit_ceil((extent.width + 1) / 2), std::bit_ceil((extent.height + 1) / 2)) : vk::Extent2D(1, 1);
+    pyramidImage = deviceWrapper.createImage(pyramidExtent, levelCount, vk::Format::eR32Sfloat, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled, vk::ImageAspectFlagBits::eColor);
+    initPyramidLayout();
+    if (!supported) {
+        return;
+    }
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        vk::ImageViewCreateInfo imageViewCreateInfo(
+            {},
+            pyramidImage.image.get(),
+            vk::ImageViewType::e2D,
+            vk::Format::eR32Sfloat,
+            vk::ComponentMapping(),
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1)
+        );
+        levelViews.push_back(deviceWrapper.device->createImageViewUnique(imageViewCreateInfo));
+    }
+
+    // 使わない配列要素には最後のミップを入れておく
+    vk::DescriptorImageInfo depthInfo(sampler.get(), depthImage.view.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::vector<vk::DescriptorImageInfo> levelInfos;
+    for (uint32_t level = 0; level < kMaxLevels; level++) {
+        levelInfos.push_back(vk::DescriptorImageInfo({}, levelViews[std::min(level, levelCount - 1)].get(), vk::ImageLayout::eGeneral));
+    }
+    vk::DescriptorBufferInfo counterInfo(counterBuffer.buffer.get(), 0, VK_WHOLE_SIZE);
+    std::vector<vk::WriteDescriptorSet> writes = {
+        vk::WriteDescriptorSet(descriptorSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &depthInfo, nullptr),
+        vk::WriteDescriptorSet(descriptorSet, 1, 0, kMaxLevels, vk::DescriptorType::eStorageImage, levelInfos.data(), nullptr),
+        vk::WriteDescriptorSet(descriptorSet, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &counterInfo)
+    };
+    deviceWrapper.device->updateDescriptorSets(writes, {});
+}
+
+//階層ZはGENERALのまま使うため、作成時に1度だけ遷移させる
+//（カリングのディスクリプタから常に参照されるため、使う前でもレイアウトを合わせておく）
+void VulkanContext::DeviceWrapper::DepthPyramidWrapper::initPyramidLayout() {
+    CommandBufWrapper& commandBufWrapper = deviceWrapper.graphicsCommandBufWrapper;
+    vk::CommandBuffer commandBuffer = commandBufWrapper.getCommandBuffer();
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    vk::ImageMemoryBarrier barrier(
+        {},//srcAccessMask
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,//dstAccessMask
+        vk::ImageLayout::eUndefined,//oldLayout
+        vk::ImageLayout::eGeneral,//newLayout
+        VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+        pyramidImage.image.get(),//image
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, pyramidImage.mipLevels, 0, 1)//subresourceRange
+    );
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, barrier);
+    commandBuffer.end();
+    QueueWrapper::Submission submission;
+    submission.commandBuffers.push_back(commandBufWrapper.getCommandBufferSubmitInfo());
+    deviceWrapper.graphicsQueueWrapper.submit(std::move(submission));
+    deviceWrapper.graphicsQueueWrapper.waitIdle();
+}
+
+void VulkanContext::DeviceWrapper::DepthPyramidWrapper::build(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags consumerStages) {
+    vk::ImageSubresourceRange depthRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1);
+    vk::ImageSubresourceRange pyramidRange(vk::ImageAspectFlagBits::eColor, 0, pyramidImage.mipLevels, 0, 1);
+
+    // 深度を読める状態にする（前のフレームの読み込みは表示前の待機で終わっている）
+    std::array<vk::ImageMemoryBarrier, 2> beforeBarriers = {
+        vk::ImageMemoryBarrier(
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite,//srcAccessMask
+            vk::AccessFlagBits::eShaderRead,//dstAccessMask
+            vk::ImageLayout::eDepthAttachmentOptimal,//oldLayout
+            vk::ImageLayout::eShaderReadOnlyOptimal,//newLayout
+            VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+            depthImage.image.get(),//image
+            depthRange//subresourceRange
+        ),
+        vk::ImageMemoryBarrier(
+            {},//srcAccessMask
+            vk::AccessFlagBits::eShaderWrite,//dstAccessMask
+            vk::ImageLayout::eGeneral,//oldLayout
+            vk::ImageLayout::eGeneral,//newLayout
+            VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+            pyramidImage.image.get(),//image
+            pyramidRange//subresourceRange
+        )
+    };
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+        vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        {},
+        {},
+        beforeBarriers
+    );
+
+    // 描画に使った範囲だけから作る（範囲外のテクセルはシェーダが読まない）
+    vk::Extent2D extent = renderExtent;
+    PyramidParams params{glm::uvec2(extent.width, extent.height), pyramidImage.mipLevels, 0};
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.get());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 0, descriptorSet, {});
+    commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(PyramidParams), &params);
+    uint32_t texelsX = (extent.width + 1) / 2;
+    uint32_t texelsY = (extent.height + 1) / 2;
+    commandBuffer.dispatch((texelsX + kGroupTexels - 1) / kGroupTexels, (texelsY + kGroupTexels - 1) / kGroupTexels, 1);
+
+    // 階層Zを読む処理と、2回目の描画の深度テストを待たせる
+    std::array<vk::ImageMemoryBarrier, 2> afterBarriers = {
+        vk::ImageMemoryBarrier(
+            {},//srcAccessMask
+            vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,//dstAccessMask
+            vk::ImageLayout::eShaderReadOnlyOptimal,//oldLayout
+            vk::ImageLayout::eDepthAttachmentOptimal,//newLayout
+            VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+            depthImage.image.get(),//image
+            depthRange//subresourceRange
+        ),
+        vk::ImageMemoryBarrier(
+            vk::AccessFlagBits::eShaderWrite,//srcAccessMask
+            vk::AccessFlagBits::eShaderRead,//dstAccessMask
+            vk::ImageLayout::eGeneral,//oldLayout
+            vk::ImageLayout::eGeneral,//newLayout
+            VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+            pyramidImage.image.get(),//image
+            pyramidRange//subresourceRange
+        )
+    };
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        consumerStages | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+        {},
+        {},
+        {},
+        afterBarriers
+    );
+}
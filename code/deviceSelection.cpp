@@ -0,0 +1,193 @@
+#include "deviceSelection.hpp"
+
+namespace render {
+
+namespace {
+
+// 種類の優先度（スコアの最上位の桁になる）
+int64_t deviceTypeTier(vk::PhysicalDeviceType type) {
+    switch (type) {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            return 4;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            return 3;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            return 2;
+        case vk::PhysicalDeviceType::eCpu:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void printCapability(std::ostream& out, const char* name, bool enabled, const char* fallback) {
+    out << "  " << std::left << std::setw(24) << name << std::right;
+    if (enabled) {
+        out << "有効" << std::endl;
+    } else {
+        out << "無効（" << fallback << "）" << std::endl;
+    }
+}
+
+} // namespace
+
+const char* validationProfileName(ValidationProfile profile) {
+    switch (profile) {
+        case ValidationProfile::Off:
+            return "無効";
+        case ValidationProfile::Validation:
+            return "検証";
+        case ValidationProfile::Synchronization:
+            return "検証 + 同期";
+        default:
+            return "不明";
+    }
+}
+
+ValidationProfile defaultValidationProfile() {
+    if (const char* value = std::getenv("VKRENDERKIT_VALIDATION")) {
+        std::string mode = value;
+        if (mode == "off" || mode == "0") {
+            return ValidationProfile::Off;
+        }
+        if (mode == "sync") {
+            return ValidationProfile::Synchronization;
+        }
+        return ValidationProfile::Validation;
+    }
+#ifdef NDEBUG
+    return ValidationProfile::Off;
+#else
+    return ValidationProfile::Validation;
+#endif
+}
+
+bool hasDeviceExtensions(vk::PhysicalDevice device, const std::vector<const char*>& extensions) {
+    std::set<std::string> requiredExtensions{extensions.begin(), extensions.end()};
+    for (const auto& extension : device.enumerateDeviceExtensionProperties()) {
+        requiredExtensions.erase(extension.extensionName);
+    }
+    return requiredExtensions.empty();
+}
+
+// Vulkan 1.3に対応したデバイスでのみ呼ぶ
+DeviceCapabilities probeDeviceCapabilities(vk::PhysicalDevice device) {
+    DeviceCapabilities capabilities;
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features>();
+    const vk::PhysicalDeviceVulkan12Features& features12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+    const vk::PhysicalDeviceVulkan13Features& features13 = features.get<vk::PhysicalDeviceVulkan13Features>();
+
+    capabilities.timelineSemaphore = features12.timelineSemaphore;
+    capabilities.synchronization2 = features13.synchronization2;
+    capabilities.descriptorIndexing = features12.descriptorIndexing
+                                   && features12.runtimeDescriptorArray
+                                   && features12.descriptorBindingPartiallyBound
+                                   && features12.descriptorBindingVariableDescriptorCount
+                                   && features12.shaderSampledImageArrayNonUniformIndexing;
+    capabilities.bufferDeviceAddress = features12.bufferDeviceAddress;
+    capabilities.drawIndirectCount = features12.drawIndirectCount;
+    capabilities.hostQueryReset = features12.hostQueryReset;
+    capabilities.multiDrawIndirect = features.get<vk::PhysicalDeviceFeatures2>().features.multiDrawIndirect;
+
+    vk::FormatFeatureFlags depthFeatures = device.getFormatProperties(vk::Format::eD32Sfloat).optimalTilingFeatures;
+    capabilities.depthPyramid = features.get<vk::PhysicalDeviceFeatures2>().features.shaderStorageImageArrayDynamicIndexing
+                             && (depthFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+                             && (depthFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+
+    if (hasDeviceExtensions(device, {VK_EXT_MESH_SHADER_EXTENSION_NAME})) {
+        auto meshFeatures = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+        capabilities.meshShader = meshFeatures.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>().taskShader
+                               && meshFeatures.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>().meshShader;
+    }
+    capabilities.memoryBudget = hasDeviceExtensions(device, {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
+    capabilities.calibratedTimestamps = hasDeviceExtensions(device, {VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME});
+    return capabilities;
+}
+
+void appendCapabilityExtensions(const DeviceCapabilities& capabilities, std::vector<const char*>& extensions) {
+    if (capabilities.meshShader) {
+        extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    }
+    if (capabilities.memoryBudget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (capabilities.calibratedTimestamps) {
+        extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    }
+}
+
+void printCapabilityReport(std::ostream& out, const DeviceCapabilities& capabilities) {
+    out << "高速パス:" << std::endl;
+    printCapability(out, "timeline semaphore", capabilities.timelineSemaphore, "バイナリセマフォとフェンス");
+    printCapability(out, "synchronization2", capabilities.synchronization2, "vkQueueSubmit・従来のバリア");
+    printCapability(out, "descriptor indexing", capabilities.descriptorIndexing, "固定数のディスクリプタ");
+    printCapability(out, "buffer device address", capabilities.bufferDeviceAddress, "ディスクリプタ経由のバッファ参照");
+    printCapability(out, "draw indirect count", capabilities.drawIndirectCount, "instanceCount=0の間接描画");
+    printCapability(out, "multi draw indirect", capabilities.multiDrawIndirect, "コマンドごとの間接描画");
+    printCapability(out, "host query reset", capabilities.hostQueryReset, "GPU時間の計測なし");
+    printCapability(out, "depth pyramid", capabilities.depthPyramid, "遮蔽カリングなし");
+    printCapability(out, "mesh shader", capabilities.meshShader, "コンピュートカリング + 間接描画");
+    printCapability(out, "memory budget", capabilities.memoryBudget, "ヒープサイズから見積もり");
+    printCapability(out, "calibrated timestamps", capabilities.calibratedTimestamps, "初期化時の提出で較正");
+}
+
+DeviceCandidate evaluateDevice(vk::PhysicalDevice device, vk::SurfaceKHR surface, const std::vector<const char*>& requiredExtensions) {
+    DeviceCandidate candidate;
+    candidate.device = device;
+    vk::PhysicalDeviceProperties properties = device.getProperties();
+    candidate.name = properties.deviceName.data();
+    candidate.type = properties.deviceType;
+
+    if (properties.apiVersion < VK_API_VERSION_1_3) {
+        candidate.rejectReason = "Vulkan 1.3に非対応";
+        return candidate;
+    }
+    if (!hasDeviceExtensions(device, requiredExtensions)) {
+        candidate.rejectReason = "必須のデバイス拡張が無い";
+        return candidate;
+    }
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan13Features>();
+    if (!features.get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering) {
+        candidate.rejectReason = "動的レンダリングに非対応";
+        return candidate;
+    }
+
+    bool canPresent = false;
+    std::vector<vk::QueueFamilyProperties> queueProps = device.getQueueFamilyProperties();
+    for (uint32_t i = 0; i < queueProps.size(); i++) {
+        vk::QueueFlags flags = queueProps[i].queueFlags;
+        if ((flags & vk::QueueFlagBits::eGraphics) && device.getSurfaceSupportKHR(i, surface)) {
+            canPresent = true;
+        }
+        if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+            candidate.dedicatedCompute = true;
+        }
+        if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            candidate.dedicatedTransfer = true;
+        }
+    }
+    if (!canPresent) {
+        candidate.rejectReason = "サーフェスへ表示できるグラフィックスキューが無い";
+        return candidate;
+    }
+
+    vk::PhysicalDeviceMemoryProperties memoryProperties = device.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+            candidate.deviceLocalBytes += memoryProperties.memoryHeaps[i].size;
+        }
+    }
+    candidate.capabilities = probeDeviceCapabilities(device);
+
+    // 種類 × 1000万 + VRAM（MiB）+ キュー構成・機能の加点（MiB相当）
+    int64_t vramMiB = std::min<int64_t>(static_cast<int64_t>(candidate.deviceLocalBytes >> 20), 8'000'000);
+    candidate.score = deviceTypeTier(candidate.type) * 10'000'000 + vramMiB;
+    candidate.score += candidate.dedicatedCompute ? 2048 : 0;
+    candidate.score += candidate.dedicatedTransfer ? 1024 : 0;
+    candidate.score += candidate.capabilities.meshShader ? 4096 : 0;
+    candidate.score += candidate.capabilities.bufferDeviceAddress ? 512 : 0;
+    candidate.score += candidate.capabilities.descriptorIndexing ? 512 : 0;
+    return candidate;
+}
+
+}
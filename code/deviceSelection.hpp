@@ -0,0 +1,66 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 検証レイヤーの設定
+enum class ValidationProfile {
+    Off,            // レイヤー無し（リリースビルドの既定）
+    Validation,     // VK_LAYER_KHRONOS_validation + デバッグメッセンジャー（デバッグビルドの既定）
+    Synchronization,// 上に加えて同期の検証（重い）
+    Count
+};
+
+const char* validationProfileName(ValidationProfile profile);
+
+// 環境変数 VKRENDERKIT_VALIDATION（off / on / sync）があればそれを、無ければビルド種別の既定を返す
+ValidationProfile defaultValidationProfile();
+
+// 使えれば有効にする機能（無い場合はそれぞれの代替経路を使う）
+struct DeviceCapabilities {
+    // Vulkan 1.2 / 1.3 のコア機能
+    bool timelineSemaphore = false;
+    bool synchronization2 = false;
+    bool descriptorIndexing = false;//実行時サイズの配列・部分バインド・非一様インデックス
+    bool bufferDeviceAddress = false;
+    bool drawIndirectCount = false;
+    bool hostQueryReset = false;
+    // 1回の間接描画で複数のコマンドを描く（drawCount > 1）
+    bool multiDrawIndirect = false;
+    // 深度を読めるD32の深度バッファとストレージイメージ配列の動的インデックス（階層Zによる遮蔽カリング）
+    bool depthPyramid = false;
+    // 拡張
+    bool meshShader = false;
+    bool memoryBudget = false;
+    bool calibratedTimestamps = false;
+};
+
+// デバイスの対応状況を調べる（拡張の機能はその拡張がある場合のみ確認する）
+DeviceCapabilities probeDeviceCapabilities(vk::PhysicalDevice device);
+
+// 有効にする機能に必要なデバイス拡張を追加する
+void appendCapabilityExtensions(const DeviceCapabilities& capabilities, std::vector<const char*>& extensions);
+
+// 有効にした高速パスと、無効な場合の代替経路を出力する
+void printCapabilityReport(std::ostream& out, const DeviceCapabilities& capabilities);
+
+bool hasDeviceExtensions(vk::PhysicalDevice device, const std::vector<const char*>& extensions);
+
+// 物理デバイスの評価結果
+// 種類（ディスクリート > 統合 > 仮想 > CPU）を最優先し、同じ種類の中ではVRAM・キュー構成・機能で比べる
+struct DeviceCandidate {
+    vk::PhysicalDevice device;
+    std::string name;
+    vk::PhysicalDeviceType type = vk::PhysicalDeviceType::eOther;
+    vk::DeviceSize deviceLocalBytes = 0;
+    bool dedicatedCompute = false;//グラフィックスを持たないコンピュートキューファミリー
+    bool dedicatedTransfer = false;//転送専用のキューファミリー
+    DeviceCapabilities capabilities;
+    int64_t score = 0;
+    std::string rejectReason;//空なら使用可能
+};
+
+// 必須条件（API 1.3・動的レンダリング・必須拡張・サーフェスへの表示）を満たさない場合はrejectReasonを設定する
+DeviceCandidate evaluateDevice(vk::PhysicalDevice device, vk::SurfaceKHR surface, const std::vector<const char*>& requiredExtensions);
+
+}
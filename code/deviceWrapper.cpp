@@ -1,311 +1,872 @@
-#include "vulkanContext.hpp"
-
-// staticメンバ変数の定義
-std::vector<uint32_t> VulkanContext::DeviceWrapper::QueueWrapper::usedQueueFamilyIndices;
-std::map<uint32_t, vk::DeviceQueueCreateInfo> VulkanContext::DeviceWrapper::QueueWrapper::queueCreateInfos;
-
-void VulkanContext::DeviceWrapper::initDevice() {
-    // キュー情報の取得
-    graphicsQueueWrapper.findQueues(QueueWrapper::QueueType::Graphics);
-    computeQueueWrapper.findQueues(QueueWrapper::QueueType::Compute);
-
-    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-    for(auto& [key, value] : graphicsQueueWrapper.getQueueCreateInfos()) {
-        queueCreateInfos.push_back(value);
-    }
-
-    // 論理デバイスの初期化
-    vk::DeviceCreateInfo deviceCreateInfo(
-        {},
-        static_cast<uint32_t>(queueCreateInfos.size()),
-        queueCreateInfos.data(),
-        0,
-        nullptr,
-        context.deviceExtensions.size(),
-        context.deviceExtensions.data(),
-        &context.deviceFeatures
-    );
-
-    vk::StructureChain createInfoChain{
-        deviceCreateInfo,
-        vk::PhysicalDeviceDynamicRenderingFeatures{true}
-    };
-
-    device = context.physicalDevice.createDeviceUnique(createInfoChain.get<vk::DeviceCreateInfo>());
-    // キューの初期化
-    graphicsQueueWrapper.initQueues();
-    computeQueueWrapper.initQueues();
-
-    // コマンドバッファの初期化
-    graphicsCommandBufWrapper.initCommandBuf(graphicsQueueWrapper);
-    computeCommandBufWrapper.initCommandBuf(computeQueueWrapper);
-
-    // スワップチェインの初期化
-    swapchainWrapper.initSwapchain();
-
-    // パイプラインの初期化
-    pipelineWrapper.initPipeline();
-
-    std::cout << "デバイスの初期化が完了しました" << std::endl;
-}
-
-//なるべく数の多いキューファミリーを選択
-void VulkanContext::DeviceWrapper::QueueWrapper::findQueues(QueueType queueType) {
-    std::vector<vk::QueueFamilyProperties> queueProps = deviceWrapper.context.physicalDevice.getQueueFamilyProperties();
-    
-    uint32_t graphicsQueueIndex = -1;
-    uint32_t graphicsQueueCount = 0;
-    uint32_t computeQueueIndex = -1;
-    uint32_t computeQueueCount = 0;
-
-    for(uint32_t i = 0; i < queueProps.size(); i++) {//キューを持つ数が最大のものを選択
-        if(queueProps[i].queueFlags & vk::QueueFlagBits::eGraphics && deviceWrapper.context.physicalDevice.getSurfaceSupportKHR(i, deviceWrapper.context.surface.get()) && !queueCreateInfos.contains(i)) {
-            graphicsQueueCount = std::max(graphicsQueueCount, queueProps[i].queueCount);
-            if(graphicsQueueCount == queueProps[i].queueCount) {
-                graphicsQueueIndex = i;
-            }
-        }
-        if(queueProps[i].queueFlags & vk::QueueFlagBits::eCompute && !queueCreateInfos.contains(i)) {
-            computeQueueCount = std::max(computeQueueCount, queueProps[i].queueCount);
-            if(computeQueueCount == queueProps[i].queueCount) {
-                computeQueueIndex = i;
-            }
-        }
-    }
-
-
-    vk::DeviceQueueCreateInfo queueCreateInfo;  // switch文の前で変数を宣言
-    switch (queueType) {
-        case QueueType::Graphics:
-            if(graphicsQueueIndex == -1) {
-                throw std::runtime_error("グラフィックスキューが見つかりませんでした");
-            }
-            queueFamilyIndex = graphicsQueueIndex;
-            for(uint32_t i = 0; i < graphicsQueueCount; i++) {
-                queuePriorities.push_back(i / graphicsQueueCount);
-            }
-            queueCreateInfo = vk::DeviceQueueCreateInfo(  // 既存の変数に代入
-                {},
-                graphicsQueueIndex,
-                graphicsQueueCount,
-                queuePriorities.data()
-            );
-            queueCreateInfos[graphicsQueueIndex] = queueCreateInfo;
-            usedQueueFamilyIndices.push_back(graphicsQueueIndex);
-            break;
-        
-        case QueueType::Compute:
-            if(computeQueueIndex == -1) {
-                throw std::runtime_error("コンピュートキューが見つかりませんでした");
-            }
-            queueFamilyIndex = computeQueueIndex;
-            for(uint32_t i = 0; i < computeQueueCount; i++) {
-                queuePriorities.push_back(i / computeQueueCount);
-            }
-            queueCreateInfo = vk::DeviceQueueCreateInfo(  // 既存の変数に代入
-                {},
-                computeQueueIndex,
-                computeQueueCount,
-                queuePriorities.data()
-            );
-            queueCreateInfos[computeQueueIndex] = queueCreateInfo;
-            usedQueueFamilyIndices.push_back(computeQueueIndex);
-            break;
-        
-        default:
-            throw std::runtime_error("不正なキュータイプです");
-            break;
-    }
-}    
-
-//キューの初期化
-void VulkanContext::DeviceWrapper::QueueWrapper::initQueues() {
-
-    for(uint32_t i = 0; i < queueCreateInfos.at(queueFamilyIndex).queueCount; i++) {
-        queues.push_back(deviceWrapper.device->getQueue(queueFamilyIndex, i));
-    }
-
-}
-
-void VulkanContext::DeviceWrapper::QueueWrapper::submit(vk::SubmitInfo submitInfo) {
-    queues.at(0).submit(submitInfo, VK_NULL_HANDLE);
-}
-
-void VulkanContext::DeviceWrapper::QueueWrapper::present(vk::PresentInfoKHR presentInfo) {
-    queues.at(0).presentKHR(presentInfo);
-    queues.at(0).waitIdle();
-}
-
-//コマンドバッファの作成
-void VulkanContext::DeviceWrapper::CommandBufWrapper::initCommandBuf(QueueWrapper& queueWrapper){
-    vk::CommandPoolCreateInfo poolCreateInfo(
-        {vk::CommandPoolCreateFlagBits::eResetCommandBuffer},
-        queueWrapper.queueFamilyIndex
-    );
-    commandPool = queueWrapper.deviceWrapper.device->createCommandPoolUnique(poolCreateInfo);
-
-    vk::CommandBufferAllocateInfo allocInfo(
-        *commandPool,
-        vk::CommandBufferLevel::ePrimary,
-        1
-    );
-    commandBuffers = queueWrapper.deviceWrapper.device->allocateCommandBuffersUnique(allocInfo);
-}
-
-void VulkanContext::DeviceWrapper::CommandBufWrapper::startRendering(vk::RenderingInfo renderingInfo) {
-    vk::CommandBufferBeginInfo beginInfo;
-    commandBuffers.at(0)->begin(beginInfo);
-    commandBuffers.at(0)->beginRendering(renderingInfo);
-} 
-
-void VulkanContext::DeviceWrapper::CommandBufWrapper::endRendering(vk::ImageMemoryBarrier imageMemoryBarrier) {
-    commandBuffers.at(0)->endRendering();
-    commandBuffers.at(0)->pipelineBarrier(
-        vk::PipelineStageFlagBits::eColorAttachmentOutput,
-        vk::PipelineStageFlagBits::eBottomOfPipe,
-        {},
-        {},
-        {},
-        imageMemoryBarrier
-    );
-    commandBuffers.at(0)->end();
-}
-
-vk::SubmitInfo VulkanContext::DeviceWrapper::CommandBufWrapper::getSubmitInfo() {
-    return vk::SubmitInfo(
-        0,
-        nullptr,
-        nullptr,
-        1,
-        &commandBuffers.at(0).get()
-    );
-}
-
-//スワップチェインの初期化
-void VulkanContext::DeviceWrapper::SwapchainWrapper::initSwapchain() {
-    vk::SurfaceCapabilitiesKHR surfaceCapabilities = deviceWrapper.context.physicalDevice.getSurfaceCapabilitiesKHR(deviceWrapper.context.surface.get());
-    std::vector<vk::SurfaceFormatKHR> surfaceFormats = deviceWrapper.context.physicalDevice.getSurfaceFormatsKHR(deviceWrapper.context.surface.get());
-    std::vector<vk::PresentModeKHR> surfacePresentModes = deviceWrapper.context.physicalDevice.getSurfacePresentModesKHR(deviceWrapper.context.surface.get());
-
-    vk::SurfaceFormatKHR swapchainFormat = surfaceFormats[0];
-    vk::PresentModeKHR presentMode = surfacePresentModes[0];
-
-    vk::SwapchainCreateInfoKHR swapchainCreateInfo(
-        {},
-        deviceWrapper.context.surface.get(),
-        surfaceCapabilities.minImageCount + 1,
-        swapchainFormat.format,
-        swapchainFormat.colorSpace,
-        surfaceCapabilities.currentExtent,
-        1,
-        vk::ImageUsageFlagBits::eColorAttachment,
-        vk::SharingMode::eExclusive,
-        0,
-        nullptr,
-        surfaceCapabilities.currentTransform,
-        vk::CompositeAlphaFlagBitsKHR::eOpaque,
-        presentMode,
-        VK_TRUE,
-        nullptr
-    );
-    swapchain = deviceWrapper.device->createSwapchainKHRUnique(swapchainCreateInfo);
-    swapchainImages = deviceWrapper.device->getSwapchainImagesKHR(swapchain.get());
-
-    for(uint32_t i = 0; i < swapchainImages.size(); i++) {
-        vk::ImageViewCreateInfo imageViewCreateInfo(
-            {},
-            swapchainImages[i],
-            vk::ImageViewType::e2D,
-            swapchainFormat.format,
-            vk::ComponentMapping(),
-            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-        );
-        swapchainImageViews.push_back(deviceWrapper.device->createImageViewUnique(imageViewCreateInfo));
-    }
-
-    vk::FenceCreateInfo fenceCreateInfo{};
-    swapchainImgFence = deviceWrapper.device->createFenceUnique(fenceCreateInfo);
-
-}
-
-vk::ImageView VulkanContext::DeviceWrapper::SwapchainWrapper::getNextImage() {
-    deviceWrapper.device->resetFences({swapchainImgFence.get()});
-    vk::ResultValue acquireResult = deviceWrapper.device->acquireNextImageKHR(swapchain.get(), UINT64_MAX,{} ,swapchainImgFence.get());
-
-    if (acquireResult.result != vk::Result::eSuccess) {
-        throw std::runtime_error("スワップチェーンイメージの取得に失敗しました");
-    }
-    imageIndex = acquireResult.value;
-
-    if (deviceWrapper.device->waitForFences({swapchainImgFence.get()}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
-        throw std::runtime_error("フェンスの待機に失敗しました");
-    }
-
-    return swapchainImageViews[imageIndex].get();
-}
-
-vk::PresentInfoKHR VulkanContext::DeviceWrapper::SwapchainWrapper::getPresentInfo() {
-    auto imageIndices = {imageIndex};
-
-    return vk::PresentInfoKHR(
-        0,                          // waitSemaphoreCount
-        nullptr,                    // pWaitSemaphores
-        1,                          // swapchainCount
-        &swapchain.get(),          // pSwapchains
-        &imageIndex,               // pImageIndices
-        nullptr                     // pResults
-    );
-}
-
-vk::ImageMemoryBarrier VulkanContext::DeviceWrapper::SwapchainWrapper::getImageMemoryBarrier(vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
-    return vk::ImageMemoryBarrier(
-        {},//srcAccessMask
-        {},//dstAccessMask
-        oldLayout,//oldLayout
-        newLayout,//newLayout
-        VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
-        VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
-        swapchainImages.at(imageIndex),//image
-        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)//subresourceRange
-    );
-}
-
-void VulkanContext::DeviceWrapper::draw(){
-    vk::ImageView swapChainImageView = swapchainWrapper.getNextImage();
-
-    std::vector<vk::RenderingAttachmentInfo> colorAttachments = {
-        vk::RenderingAttachmentInfo(
-            swapChainImageView,// imageView
-            vk::ImageLayout::eColorAttachmentOptimal, // imageLayout
-            vk::ResolveModeFlagBits::eNone, // resolveMode
-            {},                          // resolveImageView
-            vk::ImageLayout::eUndefined, // resolveImageLayout
-            vk::AttachmentLoadOp::eClear, // loadOp
-            vk::AttachmentStoreOp::eStore, // storeOp
-            vk::ClearValue{}             // clearValue
-        )
-    };
-
-    vk::RenderingInfo renderingInfo(
-        {},//flags
-        vk::Rect2D({0, 0},{context.width, context.height}),//renderArea
-        1,//layerCount
-        0,//viewMask
-        colorAttachments.size(),//colorAttachmentCount
-        colorAttachments.data(),//pColorAttachments
-        nullptr,//pDepthAttachment
-        nullptr//pStencilAttachment
-    );
-
-    graphicsCommandBufWrapper.startRendering(renderingInfo);
-    vk::ImageMemoryBarrier imageMemoryBarrier = swapchainWrapper.getImageMemoryBarrier(vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
-    graphicsCommandBufWrapper.endRendering(imageMemoryBarrier);
-    vk::SubmitInfo submitInfo = graphicsCommandBufWrapper.getSubmitInfo();
-
-    graphicsQueueWrapper.submit(submitInfo);
-
-    vk::PresentInfoKHR presentInfo = swapchainWrapper.getPresentInfo();
-    graphicsQueueWrapper.present(presentInfo);
-
-}
-
+#include "vulkanContext.hpp"
+#include "jobSystem.hpp"
+
+void VulkanContext::DeviceWrapper::initDevice() {
+    PROFILE_ZONE("initDevice");
+    // キュー情報の取得
+    graphicsQueueWrapper.findQueues(QueueWrapper::QueueType::Graphics);
+    computeQueueWrapper.findQueues(QueueWrapper::QueueType::Compute);
+
+    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos = assignQueues();
+
+    // Vulkan 1.0 の機能（作成情報が参照するため先に設定する）
+    context.deviceFeatures.multiDrawIndirect = context.capabilities.multiDrawIndirect;
+    context.deviceFeatures.shaderStorageImageArrayDynamicIndexing = context.capabilities.depthPyramid;
+
+    // 論理デバイスの初期化
+    vk::DeviceCreateInfo deviceCreateInfo(
+        {},
+        static_cast<uint32_t>(queueCreateInfos.size()),
+        queueCreateInfos.data(),
+        0,
+        nullptr,
+        context.deviceExtensions.size(),
+        context.deviceExtensions.data(),
+        &context.deviceFeatures
+    );
+
+    // 対応している高速パスだけを有効にする
+    const render::DeviceCapabilities& capabilities = context.capabilities;
+    vk::PhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.drawIndirectCount = capabilities.drawIndirectCount;
+    vulkan12Features.hostQueryReset = capabilities.hostQueryReset;
+    vulkan12Features.timelineSemaphore = capabilities.timelineSemaphore;
+    vulkan12Features.bufferDeviceAddress = capabilities.bufferDeviceAddress;
+    if (capabilities.descriptorIndexing) {
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
+
+    vk::PhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.dynamicRendering = VK_TRUE;
+    vulkan13Features.synchronization2 = capabilities.synchronization2;
+
+    vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+    meshShaderFeatures.taskShader = VK_TRUE;
+    meshShaderFeatures.meshShader = VK_TRUE;
+
+    vk::StructureChain createInfoChain{
+        deviceCreateInfo,
+        vulkan12Features,
+        vulkan13Features,
+        meshShaderFeatures
+    };
+    if (!capabilities.meshShader) {
+        createInfoChain.unlink<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+    }
+
+    {
+        PROFILE_ZONE("createDevice");
+        device = context.physicalDevice.createDeviceUnique(createInfoChain.get<vk::DeviceCreateInfo>());
+    }
+    dispatchLoader = vk::DispatchLoaderDynamic(context.instance.get(), vkGetInstanceProcAddr, device.get());
+    // キューの初期化
+    graphicsQueueWrapper.initQueues();
+    computeQueueWrapper.initQueues();
+
+    // コマンドバッファの初期化
+    graphicsCommandBufWrapper.initCommandBuf(graphicsQueueWrapper);
+    computeCommandBufWrapper.initCommandBuf(computeQueueWrapper);
+
+    // GPUのタイムスタンプの較正（初期化時の提出にグラフィックスのコマンドバッファを使う）
+    gpuProfilerWrapper.initGpuProfiler();
+
+    // スワップチェインの初期化
+    swapchainWrapper.initSwapchain();
+
+    // フレームのスロットごとのフェンス（最初の待機で止まらないようシグナル済みで作る）
+    for (vk::UniqueFence& frameFence : frameFences) {
+        frameFence = device->createFenceUnique(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+    }
+
+    // 深度バッファと階層Z（スワップチェインと同じ大きさ）
+    depthPyramidWrapper.initDepthPyramid(swapchainWrapper.swapchainExtent);
+
+    // 動的解像度（描画先は有効にしたときに作る）
+    dynamicResolutionWrapper.initDynamicResolution();
+
+    // フレームごとの定数用リングバッファ（1フレームあたり8MiB）
+    frameRingWrapper.initFrameRing(8 * 1024 * 1024);
+
+    // パイプラインの初期化
+    pipelineWrapper.initPipeline();
+
+    // クラスタライティング（カリングのディスクリプタから参照するため、モデルの読み込みより前に作る）
+    lightClusterWrapper.initLightClusters();
+
+    std::cout << "デバイスの初期化が完了しました" << std::endl;
+}
+
+//メモリタイプの検索
+uint32_t VulkanContext::DeviceWrapper::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) {
+    vk::PhysicalDeviceMemoryProperties memoryProperties = context.physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("適切なメモリタイプが見つかりませんでした");
+}
+
+//バッファの作成（ホストから見えるメモリは永続的にマップする）
+VulkanContext::DeviceWrapper::BufferResource VulkanContext::DeviceWrapper::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties) {
+    BufferResource resource;
+    resource.size = size;
+
+    // グラフィックスとコンピュートのキューファミリーが異なる場合は共有モードにする
+    std::vector<uint32_t> queueFamilyIndices = {graphicsQueueWrapper.queueFamilyIndex, computeQueueWrapper.queueFamilyIndex};
+    bool concurrent = queueFamilyIndices[0] != queueFamilyIndices[1];
+
+    vk::BufferCreateInfo bufferCreateInfo(
+        {},//flags
+        size,//size
+        usage,//usage
+        concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,//sharingMode
+        concurrent ? static_cast<uint32_t>(queueFamilyIndices.size()) : 0,//queueFamilyIndexCount
+        concurrent ? queueFamilyIndices.data() : nullptr//pQueueFamilyIndices
+    );
+    resource.buffer = device->createBufferUnique(bufferCreateInfo);
+
+    vk::MemoryRequirements requirements = device->getBufferMemoryRequirements(resource.buffer.get());
+    vk::MemoryAllocateInfo allocateInfo(
+        requirements.size,
+        findMemoryType(requirements.memoryTypeBits, properties)
+    );
+    // シェーダからアドレスで参照するバッファはメモリにもデバイスアドレスの取得を許す
+    bool deviceAddress = static_cast<bool>(usage & vk::BufferUsageFlagBits::eShaderDeviceAddress);
+    vk::MemoryAllocateFlagsInfo allocateFlagsInfo(vk::MemoryAllocateFlagBits::eDeviceAddress);
+    if (deviceAddress) {
+        allocateInfo.setPNext(&allocateFlagsInfo);
+    }
+    resource.memory = device->allocateMemoryUnique(allocateInfo);
+    device->bindBufferMemory(resource.buffer.get(), resource.memory.get(), 0);
+    if (deviceAddress) {
+        resource.address = device->getBufferAddress(vk::BufferDeviceAddressInfo(resource.buffer.get()));
+    }
+
+    if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+        resource.mapped = device->mapMemory(resource.memory.get(), 0, VK_WHOLE_SIZE);
+    }
+    return resource;
+}
+
+//イメージの作成（グラフィックスキューでのみ使う）
+VulkanContext::DeviceWrapper::ImageResource VulkanContext::DeviceWrapper::createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect,
+                                                                                     uint32_t arrayLayers, vk::ImageViewType viewType) {
+    ImageResource resource;
+    resource.extent = extent;
+    resource.mipLevels = mipLevels;
+    resource.arrayLayers = arrayLayers;
+
+    vk::ImageCreateInfo imageCreateInfo(
+        {},//flags
+        vk::ImageType::e2D,//imageType
+        format,//format
+        vk::Extent3D(extent, 1),//extent
+        mipLevels,//mipLevels
+        arrayLayers,//arrayLayers
+        vk::SampleCountFlagBits::e1,//samples
+        vk::ImageTiling::eOptimal,//tiling
+        usage,//usage
+        vk::SharingMode::eExclusive,//sharingMode
+        0,//queueFamilyIndexCount
+        nullptr,//pQueueFamilyIndices
+        vk::ImageLayout::eUndefined//initialLayout
+    );
+    resource.image = device->createImageUnique(imageCreateInfo);
+
+    vk::MemoryRequirements requirements = device->getImageMemoryRequirements(resource.image.get());
+    vk::MemoryAllocateInfo allocateInfo(
+        requirements.size,
+        findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)
+    );
+    resource.memory = device->allocateMemoryUnique(allocateInfo);
+    device->bindImageMemory(resource.image.get(), resource.memory.get(), 0);
+
+    vk::ImageViewCreateInfo imageViewCreateInfo(
+        {},
+        resource.image.get(),
+        viewType,
+        format,
+        vk::ComponentMapping(),
+        vk::ImageSubresourceRange(aspect, 0, mipLevels, 0, arrayLayers)
+    );
+    resource.view = device->createImageViewUnique(imageViewCreateInfo);
+    return resource;
+}
+
+//キューファミリーの選択
+//グラフィックスは表示できるファミリー、コンピュートはグラフィックスを持たないファミリー（非同期コンピュート）を優先し、
+//それぞれキューの数が多いものを選ぶ。専用のファミリーが無ければグラフィックスと共有する
+void VulkanContext::DeviceWrapper::QueueWrapper::findQueues(QueueType type) {
+    VulkanContext& context = deviceWrapper.context;
+    std::vector<vk::QueueFamilyProperties> queueProps = context.physicalDevice.getQueueFamilyProperties();
+    queueType = type;
+
+    uint32_t bestIndex = UINT32_MAX;
+    uint32_t bestRank = 0;
+    for(uint32_t i = 0; i < queueProps.size(); i++) {
+        vk::QueueFlags flags = queueProps[i].queueFlags;
+        uint32_t rank = 0;
+        switch (queueType) {
+            case QueueType::Graphics:
+                if ((flags & vk::QueueFlagBits::eGraphics) && context.physicalDevice.getSurfaceSupportKHR(i, context.surface.get())) {
+                    rank = queueProps[i].queueCount;
+                }
+                break;
+            case QueueType::Compute:
+                if (flags & vk::QueueFlagBits::eCompute) {
+                    rank = queueProps[i].queueCount + ((flags & vk::QueueFlagBits::eGraphics) ? 0 : 1024);
+                }
+                break;
+            default:
+                throw std::runtime_error("不正なキュータイプです");
+        }
+        if (rank > bestRank) {
+            bestRank = rank;
+            bestIndex = i;
+        }
+    }
+
+    if (bestIndex == UINT32_MAX) {
+        throw std::runtime_error(queueType == QueueType::Graphics ? "グラフィックスキューが見つかりませんでした" : "コンピュートキューが見つかりませんでした");
+    }
+    queueFamilyIndex = bestIndex;
+}
+
+//ファミリー内のキューを役割ごとに割り当て、優先度を決める
+//各役割の主キューは1.0、残り（submitIndependentで振り分ける独立した処理用）は0.5
+std::vector<vk::DeviceQueueCreateInfo> VulkanContext::DeviceWrapper::assignQueues() {
+    std::vector<vk::QueueFamilyProperties> queueProps = context.physicalDevice.getQueueFamilyProperties();
+    queueFamilyPriorities.clear();
+
+    auto assign = [&](QueueWrapper& queueWrapper, uint32_t first, uint32_t count) {
+        queueWrapper.firstQueueIndex = first;
+        queueWrapper.queueCount = count;
+        std::vector<float>& priorities = queueFamilyPriorities[queueWrapper.queueFamilyIndex];
+        priorities.resize(std::max<size_t>(priorities.size(), first + count), 0.5f);
+        priorities[first] = 1.0f;
+    };
+
+    uint32_t graphicsFamilyCount = queueProps[graphicsQueueWrapper.queueFamilyIndex].queueCount;
+    if (graphicsQueueWrapper.queueFamilyIndex != computeQueueWrapper.queueFamilyIndex) {
+        assign(graphicsQueueWrapper, 0, graphicsFamilyCount);
+        assign(computeQueueWrapper, 0, queueProps[computeQueueWrapper.queueFamilyIndex].queueCount);
+    } else if (graphicsFamilyCount >= 2) {
+        uint32_t graphicsCount = (graphicsFamilyCount + 1) / 2;
+        assign(graphicsQueueWrapper, 0, graphicsCount);
+        assign(computeQueueWrapper, graphicsCount, graphicsFamilyCount - graphicsCount);
+    } else {
+        assign(graphicsQueueWrapper, 0, 1);
+        assign(computeQueueWrapper, 0, 1);
+    }
+
+    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+    for (const auto& [familyIndex, priorities] : queueFamilyPriorities) {
+        queueCreateInfos.push_back(vk::DeviceQueueCreateInfo(
+            {},
+            familyIndex,
+            static_cast<uint32_t>(priorities.size()),
+            priorities.data()
+        ));
+    }
+
+    std::cout << "キュー: グラフィックス ファミリー" << graphicsQueueWrapper.queueFamilyIndex << " × " << graphicsQueueWrapper.queueCount
+              << ", コンピュート ファミリー" << computeQueueWrapper.queueFamilyIndex << " × " << computeQueueWrapper.queueCount
+              << (graphicsQueueWrapper.queueFamilyIndex == computeQueueWrapper.queueFamilyIndex ? "（共有）" : "（非同期）") << std::endl;
+    return queueCreateInfos;
+}
+
+//キューの初期化
+void VulkanContext::DeviceWrapper::QueueWrapper::initQueues() {
+    queues.clear();
+    queueMutexes.clear();
+    for(uint32_t i = firstQueueIndex; i < firstQueueIndex + queueCount; i++) {
+        queues.push_back(deviceWrapper.device->getQueue(queueFamilyIndex, i));
+        std::unique_ptr<std::mutex>& mutex = deviceWrapper.queueMutexes[{queueFamilyIndex, i}];
+        if (!mutex) {
+            mutex = std::make_unique<std::mutex>();
+        }
+        queueMutexes.push_back(mutex.get());
+    }
+}
+
+void VulkanContext::DeviceWrapper::QueueWrapper::enqueue(Submission submission) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pending.push_back(std::move(submission));
+}
+
+void VulkanContext::DeviceWrapper::QueueWrapper::flush(vk::Fence fence) {
+    std::vector<Submission> batch;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        batch.swap(pending);
+    }
+    if (!batch.empty() || fence) {
+        submitBatch(0, batch, fence);
+    }
+
+    // 確保済みの領域を次の提出に使い回す
+    batch.clear();
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (pending.empty()) {
+        pending.swap(batch);
+    }
+}
+
+void VulkanContext::DeviceWrapper::QueueWrapper::submit(Submission submission, vk::Fence fence) {
+    enqueue(std::move(submission));
+    flush(fence);
+}
+
+uint32_t VulkanContext::DeviceWrapper::QueueWrapper::submitIndependent(Submission submission, vk::Fence fence) {
+    uint32_t queue = queues.size() > 1 ? 1 + nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(queues.size() - 1) : 0;
+    std::vector<Submission> batch;
+    batch.push_back(std::move(submission));
+    submitBatch(queue, batch, fence);
+    return queue;
+}
+
+//synchronization2があればvkQueueSubmit2、無ければ従来のvkQueueSubmitへ変換して1回で提出する
+void VulkanContext::DeviceWrapper::QueueWrapper::submitBatch(uint32_t queue, const std::vector<Submission>& submissions, vk::Fence fence) {
+    std::pmr::memory_resource* resource = deviceWrapper.context.frameArena.getThreadResource();
+    const render::DeviceCapabilities& capabilities = deviceWrapper.context.capabilities;
+
+    if (capabilities.synchronization2) {
+        std::pmr::vector<vk::SubmitInfo2> submitInfos(resource);
+        submitInfos.reserve(submissions.size());
+        for (const Submission& submission : submissions) {
+            submitInfos.push_back(vk::SubmitInfo2(
+                {},
+                static_cast<uint32_t>(submission.waitSemaphores.size()),
+                submission.waitSemaphores.data(),
+                static_cast<uint32_t>(submission.commandBuffers.size()),
+                submission.commandBuffers.data(),
+                static_cast<uint32_t>(submission.signalSemaphores.size()),
+                submission.signalSemaphores.data()
+            ));
+        }
+        std::lock_guard<std::mutex> lock(*queueMutexes.at(queue));
+        queues.at(queue).submit2(static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), fence);
+        return;
+    }
+
+    // 従来の提出へ変換する（ステージはVkPipelineStageFlagsと共通の下位32ビットのみ使える）
+    struct LegacySubmission {
+        std::pmr::vector<vk::Semaphore> waitSemaphores;
+        std::pmr::vector<vk::PipelineStageFlags> waitStages;
+        std::pmr::vector<uint64_t> waitValues;
+        std::pmr::vector<vk::CommandBuffer> commandBuffers;
+        std::pmr::vector<vk::Semaphore> signalSemaphores;
+        std::pmr::vector<uint64_t> signalValues;
+        vk::TimelineSemaphoreSubmitInfo timelineInfo;
+    };
+    std::pmr::vector<LegacySubmission> legacy(resource);
+    legacy.reserve(submissions.size());
+    std::pmr::vector<vk::SubmitInfo> submitInfos(resource);
+    submitInfos.reserve(submissions.size());
+    for (const Submission& submission : submissions) {
+        legacy.push_back({
+            std::pmr::vector<vk::Semaphore>(resource), std::pmr::vector<vk::PipelineStageFlags>(resource), std::pmr::vector<uint64_t>(resource),
+            std::pmr::vector<vk::CommandBuffer>(resource), std::pmr::vector<vk::Semaphore>(resource), std::pmr::vector<uint64_t>(resource), {}
+        });
+        LegacySubmission& converted = legacy.back();
+        for (const vk::SemaphoreSubmitInfo& wait : submission.waitSemaphores) {
+            converted.waitSemaphores.push_back(wait.semaphore);
+            converted.waitStages.push_back(vk::PipelineStageFlags(static_cast<VkPipelineStageFlags>(static_cast<VkPipelineStageFlags2>(wait.stageMask))));
+            converted.waitValues.push_back(wait.value);
+        }
+        for (const vk::CommandBufferSubmitInfo& commandBuffer : submission.commandBuffers) {
+            converted.commandBuffers.push_back(commandBuffer.commandBuffer);
+        }
+        for (const vk::SemaphoreSubmitInfo& signal : submission.signalSemaphores) {
+            converted.signalSemaphores.push_back(signal.semaphore);
+            converted.signalValues.push_back(signal.value);
+        }
+
+        vk::SubmitInfo submitInfo(
+            static_cast<uint32_t>(converted.waitSemaphores.size()),
+            converted.waitSemaphores.data(),
+            converted.waitStages.data(),
+            static_cast<uint32_t>(converted.commandBuffers.size()),
+            converted.commandBuffers.data(),
+            static_cast<uint32_t>(converted.signalSemaphores.size()),
+            converted.signalSemaphores.data()
+        );
+        // タイムラインセマフォの値（バイナリセマフォでは無視される）
+        if (capabilities.timelineSemaphore) {
+            converted.timelineInfo = vk::TimelineSemaphoreSubmitInfo(
+                static_cast<uint32_t>(converted.waitValues.size()),
+                converted.waitValues.data(),
+                static_cast<uint32_t>(converted.signalValues.size()),
+                converted.signalValues.data()
+            );
+            submitInfo.pNext = &converted.timelineInfo;
+        }
+        submitInfos.push_back(submitInfo);
+    }
+    std::lock_guard<std::mutex> lock(*queueMutexes.at(queue));
+    queues.at(queue).submit(static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), fence);
+}
+
+vk::Result VulkanContext::DeviceWrapper::QueueWrapper::present(vk::PresentInfoKHR presentInfo) {
+    std::lock_guard<std::mutex> lock(*queueMutexes.at(0));
+    vk::Result result;
+    try {
+        result = queues.at(0).presentKHR(presentInfo);
+    } catch (const vk::OutOfDateKHRError&) {
+        result = vk::Result::eErrorOutOfDateKHR;
+    }
+    return result;
+}
+
+void VulkanContext::DeviceWrapper::QueueWrapper::waitIdle() {
+    for (size_t i = 0; i < queues.size(); i++) {
+        std::lock_guard<std::mutex> lock(*queueMutexes[i]);
+        queues[i].waitIdle();
+    }
+}
+
+//コマンドバッファの作成
+void VulkanContext::DeviceWrapper::CommandBufWrapper::initCommandBuf(QueueWrapper& queueWrapper){
+    vk::CommandPoolCreateInfo poolCreateInfo(
+        {vk::CommandPoolCreateFlagBits::eResetCommandBuffer},
+        queueWrapper.queueFamilyIndex
+    );
+    commandPool = queueWrapper.deviceWrapper.device->createCommandPoolUnique(poolCreateInfo);
+
+    vk::CommandBufferAllocateInfo allocInfo(
+        *commandPool,
+        vk::CommandBufferLevel::ePrimary,
+        1
+    );
+    commandBuffers = queueWrapper.deviceWrapper.device->allocateCommandBuffersUnique(allocInfo);
+}
+
+void VulkanContext::DeviceWrapper::CommandBufWrapper::startRendering(vk::RenderingInfo renderingInfo, vk::ArrayProxy<const vk::ImageMemoryBarrier> imageMemoryBarriers) {
+    begin();
+    beginRendering(renderingInfo, imageMemoryBarriers);
+}
+
+void VulkanContext::DeviceWrapper::CommandBufWrapper::begin() {
+    vk::CommandBufferBeginInfo beginInfo;
+    commandBuffers.at(0)->begin(beginInfo);
+}
+
+// イメージの取得待ち（カラー出力の段階で待つ）と前のフレームの深度の書き込みの後にレイアウトを遷移する
+void VulkanContext::DeviceWrapper::CommandBufWrapper::beginRendering(vk::RenderingInfo renderingInfo, vk::ArrayProxy<const vk::ImageMemoryBarrier> imageMemoryBarriers) {
+    commandBuffers.at(0)->pipelineBarrier(
+        vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+        vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+        {},
+        {},
+        {},
+        imageMemoryBarriers
+    );
+    commandBuffers.at(0)->beginRendering(renderingInfo);
+} 
+
+void VulkanContext::DeviceWrapper::CommandBufWrapper::endRendering(vk::ImageMemoryBarrier imageMemoryBarrier) {
+    commandBuffers.at(0)->endRendering();
+    commandBuffers.at(0)->pipelineBarrier(
+        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        vk::PipelineStageFlagBits::eBottomOfPipe,
+        {},
+        {},
+        {},
+        imageMemoryBarrier
+    );
+    commandBuffers.at(0)->end();
+}
+
+//スワップチェインの初期化
+void VulkanContext::DeviceWrapper::SwapchainWrapper::initSwapchain() {
+    PROFILE_ZONE("initSwapchain");
+    createSwapchain();
+
+    for (vk::UniqueSemaphore& semaphore : imageAvailableSemaphores) {
+        semaphore = deviceWrapper.device->createSemaphoreUnique(vk::SemaphoreCreateInfo());
+    }
+}
+
+//スワップチェインの作成（既存のものがあれば引き継ぐ）
+void VulkanContext::DeviceWrapper::SwapchainWrapper::createSwapchain() {
+    VulkanContext& context = deviceWrapper.context;
+    vk::SurfaceCapabilitiesKHR surfaceCapabilities = context.physicalDevice.getSurfaceCapabilitiesKHR(context.surface.get());
+    std::vector<vk::SurfaceFormatKHR> surfaceFormats = context.physicalDevice.getSurfaceFormatsKHR(context.surface.get());
+    std::vector<vk::PresentModeKHR> surfacePresentModes = context.physicalDevice.getSurfacePresentModesKHR(context.surface.get());
+
+    // パイプラインはB8G8R8A8_UNORMで作るため、あればそれを使う
+    swapchainFormat = surfaceFormats[0];
+    for (const auto& surfaceFormat : surfaceFormats) {
+        if (surfaceFormat.format == vk::Format::eB8G8R8A8Unorm && surfaceFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+            swapchainFormat = surfaceFormat;
+            break;
+        }
+    }
+    presentMode = render::choosePresentMode(presentPolicy, surfacePresentModes);
+
+    // currentExtentが未定義の場合はフレームバッファのサイズを使う
+    swapchainExtent = surfaceCapabilities.currentExtent;
+    if (swapchainExtent.width == UINT32_MAX) {
+        int framebufferWidth, framebufferHeight;
+        context.getFramebufferSize(framebufferWidth, framebufferHeight);
+        swapchainExtent.width = std::clamp(static_cast<uint32_t>(framebufferWidth), surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width);
+        swapchainExtent.height = std::clamp(static_cast<uint32_t>(framebufferHeight), surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
+    }
+    context.width = swapchainExtent.width;
+    context.height = swapchainExtent.height;
+
+    // 動的解像度では縮小した描画先から転送で拡大して書き込む
+    transferDstSupported = static_cast<bool>(surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
+    vk::ImageUsageFlags imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (transferDstSupported) {
+        imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
+
+    vk::SwapchainCreateInfoKHR swapchainCreateInfo(
+        {},
+        context.surface.get(),
+        render::chooseImageCount(presentMode, surfaceCapabilities),
+        swapchainFormat.format,
+        swapchainFormat.colorSpace,
+        swapchainExtent,
+        1,
+        imageUsage,
+        vk::SharingMode::eExclusive,
+        0,
+        nullptr,
+        surfaceCapabilities.currentTransform,
+        vk::CompositeAlphaFlagBitsKHR::eOpaque,
+        presentMode,
+        VK_TRUE,
+        swapchain.get()//oldSwapchain
+    );
+    vk::UniqueSwapchainKHR newSwapchain = deviceWrapper.device->createSwapchainKHRUnique(swapchainCreateInfo);
+
+    // 古いイメージビューを先に破棄してから古いスワップチェインを破棄する
+    swapchainImageViews.clear();
+    swapchain = std::move(newSwapchain);
+    swapchainImages = deviceWrapper.device->getSwapchainImagesKHR(swapchain.get());
+
+    for(uint32_t i = 0; i < swapchainImages.size(); i++) {
+        vk::ImageViewCreateInfo imageViewCreateInfo(
+            {},
+            swapchainImages[i],
+            vk::ImageViewType::e2D,
+            swapchainFormat.format,
+            vk::ComponentMapping(),
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+        );
+        swapchainImageViews.push_back(deviceWrapper.device->createImageViewUnique(imageViewCreateInfo));
+    }
+
+    // 描画完了のセマフォはイメージごと（古いイメージの表示が待っている可能性があるため、減らさずに使い回す）
+    while (renderFinishedSemaphores.size() < swapchainImages.size()) {
+        renderFinishedSemaphores.push_back(deviceWrapper.device->createSemaphoreUnique(vk::SemaphoreCreateInfo()));
+    }
+
+    std::cout << "スワップチェイン: " << swapchainExtent.width << "x" << swapchainExtent.height
+              << ", " << swapchainImages.size() << " 枚, " << vk::to_string(presentMode)
+              << " (" << render::presentPolicyName(presentPolicy) << ")" << std::endl;
+}
+
+void VulkanContext::DeviceWrapper::SwapchainWrapper::recreateSwapchain() {
+    PROFILE_ZONE("recreateSwapchain");
+    // 最小化中はサイズが0になるため、戻るまで待つ
+    // 描画スレッドからはイベントを処理できないため、メインスレッドがサイズを更新するのを待つ
+    int framebufferWidth = 0, framebufferHeight = 0;
+    deviceWrapper.context.getFramebufferSize(framebufferWidth, framebufferHeight);
+    while ((framebufferWidth == 0 || framebufferHeight == 0) && !deviceWrapper.context.windowShouldClose()) {
+        if (render::JobSystem::instance().isMainThread()) {
+            glfwWaitEvents();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        deviceWrapper.context.getFramebufferSize(framebufferWidth, framebufferHeight);
+    }
+
+    // 使用中のイメージが無くなるまで待ってから作り直す
+    deviceWrapper.device->waitIdle();
+    createSwapchain();
+    recreateRequested = false;
+    deviceWrapper.context.framebufferResized = false;
+}
+
+vk::ImageView VulkanContext::DeviceWrapper::SwapchainWrapper::getNextImage(uint32_t slot) {
+    if (imageAcquired) {
+        return swapchainImageViews[imageIndex].get();
+    }
+    PROFILE_ZONE("acquire");
+    if (recreateRequested || deviceWrapper.context.framebufferResized) {
+        recreateSwapchain();
+    }
+
+    while (true) {
+        vk::ResultValue<uint32_t> acquireResult(vk::Result::eErrorOutOfDateKHR, 0);
+        try {
+            acquireResult = deviceWrapper.device->acquireNextImageKHR(swapchain.get(), UINT64_MAX, imageAvailableSemaphores.at(slot).get(), {});
+        } catch (const vk::OutOfDateKHRError&) {
+            // セマフォはシグナルされないため、作り直して取得し直す
+            recreateSwapchain();
+            continue;
+        }
+
+        if (acquireResult.result != vk::Result::eSuccess && acquireResult.result != vk::Result::eSuboptimalKHR) {
+            throw std::runtime_error("スワップチェーンイメージの取得に失敗しました");
+        }
+        imageIndex = acquireResult.value;
+        acquiredSlot = slot;
+        imageAcquired = true;
+
+        // SUBOPTIMALでもこのフレームは描画し、表示後に作り直す
+        if (acquireResult.result == vk::Result::eSuboptimalKHR) {
+            recreateRequested = true;
+        }
+        return swapchainImageViews[imageIndex].get();
+    }
+}
+
+vk::PresentInfoKHR VulkanContext::DeviceWrapper::SwapchainWrapper::getPresentInfo() {
+    imageAcquired = false;
+    return vk::PresentInfoKHR(
+        1,                          // waitSemaphoreCount
+        &renderFinishedSemaphores.at(imageIndex).get(), // pWaitSemaphores
+        1,                          // swapchainCount
+        &swapchain.get(),          // pSwapchains
+        &imageIndex,               // pImageIndices
+        nullptr                     // pResults
+    );
+}
+
+vk::ImageMemoryBarrier VulkanContext::DeviceWrapper::SwapchainWrapper::getImageMemoryBarrier(vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+    return vk::ImageMemoryBarrier(
+        {},//srcAccessMask
+        {},//dstAccessMask
+        oldLayout,//oldLayout
+        newLayout,//newLayout
+        VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+        swapchainImages.at(imageIndex),//image
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)//subresourceRange
+    );
+}
+
+void VulkanContext::DeviceWrapper::acquireFrame() {
+    swapchainWrapper.getNextImage(getFrameSlot());
+}
+
+void VulkanContext::DeviceWrapper::waitForFrame() {
+    if (!framePending) {
+        return;
+    }
+    {
+        PROFILE_ZONE("waitForFrame");
+        uint32_t previousSlot = static_cast<uint32_t>((submittedFrames - 1) % render::kFramesInFlight);
+        if (device->waitForFences({frameFences[previousSlot].get()}, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+            throw std::runtime_error("フェンスの待機に失敗しました");
+        }
+    }
+    framePending = false;
+
+    // 各ラッパーのGPU時間はプロファイラのゾーンから読むため、先に回収する
+    gpuProfilerWrapper.collect();
+    if (meshletCullWrapper.isReady()) {
+        meshletCullWrapper.collectStatistics();
+    }
+    shadowMapWrapper.collectStatistics();
+    lightClusterWrapper.collectStatistics();
+    transparencyWrapper.collectStatistics();
+    dynamicResolutionWrapper.collect();
+}
+
+void VulkanContext::DeviceWrapper::draw(){
+    // 通常は入力の取得前に取得済み（取得の待ちを入力から表示までの時間に含めない）
+    vk::ImageView swapChainImageView = swapchainWrapper.getNextImage(getFrameSlot());
+    waitForFrame();
+    gpuProfilerWrapper.beginFrame();
+
+    // このフレームのカメラ定数（リングバッファの同じ領域を使った前回のフレームは完了済み）
+    frameRingWrapper.beginFrame(context.frameNumber);
+    FrameRingWrapper::CameraConstants camera{
+        context.viewMatrix,
+        context.projectionMatrix,
+        context.projectionMatrix * context.viewMatrix,
+        glm::vec4(context.cameraPosition, 1.0f)
+    };
+    frameRingWrapper.writeCamera(camera);
+
+    // リサイズ後は深度バッファと階層Zを合わせる（前のフレームは完了済み）
+    if (depthPyramidWrapper.resize(swapchainWrapper.swapchainExtent)) {
+        meshletCullWrapper.updatePyramidDescriptor();
+    }
+
+    // 動的解像度の倍率から描画の大きさを決める（深度バッファと階層Zはその範囲だけを使う）
+    dynamicResolutionWrapper.beginFrame(swapchainWrapper.swapchainExtent);
+    vk::Extent2D renderExtent = dynamicResolutionWrapper.getRenderExtent();
+    depthPyramidWrapper.setRenderExtent(renderExtent);
+    bool upscale = dynamicResolutionWrapper.isActive();
+    vk::Image colorImage = upscale ? dynamicResolutionWrapper.getTargetImage() : swapchainWrapper.getCurrentImage();
+
+    std::pmr::vector<vk::RenderingAttachmentInfo> colorAttachments(context.frameArena.getThreadResource());
+    colorAttachments.push_back(
+        vk::RenderingAttachmentInfo(
+            upscale ? dynamicResolutionWrapper.getTargetView() : swapChainImageView,// imageView
+            vk::ImageLayout::eColorAttachmentOptimal, // imageLayout
+            vk::ResolveModeFlagBits::eNone, // resolveMode
+            {},                          // resolveImageView
+            vk::ImageLayout::eUndefined, // resolveImageLayout
+            vk::AttachmentLoadOp::eClear, // loadOp
+            vk::AttachmentStoreOp::eStore, // storeOp
+            vk::ClearValue{}             // clearValue
+        )
+    );
+
+    vk::RenderingAttachmentInfo depthAttachment(
+        depthPyramidWrapper.getDepthView(),// imageView
+        vk::ImageLayout::eDepthAttachmentOptimal, // imageLayout
+        vk::ResolveModeFlagBits::eNone, // resolveMode
+        {},                          // resolveImageView
+        vk::ImageLayout::eUndefined, // resolveImageLayout
+        vk::AttachmentLoadOp::eClear, // loadOp
+        vk::AttachmentStoreOp::eStore, // storeOp
+        vk::ClearDepthStencilValue(1.0f, 0) // clearValue
+    );
+
+    vk::RenderingInfo renderingInfo(
+        {},//flags
+        vk::Rect2D({0, 0}, renderExtent),//renderArea
+        1,//layerCount
+        0,//viewMask
+        colorAttachments.size(),//colorAttachmentCount
+        colorAttachments.data(),//pColorAttachments
+        &depthAttachment,//pDepthAttachment
+        nullptr//pStencilAttachment
+    );
+
+    // カスケードの範囲とページの再利用の判定、カスケードごとの投影元の選別
+    shadowMapWrapper.update(context.viewMatrix, context.projectionMatrix);
+
+    // メッシュレットカリング（コンピュートキュー）
+    bool waitCull = meshletCullWrapper.isReady() && meshletCullWrapper.dispatchCull(computeCommandBufWrapper, computeQueueWrapper);
+    // ライトのクラスタへの割り当て（コンピュートキュー、フラグメントシェーダの前に待つ）
+    bool waitLights = lightClusterWrapper.dispatch(computeQueueWrapper);
+    // どちらも溜めてあるだけなので、1回のvkQueueSubmit2で提出する
+    computeQueueWrapper.flush();
+
+    {
+        PROFILE_ZONE("record");
+        vk::CommandBuffer commandBuffer = graphicsCommandBufWrapper.getCommandBuffer();
+        // カラーと深度の遷移（毎フレーム記録するためヒープに確保しない）
+        std::array<vk::ImageMemoryBarrier, 2> attachmentBarriers = {
+            vk::ImageMemoryBarrier(
+                {},//srcAccessMask
+                vk::AccessFlagBits::eColorAttachmentWrite,//dstAccessMask
+                vk::ImageLayout::eUndefined,//oldLayout
+                vk::ImageLayout::eColorAttachmentOptimal,//newLayout
+                VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+                VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+                colorImage,//image
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)//subresourceRange
+            ),
+            vk::ImageMemoryBarrier(
+                {},//srcAccessMask
+                vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,//dstAccessMask
+                vk::ImageLayout::eUndefined,//oldLayout
+                vk::ImageLayout::eDepthAttachmentOptimal,//newLayout
+                VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+                VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+                depthPyramidWrapper.getDepthImage(),//image
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)//subresourceRange
+            )
+        };
+        graphicsCommandBufWrapper.begin();
+        // 常駐管理で読み込んだジオメトリをプールへ転送する
+        geometryBufferWrapper.recordUploads(commandBuffer);
+        dynamicResolutionWrapper.beginFrameZone(commandBuffer);
+        // シャドウマップはメインの描画より前に作る
+        shadowMapWrapper.record(commandBuffer);
+        graphicsCommandBufWrapper.beginRendering(renderingInfo, attachmentBarriers);
+        uint32_t drawZone = gpuProfilerWrapper.beginZone(commandBuffer, "graphics queue", "draw");
+        if (meshletCullWrapper.isReady()) {
+            meshletCullWrapper.recordDraw(commandBuffer, 0);
+        }
+        gpuProfilerWrapper.endZone(commandBuffer, drawZone);
+
+        // 1回目の深度から階層Zを作り、前フレームで見えていなかったものを判定して描き足す
+        if (meshletCullWrapper.isReady() && meshletCullWrapper.isOcclusionActive()) {
+            commandBuffer.endRendering();
+            uint32_t lateZone = gpuProfilerWrapper.beginZone(commandBuffer, "graphics queue", "occlusion");
+            vk::PipelineStageFlags pyramidConsumers = context.capabilities.meshShader ? vk::PipelineStageFlagBits::eTaskShaderEXT : vk::PipelineStageFlagBits::eComputeShader;
+            depthPyramidWrapper.build(commandBuffer, pyramidConsumers);
+            meshletCullWrapper.recordLateCull(commandBuffer);
+
+            colorAttachments[0].loadOp = vk::AttachmentLoadOp::eLoad;
+            depthAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+            commandBuffer.beginRendering(renderingInfo);
+            meshletCullWrapper.recordDraw(commandBuffer, 1);
+            gpuProfilerWrapper.endZone(commandBuffer, lateZone);
+            meshletCullWrapper.setDrawZones(drawZone, lateZone);
+        } else {
+            meshletCullWrapper.setDrawZones(drawZone, UINT32_MAX);
+        }
+
+        // 半透明は不透明の後に描く（不透明の深度で判定し、深度は書かない）
+        colorAttachments[0].loadOp = vk::AttachmentLoadOp::eLoad;
+        depthAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+        transparencyWrapper.record(commandBuffer, renderingInfo);
+        if (upscale) {
+            commandBuffer.endRendering();
+            dynamicResolutionWrapper.recordUpscale(commandBuffer, swapchainWrapper.getCurrentImage(), swapchainWrapper.swapchainExtent);
+            dynamicResolutionWrapper.endFrameZone(commandBuffer);
+            commandBuffer.end();
+        } else {
+            dynamicResolutionWrapper.endFrameZone(commandBuffer);
+            vk::ImageMemoryBarrier imageMemoryBarrier = swapchainWrapper.getImageMemoryBarrier(vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::ePresentSrcKHR);
+            graphicsCommandBufWrapper.endRendering(imageMemoryBarrier);
+        }
+    }
+    QueueWrapper::Submission submission(context.frameArena.getThreadResource());
+    submission.commandBuffers.push_back(graphicsCommandBufWrapper.getCommandBufferSubmitInfo());
+
+    // カリング結果の間接描画引数を読む前にコンピュートの完了を待つ（2回目のカリングも可視情報を読む）
+    if (waitCull) {
+        submission.waitSemaphores.push_back(vk::SemaphoreSubmitInfo(
+            meshletCullWrapper.getCullSemaphore(),
+            0,
+            vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexInput | vk::PipelineStageFlagBits2::eComputeShader
+        ));
+    }
+
+    if (waitLights) {
+        submission.waitSemaphores.push_back(vk::SemaphoreSubmitInfo(lightClusterWrapper.getSemaphore(), 0, vk::PipelineStageFlagBits2::eFragmentShader));
+    }
+
+    // イメージの取得を待ってから書き込み、表示は描画の完了を待つ
+    submission.waitSemaphores.push_back(vk::SemaphoreSubmitInfo(swapchainWrapper.getImageAvailableSemaphore(), 0, vk::PipelineStageFlagBits2::eColorAttachmentOutput));
+    submission.signalSemaphores.push_back(vk::SemaphoreSubmitInfo(swapchainWrapper.getRenderFinishedSemaphore(), 0, vk::PipelineStageFlagBits2::eAllCommands));
+
+    {
+        PROFILE_ZONE("submit");
+        vk::Fence frameFence = frameFences[getFrameSlot()].get();
+        device->resetFences({frameFence});
+        graphicsQueueWrapper.submit(std::move(submission), frameFence);
+        submittedFrames++;
+        framePending = true;
+    }
+
+    vk::PresentInfoKHR presentInfo = swapchainWrapper.getPresentInfo();
+    vk::Result presentResult;
+    {
+        PROFILE_ZONE("present");
+        presentResult = graphicsQueueWrapper.present(presentInfo);
+    }
+    if (presentResult == vk::Result::eErrorOutOfDateKHR || presentResult == vk::Result::eSuboptimalKHR) {
+        swapchainWrapper.requestRecreate();
+    }
+    // このフレームの完了は次のフレームの記録の前（waitForFrame）で待つ
+}
+
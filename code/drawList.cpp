@@ -0,0 +1,252 @@
+#include "drawList.hpp"
+#include "profiler.hpp"
+#include "jobSystem.hpp"
+
+namespace render {
+
+namespace {
+
+constexpr uint64_t kPipelineMask = (1ull << kSortKeyPipelineBits) - 1;
+constexpr uint64_t kMaterialMask = (1ull << kSortKeyMaterialBits) - 1;
+constexpr uint64_t kDepthMask = (1ull << kSortKeyDepthBits) - 1;
+
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kRadixSize = 1u << kRadixBits;
+constexpr uint32_t kRadixPasses = 64 / kRadixBits;
+constexpr size_t kMinKeysPerThread = 16384;//これより少ないとジョブの同期の方が高くつく
+constexpr size_t kKeysPerJob = 4096;//キーの作成を分けるまとまり
+
+using Histogram = std::array<uint32_t, kRadixSize>;
+
+// 正のfloatはビット列の大小が値の大小と一致するため、上位24bitをそのまま使う
+uint64_t quantizeDepth(float viewDepth) {
+    float depth = std::max(viewDepth, 0.0f);
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return (bits >> 7) & kDepthMask;
+}
+
+uint32_t radixDigit(uint64_t key, uint32_t pass) {
+    return static_cast<uint32_t>(key >> (pass * kRadixBits)) & (kRadixSize - 1);
+}
+
+double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+uint64_t makeOpaqueSortKey(uint32_t pipeline, uint32_t material, float viewDepth) {
+    return ((pipeline & kPipelineMask) << 55)
+         | ((material & kMaterialMask) << 39)
+         | (quantizeDepth(viewDepth) << 15);
+}
+
+uint64_t makeTransparentSortKey(uint32_t pipeline, uint32_t material, float viewDepth) {
+    return (1ull << 63)
+         | ((kDepthMask - quantizeDepth(viewDepth)) << 39)
+         | ((pipeline & kPipelineMask) << 31)
+         | ((material & kMaterialMask) << 15);
+}
+
+uint32_t sortKeyPipeline(uint64_t key) {
+    return static_cast<uint32_t>(isTransparentSortKey(key) ? (key >> 31) & kPipelineMask : (key >> 55) & kPipelineMask);
+}
+
+uint32_t sortKeyMaterial(uint64_t key) {
+    return static_cast<uint32_t>(isTransparentSortKey(key) ? (key >> 15) & kMaterialMask : (key >> 39) & kMaterialMask);
+}
+
+void radixSort(std::vector<DrawKey>& keys, std::vector<DrawKey>& scratch, size_t threadCount, std::pmr::memory_resource* resource) {
+    const size_t count = keys.size();
+    scratch.resize(count);
+    if (count < 2) {
+        return;
+    }
+
+    JobSystem& jobs = JobSystem::instance();
+    if (threadCount == 0) {
+        threadCount = jobs.getThreadCount();
+    }
+    threadCount = std::clamp<size_t>(count / kMinKeysPerThread, 1, threadCount);
+
+    // 担当範囲（チャンク）ごとのヒストグラムと書き込み位置
+    // 作業領域はフレームアリーナから確保する
+    std::pmr::vector<std::array<Histogram, kRadixPasses>> histograms(threadCount, resource);
+    std::pmr::vector<Histogram> offsets(threadCount, resource);
+    std::pmr::vector<uint32_t> activePasses(resource);
+    activePasses.reserve(kRadixPasses);
+    DrawKey* src = keys.data();
+    DrawKey* dst = scratch.data();
+
+    auto chunkBegin = [&](size_t chunk) { return count * chunk / threadCount; };
+    // 各段階はチャンクごとのジョブで処理し、段階の間で合流する
+    auto forEachChunk = [&](auto&& body) {
+        jobs.parallelFor(threadCount, 1, [&](size_t begin, size_t end) {
+            PROFILE_ZONE("radixSort.chunk");
+            for (size_t chunk = begin; chunk < end; chunk++) {
+                body(chunk, chunkBegin(chunk), chunkBegin(chunk + 1));
+            }
+        });
+    };
+
+    // 最初は全桁のヒストグラムを1回の走査で作る
+    forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+        auto& histogram = histograms[chunk];
+        for (auto& h : histogram) {
+            h.fill(0);
+        }
+        for (size_t i = begin; i < end; i++) {
+            uint64_t key = src[i].key;
+            for (uint32_t pass = 0; pass < kRadixPasses; pass++) {
+                histogram[pass][radixDigit(key, pass)]++;
+            }
+        }
+    });
+
+    // 全要素で同じ値になる桁（未使用ビットなど）は並び替え不要
+    for (uint32_t pass = 0; pass < kRadixPasses; pass++) {
+        for (uint32_t digit = 0; digit < kRadixSize; digit++) {
+            size_t total = 0;
+            for (const auto& histogram : histograms) {
+                total += histogram[pass][digit];
+            }
+            if (total == count) {
+                break;
+            }
+            if (total != 0) {
+                activePasses.push_back(pass);
+                break;
+            }
+        }
+    }
+
+    for (size_t cursor = 0; cursor < activePasses.size(); cursor++) {
+        uint32_t pass = activePasses[cursor];
+        if (cursor > 0) {
+            // 並び替え後は担当範囲の中身が変わるため、この桁のヒストグラムを取り直す
+            forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+                Histogram& histogram = histograms[chunk][pass];
+                histogram.fill(0);
+                for (size_t i = begin; i < end; i++) {
+                    histogram[radixDigit(src[i].key, pass)]++;
+                }
+            });
+        }
+
+        uint32_t position = 0;
+        for (uint32_t digit = 0; digit < kRadixSize; digit++) {
+            for (size_t chunk = 0; chunk < threadCount; chunk++) {
+                offsets[chunk][digit] = position;
+                position += histograms[chunk][pass][digit];
+            }
+        }
+
+        forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+            Histogram& offset = offsets[chunk];
+            for (size_t i = begin; i < end; i++) {
+                dst[offset[radixDigit(src[i].key, pass)]++] = src[i];
+            }
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != keys.data()) {
+        keys.swap(scratch);
+    }
+}
+
+uint32_t pipelineIndexOf(const geometry::Primitive& primitive) {
+    uint32_t index = 0;
+    if (primitive.isTransparent) {
+        index |= 1;
+    }
+    if (primitive.attributes.hasJoints && primitive.attributes.hasWeights) {
+        index |= 2;
+    }
+    if (primitive.topology != vk::PrimitiveTopology::eTriangleList) {
+        index |= 4;
+    }
+    return index;
+}
+
+uint32_t collectDrawRecords(const geometry::Model& model, const glm::mat4& rootMatrix, uint32_t materialBase, std::vector<DrawRecord>& records) {
+    // マテリアル無しは各モデルの先頭番号を使う
+    uint32_t materialCount = 1;
+    for (const auto& node : model.nodes) {
+        auto it = model.gltfToMesh.find(node.meshIndex);
+        if (it == model.gltfToMesh.end()) {
+            continue;
+        }
+        for (const auto& primitive : model.meshes[it->second].primitives) {
+            uint32_t material = primitive.materialIndex == UINT32_MAX ? 0 : primitive.materialIndex + 1;
+            materialCount = std::max(materialCount, material + 1);
+            records.push_back({&primitive, rootMatrix * node.globalMatrix, pipelineIndexOf(primitive), materialBase + material});
+        }
+    }
+    return materialBase + materialCount;
+}
+
+namespace {
+
+DrawKey makeDrawKey(const DrawRecord& record, uint32_t drawIndex, const glm::mat4& viewMatrix) {
+    glm::vec4 center = viewMatrix * record.worldMatrix * glm::vec4(record.primitive->boundsCenter, 1.0f);
+    float viewDepth = -center.z;
+    uint64_t key = record.primitive->isTransparent
+        ? makeTransparentSortKey(record.pipelineIndex, record.materialIndex, viewDepth)
+        : makeOpaqueSortKey(record.pipelineIndex, record.materialIndex, viewDepth);
+    return {key, drawIndex};
+}
+
+} // namespace
+
+void DrawList::build(const std::vector<DrawRecord>& records, const glm::mat4& viewMatrix) {
+    keys.resize(records.size());
+    JobSystem::instance().parallelFor(records.size(), kKeysPerJob, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            keys[i] = makeDrawKey(records[i], static_cast<uint32_t>(i), viewMatrix);
+        }
+    });
+}
+
+void DrawList::buildTransparent(const std::vector<DrawRecord>& records, const std::vector<uint32_t>& visible, const glm::mat4& viewMatrix) {
+    keys.clear();
+    for (uint32_t index : visible) {
+        if (records[index].primitive->isTransparent) {
+            keys.push_back(makeDrawKey(records[index], index, viewMatrix));
+        }
+    }
+}
+
+void DrawList::sort(size_t threadCount, std::pmr::memory_resource* resource) {
+    PROFILE_ZONE("drawList.sort");
+    auto start = std::chrono::steady_clock::now();
+    radixSort(keys, scratch, threadCount, resource);
+    sortMilliseconds = elapsedMilliseconds(start);
+}
+
+DrawListStatistics DrawList::computeStatistics() const {
+    DrawListStatistics stats;
+    uint32_t currentPipeline = UINT32_MAX;
+    uint32_t currentMaterial = UINT32_MAX;
+    for (const DrawKey& drawKey : keys) {
+        if (isTransparentSortKey(drawKey.key)) {
+            stats.transparentDraws++;
+        } else {
+            stats.opaqueDraws++;
+        }
+        uint32_t pipeline = sortKeyPipeline(drawKey.key);
+        uint32_t material = sortKeyMaterial(drawKey.key);
+        if (pipeline != currentPipeline) {
+            stats.pipelineChanges++;
+            currentPipeline = pipeline;
+        }
+        if (material != currentMaterial) {
+            stats.materialChanges++;
+            currentMaterial = material;
+        }
+    }
+    return stats;
+}
+
+}
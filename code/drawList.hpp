@@ -0,0 +1,86 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace render {
+
+// 64bitソートキー
+// 不透明:  [63]=0 | [62..55] パイプライン | [54..39] マテリアル | [38..15] 深度（手前から奥）
+// 半透明:  [63]=1 | [62..39] 深度（奥から手前） | [38..31] パイプライン | [30..15] マテリアル
+// 不透明を先に描き、その中ではパイプライン・マテリアルの切り替えが最小になるよう並ぶ
+constexpr uint32_t kSortKeyPipelineBits = 8;
+constexpr uint32_t kSortKeyMaterialBits = 16;
+constexpr uint32_t kSortKeyDepthBits = 24;
+
+uint64_t makeOpaqueSortKey(uint32_t pipeline, uint32_t material, float viewDepth);
+uint64_t makeTransparentSortKey(uint32_t pipeline, uint32_t material, float viewDepth);
+
+inline bool isTransparentSortKey(uint64_t key) {
+    return (key >> 63) != 0;
+}
+uint32_t sortKeyPipeline(uint64_t key);
+uint32_t sortKeyMaterial(uint64_t key);
+
+// ソート対象（drawIndexは呼び出し側の描画レコードの番号）
+struct DrawKey {
+    uint64_t key;
+    uint32_t drawIndex;
+};
+
+// LSD基数ソート（8bit×8パス、全要素で値が同じ桁は飛ばす）
+// 要素数が少ない場合は分割しない。threadCount（分割数）= 0 でジョブシステムのスレッド数
+// 作業領域はresourceから確保する（フレームアリーナを渡せばヒープ確保は起きない）
+void radixSort(std::vector<DrawKey>& keys, std::vector<DrawKey>& scratch, size_t threadCount = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+// 描画1回分の情報
+struct DrawRecord {
+    const geometry::Primitive* primitive;
+    glm::mat4 worldMatrix;
+    uint32_t pipelineIndex;
+    uint32_t materialIndex;//モデルをまたいで一意な番号
+};
+
+// パイプラインの区別（スキニング・半透明・トポロジ）
+uint32_t pipelineIndexOf(const geometry::Primitive& primitive);
+
+// モデル内のメッシュを持つノードを描画レコードとして追加
+// materialBaseはモデルごとのマテリアル番号の開始位置。戻り値は次のモデルのmaterialBase
+uint32_t collectDrawRecords(const geometry::Model& model, const glm::mat4& rootMatrix, uint32_t materialBase, std::vector<DrawRecord>& records);
+
+struct DrawListStatistics {
+    uint64_t opaqueDraws = 0;
+    uint64_t transparentDraws = 0;
+    uint64_t pipelineChanges = 0;
+    uint64_t materialChanges = 0;
+};
+
+// 毎フレームキーを作り直してソートする描画リスト
+class DrawList {
+    public:
+        void clear() {
+            keys.clear();
+        }
+
+        void add(uint64_t key, uint32_t drawIndex) {
+            keys.push_back({key, drawIndex});
+        }
+
+        // 描画レコードとビュー行列からキーを作り直す
+        void build(const std::vector<DrawRecord>& records, const glm::mat4& viewMatrix);
+        // 可視判定を通った半透明のレコードのみ（visibleはrecordsの番号。描画時に並び順を使うのは半透明だけのため）
+        void buildTransparent(const std::vector<DrawRecord>& records, const std::vector<uint32_t>& visible, const glm::mat4& viewMatrix);
+
+        void sort(size_t threadCount = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        const std::vector<DrawKey>& getKeys() const { return keys; }
+        double getSortMilliseconds() const { return sortMilliseconds; }
+
+        // 現在の並び順で描いた場合のステート切り替え回数
+        DrawListStatistics computeStatistics() const;
+
+    private:
+        std::vector<DrawKey> keys;
+        std::vector<DrawKey> scratch;
+        double sortMilliseconds = 0.0;
+};
+
+}
@@ -0,0 +1,72 @@
+#include "dynamicResolution.hpp"
+
+namespace render {
+
+namespace {
+
+constexpr float kMinScaleChange = 0.02f;//これより小さい変化は無視する（描画の大きさが揺れないように）
+
+} // namespace
+
+ResolutionController::ResolutionController(const DynamicResolutionSettings& settings) {
+    setSettings(settings);
+}
+
+void ResolutionController::setSettings(const DynamicResolutionSettings& newSettings) {
+    settings = newSettings;
+    settings.maxScale = std::clamp(settings.maxScale, 0.01f, 1.0f);
+    settings.minScale = std::clamp(settings.minScale, 0.01f, settings.maxScale);
+    settings.historyFrames = std::max(settings.historyFrames, 1u);
+    reset();
+}
+
+void ResolutionController::reset() {
+    scale = settings.maxScale;
+    history.clear();
+    nextSample = 0;
+    framesSinceChange = 0;
+}
+
+float ResolutionController::fitScale(const Sample& sample) const {
+    double budget = settings.targetMilliseconds * settings.headroom;
+    return sample.scale * static_cast<float>(std::sqrt(budget / std::max(sample.milliseconds, 1e-3)));
+}
+
+void ResolutionController::changeScale(float newScale) {
+    scale = std::clamp(newScale, settings.minScale, settings.maxScale);
+    framesSinceChange = 0;
+}
+
+float ResolutionController::update(float measuredScale, double gpuMilliseconds) {
+    Sample sample{measuredScale, gpuMilliseconds};
+    if (history.size() < settings.historyFrames) {
+        history.push_back(sample);
+    } else {
+        history[nextSample] = sample;
+    }
+    nextSample = (nextSample + 1) % settings.historyFrames;
+    framesSinceChange++;
+
+    // 目標を超えたら、そのフレームだけから直ちに下げる
+    if (gpuMilliseconds > settings.targetMilliseconds) {
+        float fitted = fitScale(sample);
+        if (fitted < scale) {
+            changeScale(fitted);
+        }
+        return scale;
+    }
+
+    // 履歴の最も遅いフレームが予算に収まる倍率
+    float fitted = settings.maxScale;
+    for (const Sample& recorded : history) {
+        fitted = std::min(fitted, fitScale(recorded));
+    }
+    if (fitted < scale - kMinScaleChange) {
+        changeScale(fitted);
+    } else if (fitted > scale + kMinScaleChange && history.size() == settings.historyFrames && framesSinceChange >= settings.increaseInterval) {
+        changeScale(std::min(fitted, scale + settings.maxIncrease));
+    }
+    return scale;
+}
+
+}
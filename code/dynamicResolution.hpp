@@ -0,0 +1,58 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 動的解像度の設定
+struct DynamicResolutionSettings {
+    float targetMilliseconds = 16.6f;//グラフィックスキューの1フレームの目標時間
+    float headroom = 0.9f;//目標のこの割合を狙う（フレームごとのばらつきで目標を超えないように）
+    float minScale = 0.5f;//描画の大きさの倍率（一辺）
+    float maxScale = 1.0f;
+    float maxIncrease = 0.05f;//1回に上げる倍率の上限（下げる幅は制限しない）
+    uint32_t historyFrames = 16;//倍率を上げる判断に使うフレーム数
+    uint32_t increaseInterval = 8;//倍率を変えてから次に上げるまでのフレーム数
+};
+
+// 1フレームの記録（トレース用）
+struct ResolutionSample {
+    uint64_t frame;
+    float scale;
+    float gpuMilliseconds;
+};
+
+// GPU時間の履歴から描画の倍率を決める
+// GPU時間は画素数（倍率の2乗）に比例するとみなし、計測したフレームの時間を他の倍率での時間に換算する
+// 目標を超えたフレームがあれば直ちに下げ、履歴の最も遅いフレームでも余裕がある場合だけ少しずつ上げる
+class ResolutionController {
+    public:
+        explicit ResolutionController(const DynamicResolutionSettings& settings = {});
+
+        void setSettings(const DynamicResolutionSettings& newSettings);
+        const DynamicResolutionSettings& getSettings() const { return settings; }
+
+        // 計測したフレームの倍率とGPU時間を渡し、次のフレームの倍率を返す
+        float update(float measuredScale, double gpuMilliseconds);
+        float getScale() const { return scale; }
+
+        // 履歴を捨てて最大の倍率からやり直す
+        void reset();
+
+    private:
+        struct Sample {
+            float scale;
+            double milliseconds;
+        };
+
+        DynamicResolutionSettings settings;
+        float scale = 1.0f;
+        std::vector<Sample> history;//historyFrames個のリングバッファ
+        size_t nextSample = 0;
+        uint32_t framesSinceChange = 0;
+
+        // 予算に収まる倍率（計測したフレームから換算）
+        float fitScale(const Sample& sample) const;
+        void changeScale(float newScale);
+};
+
+}
@@ -0,0 +1,148 @@
+#include "vulkanContext.hpp"
+
+namespace {
+
+constexpr size_t kMaxTraceSamples = 1 << 16;//これを超えたフレームはトレースに記録しない（resetTraceで再開する）
+constexpr uint64_t kPrintInterval = 120;
+
+} // namespace
+
+//拡大の転送に対応しているかを調べる
+//倍率はGPU時間だけで決めるため、GPUプロファイラでタイムスタンプを取れないデバイスでは使わない
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::initDynamicResolution() {
+    PROFILE_ZONE("initDynamicResolution");
+    VulkanContext& context = deviceWrapper.context;
+    vk::FormatFeatureFlags features = context.physicalDevice.getFormatProperties(deviceWrapper.swapchainWrapper.getFormat()).optimalTilingFeatures;
+    filter = (features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) ? vk::Filter::eLinear : vk::Filter::eNearest;
+
+    supported = deviceWrapper.gpuProfilerWrapper.isSupported()
+                && deviceWrapper.swapchainWrapper.isTransferDstSupported()
+                && (features & vk::FormatFeatureFlagBits::eBlitSrc)
+                && (features & vk::FormatFeatureFlagBits::eBlitDst);
+
+    render::DynamicResolutionSettings settings = controller.getSettings();
+    if (const char* value = std::getenv("VKRENDERKIT_GPU_TARGET_MS")) {
+        settings.targetMilliseconds = std::stof(value);
+    }
+    controller.setSettings(settings);
+    scale = 1.0f;
+    renderExtent = deviceWrapper.swapchainWrapper.getExtent();
+
+    std::cout << "動的解像度: " << (supported ? "対応" : "非対応")
+              << " (目標 " << settings.targetMilliseconds << " ms, 倍率 " << settings.minScale << "〜" << settings.maxScale
+              << ", " << vk::to_string(filter) << ")" << std::endl;
+}
+
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::setEnabled(bool value) {
+    enabled = value;
+    controller.reset();
+    frameCounter = 0;
+    printMilliseconds = 0.0;
+    printMinScale = controller.getScale();
+}
+
+//描画先は出力と同じ大きさで作り、倍率を変えても作り直さない（前のフレームは完了済み）
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::beginFrame(vk::Extent2D outputExtent) {
+    active = enabled && supported;
+    if (active && targetImage.extent != outputExtent) {
+        targetImage = deviceWrapper.createImage(
+            outputExtent, 1, deviceWrapper.swapchainWrapper.getFormat(),
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc, vk::ImageAspectFlagBits::eColor);
+    }
+
+    scale = active ? controller.getScale() : 1.0f;
+    renderExtent = outputExtent;
+    if (active) {
+        renderExtent.width = std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.width * scale)));
+        renderExtent.height = std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.height * scale)));
+    }
+    frameZone = UINT32_MAX;
+}
+
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::beginFrameZone(vk::CommandBuffer commandBuffer) {
+    frameZone = deviceWrapper.gpuProfilerWrapper.beginZone(commandBuffer, "graphics queue", "frame");
+}
+
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::endFrameZone(vk::CommandBuffer commandBuffer) {
+    deviceWrapper.gpuProfilerWrapper.endZone(commandBuffer, frameZone);
+}
+
+//出力のイメージは以前の内容を捨てて転送先にし、転送後に表示できるレイアウトにする
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::recordUpscale(vk::CommandBuffer commandBuffer, vk::Image outputImage, vk::Extent2D outputExtent) {
+    uint32_t upscaleZone = deviceWrapper.gpuProfilerWrapper.beginZone(commandBuffer, "graphics queue", "upscale");
+    vk::ImageSubresourceRange colorRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    std::array<vk::ImageMemoryBarrier, 2> beforeBarriers = {
+        vk::ImageMemoryBarrier(
+            vk::AccessFlagBits::eColorAttachmentWrite,//srcAccessMask
+            vk::AccessFlagBits::eTransferRead,//dstAccessMask
+            vk::ImageLayout::eColorAttachmentOptimal,//oldLayout
+            vk::ImageLayout::eTransferSrcOptimal,//newLayout
+            VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+            targetImage.image.get(),//image
+            colorRange//subresourceRange
+        ),
+        vk::ImageMemoryBarrier(
+            {},//srcAccessMask
+            vk::AccessFlagBits::eTransferWrite,//dstAccessMask
+            vk::ImageLayout::eUndefined,//oldLayout
+            vk::ImageLayout::eTransferDstOptimal,//newLayout
+            VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+            outputImage,//image
+            colorRange//subresourceRange
+        )
+    };
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, beforeBarriers);
+
+    vk::ImageSubresourceLayers layers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    vk::ImageBlit region(
+        layers,//srcSubresource
+        {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1)},//srcOffsets
+        layers,//dstSubresource
+        {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int32_t>(outputExtent.width), static_cast<int32_t>(outputExtent.height), 1)}//dstOffsets
+    );
+    commandBuffer.blitImage(targetImage.image.get(), vk::ImageLayout::eTransferSrcOptimal, outputImage, vk::ImageLayout::eTransferDstOptimal, region, filter);
+
+    vk::ImageMemoryBarrier presentBarrier(
+        vk::AccessFlagBits::eTransferWrite,//srcAccessMask
+        {},//dstAccessMask
+        vk::ImageLayout::eTransferDstOptimal,//oldLayout
+        vk::ImageLayout::ePresentSrcKHR,//newLayout
+        VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+        outputImage,//image
+        colorRange//subresourceRange
+    );
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, presentBarrier);
+    deviceWrapper.gpuProfilerWrapper.endZone(commandBuffer, upscaleZone);
+}
+
+//フレーム完了後、GpuProfilerWrapper::collect()の後に呼ぶ（waitForFrameでフェンスの待機が済んでいる前提）
+//GPU時間はプロファイラのゾーンから読む（タイムスタンプの有効ビットでマスク済み）
+void VulkanContext::DeviceWrapper::DynamicResolutionWrapper::collect() {
+    double milliseconds = 0.0;
+    if (!deviceWrapper.gpuProfilerWrapper.getZoneMilliseconds(frameZone, milliseconds)) {
+        return;
+    }
+    if (trace.size() < kMaxTraceSamples) {
+        trace.push_back({deviceWrapper.context.frameNumber, scale, static_cast<float>(milliseconds)});
+    }
+    if (!active) {
+        return;
+    }
+    controller.update(scale, milliseconds);
+
+    // 一定フレームごとに平均を出力
+    printMilliseconds += milliseconds;
+    printMinScale = std::min(printMinScale, scale);
+    if (++frameCounter % kPrintInterval != 0) {
+        return;
+    }
+    if (deviceWrapper.context.statisticsOutput) {
+        std::cout << "動的解像度: 倍率 " << scale << " (最小 " << printMinScale << "), 描画 " << renderExtent.width << "x" << renderExtent.height
+                  << ", GPU " << printMilliseconds / kPrintInterval << " ms (目標 " << controller.getSettings().targetMilliseconds << " ms)" << std::endl;
+    }
+    printMilliseconds = 0.0;
+    printMinScale = controller.getScale();
+}
@@ -0,0 +1,90 @@
+#include "frameArena.hpp"
+
+namespace render {
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment) {
+    if (!blocks.empty()) {
+        Block& block = blocks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        uintptr_t aligned = (base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (aligned + bytes <= base + block.size) {
+            offset = aligned + bytes - base;
+            usedBytes += bytes;
+            return reinterpret_cast<void*>(aligned);
+        }
+    }
+
+    // 足りない場合は新しいブロックを追加する（大きな要求はそのサイズで確保）
+    size_t size = std::max(blockSize, bytes + alignment);
+    blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    uintptr_t base = reinterpret_cast<uintptr_t>(blocks.back().data.get());
+    uintptr_t aligned = (base + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    offset = aligned + bytes - base;
+    usedBytes += bytes;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void LinearArena::reset() {
+    // 複数ブロックに分かれた場合は、次のフレームで確保が起きないよう1ブロックにまとめる
+    if (blocks.size() > 1) {
+        blockSize = getCapacity();
+        blocks.clear();
+        blocks.push_back({std::make_unique<std::byte[]>(blockSize), blockSize});
+    }
+    offset = 0;
+    usedBytes = 0;
+}
+
+size_t LinearArena::getCapacity() const {
+    size_t capacity = 0;
+    for (const Block& block : blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+FrameArena::FrameArena() {
+    for (auto& frameArenas : arenas) {
+        frameArenas.resize(kMaxArenaThreads);
+    }
+}
+
+uint32_t FrameArena::threadIndex() {
+    static std::atomic<uint32_t> nextIndex{0};
+    thread_local uint32_t index = nextIndex.fetch_add(1);
+    return index;
+}
+
+void FrameArena::beginFrame(uint64_t frameNumber) {
+    frameSlot = static_cast<uint32_t>(frameNumber % kFramesInFlight);
+    for (auto& arena : arenas[frameSlot]) {
+        if (arena) {
+            arena->reset();
+        }
+    }
+}
+
+std::pmr::memory_resource* FrameArena::getThreadResource() {
+    uint32_t index = threadIndex();
+    if (!arenaEnabled || index >= kMaxArenaThreads) {
+        return std::pmr::new_delete_resource();
+    }
+    // アリーナはそのスレッドが初めて使うときに作る（各スレッドは自分の要素のみ触る）
+    std::unique_ptr<LinearArena>& arena = arenas[frameSlot][index];
+    if (!arena) {
+        arena = std::make_unique<LinearArena>();
+    }
+    return arena.get();
+}
+
+size_t FrameArena::getUsedBytes() const {
+    size_t used = 0;
+    for (const auto& arena : arenas[frameSlot]) {
+        if (arena) {
+            used += arena->getUsedBytes();
+        }
+    }
+    return used;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 線形アロケータ（個別の解放はせず、reset()でまとめて解放する）
+// ブロックが足りなくなった場合は追加で確保し、次のreset()で合計サイズの1ブロックにまとめる
+class LinearArena : public std::pmr::memory_resource {
+    public:
+        explicit LinearArena(size_t initialBlockSize = 64 * 1024) : blockSize(initialBlockSize) {}
+
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        void reset();
+
+        size_t getUsedBytes() const { return usedBytes; }
+        size_t getCapacity() const;
+
+    private:
+        struct Block {
+            std::unique_ptr<std::byte[]> data;
+            size_t size;
+        };
+        std::vector<Block> blocks;
+        size_t blockSize;
+        size_t offset = 0;//最後のブロック内の位置
+        size_t usedBytes = 0;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+
+constexpr uint32_t kFramesInFlight = 2;
+constexpr uint32_t kMaxArenaThreads = 64;
+
+// フレームごと・スレッドごとのアリーナ
+// フレームのフェンスがシグナルされ、そのフレームのGPU処理が終わった時点でbeginFrame()でまとめて解放する
+// スレッドは初回使用時に番号を割り当て、上限を超えたスレッドは通常のヒープを使う
+class FrameArena {
+    public:
+        FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+        FrameArena(FrameArena&&) noexcept = default;
+        FrameArena& operator=(FrameArena&&) noexcept = default;
+
+        void beginFrame(uint64_t frameNumber);
+
+        // 現在のフレーム・呼び出し元スレッドのリソース
+        std::pmr::memory_resource* getThreadResource();
+
+        // 無効時は通常のヒープを返す（比較計測用）
+        void setEnabled(bool enabled) { arenaEnabled = enabled; }
+        bool isEnabled() const { return arenaEnabled; }
+
+        size_t getUsedBytes() const;
+
+    private:
+        std::array<std::vector<std::unique_ptr<LinearArena>>, kFramesInFlight> arenas;
+        uint32_t frameSlot = 0;
+        bool arenaEnabled = true;
+
+        static uint32_t threadIndex();
+};
+
+}
@@ -0,0 +1,103 @@
+#include "framePacer.hpp"
+
+namespace render {
+
+namespace {
+
+constexpr double kAverageWeight = 0.1;
+constexpr double kPeakDecay = 0.98;
+
+double toMilliseconds(FramePacer::Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}
+
+const char* presentPolicyName(PresentPolicy policy) {
+    switch (policy) {
+        case PresentPolicy::LowLatency:
+            return "低遅延";
+        case PresentPolicy::PowerSaving:
+            return "省電力";
+        case PresentPolicy::FifoRelaxed:
+            return "FIFO_RELAXED";
+        default:
+            return "不明";
+    }
+}
+
+vk::PresentModeKHR choosePresentMode(PresentPolicy policy, const std::vector<vk::PresentModeKHR>& availableModes) {
+    std::vector<vk::PresentModeKHR> candidates;
+    switch (policy) {
+        case PresentPolicy::LowLatency:
+            candidates = {vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+            break;
+        case PresentPolicy::FifoRelaxed:
+            candidates = {vk::PresentModeKHR::eFifoRelaxed};
+            break;
+        default:
+            break;
+    }
+
+    for (vk::PresentModeKHR candidate : candidates) {
+        if (std::find(availableModes.begin(), availableModes.end(), candidate) != availableModes.end()) {
+            return candidate;
+        }
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
+uint32_t chooseImageCount(vk::PresentModeKHR presentMode, const vk::SurfaceCapabilitiesKHR& capabilities) {
+    uint32_t imageCount = presentMode == vk::PresentModeKHR::eMailbox ? 3 : 2;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount != 0) {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+    return imageCount;
+}
+
+void FramePacer::waitForNextFrame() {
+    if (!pacingEnabled || !hasHistory) {
+        return;
+    }
+
+    // 次の表示に間に合う最も遅い時刻まで入力の取得を遅らせる
+    double budget = presentIntervalMilliseconds - std::max(workMilliseconds, workPeakMilliseconds) - safetyMarginMilliseconds;
+    if (budget <= 0.0) {
+        return;
+    }
+    auto wakeTime = lastPresent + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(budget));
+    if (wakeTime > Clock::now()) {
+        std::this_thread::sleep_until(wakeTime);
+    }
+}
+
+void FramePacer::markInputSampled() {
+    inputSampled = Clock::now();
+}
+
+double FramePacer::markPresented() {
+    Clock::time_point now = Clock::now();
+    double latency = toMilliseconds(now - inputSampled);
+
+    if (hasHistory) {
+        double interval = toMilliseconds(now - lastPresent);
+        presentIntervalMilliseconds += (interval - presentIntervalMilliseconds) * kAverageWeight;
+        workMilliseconds += (latency - workMilliseconds) * kAverageWeight;
+        workPeakMilliseconds = std::max(latency, workPeakMilliseconds * kPeakDecay);
+    } else {
+        // 初回は待機しない値で始める
+        presentIntervalMilliseconds = 0.0;
+        workMilliseconds = latency;
+        workPeakMilliseconds = latency;
+        hasHistory = true;
+    }
+    lastPresent = now;
+    return latency;
+}
+
+void FramePacer::reset() {
+    hasHistory = false;
+}
+
+}
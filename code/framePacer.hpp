@@ -0,0 +1,57 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 表示方式の方針
+enum class PresentPolicy {
+    LowLatency,     // MAILBOX → IMMEDIATE → FIFO（ティアリングよりも遅延を優先）
+    PowerSaving,    // FIFO（垂直同期で待つため消費電力が少ない）
+    FifoRelaxed,    // FIFO_RELAXED → FIFO（間に合わなかったフレームだけ即時表示）
+    Count
+};
+
+const char* presentPolicyName(PresentPolicy policy);
+
+// 方針に合う表示モードを選ぶ（FIFOは必ず対応しているため最後の候補にする）
+vk::PresentModeKHR choosePresentMode(PresentPolicy policy, const std::vector<vk::PresentModeKHR>& availableModes);
+
+// スワップチェインのイメージ数
+// MAILBOXは3枚で常に空きを作り、FIFO系は最小枚数にしてキューに溜まるフレームを減らす
+uint32_t chooseImageCount(vk::PresentModeKHR presentMode, const vk::SurfaceCapabilitiesKHR& capabilities);
+
+// フレームペーシング
+// 直前の表示から次の表示までの間隔とフレームの処理時間を予測し、
+// 入力の取得をなるべく表示直前まで遅らせて入力から表示までの遅延を縮める
+class FramePacer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        void setEnabled(bool enabled) { pacingEnabled = enabled; }
+        bool isEnabled() const { return pacingEnabled; }
+
+        // 入力を取得する直前に呼ぶ（必要なら待機する）
+        void waitForNextFrame();
+        // 入力を取得した時点で呼ぶ
+        void markInputSampled();
+        // 表示を要求した直後に呼ぶ。入力から表示の要求までの遅延（ミリ秒）を返す
+        // イメージの取得の待ちは入力の取得より前に済ませ、GPUの完了は待たない（FIFOでも処理時間が表示間隔に収まる）
+        double markPresented();
+
+        // 表示方式を変えたときは予測をやり直す
+        void reset();
+
+    private:
+        bool pacingEnabled = true;
+        bool hasHistory = false;
+
+        Clock::time_point lastPresent;
+        Clock::time_point inputSampled;
+
+        double presentIntervalMilliseconds = 0.0;//表示間隔の移動平均
+        double workMilliseconds = 0.0;//入力から表示の要求までの処理時間の移動平均
+        double workPeakMilliseconds = 0.0;//処理時間の緩やかに減衰する最大値（待ちすぎ防止）
+        double safetyMarginMilliseconds = 1.0;
+};
+
+}
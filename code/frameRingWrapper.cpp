@@ -0,0 +1,71 @@
+#include "vulkanContext.hpp"
+
+//リングバッファの作成（partitionBytes × フレーム数 + 余白）
+void VulkanContext::DeviceWrapper::FrameRingWrapper::initFrameRing(vk::DeviceSize partitionBytes) {
+    vk::PhysicalDeviceLimits limits = deviceWrapper.context.physicalDevice.getProperties().limits;
+    alignment = std::max<vk::DeviceSize>({limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16});
+    partitionSize = (partitionBytes + alignment - 1) / alignment * alignment;
+
+    // ダイナミックオフセット + ディスクリプタの範囲がバッファに収まるよう、末尾にオブジェクト範囲分の余白を取る
+    vk::DeviceSize objectRange = std::min<vk::DeviceSize>(partitionSize, limits.maxStorageBufferRange);
+    ringBuffer = deviceWrapper.createBuffer(
+        partitionSize * render::kFramesInFlight + objectRange,
+        vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+
+    vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    if (deviceWrapper.context.capabilities.meshShader) {
+        stages |= vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT;
+    }
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1, stages),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBufferDynamic, 1, stages)
+    };
+    descriptorSetLayout = deviceWrapper.device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 1),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBufferDynamic, 1)
+    };
+    descriptorPool = deviceWrapper.device->createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, 1, poolSizes));
+    descriptorSet = deviceWrapper.device->allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), 1, &descriptorSetLayout.get())).front();
+
+    // ディスクリプタは作成時に1度だけ書き込む
+    vk::DescriptorBufferInfo cameraInfo(ringBuffer.buffer.get(), 0, sizeof(CameraConstants));
+    vk::DescriptorBufferInfo objectInfo(ringBuffer.buffer.get(), 0, objectRange);
+    std::vector<vk::WriteDescriptorSet> writes = {
+        vk::WriteDescriptorSet(descriptorSet, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic, nullptr, &cameraInfo),
+        vk::WriteDescriptorSet(descriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBufferDynamic, nullptr, &objectInfo)
+    };
+    deviceWrapper.device->updateDescriptorSets(writes, {});
+
+    beginFrame(0);
+}
+
+void VulkanContext::DeviceWrapper::FrameRingWrapper::beginFrame(uint64_t frameNumber) {
+    frameBegin = (frameNumber % render::kFramesInFlight) * partitionSize;
+    cursor = frameBegin;
+}
+
+VulkanContext::DeviceWrapper::FrameRingWrapper::Allocation VulkanContext::DeviceWrapper::FrameRingWrapper::allocate(vk::DeviceSize size) {
+    vk::DeviceSize offset = (cursor + alignment - 1) / alignment * alignment;
+    if (offset + size > frameBegin + partitionSize) {
+        throw std::runtime_error("フレームリングバッファの容量が不足しています");
+    }
+    cursor = offset + size;
+    return {static_cast<uint32_t>(offset), static_cast<std::byte*>(ringBuffer.mapped) + offset};
+}
+
+uint32_t VulkanContext::DeviceWrapper::FrameRingWrapper::writeCamera(const CameraConstants& camera) {
+    Allocation allocation = allocate(sizeof(CameraConstants));
+    std::memcpy(allocation.data, &camera, sizeof(CameraConstants));
+    cameraOffset = allocation.offset;
+    return cameraOffset;
+}
+
+uint32_t VulkanContext::DeviceWrapper::FrameRingWrapper::writeObjects(const ObjectConstants* objects, size_t count) {
+    Allocation allocation = allocate(count * sizeof(ObjectConstants));
+    std::memcpy(allocation.data, objects, count * sizeof(ObjectConstants));
+    return allocation.offset;
+}
@@ -1,322 +1,700 @@
-#include "geometry.hpp"
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <tiny_gltf.h>
-
-namespace geometry
-{
-    
-void Model::readGLTF(std::string filename){
-    tinygltf::Model model;
-    tinygltf::TinyGLTF loader;
-    std::string err, warn;
-    std::vector<Scene> scenes;
-
-    std::string extension = filename.substr(filename.find_last_of(".") + 1);
-    if (extension != "gltf" && extension != "glb") {
-        throw std::runtime_error("GLTFファイルではありません");
-    }
-
-    bool ret = extension == "gltf" ? loader.LoadASCIIFromFile(&model, &err, &warn, filename) : loader.LoadBinaryFromFile(&model, &err, &warn, filename);
-
-    if (!warn.empty()) {
-        std::cout << "Warn: " << warn << std::endl;
-    }
-    if (!err.empty()) {
-        std::cout << "Err: " << err << std::endl;
-    }
-    if (!ret) {
-        throw std::runtime_error("GLTFファイルの読み込みに失敗しました");
-    }
-
-    
-    for(size_t i = 0; i < model.scenes.size(); i++) {
-        Scene scene;
-        scene.name = model.scenes[i].name;
-        for(size_t j = 0; j < model.scenes[i].nodes.size(); j++) {
-            uint32_t rootIndex = readNode(model, model.scenes[i].nodes[j], -1);
-            scene.rootNodeIndices.push_back(rootIndex);
-        }
-        scenes.push_back(scene);
-    }
-    dumpGLTF(model);
-}
-
-uint32_t Model::readNode(tinygltf::Model &model, uint32_t gltfNodeIndex, int32_t parentIndex) {
-    //すでに読み込まれているノードの場合はインデックスを返す
-    if (gltfToNode.find(gltfNodeIndex) != gltfToNode.end()) {
-        if(parentIndex != -1) {
-            nodes[gltfToNode[gltfNodeIndex]].parents.push_back(parentIndex);
-        }
-
-        return gltfToNode[gltfNodeIndex];
-    }
-    
-    //ノード作成とプロパティ設定
-    tinygltf::Node node = model.nodes[gltfNodeIndex];
-    Node newNode;
-    newNode.parents.push_back(parentIndex);
-    newNode.meshIndex = node.mesh;
-    
-    //トランスフォーム設定 - GLTFの仕様に従う
-    if (!node.matrix.empty()) {
-        // 行列が明示的に指定されている場合
-        newNode.localMatrix = glm::make_mat4(node.matrix.data());
-        
-        // オプション: 行列からTRSを抽出
-        glm::vec3 skew;
-        glm::vec4 perspective;
-        glm::decompose(newNode.localMatrix, 
-                    newNode.transform.scale,
-                    newNode.transform.rotation, 
-                    newNode.transform.translation, 
-                    skew, perspective);
-    } else {
-        // TRSが指定されている場合
-        if (!node.translation.empty()) {
-            newNode.transform.translation = glm::make_vec3(node.translation.data());
-        }
-        if (!node.rotation.empty()) {
-            newNode.transform.rotation = glm::make_quat(node.rotation.data());
-        }
-        if (!node.scale.empty()) {
-            newNode.transform.scale = glm::make_vec3(node.scale.data());
-        }
-        
-        // TRSから行列を計算
-        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), newNode.transform.translation);
-        glm::mat4 rotationMatrix = glm::mat4_cast(newNode.transform.rotation);
-        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), newNode.transform.scale);
-        
-        // T * R * S の順に適用
-        newNode.localMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-    }
-    
-    //メッシュの読み込み
-    if (node.mesh != -1) {
-        readMesh(model, node.mesh);
-    }
-
-    //ノードを追加し、インデックスを保存
-    uint32_t currentIndex = static_cast<uint32_t>(nodes.size());
-    nodes.push_back(newNode);
-    nodes[currentIndex].nodeIndex = currentIndex;
-    gltfToNode[gltfNodeIndex] = currentIndex;
-    
-    //子ノードを処理
-    for(size_t i = 0; i < node.children.size(); i++) {
-        uint32_t childIndex = readNode(model, node.children[i], currentIndex);
-        nodes[currentIndex].children.push_back(childIndex);
-    }
-    
-    return currentIndex;
-}
-
-void Model::readMesh(tinygltf::Model &model, uint32_t gltfMeshIndex){
-
-    if(gltfToMesh.find(gltfMeshIndex) != gltfToMesh.end()) {
-        return;
-    }
-
-    tinygltf::Mesh mesh = model.meshes[gltfMeshIndex];
-    Mesh newMesh;
-    meshes.push_back(newMesh);
-    meshes[meshes.size() - 1].meshIndex = meshes.size() - 1;
-    gltfToMesh[gltfMeshIndex] = meshes.size() - 1;
-    for(size_t i = 0; i < mesh.primitives.size(); i++) {
-        meshes[meshes.size() - 1].primitives.push_back(readPrimitive(model, mesh.primitives[i]));
-    }
-}
-
-Primitive Model::readPrimitive(tinygltf::Model &model, tinygltf::Primitive &primitive){
-    Primitive newPrimitive;
-    
-    // インデックスバッファ情報の抽出
-    if (primitive.indices >= 0) {
-        const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
-        newPrimitive.indexCount = static_cast<uint32_t>(indexAccessor.count);
-        // firstIndexはバッファ読み込み時に設定
-    } else {
-        // インデックスバッファが無い場合は頂点数をカウント
-        // 頂点数は最初のアトリビュートから取得（通常はPOSITION）
-        if (!primitive.attributes.empty()) {
-            auto it = primitive.attributes.find("POSITION");
-            if (it != primitive.attributes.end()) {
-                const tinygltf::Accessor &posAccessor = model.accessors[it->second];
-                newPrimitive.indexCount = static_cast<uint32_t>(posAccessor.count);
-            }
-        }
-    }
-
-    newPrimitive.attributes = {};
-    for (const auto &attrib : primitive.attributes) {
-        if (attrib.first == "NORMAL") {
-            newPrimitive.attributes.hasNormals = true;
-        } else if (attrib.first == "TANGENT") {
-            newPrimitive.attributes.hasTangents = true;
-        } else if (attrib.first.rfind("TEXCOORD", 0) == 0) {
-            newPrimitive.attributes.hasTexCoords = true;
-        } else if (attrib.first.rfind("COLOR", 0) == 0) {
-            newPrimitive.attributes.hasColors = true;
-        } else if (attrib.first.rfind("JOINTS", 0) == 0) {
-            newPrimitive.attributes.hasJoints = true;
-        } else if (attrib.first.rfind("WEIGHTS", 0) == 0) {
-            newPrimitive.attributes.hasWeights = true;
-        }
-    }
-
-    
-
-    // トポロジーの設定
-    switch (primitive.mode) {
-        case TINYGLTF_MODE_POINTS:
-            newPrimitive.topology = vk::PrimitiveTopology::ePointList;
-            break;
-        case TINYGLTF_MODE_LINE:
-            newPrimitive.topology = vk::PrimitiveTopology::eLineList;
-            break;
-        case TINYGLTF_MODE_LINE_LOOP:
-        case TINYGLTF_MODE_LINE_STRIP:
-            newPrimitive.topology = vk::PrimitiveTopology::eLineStrip;
-            break;
-        case TINYGLTF_MODE_TRIANGLE_STRIP:
-            newPrimitive.topology = vk::PrimitiveTopology::eTriangleStrip;
-            break;
-        case TINYGLTF_MODE_TRIANGLE_FAN:
-            newPrimitive.topology = vk::PrimitiveTopology::eTriangleFan;
-            break;
-        case TINYGLTF_MODE_TRIANGLES:
-        default:
-            newPrimitive.topology = vk::PrimitiveTopology::eTriangleList;
-            break;
-    }
-
-    // マテリアルインデックス
-    newPrimitive.materialIndex = primitive.material >= 0 ? 
-                                static_cast<uint32_t>(primitive.material) : 
-                                UINT32_MAX;  // 無効値
-
-    if (primitive.material != -1) {
-        //loadMaterial(model, model.materials[primitive.material]);
-    }
-
-    // 透明度フラグの設定（マテリアル情報から決定）
-    newPrimitive.isTransparent = false;
-    if (primitive.material >= 0 && primitive.material < model.materials.size()) {
-        const auto &material = model.materials[primitive.material];
-        // アルファモードとアルファ値をチェック
-        if (material.alphaMode == "BLEND") {
-            newPrimitive.isTransparent = true;
-        } else if (material.alphaMode == "MASK" && material.alphaCutoff < 1.0f) {
-            newPrimitive.isTransparent = true;
-        } else if (!material.pbrMetallicRoughness.baseColorFactor.empty() && 
-                  material.pbrMetallicRoughness.baseColorFactor.size() >= 4 && 
-                  material.pbrMetallicRoughness.baseColorFactor[3] < 1.0f) {
-            newPrimitive.isTransparent = true;
-        }
-    }
-    
-    return newPrimitive;
-}
-
-
-
-}
-
-
-void dumpGLTF(tinygltf::Model &model) {
-    for(size_t i = 0; i < model.scenes.size(); i++) {
-        std::cout << "Scene " << i << std::endl;
-        for(size_t j = 0; j < model.scenes[i].nodes.size(); j++) {
-            dumpNode(model, model.nodes[model.scenes[i].nodes[j]], j, 1);
-        }        
-    }    
-}
-
-void dumpSpace(uint32_t depth) {
-    for(uint32_t i = 0; i < depth; i++) {
-        std::cout << "|    ";
-    }
-}
-
-void dumpNode(tinygltf::Model &model, tinygltf::Node &node, uint32_t nodeIndex, uint32_t depth) {
-    dumpSpace(depth);
-    std::cout << "Node " << nodeIndex << " : " << node.name << std::endl;
-    
-    if (node.camera != -1) {
-        dumpSpace(depth);
-        std::cout << "  Camera: " << node.camera << std::endl;
-    }
-    if (!node.translation.empty()) {
-        dumpSpace(depth);
-        std::cout << "  Translation: ";
-        for (const auto &t : node.translation) {
-            std::cout << t << " ";
-        }
-        std::cout << std::endl;
-    }
-    if (!node.rotation.empty()) {
-        dumpSpace(depth);
-        std::cout << "  Rotation: ";
-        for (const auto &r : node.rotation) {
-            std::cout << r << " ";
-        }
-        std::cout << std::endl;
-    }
-    if (!node.scale.empty()) {
-        dumpSpace(depth);
-        std::cout << "  Scale: ";
-        for (const auto &s : node.scale) {
-            std::cout << s << " ";
-        }
-        std::cout << std::endl;
-    }
-    if (!node.matrix.empty()) {
-        dumpSpace(depth);
-        std::cout << "  Matrix: ";
-        for (const auto &m : node.matrix) {
-            std::cout << m << " ";
-        }
-        std::cout << std::endl;
-    }
-    if (node.mesh != -1) {
-        dumpSpace(depth);
-        std::cout << "  Mesh: " << node.mesh << std::endl;
-        dumpMesh(model, model.meshes[node.mesh], depth + 1);
-    }
-    for(size_t i = 0; i < node.children.size(); i++) {
-        uint32_t nodeIndex = node.children[i];
-        dumpNode(model, model.nodes[node.children[i]], nodeIndex, depth + 1);
-    }
-}
-
-void dumpMesh(tinygltf::Model &model, tinygltf::Mesh &mesh, uint32_t depth) {
-    dumpSpace(depth);
-    std::cout << "Mesh: " << mesh.name << std::endl;
-
-    for(size_t i = 0; i < mesh.primitives.size(); i++) {
-        dumpPrimitive(model, mesh.primitives[i], depth + 1);
-    }
-}
-
-void dumpPrimitive(tinygltf::Model &model, tinygltf::Primitive &primitive, uint32_t depth) {
-    dumpSpace(depth);
-    std::cout << "Primitive: " << std::endl;
-
-    for (const auto &attrib : primitive.attributes) {
-        dumpSpace(depth + 1);
-        std::cout << "Attribute: " << attrib.first << " (Accessor ID: " << attrib.second << ")" << std::endl;
-    }
-
-    if (primitive.indices != -1) {
-        dumpSpace(depth + 1);
-        std::cout << "Indices (Accessor ID): " << primitive.indices << std::endl;
-    }
-
-    dumpSpace(depth + 1);
-    std::cout << "Material: " << primitive.material << std::endl;
-
-    dumpSpace(depth + 1);
-    std::cout << "Mode: " << primitive.mode << std::endl;
-}
+#include "geometry.hpp"
+#include "profiler.hpp"
+#include "jobSystem.hpp"
+#include "morphTarget.hpp"
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <tiny_gltf.h>
+
+namespace geometry
+{
+
+namespace {
+
+//アクセサの1要素を正規化を考慮してfloatとして読み込む
+float readComponentAsFloat(const unsigned char* data, int componentType, bool normalized) {
+    switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+            float value;
+            std::memcpy(&value, data, sizeof(float));
+            return value;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+            uint8_t value = *data;
+            return normalized ? value / 255.0f : static_cast<float>(value);
+        }
+        case TINYGLTF_COMPONENT_TYPE_BYTE: {
+            int8_t value = static_cast<int8_t>(*data);
+            return normalized ? std::max(value / 127.0f, -1.0f) : static_cast<float>(value);
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(uint16_t));
+            return normalized ? value / 65535.0f : static_cast<float>(value);
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT: {
+            int16_t value;
+            std::memcpy(&value, data, sizeof(int16_t));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(uint32_t));
+            return static_cast<float>(value);
+        }
+        default:
+            throw std::runtime_error("未対応のコンポーネント型です");
+    }
+}
+
+//アクセサの1要素を整数として読み込む（インデックス・ジョイント用）
+uint32_t readComponentAsUint(const unsigned char* data, int componentType) {
+    switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            return *data;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(uint16_t));
+            return value;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(uint32_t));
+            return value;
+        }
+        default:
+            throw std::runtime_error("未対応のインデックス型です");
+    }
+}
+
+//bufferViewのbyteOffsetからbyteLengthバイトの先頭を返す（バッファの範囲を超える場合は例外）
+const unsigned char* bufferViewData(const tinygltf::Model& model, int bufferViewIndex, size_t byteOffset, size_t byteLength) {
+    if (bufferViewIndex < 0 || static_cast<size_t>(bufferViewIndex) >= model.bufferViews.size()) {
+        throw std::runtime_error("bufferViewの番号が不正です");
+    }
+    const tinygltf::BufferView& bufferView = model.bufferViews[bufferViewIndex];
+    if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= model.buffers.size()) {
+        throw std::runtime_error("bufferの番号が不正です");
+    }
+    const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+    if (bufferView.byteOffset + bufferView.byteLength > buffer.data.size() || byteOffset + byteLength > bufferView.byteLength) {
+        throw std::runtime_error("アクセサがバッファの範囲外を参照しています");
+    }
+    return buffer.data.data() + bufferView.byteOffset + byteOffset;
+}
+
+//アクセサの要素ごとにコールバックを呼ぶ
+//callback(要素番号, 要素先頭ポインタ, コンポーネント数, コンポーネントサイズ)
+//疎なアクセサは密な部分（bufferViewが無ければ呼ばない）の後に、置き換える要素ごとに同じ番号で呼び直す
+template<typename Func>
+void forEachAccessorElement(const tinygltf::Model& model, const tinygltf::Accessor& accessor, Func callback) {
+    int componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+    int componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    if (componentCount <= 0 || componentSize <= 0) {
+        throw std::runtime_error("アクセサの型が不正です");
+    }
+    size_t elementSize = static_cast<size_t>(componentCount) * componentSize;
+
+    if (accessor.bufferView >= 0 && accessor.count > 0) {
+        if (static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size()) {
+            throw std::runtime_error("bufferViewの番号が不正です");
+        }
+        int stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+        if (stride <= 0) {
+            throw std::runtime_error("アクセサのストライドが不正です");
+        }
+        const unsigned char* base = bufferViewData(model, accessor.bufferView, accessor.byteOffset, (accessor.count - 1) * stride + elementSize);
+        for (size_t i = 0; i < accessor.count; i++) {
+            callback(i, base + i * stride, componentCount, componentSize);
+        }
+    }
+
+    if (accessor.sparse.isSparse && accessor.sparse.count > 0) {
+        const auto& sparse = accessor.sparse;
+        size_t sparseCount = static_cast<size_t>(sparse.count);
+        int indexSize = tinygltf::GetComponentSizeInBytes(sparse.indices.componentType);
+        if (indexSize <= 0) {
+            throw std::runtime_error("疎なアクセサのインデックス型が不正です");
+        }
+        const unsigned char* indexBase = bufferViewData(model, sparse.indices.bufferView, sparse.indices.byteOffset, sparseCount * indexSize);
+        const unsigned char* valueBase = bufferViewData(model, sparse.values.bufferView, sparse.values.byteOffset, sparseCount * elementSize);
+        for (size_t k = 0; k < sparseCount; k++) {
+            uint32_t index = readComponentAsUint(indexBase + k * indexSize, sparse.indices.componentType);
+            if (index >= accessor.count) {
+                throw std::runtime_error("疎なアクセサの要素番号が範囲外です");
+            }
+            callback(index, valueBase + k * elementSize, componentCount, componentSize);
+        }
+    }
+}
+
+//float系アトリビュートを最大4要素まで読み込む（要素数はPOSITIONと同じであること）
+template<typename Vec>
+void readFloatAttribute(const tinygltf::Model& model, int accessorIndex, std::vector<StaticVertexAttributes>& vertices, Vec StaticVertexAttributes::* member) {
+    const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+    if (accessor.count != vertices.size()) {
+        throw std::runtime_error("アトリビュートの要素数がPOSITIONと一致しません");
+    }
+    forEachAccessorElement(model, accessor, [&](size_t i, const unsigned char* data, int componentCount, int componentSize) {
+        Vec& dst = vertices[i].*member;
+        for (int c = 0; c < std::min<int>(componentCount, Vec::length()); c++) {
+            dst[c] = readComponentAsFloat(data + c * componentSize, accessor.componentType, accessor.normalized);
+        }
+    });
+}
+
+//モーフターゲットの位置の差分を読み込み、動く頂点だけを残す
+//疎なアクセサは密な部分（無ければ0）の上に指定された要素を上書きする
+MorphTarget readMorphTarget(const tinygltf::Model& model, int accessorIndex, size_t vertexCount) {
+    const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+    std::vector<glm::vec3> deltas(vertexCount, glm::vec3(0.0f));
+    forEachAccessorElement(model, accessor, [&](size_t i, const unsigned char* data, int componentCount, int componentSize) {
+        if (i >= vertexCount) {
+            return;
+        }
+        glm::vec3 delta(0.0f);
+        for (int c = 0; c < std::min(componentCount, 3); c++) {
+            delta[c] = readComponentAsFloat(data + c * componentSize, accessor.componentType, accessor.normalized);
+        }
+        deltas[i] = delta;
+    });
+    return makeSparseMorphTarget(deltas);
+}
+
+std::vector<float> toFloatWeights(const std::vector<double>& weights) {
+    return std::vector<float>(weights.begin(), weights.end());
+}
+
+Light readLight(const tinygltf::Light& light) {
+    Light newLight;
+    if (light.type == "directional") {
+        newLight.type = LightType::Directional;
+    } else if (light.type == "spot") {
+        newLight.type = LightType::Spot;
+    }
+    if (light.color.size() >= 3) {
+        newLight.color = glm::vec3(light.color[0], light.color[1], light.color[2]);
+    }
+    newLight.intensity = static_cast<float>(light.intensity);
+    newLight.range = static_cast<float>(light.range);
+    newLight.innerConeAngle = static_cast<float>(light.spot.innerConeAngle);
+    newLight.outerConeAngle = static_cast<float>(light.spot.outerConeAngle);
+    return newLight;
+}
+
+} // namespace
+    
+void Model::readGLTF(std::string filename){
+    PROFILE_ZONE("readGLTF");
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    std::vector<Scene> scenes;
+
+    std::string extension = filename.substr(filename.find_last_of(".") + 1);
+    if (extension != "gltf" && extension != "glb") {
+        throw std::runtime_error("GLTFファイルではありません");
+    }
+
+    bool ret;
+    {
+        PROFILE_ZONE("tinygltf.load");
+        ret = extension == "gltf" ? loader.LoadASCIIFromFile(&model, &err, &warn, filename) : loader.LoadBinaryFromFile(&model, &err, &warn, filename);
+    }
+
+    if (!warn.empty()) {
+        std::cout << "Warn: " << warn << std::endl;
+    }
+    if (!err.empty()) {
+        std::cout << "Err: " << err << std::endl;
+    }
+    if (!ret) {
+        throw std::runtime_error("GLTFファイルの読み込みに失敗しました");
+    }
+
+    // マテリアルはglTFの順に登録する（係数のみ）
+    for (size_t i = 0; i < model.materials.size(); i++) {
+        gltfToMaterial[static_cast<uint32_t>(i)] = static_cast<uint32_t>(materials.size());
+        readMaterial(model.materials[i]);
+    }
+
+    // KHR_lights_punctualのライト（ノードからは番号で参照する）
+    for (const tinygltf::Light& light : model.lights) {
+        lights.push_back(readLight(light));
+    }
+
+    // メッシュの展開はノードの走査より先に並列で行う（readNodeからは登録済みのものとして扱われる）
+    readMeshes(model);
+
+    {
+        PROFILE_ZONE("readNode");
+        for(size_t i = 0; i < model.scenes.size(); i++) {
+            Scene scene;
+            scene.name = model.scenes[i].name;
+            for(size_t j = 0; j < model.scenes[i].nodes.size(); j++) {
+                uint32_t rootIndex = readNode(model, model.scenes[i].nodes[j], -1);
+                scene.rootNodeIndices.push_back(rootIndex);
+            }
+            scenes.push_back(scene);
+        }
+    }
+    dumpGLTF(model);
+
+    // メッシュの最適化（頂点キャッシュ・オーバードロー・フェッチ）
+    optimizeMeshes();
+
+    // LODの生成（既定の設定では作らない）
+    generateLods();
+
+    // メッシュレットの構築
+    buildMeshlets();
+
+    // ワールド行列の計算
+    updateGlobalMatrices();
+}
+
+uint32_t Model::readNode(tinygltf::Model &model, uint32_t gltfNodeIndex, int32_t parentIndex) {
+    //すでに読み込まれているノードの場合はインデックスを返す
+    if (gltfToNode.find(gltfNodeIndex) != gltfToNode.end()) {
+        if(parentIndex != -1) {
+            nodes[gltfToNode[gltfNodeIndex]].parents.push_back(parentIndex);
+        }
+
+        return gltfToNode[gltfNodeIndex];
+    }
+    
+    //ノード作成とプロパティ設定
+    tinygltf::Node node = model.nodes[gltfNodeIndex];
+    Node newNode;
+    newNode.parents.push_back(parentIndex);
+    newNode.meshIndex = node.mesh;
+    newNode.morphWeights = toFloatWeights(node.weights);
+    newNode.lightIndex = node.light;
+    
+    //トランスフォーム設定 - GLTFの仕様に従う
+    if (!node.matrix.empty()) {
+        // 行列が明示的に指定されている場合
+        newNode.localMatrix = glm::make_mat4(node.matrix.data());
+        
+        // オプション: 行列からTRSを抽出
+        glm::vec3 skew;
+        glm::vec4 perspective;
+        glm::decompose(newNode.localMatrix, 
+                    newNode.transform.scale,
+                    newNode.transform.rotation, 
+                    newNode.transform.translation, 
+                    skew, perspective);
+    } else {
+        // TRSが指定されている場合
+        if (!node.translation.empty()) {
+            newNode.transform.translation = glm::make_vec3(node.translation.data());
+        }
+        if (!node.rotation.empty()) {
+            newNode.transform.rotation = glm::make_quat(node.rotation.data());
+        }
+        if (!node.scale.empty()) {
+            newNode.transform.scale = glm::make_vec3(node.scale.data());
+        }
+        
+        // TRSから行列を計算
+        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), newNode.transform.translation);
+        glm::mat4 rotationMatrix = glm::mat4_cast(newNode.transform.rotation);
+        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), newNode.transform.scale);
+        
+        // T * R * S の順に適用
+        newNode.localMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+    }
+    
+    //メッシュの読み込み
+    if (node.mesh != -1) {
+        readMesh(model, node.mesh);
+    }
+
+    //ノードを追加し、インデックスを保存
+    uint32_t currentIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(newNode);
+    nodes[currentIndex].nodeIndex = currentIndex;
+    gltfToNode[gltfNodeIndex] = currentIndex;
+    
+    //子ノードを処理
+    for(size_t i = 0; i < node.children.size(); i++) {
+        uint32_t childIndex = readNode(model, node.children[i], currentIndex);
+        nodes[currentIndex].children.push_back(childIndex);
+    }
+    
+    return currentIndex;
+}
+
+void Model::readMesh(tinygltf::Model &model, uint32_t gltfMeshIndex){
+
+    if(gltfToMesh.find(gltfMeshIndex) != gltfToMesh.end()) {
+        return;
+    }
+
+    tinygltf::Mesh mesh = model.meshes[gltfMeshIndex];
+    Mesh newMesh;
+    meshes.push_back(newMesh);
+    meshes[meshes.size() - 1].meshIndex = meshes.size() - 1;
+    meshes[meshes.size() - 1].morphWeights = toFloatWeights(mesh.weights);
+    gltfToMesh[gltfMeshIndex] = meshes.size() - 1;
+    for(size_t i = 0; i < mesh.primitives.size(); i++) {
+        meshes[meshes.size() - 1].primitives.push_back(readPrimitive(model, mesh.primitives[i]));
+    }
+}
+
+// ノードから参照されるメッシュを登録し、プリミティブの展開をジョブで並列に行う
+void Model::readMeshes(tinygltf::Model& model) {
+    PROFILE_ZONE("readMeshes");
+    struct PrimitiveWork {
+        uint32_t meshIndex;
+        uint32_t gltfMeshIndex;
+        uint32_t primitiveIndex;
+    };
+    std::vector<PrimitiveWork> work;
+    for (const tinygltf::Node& node : model.nodes) {
+        if (node.mesh < 0 || gltfToMesh.find(node.mesh) != gltfToMesh.end()) {
+            continue;
+        }
+        uint32_t meshIndex = static_cast<uint32_t>(meshes.size());
+        Mesh newMesh;
+        newMesh.meshIndex = meshIndex;
+        newMesh.primitives.resize(model.meshes[node.mesh].primitives.size());
+        newMesh.morphWeights = toFloatWeights(model.meshes[node.mesh].weights);
+        meshes.push_back(std::move(newMesh));
+        gltfToMesh[node.mesh] = meshIndex;
+        for (uint32_t i = 0; i < meshes[meshIndex].primitives.size(); i++) {
+            work.push_back({meshIndex, static_cast<uint32_t>(node.mesh), i});
+        }
+    }
+
+    parallelFor(work.size(), [&](size_t i) {
+        const PrimitiveWork& item = work[i];
+        meshes[item.meshIndex].primitives[item.primitiveIndex] = readPrimitive(model, model.meshes[item.gltfMeshIndex].primitives[item.primitiveIndex]);
+    });
+}
+
+Primitive Model::readPrimitive(tinygltf::Model &model, tinygltf::Primitive &primitive){
+    Primitive newPrimitive;
+    
+    // インデックスバッファ情報の抽出
+    if (primitive.indices >= 0) {
+        const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
+        newPrimitive.indexCount = static_cast<uint32_t>(indexAccessor.count);
+        // firstIndexはバッファ読み込み時に設定
+    } else {
+        // インデックスバッファが無い場合は頂点数をカウント
+        // 頂点数は最初のアトリビュートから取得（通常はPOSITION）
+        if (!primitive.attributes.empty()) {
+            auto it = primitive.attributes.find("POSITION");
+            if (it != primitive.attributes.end()) {
+                const tinygltf::Accessor &posAccessor = model.accessors[it->second];
+                newPrimitive.indexCount = static_cast<uint32_t>(posAccessor.count);
+            }
+        }
+    }
+
+    newPrimitive.attributes = {};
+    for (const auto &attrib : primitive.attributes) {
+        if (attrib.first == "NORMAL") {
+            newPrimitive.attributes.hasNormals = true;
+        } else if (attrib.first == "TANGENT") {
+            newPrimitive.attributes.hasTangents = true;
+        } else if (attrib.first.rfind("TEXCOORD", 0) == 0) {
+            newPrimitive.attributes.hasTexCoords = true;
+        } else if (attrib.first.rfind("COLOR", 0) == 0) {
+            newPrimitive.attributes.hasColors = true;
+        } else if (attrib.first.rfind("JOINTS", 0) == 0) {
+            newPrimitive.attributes.hasJoints = true;
+        } else if (attrib.first.rfind("WEIGHTS", 0) == 0) {
+            newPrimitive.attributes.hasWeights = true;
+        }
+    }
+
+    // 頂点データの読み込み（各アトリビュートの0番目のセットのみ）
+    auto positionIt = primitive.attributes.find("POSITION");
+    if (positionIt != primitive.attributes.end()) {
+        StaticVertexAttributes defaultVertex{};
+        defaultVertex.color = glm::vec4(1.0f);
+        newPrimitive.vertices.assign(model.accessors[positionIt->second].count, defaultVertex);
+
+        readFloatAttribute(model, positionIt->second, newPrimitive.vertices, &StaticVertexAttributes::position);
+        if (auto it = primitive.attributes.find("NORMAL"); it != primitive.attributes.end()) {
+            readFloatAttribute(model, it->second, newPrimitive.vertices, &StaticVertexAttributes::normal);
+        }
+        if (auto it = primitive.attributes.find("TANGENT"); it != primitive.attributes.end()) {
+            readFloatAttribute(model, it->second, newPrimitive.vertices, &StaticVertexAttributes::tangent);
+        }
+        if (auto it = primitive.attributes.find("TEXCOORD_0"); it != primitive.attributes.end()) {
+            readFloatAttribute(model, it->second, newPrimitive.vertices, &StaticVertexAttributes::texCoord);
+        }
+        if (auto it = primitive.attributes.find("COLOR_0"); it != primitive.attributes.end()) {
+            readFloatAttribute(model, it->second, newPrimitive.vertices, &StaticVertexAttributes::color);
+        }
+        if (auto it = primitive.attributes.find("WEIGHTS_0"); it != primitive.attributes.end()) {
+            readFloatAttribute(model, it->second, newPrimitive.vertices, &StaticVertexAttributes::weight);
+        }
+        if (auto it = primitive.attributes.find("JOINTS_0"); it != primitive.attributes.end()) {
+            const tinygltf::Accessor& accessor = model.accessors[it->second];
+            if (accessor.count != newPrimitive.vertices.size()) {
+                throw std::runtime_error("アトリビュートの要素数がPOSITIONと一致しません");
+            }
+            forEachAccessorElement(model, accessor, [&](size_t i, const unsigned char* data, int componentCount, int componentSize) {
+                for (int c = 0; c < std::min(componentCount, 4); c++) {
+                    newPrimitive.vertices[i].joint[c] = readComponentAsUint(data + c * componentSize, accessor.componentType);
+                }
+            });
+        }
+    }
+
+    // インデックスデータの読み込み（無い場合は連番を生成）
+    // 範囲外のインデックスは最適化・LOD・メッシュレットの構築で頂点配列の外を読むため、読み込み時に拒否する
+    if (primitive.indices >= 0) {
+        const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+        newPrimitive.indices.resize(indexAccessor.count);
+        forEachAccessorElement(model, indexAccessor, [&](size_t i, const unsigned char* data, int, int) {
+            newPrimitive.indices[i] = readComponentAsUint(data, indexAccessor.componentType);
+        });
+        size_t vertexCount = newPrimitive.vertices.size();
+        if (std::any_of(newPrimitive.indices.begin(), newPrimitive.indices.end(), [&](uint32_t index) { return index >= vertexCount; })) {
+            throw std::runtime_error("インデックスが頂点数を超えています");
+        }
+    } else {
+        newPrimitive.indices.resize(newPrimitive.vertices.size());
+        std::iota(newPrimitive.indices.begin(), newPrimitive.indices.end(), 0u);
+    }
+    newPrimitive.firstIndex = 0;
+    newPrimitive.vertexOffset = 0;
+
+    // バウンディングの計算
+    if (!newPrimitive.vertices.empty()) {
+        newPrimitive.boundsMin = newPrimitive.vertices[0].position;
+        newPrimitive.boundsMax = newPrimitive.vertices[0].position;
+        for (const auto& vertex : newPrimitive.vertices) {
+            newPrimitive.boundsMin = glm::min(newPrimitive.boundsMin, vertex.position);
+            newPrimitive.boundsMax = glm::max(newPrimitive.boundsMax, vertex.position);
+        }
+        newPrimitive.boundsCenter = (newPrimitive.boundsMin + newPrimitive.boundsMax) * 0.5f;
+        for (const auto& vertex : newPrimitive.vertices) {
+            newPrimitive.boundsRadius = std::max(newPrimitive.boundsRadius, glm::distance(newPrimitive.boundsCenter, vertex.position));
+        }
+    }
+
+    // モーフターゲット（位置の差分のみ。重みの数と揃えるため、差分の無いターゲットも空のまま残す）
+    for (const auto& target : primitive.targets) {
+        MorphTarget morphTarget;
+        if (auto it = target.find("POSITION"); it != target.end()) {
+            morphTarget = readMorphTarget(model, it->second, newPrimitive.vertices.size());
+        }
+
+        // 重みが0〜1の範囲で動く分だけバウンディングを広げる
+        glm::vec3 deltaMin(0.0f);
+        glm::vec3 deltaMax(0.0f);
+        float reach = 0.0f;
+        for (const glm::vec3& delta : morphTarget.positionDeltas) {
+            deltaMin = glm::min(deltaMin, delta);
+            deltaMax = glm::max(deltaMax, delta);
+            reach = std::max(reach, glm::length(delta));
+        }
+        newPrimitive.boundsMin += deltaMin;
+        newPrimitive.boundsMax += deltaMax;
+        newPrimitive.boundsRadius += reach;
+        newPrimitive.morphTargets.push_back(std::move(morphTarget));
+    }
+
+    
+
+    // トポロジーの設定
+    switch (primitive.mode) {
+        case TINYGLTF_MODE_POINTS:
+            newPrimitive.topology = vk::PrimitiveTopology::ePointList;
+            break;
+        case TINYGLTF_MODE_LINE:
+            newPrimitive.topology = vk::PrimitiveTopology::eLineList;
+            break;
+        case TINYGLTF_MODE_LINE_LOOP:
+        case TINYGLTF_MODE_LINE_STRIP:
+            newPrimitive.topology = vk::PrimitiveTopology::eLineStrip;
+            break;
+        case TINYGLTF_MODE_TRIANGLE_STRIP:
+            newPrimitive.topology = vk::PrimitiveTopology::eTriangleStrip;
+            break;
+        case TINYGLTF_MODE_TRIANGLE_FAN:
+            newPrimitive.topology = vk::PrimitiveTopology::eTriangleFan;
+            break;
+        case TINYGLTF_MODE_TRIANGLES:
+        default:
+            newPrimitive.topology = vk::PrimitiveTopology::eTriangleList;
+            break;
+    }
+
+    // マテリアルインデックス
+    newPrimitive.materialIndex = primitive.material >= 0 ? 
+                                static_cast<uint32_t>(primitive.material) : 
+                                UINT32_MAX;  // 無効値
+
+    if (primitive.material != -1) {
+        //loadMaterial(model, model.materials[primitive.material]);
+    }
+
+    // 透明度フラグの設定（マテリアル情報から決定）
+    newPrimitive.isTransparent = false;
+    if (primitive.material >= 0 && primitive.material < model.materials.size()) {
+        const auto &material = model.materials[primitive.material];
+        // アルファモードとアルファ値をチェック
+        if (material.alphaMode == "BLEND") {
+            newPrimitive.isTransparent = true;
+        } else if (material.alphaMode == "MASK" && material.alphaCutoff < 1.0f) {
+            newPrimitive.isTransparent = true;
+        } else if (!material.pbrMetallicRoughness.baseColorFactor.empty() && 
+                  material.pbrMetallicRoughness.baseColorFactor.size() >= 4 && 
+                  material.pbrMetallicRoughness.baseColorFactor[3] < 1.0f) {
+            newPrimitive.isTransparent = true;
+        }
+    }
+    
+    return newPrimitive;
+}
+
+// テクスチャは読み込まず、係数だけを取り出す
+void Model::readMaterial(tinygltf::Material& material) {
+    const auto& pbr = material.pbrMetallicRoughness;
+    Material newMaterial{};
+    newMaterial.baseColorFactor = pbr.baseColorFactor.size() >= 4
+        ? glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2], pbr.baseColorFactor[3])
+        : glm::vec4(1.0f);
+    newMaterial.metallicFactor = static_cast<float>(pbr.metallicFactor);
+    newMaterial.roughnessFactor = static_cast<float>(pbr.roughnessFactor);
+    materials.push_back(std::move(newMaterial));
+}
+
+// ノードは親より後ろに追加されるため、先頭から順に親の行列を掛ければよい
+void Model::updateGlobalMatrices() {
+    PROFILE_ZONE("updateGlobalMatrices");
+    for (auto& node : nodes) {
+        int32_t parentIndex = node.parents.empty() ? -1 : node.parents[0];
+        node.globalMatrix = parentIndex >= 0 ? nodes[parentIndex].globalMatrix * node.localMatrix : node.localMatrix;
+    }
+}
+
+// ジョブは例外を投げられないため、最初の例外を受け取っておき、全体が終わってから投げ直す
+void parallelFor(size_t count, const std::function<void(size_t)>& func) {
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    render::JobSystem::instance().parallelFor(count, 1, [&](size_t begin, size_t end) {
+        PROFILE_ZONE("parallelFor");
+        try {
+            for (size_t i = begin; i < end; i++) {
+                func(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
+
+
+void dumpGLTF(tinygltf::Model &model) {
+    PROFILE_ZONE("dumpGLTF");
+    for(size_t i = 0; i < model.scenes.size(); i++) {
+        std::cout << "Scene " << i << std::endl;
+        for(size_t j = 0; j < model.scenes[i].nodes.size(); j++) {
+            dumpNode(model, model.nodes[model.scenes[i].nodes[j]], j, 1);
+        }        
+    }    
+}
+
+void dumpSpace(uint32_t depth) {
+    for(uint32_t i = 0; i < depth; i++) {
+        std::cout << "|    ";
+    }
+}
+
+void dumpNode(tinygltf::Model &model, tinygltf::Node &node, uint32_t nodeIndex, uint32_t depth) {
+    dumpSpace(depth);
+    std::cout << "Node " << nodeIndex << " : " << node.name << std::endl;
+    
+    if (node.camera != -1) {
+        dumpSpace(depth);
+        std::cout << "  Camera: " << node.camera << std::endl;
+    }
+    if (!node.translation.empty()) {
+        dumpSpace(depth);
+        std::cout << "  Translation: ";
+        for (const auto &t : node.translation) {
+            std::cout << t << " ";
+        }
+        std::cout << std::endl;
+    }
+    if (!node.rotation.empty()) {
+        dumpSpace(depth);
+        std::cout << "  Rotation: ";
+        for (const auto &r : node.rotation) {
+            std::cout << r << " ";
+        }
+        std::cout << std::endl;
+    }
+    if (!node.scale.empty()) {
+        dumpSpace(depth);
+        std::cout << "  Scale: ";
+        for (const auto &s : node.scale) {
+            std::cout << s << " ";
+        }
+        std::cout << std::endl;
+    }
+    if (!node.matrix.empty()) {
+        dumpSpace(depth);
+        std::cout << "  Matrix: ";
+        for (const auto &m : node.matrix) {
+            std::cout << m << " ";
+        }
+        std::cout << std::endl;
+    }
+    if (node.mesh != -1) {
+        dumpSpace(depth);
+        std::cout << "  Mesh: " << node.mesh << std::endl;
+        dumpMesh(model, model.meshes[node.mesh], depth + 1);
+    }
+    for(size_t i = 0; i < node.children.size(); i++) {
+        uint32_t nodeIndex = node.children[i];
+        dumpNode(model, model.nodes[node.children[i]], nodeIndex, depth + 1);
+    }
+}
+
+void dumpMesh(tinygltf::Model &model, tinygltf::Mesh &mesh, uint32_t depth) {
+    dumpSpace(depth);
+    std::cout << "Mesh: " << mesh.name << std::endl;
+
+    for(size_t i = 0; i < mesh.primitives.size(); i++) {
+        dumpPrimitive(model, mesh.primitives[i], depth + 1);
+    }
+}
+
+void dumpPrimitive(tinygltf::Model &model, tinygltf::Primitive &primitive, uint32_t depth) {
+    dumpSpace(depth);
+    std::cout << "Primitive: " << std::endl;
+
+    for (const auto &attrib : primitive.attributes) {
+        dumpSpace(depth + 1);
+        std::cout << "Attribute: " << attrib.first << " (Accessor ID: " << attrib.second << ")" << std::endl;
+    }
+
+    if (primitive.indices != -1) {
+        dumpSpace(depth + 1);
+        std::cout << "Indices (Accessor ID): " << primitive.indices << std::endl;
+    }
+
+    dumpSpace(depth + 1);
+    std::cout << "Material: " << primitive.material << std::endl;
+
+    dumpSpace(depth + 1);
+    std::cout << "Mode: " << primitive.mode << std::endl;
+}
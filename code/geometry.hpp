@@ -1,157 +1,289 @@
-#pragma once
-#include "header.hpp"
-
-namespace geometry{
-
-struct StaticVertexAttributes {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec4 tangent;
-    
-    //可変要素
-    glm::vec2 texCoord;
-    glm::vec4 color;
-    glm::uvec4 joint;
-    glm::vec4 weight;
-
-    static vk::VertexInputBindingDescription getBindingDescription() {
-        return vk::VertexInputBindingDescription(0, sizeof(StaticVertexAttributes), vk::VertexInputRate::eVertex);
-    }
-
-    static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions() {
-        return {
-            vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(StaticVertexAttributes, position)),
-            vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(StaticVertexAttributes, normal)),
-            vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(StaticVertexAttributes, tangent)),
-            vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32Sfloat, offsetof(StaticVertexAttributes, texCoord)),
-            vk::VertexInputAttributeDescription(4, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(StaticVertexAttributes, color)),
-            vk::VertexInputAttributeDescription(5, 0, vk::Format::eR32G32B32A32Uint, offsetof(StaticVertexAttributes, joint)),
-            vk::VertexInputAttributeDescription(6, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(StaticVertexAttributes, weight))
-        };
-    }
-};
-
-struct DynamicVertexAttributes {
-    glm::vec3 position;
-
-    static vk::VertexInputBindingDescription getBindingDescription() {
-        return vk::VertexInputBindingDescription(1, sizeof(DynamicVertexAttributes), vk::VertexInputRate::eVertex);
-    }
-
-    static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions() {
-        return {
-            vk::VertexInputAttributeDescription(7, 0, vk::Format::eR32G32B32Sfloat, offsetof(DynamicVertexAttributes, position))
-        };
-    }
-};
-
-struct Material {
-    glm::vec4 baseColorFactor;
-    float metallicFactor;
-    float roughnessFactor;
-
-    vk::UniqueImage baseColorTexture;
-    vk::UniqueImageView baseColorTextureView;
-    vk::UniqueSampler baseColorTextureSampler;
-
-    vk::UniqueImage metallicRoughnessTexture;
-    vk::UniqueImageView metallicRoughnessTextureView;
-    vk::UniqueSampler metallicRoughnessTextureSampler;
-
-    vk::UniqueImage normalTexture;
-    vk::UniqueImageView normalTextureView;
-    vk::UniqueSampler normalTextureSampler;
-
-    vk::UniqueImage occlusionTexture;
-    vk::UniqueImageView occlusionTextureView;
-    vk::UniqueSampler occlusionTextureSampler;
-
-    vk::UniqueImage emissiveTexture;
-    vk::UniqueImageView emissiveTextureView;
-    vk::UniqueSampler emissiveTextureSampler;
-};
-
-struct Transform {
-    glm::vec3 translation;
-    glm::quat rotation;
-    glm::vec3 scale;
-};
-
-struct Scene {
-    std::string name;
-    std::vector<uint32_t> rootNodeIndices;
-};
-
-struct Node {
-    uint32_t nodeIndex;
-    std::vector<int32_t> parents;
-    std::vector<uint32_t> children;
-    uint32_t meshIndex;
-    
-    Transform transform = {
-        glm::vec3(0.0f),
-        glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
-        glm::vec3(1.0f)
-    };
-
-    glm::mat4 localMatrix = glm::mat4(1.0f);
-    glm::mat4 globalMatrix = glm::mat4(1.0f);
-};
-
-struct Primitive {
-    uint32_t firstIndex;
-    uint32_t indexCount;
-    uint32_t vertexOffset;//初期化はバッファを読み込むときに行う
-    uint32_t materialIndex;
-    vk::PrimitiveTopology topology;
-
-    // アトリビュート存在フラグ
-    struct {
-        bool hasNormals : 1;
-        bool hasTangents : 1;
-        bool hasTexCoords : 1;
-        bool hasColors : 1;
-        bool hasJoints : 1;
-        bool hasWeights : 1;
-    } attributes;
-
-    // 透過フラグ（レンダリング順序決定用）
-    bool isTransparent;
-};
-
-struct Mesh {
-    std::vector<int32_t> nodeIndex;
-    uint32_t meshIndex;
-    std::vector<Primitive> primitives;
-};
-
-struct Model {
-    std::vector<Scene> scenes;
-    std::vector<Node> nodes;
-    std::vector<Mesh> meshes;
-    std::vector<Material> materials;
-
-    std::unordered_map<uint32_t, uint32_t> gltfToNode; //key: gltf node index, value: node index
-    std::unordered_map<uint32_t, uint32_t> gltfToMesh; //key: gltf mesh index, value: mesh index
-    std::unordered_map<uint32_t, uint32_t> gltfToMaterial; //key: gltf material index, value: material index
-        
-    void readGLTF(std::string filename);
-    uint32_t readNode(tinygltf::Model &model, uint32_t gltfNodeIndex, int32_t parentIndex);
-    void readMesh(tinygltf::Model& model, uint32_t gltfMeshIndex);
-    Primitive readPrimitive(tinygltf::Model& model, tinygltf::Primitive& primitive);
-    void readMaterial(tinygltf::Model& model, tinygltf::Material& material);
-
-    void checkGLTF();
-    void checkNode(uint32_t nodeIndex);
-    void checkMesh(uint32_t meshIndex);
-
-};
-
-
-}
-
-
-void dumpGLTF(tinygltf::Model& model);
-void dumpNode(tinygltf::Model& model, tinygltf::Node& node, uint32_t nodeIndex, uint32_t depth);
-void dumpMesh(tinygltf::Model &model, tinygltf::Mesh &mesh, uint32_t depth);
+#pragma once
+#include "header.hpp"
+
+namespace geometry{
+
+// 頂点プル（シェーダがストレージバッファから頂点を読み出して復元する経路）での属性の形式
+enum class VertexFormat : uint32_t {
+    None = 0,//属性が無い（既定値を使う）
+    Float3 = 1,
+    Snorm8x4 = 2,//xyzを符号付き8ビットに詰めたもの
+};
+
+// 頂点プル用のレイアウト（シェーダ側のプッシュ定数と同じ並び。オフセットと間隔は4バイト単位）
+struct VertexPullLayout {
+    uint32_t stride;
+    uint32_t positionOffset;//位置は常にFloat3
+    uint32_t normalOffset;
+    VertexFormat normalFormat;
+};
+
+struct StaticVertexAttributes {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec4 tangent;
+    
+    //可変要素
+    glm::vec2 texCoord;
+    glm::vec4 color;
+    glm::uvec4 joint;
+    glm::vec4 weight;
+
+    static vk::VertexInputBindingDescription getBindingDescription() {
+        return vk::VertexInputBindingDescription(0, sizeof(StaticVertexAttributes), vk::VertexInputRate::eVertex);
+    }
+
+    static std::array<vk::VertexInputAttributeDescription, 7> getAttributeDescriptions() {
+        return {
+            vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(StaticVertexAttributes, position)),
+            vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(StaticVertexAttributes, normal)),
+            vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(StaticVertexAttributes, tangent)),
+            vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32Sfloat, offsetof(StaticVertexAttributes, texCoord)),
+            vk::VertexInputAttributeDescription(4, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(StaticVertexAttributes, color)),
+            vk::VertexInputAttributeDescription(5, 0, vk::Format::eR32G32B32A32Uint, offsetof(StaticVertexAttributes, joint)),
+            vk::VertexInputAttributeDescription(6, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(StaticVertexAttributes, weight))
+        };
+    }
+
+    static VertexPullLayout getPullLayout() {
+        return {
+            sizeof(StaticVertexAttributes) / sizeof(uint32_t),
+            offsetof(StaticVertexAttributes, position) / sizeof(uint32_t),
+            offsetof(StaticVertexAttributes, normal) / sizeof(uint32_t),
+            VertexFormat::Float3
+        };
+    }
+};
+
+struct DynamicVertexAttributes {
+    glm::vec3 position;
+
+    static vk::VertexInputBindingDescription getBindingDescription() {
+        return vk::VertexInputBindingDescription(1, sizeof(DynamicVertexAttributes), vk::VertexInputRate::eVertex);
+    }
+
+    static std::array<vk::VertexInputAttributeDescription, 1> getAttributeDescriptions() {
+        return {
+            vk::VertexInputAttributeDescription(7, 0, vk::Format::eR32G32B32Sfloat, offsetof(DynamicVertexAttributes, position))
+        };
+    }
+};
+
+struct Material {
+    glm::vec4 baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+
+    vk::UniqueImage baseColorTexture;
+    vk::UniqueImageView baseColorTextureView;
+    vk::UniqueSampler baseColorTextureSampler;
+
+    vk::UniqueImage metallicRoughnessTexture;
+    vk::UniqueImageView metallicRoughnessTextureView;
+    vk::UniqueSampler metallicRoughnessTextureSampler;
+
+    vk::UniqueImage normalTexture;
+    vk::UniqueImageView normalTextureView;
+    vk::UniqueSampler normalTextureSampler;
+
+    vk::UniqueImage occlusionTexture;
+    vk::UniqueImageView occlusionTextureView;
+    vk::UniqueSampler occlusionTextureSampler;
+
+    vk::UniqueImage emissiveTexture;
+    vk::UniqueImageView emissiveTextureView;
+    vk::UniqueSampler emissiveTextureSampler;
+};
+
+// KHR_lights_punctualのライトの種類
+enum class LightType : uint32_t {
+    Directional = 0,
+    Point = 1,
+    Spot = 2,
+};
+
+// KHR_lights_punctualのライト（ノードのローカル空間で原点に置かれ、-zへ向く）
+struct Light {
+    LightType type = LightType::Point;
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;//平行光源はルクス、それ以外はカンデラ
+    float range = 0.0f;//0なら無限（クラスタへの割り当てでは強度から打ち切る距離を決める）
+    float innerConeAngle = 0.0f;
+    float outerConeAngle = 0.7853981634f;//π/4（glTFの既定値）
+};
+
+struct Transform {
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+};
+
+struct Scene {
+    std::string name;
+    std::vector<uint32_t> rootNodeIndices;
+};
+
+struct Node {
+    uint32_t nodeIndex;
+    std::vector<int32_t> parents;
+    std::vector<uint32_t> children;
+    uint32_t meshIndex;
+    
+    Transform transform = {
+        glm::vec3(0.0f),
+        glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+        glm::vec3(1.0f)
+    };
+
+    glm::mat4 localMatrix = glm::mat4(1.0f);
+    glm::mat4 globalMatrix = glm::mat4(1.0f);
+
+    // モーフターゲットの重み（空ならMesh::morphWeightsを使う）
+    std::vector<float> morphWeights;
+
+    int32_t lightIndex = -1;//Model::lightsの番号（-1なら無し）
+};
+
+// 簡略化されたLODレベル（頂点はPrimitive::verticesを共有）
+struct PrimitiveLod {
+    std::vector<uint32_t> indices;
+    float error;//バウンディング半径に対する相対誤差
+};
+
+// モーフターゲット（位置の差分のみ）
+// 差分が0でない頂点だけを頂点番号の昇順で持つ
+struct MorphTarget {
+    std::vector<uint32_t> vertices;
+    std::vector<glm::vec3> positionDeltas;
+};
+
+// メッシュレット（最大64頂点・124三角形のクラスタ）
+struct Meshlet {
+    uint32_t vertexOffset;      // Primitive::meshletVertices内の開始位置
+    uint32_t triangleOffset;    // Primitive::meshletTriangles内の開始位置（三角形単位）
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+
+    // カリング用のバウンディング球と法線コーン（ローカル空間）
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneApex;
+    glm::vec3 coneAxis;
+    float coneCutoff;           // 1.0ならコーンによるカリング不可
+};
+
+struct Primitive {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t vertexOffset;//初期化はバッファを読み込むときに行う
+    uint32_t geometryIndex = UINT32_MAX;//World内の共有ジオメトリ番号（内容が同一のプリミティブは同じ番号）
+    uint32_t materialIndex;
+    vk::PrimitiveTopology topology;
+
+    // アトリビュート存在フラグ
+    struct {
+        bool hasNormals : 1;
+        bool hasTangents : 1;
+        bool hasTexCoords : 1;
+        bool hasColors : 1;
+        bool hasJoints : 1;
+        bool hasWeights : 1;
+    } attributes;
+
+    // 透過フラグ（レンダリング順序決定用）
+    bool isTransparent;
+
+    // CPU側の頂点・インデックスデータ（GPUバッファへの転送前）
+    std::vector<StaticVertexAttributes> vertices;
+    std::vector<uint32_t> indices;
+
+    // ローカル空間のバウンディング
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+
+    // LOD1以降（LOD0はindices）
+    std::vector<PrimitiveLod> lods;
+
+    // メッシュレット分割結果
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;  // メッシュレットローカル→プリミティブの頂点インデックス
+    std::vector<uint8_t> meshletTriangles;  // メッシュレットローカルの頂点インデックス（3つで1三角形）
+
+    // モーフターゲット（頂点番号で差分を指すため、持つ場合は頂点の統合・並べ替えをしない）
+    // バウンディングは重みが0〜1の範囲で動く分を含めて広げてある
+    std::vector<MorphTarget> morphTargets;
+};
+
+struct Mesh {
+    std::vector<int32_t> nodeIndex;
+    uint32_t meshIndex;
+    std::vector<Primitive> primitives;
+    std::vector<float> morphWeights;//既定の重み（glTFのmesh.weights）
+};
+
+// インポート時のメッシュ最適化設定
+struct MeshOptimizeSettings {
+    bool enabled = true;
+    bool deduplicateVertices = true;   // ビット単位で同一の頂点を統合
+    bool optimizeVertexCache = true;   // 頂点キャッシュ局所性のための三角形並べ替え
+    bool optimizeOverdraw = true;      // オーバードロー削減のためのクラスタ並べ替え
+    bool optimizeVertexFetch = true;   // フェッチ局所性のための頂点並べ替え
+    uint32_t cacheSize = 16;           // ACMR/ATVR計測用のFIFOキャッシュサイズ
+    float overdrawThreshold = 1.05f;   // オーバードロー最適化で許容するACMRの悪化率
+};
+
+// LOD生成設定
+// 実行時の描画はLODを使わない（GPUのプールにはLOD0だけを詰める）ため、既定では作らない
+// benchの群衆のようにオフラインで選択を評価するときだけenabledにしてgenerateLodsを呼ぶ
+struct LodSettings {
+    bool enabled = false;
+    uint32_t maxLodCount = 4;          // LOD0を含むレベル数
+    float reductionRatio = 0.5f;       // 1レベルあたりの三角形数の比率
+    float maxError = 0.05f;            // バウンディング半径に対する許容誤差
+    float attributeWeight = 1.0f;      // 法線・UVの差に対する重み
+    uint32_t minTriangles = 64;        // これより少ない場合はLODを作らない
+    bool lockSkinningBorders = true;   // 支配ジョイントが変わる境界を固定
+};
+
+struct Model {
+    std::vector<Scene> scenes;
+    std::vector<Node> nodes;
+    std::vector<Mesh> meshes;
+    std::vector<Material> materials;
+    std::vector<Light> lights;//glTFの順
+
+    std::unordered_map<uint32_t, uint32_t> gltfToNode; //key: gltf node index, value: node index
+    std::unordered_map<uint32_t, uint32_t> gltfToMesh; //key: gltf mesh index, value: mesh index
+    std::unordered_map<uint32_t, uint32_t> gltfToMaterial; //key: gltf material index, value: material index
+        
+    void readGLTF(std::string filename);
+    uint32_t readNode(tinygltf::Model &model, uint32_t gltfNodeIndex, int32_t parentIndex);
+    void readMesh(tinygltf::Model& model, uint32_t gltfMeshIndex);
+    void readMeshes(tinygltf::Model& model);
+    Primitive readPrimitive(tinygltf::Model& model, tinygltf::Primitive& primitive);
+    void readMaterial(tinygltf::Material& material);
+
+    void optimizeMeshes(const MeshOptimizeSettings& settings = {});
+    void generateLods(const LodSettings& settings = {});
+    void buildMeshlets();
+    void updateGlobalMatrices();
+
+    void checkGLTF();
+    void checkNode(uint32_t nodeIndex);
+    void checkMesh(uint32_t meshIndex);
+
+};
+
+
+// [0, count) をジョブシステムで並列に処理する
+void parallelFor(size_t count, const std::function<void(size_t)>& func);
+
+}
+
+
+void dumpGLTF(tinygltf::Model& model);
+void dumpNode(tinygltf::Model& model, tinygltf::Node& node, uint32_t nodeIndex, uint32_t depth);
+void dumpMesh(tinygltf::Model &model, tinygltf::Mesh &mesh, uint32_t depth);
 void dumpPrimitive(tinygltf::Model &model, tinygltf::Primitive &primitive, uint32_t depth);
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "vulkanContext.hpp"
+
+namespace {
+
+// プールと位置ストリームはデバイスローカルに置き、ホストからはステージングバッファ経由で転送する
+const vk::MemoryPropertyFlags kPoolMemory = vk::MemoryPropertyFlagBits::eDeviceLocal;
+const vk::MemoryPropertyFlags kStagingMemory = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+constexpr vk::DeviceSize kStagingBytes = 8 * 1024 * 1024;//これより大きいジオメトリは必要な大きさで作り直す
+
+// 頂点の開始位置が頂点サイズの倍数になるように割り当てる（インデックスも4バイト境界に揃う）
+constexpr uint64_t kVertexStride = sizeof(geometry::StaticVertexAttributes);
+static_assert(kVertexStride % sizeof(uint32_t) == 0);
+
+// 位置だけのストリーム（プールと同じ頂点番号で参照できるよう、プールの頂点1つ分ごとに1要素を持つ）
+constexpr uint64_t kPositionStride = sizeof(glm::vec3);
+constexpr uint64_t kQuantizedPositionStride = sizeof(uint64_t);//半精度浮動小数点数 × 4
+
+} // namespace
+
+//プールを作成し、容量に収まるジオメトリを転送
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::upload(const geometry::World& world, vk::DeviceSize poolBytes) {
+    PROFILE_ZONE("geometryBuffer.upload");
+    const std::vector<geometry::GeometryRange>& geometries = world.getGeometries();
+    placements.assign(geometries.size(), Placement{});
+    geometryBytes.resize(geometries.size());
+    vertexCounts.resize(geometries.size());
+    uint64_t totalBytes = 0;
+    for (size_t i = 0; i < geometries.size(); i++) {
+        vertexCounts[i] = geometries[i].vertexCount;
+        geometryBytes[i] = geometries[i].vertexCount * kVertexStride + geometries[i].indexCount * sizeof(uint32_t);
+        totalBytes += (geometryBytes[i] + kVertexStride - 1) / kVertexStride * kVertexStride;
+    }
+
+    // 全体が予算に収まる場合は全体の大きさにする
+    vk::DeviceSize capacity = std::max<vk::DeviceSize>(std::min<vk::DeviceSize>(totalBytes, poolBytes / kVertexStride * kVertexStride), kVertexStride);
+    vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+                               | vk::BufferUsageFlagBits::eTransferDst;
+    if (deviceWrapper.context.capabilities.bufferDeviceAddress) {
+        usage |= vk::BufferUsageFlagBits::eShaderDeviceAddress;//頂点プル
+    }
+    poolCopies.clear();
+    positionCopies.clear();
+    stagingCursor = 0;
+    poolBuffer = deviceWrapper.createBuffer(capacity, usage, kPoolMemory);
+    allocator.reset(capacity);
+    positionBuffer = deviceWrapper.createBuffer(capacity / kVertexStride * getPositionStride(),
+                                                vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, kPoolMemory);
+
+    std::vector<uint8_t> data;
+    uint32_t residentCount = 0;
+    for (uint32_t i = 0; i < geometries.size(); i++) {
+        if (allocator.getUsedBytes() + geometryBytes[i] > capacity) {
+            continue;
+        }
+        readGeometry(world, i, data);
+        residentCount += makeResident(i, data) ? 1 : 0;
+    }
+    flushUploads();
+
+    const geometry::WorldStatistics& stats = world.getStatistics();
+    std::cout << "共有ジオメトリ: " << stats.primitiveCount << " プリミティブ -> " << stats.uniqueGeometryCount << " ジオメトリ, "
+              << "頂点 " << stats.vertexBytes << " バイト, インデックス " << stats.indexBytes << " バイト, "
+              << "重複排除 " << stats.deduplicatedBytes << " バイト" << std::endl;
+    std::cout << "ジオメトリプール: " << capacity << " バイト, 常駐 " << residentCount << " / " << geometries.size() << " ジオメトリ, "
+              << "位置ストリーム " << positionBuffer.size << " バイト（" << (quantizedPositions ? "半精度" : "単精度") << "）" << std::endl;
+}
+
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::readGeometry(const geometry::World& world, uint32_t geometryIndex, std::vector<uint8_t>& data) {
+    const geometry::GeometryRange& range = world.getGeometries()[geometryIndex];
+    size_t vertexBytes = range.vertexCount * kVertexStride;
+    size_t indexBytes = range.indexCount * sizeof(uint32_t);
+    size_t positionBytes = range.vertexCount * sizeof(glm::vec3);
+    data.resize(vertexBytes + indexBytes + positionBytes);
+    std::memcpy(data.data(), world.getVertices().data() + range.vertexOffset, vertexBytes);
+    std::memcpy(data.data() + vertexBytes, world.getIndices().data() + range.firstIndex, indexBytes);
+
+    // 位置だけを詰めたストリーム（深度のみのパスが読む）
+    glm::vec3* positions = reinterpret_cast<glm::vec3*>(data.data() + vertexBytes + indexBytes);
+    const geometry::StaticVertexAttributes* vertices = world.getVertices().data() + range.vertexOffset;
+    for (uint32_t i = 0; i < range.vertexCount; i++) {
+        std::memcpy(&positions[i], &vertices[i].position, sizeof(glm::vec3));
+    }
+}
+
+bool VulkanContext::DeviceWrapper::GeometryBufferWrapper::makeResident(uint32_t geometryIndex, const std::vector<uint8_t>& data) {
+    Placement& placement = placements[geometryIndex];
+    if (placement.resident) {
+        return true;
+    }
+    uint64_t offset = allocator.allocate(geometryBytes[geometryIndex], kVertexStride);
+    if (offset == render::RangeAllocator::kInvalidOffset) {
+        return false;
+    }
+    vk::DeviceSize stagingOffset;
+    std::memcpy(stage(geometryBytes[geometryIndex], stagingOffset), data.data(), geometryBytes[geometryIndex]);
+    poolCopies.push_back(vk::BufferCopy(stagingOffset, offset, geometryBytes[geometryIndex]));
+
+    // インデックスはジオメトリ内の頂点番号のまま（描画時にvertexOffsetを足す）
+    placement.byteOffset = offset;
+    placement.vertexOffset = static_cast<uint32_t>(offset / kVertexStride);
+    writePositions(placement.vertexOffset, data.data() + geometryBytes[geometryIndex], vertexCounts[geometryIndex]);
+    placement.firstIndex = static_cast<uint32_t>((offset + vertexCounts[geometryIndex] * kVertexStride) / sizeof(uint32_t));
+    placement.resident = true;
+    return true;
+}
+
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::writePositions(uint32_t vertexOffset, const uint8_t* positions, uint32_t vertexCount) {
+    vk::DeviceSize bytes = vertexCount * getPositionStride();
+    vk::DeviceSize stagingOffset;
+    uint8_t* target = stage(bytes, stagingOffset);
+    positionCopies.push_back(vk::BufferCopy(stagingOffset, vertexOffset * getPositionStride(), bytes));
+    if (!quantizedPositions) {
+        std::memcpy(target, positions, vertexCount * kPositionStride);
+        return;
+    }
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        glm::vec3 position;
+        std::memcpy(&position, positions + i * kPositionStride, sizeof(glm::vec3));
+        uint64_t packed = glm::packHalf4x16(glm::vec4(position, 1.0f));
+        std::memcpy(target + i * kQuantizedPositionStride, &packed, sizeof(uint64_t));
+    }
+}
+
+//ステージングバッファの領域を確保する（足りなければ溜まった転送を先に実行して空ける）
+uint8_t* VulkanContext::DeviceWrapper::GeometryBufferWrapper::stage(vk::DeviceSize size, vk::DeviceSize& offset) {
+    if (stagingCursor + size > stagingBuffer.size) {
+        flushUploads();
+        if (size > stagingBuffer.size) {
+            stagingBuffer = deviceWrapper.createBuffer(std::max(size, kStagingBytes), vk::BufferUsageFlagBits::eTransferSrc, kStagingMemory);
+        }
+    }
+    offset = stagingCursor;
+    stagingCursor += size;
+    return static_cast<uint8_t*>(stagingBuffer.mapped) + offset;
+}
+
+//溜まった転送をコマンドバッファに記録し、描画で読む前にバリアを張る
+//ステージングバッファは次の書き込み（前のフレームの完了後）から先頭に戻して使う
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::recordUploads(vk::CommandBuffer commandBuffer) {
+    if (poolCopies.empty() && positionCopies.empty()) {
+        return;
+    }
+    if (!poolCopies.empty()) {
+        commandBuffer.copyBuffer(stagingBuffer.buffer.get(), poolBuffer.buffer.get(), poolCopies);
+    }
+    if (!positionCopies.empty()) {
+        commandBuffer.copyBuffer(stagingBuffer.buffer.get(), positionBuffer.buffer.get(), positionCopies);
+    }
+
+    vk::PipelineStageFlags consumers = vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader;
+    if (deviceWrapper.context.capabilities.meshShader) {
+        consumers |= vk::PipelineStageFlagBits::eTaskShaderEXT | vk::PipelineStageFlagBits::eMeshShaderEXT;
+    }
+    vk::MemoryBarrier barrier(
+        vk::AccessFlagBits::eTransferWrite,//srcAccessMask
+        vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eShaderRead//dstAccessMask
+    );
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, consumers, {}, barrier, {}, {});
+
+    poolCopies.clear();
+    positionCopies.clear();
+    stagingCursor = 0;
+}
+
+//溜まった転送をすぐに実行して完了を待つ（読み込み時と、1フレーム分がステージングバッファに収まらない場合）
+//グラフィックスのコマンドバッファを使うため、フレームの記録の外で呼ぶ
+//描画とは順序関係が無いため、主キュー以外（独立した処理用のキュー）へ提出する
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::flushUploads() {
+    if (poolCopies.empty() && positionCopies.empty()) {
+        stagingCursor = 0;
+        return;
+    }
+    PROFILE_ZONE("geometryBuffer.flushUploads");
+    CommandBufWrapper& commandBufWrapper = deviceWrapper.graphicsCommandBufWrapper;
+    vk::CommandBuffer commandBuffer = commandBufWrapper.getCommandBuffer();
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    recordUploads(commandBuffer);
+    commandBuffer.end();
+    QueueWrapper::Submission submission;
+    submission.commandBuffers.push_back(commandBufWrapper.getCommandBufferSubmitInfo());
+    deviceWrapper.graphicsQueueWrapper.submitIndependent(std::move(submission));
+    deviceWrapper.graphicsQueueWrapper.waitIdle();
+}
+
+vk::DeviceSize VulkanContext::DeviceWrapper::GeometryBufferWrapper::getPositionStride() const {
+    return quantizedPositions ? kQuantizedPositionStride : kPositionStride;
+}
+
+vk::Format VulkanContext::DeviceWrapper::GeometryBufferWrapper::getPositionFormat() const {
+    return quantizedPositions ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR32G32B32Sfloat;
+}
+
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::evict(uint32_t geometryIndex) {
+    Placement& placement = placements[geometryIndex];
+    if (!placement.resident) {
+        return;
+    }
+    allocator.free(placement.byteOffset, geometryBytes[geometryIndex]);
+    placement.resident = false;
+}
+
+uint32_t VulkanContext::DeviceWrapper::GeometryBufferWrapper::getHeapIndex() {
+    vk::PhysicalDeviceMemoryProperties memoryProperties = deviceWrapper.context.physicalDevice.getMemoryProperties();
+    return memoryProperties.memoryTypes[deviceWrapper.findMemoryType(UINT32_MAX, kPoolMemory)].heapIndex;
+}
+
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::bind(vk::CommandBuffer commandBuffer) {
+    commandBuffer.bindVertexBuffers(0, poolBuffer.buffer.get(), vk::DeviceSize{0});
+    bindIndices(commandBuffer);
+}
+
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::bindPositions(vk::CommandBuffer commandBuffer) {
+    commandBuffer.bindVertexBuffers(0, positionBuffer.buffer.get(), vk::DeviceSize{0});
+    bindIndices(commandBuffer);
+}
+
+void VulkanContext::DeviceWrapper::GeometryBufferWrapper::bindIndices(vk::CommandBuffer commandBuffer) {
+    commandBuffer.bindIndexBuffer(poolBuffer.buffer.get(), 0, vk::IndexType::eUint32);
+}
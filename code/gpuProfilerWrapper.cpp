@@ -0,0 +1,174 @@
+#include "vulkanContext.hpp"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace {
+
+// steady_clockと同じ時間軸のホストドメイン
+#if defined(_WIN32)
+constexpr vk::TimeDomainEXT kHostTimeDomain = vk::TimeDomainEXT::eQueryPerformanceCounter;
+#else
+constexpr vk::TimeDomainEXT kHostTimeDomain = vk::TimeDomainEXT::eClockMonotonic;
+#endif
+
+uint64_t hostTimestampToNanoseconds(uint64_t timestamp) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+    return timestamp / ticksPerSecond * 1000000000ull + timestamp % ticksPerSecond * 1000000000ull / ticksPerSecond;
+#else
+    return timestamp;
+#endif
+}
+
+} // namespace
+
+void VulkanContext::DeviceWrapper::GpuProfilerWrapper::initGpuProfiler() {
+    VulkanContext& context = deviceWrapper.context;
+
+    // グラフィックスとコンピュートの両方でタイムスタンプが使え、ホストからクエリをリセットできる場合のみ
+    std::vector<vk::QueueFamilyProperties> queueProps = context.physicalDevice.getQueueFamilyProperties();
+    uint32_t validBits = std::min(queueProps[deviceWrapper.graphicsQueueWrapper.queueFamilyIndex].timestampValidBits,
+                                  queueProps[deviceWrapper.computeQueueWrapper.queueFamilyIndex].timestampValidBits);
+    supported = context.capabilities.hostQueryReset && validBits > 0;
+    if (!supported) {
+        std::cout << "GPUプロファイラ: タイムスタンプが使えないため無効" << std::endl;
+        return;
+    }
+    timestampPeriod = context.physicalDevice.getProperties().limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+    queryPool = deviceWrapper.device->createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, kMaxQueries));
+    zones.reserve(kMaxQueries / 2);
+    zoneMilliseconds.reserve(kMaxQueries / 2);
+
+    if (context.capabilities.calibratedTimestamps) {
+        std::vector<vk::TimeDomainEXT> domains = context.physicalDevice.getCalibrateableTimeDomainsEXT(deviceWrapper.dispatchLoader);
+        calibrated = std::find(domains.begin(), domains.end(), vk::TimeDomainEXT::eDevice) != domains.end()
+                  && std::find(domains.begin(), domains.end(), kHostTimeDomain) != domains.end();
+        hostTimeDomain = kHostTimeDomain;
+    }
+    if (calibrated) {
+        calibrate();
+    } else {
+        calibrateBySubmit();
+    }
+    std::cout << "GPUプロファイラ: " << (calibrated ? "VK_EXT_calibrated_timestampsで時刻を較正" : "初期化時の提出で時刻を較正") << std::endl;
+}
+
+// デバイスとホストの時刻を同時に取得して差を求める
+void VulkanContext::DeviceWrapper::GpuProfilerWrapper::calibrate() {
+    std::array<vk::CalibratedTimestampInfoEXT, 2> infos = {
+        vk::CalibratedTimestampInfoEXT(vk::TimeDomainEXT::eDevice),
+        vk::CalibratedTimestampInfoEXT(hostTimeDomain)
+    };
+    std::array<uint64_t, 2> timestamps{};
+    uint64_t maxDeviation = 0;
+    VkResult result = deviceWrapper.dispatchLoader.vkGetCalibratedTimestampsEXT(
+        deviceWrapper.device.get(),
+        static_cast<uint32_t>(infos.size()),
+        reinterpret_cast<const VkCalibratedTimestampInfoEXT*>(infos.data()),
+        timestamps.data(),
+        &maxDeviation
+    );
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    deviceToHostOffset = static_cast<int64_t>(hostTimestampToNanoseconds(timestamps[1]))
+                       - static_cast<int64_t>((timestamps[0] & timestampMask) * timestampPeriod);
+}
+
+// タイムスタンプを1つ書くだけのコマンドを提出し、完了を待った直後のホスト時刻に合わせる
+// GPUの時刻は待機から戻るまでの分だけ遅く見積もられる
+void VulkanContext::DeviceWrapper::GpuProfilerWrapper::calibrateBySubmit() {
+    CommandBufWrapper& commandBufWrapper = deviceWrapper.graphicsCommandBufWrapper;
+    vk::CommandBuffer commandBuffer = commandBufWrapper.getCommandBuffer();
+    deviceWrapper.device->resetQueryPool(queryPool.get(), 0, 1);
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool.get(), 0);
+    commandBuffer.end();
+    QueueWrapper::Submission submission;
+    submission.commandBuffers.push_back(commandBufWrapper.getCommandBufferSubmitInfo());
+    deviceWrapper.graphicsQueueWrapper.submit(std::move(submission));
+    deviceWrapper.device->waitIdle();
+    uint64_t hostNanoseconds = render::profiler::now();
+
+    uint64_t ticks = 0;
+    vk::Result result = deviceWrapper.device->getQueryPoolResults(queryPool.get(), 0, 1, sizeof(ticks), &ticks, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    if (result == vk::Result::eSuccess) {
+        deviceToHostOffset = static_cast<int64_t>(hostNanoseconds) - static_cast<int64_t>((ticks & timestampMask) * timestampPeriod);
+    }
+}
+
+// 各パスのGPU時間の統計にも使うため、トレースを記録していなくても対応していれば毎フレーム計測する
+void VulkanContext::DeviceWrapper::GpuProfilerWrapper::beginFrame() {
+    zones.clear();
+    zoneMilliseconds.clear();
+    queryCount = 0;
+    active = supported;
+    traced = active && render::profiler::isEnabled();
+    if (active) {
+        deviceWrapper.device->resetQueryPool(queryPool.get(), 0, kMaxQueries);
+    }
+}
+
+uint32_t VulkanContext::DeviceWrapper::GpuProfilerWrapper::beginZone(vk::CommandBuffer commandBuffer, const char* track, const char* name) {
+    if (!active || queryCount + 2 > kMaxQueries) {
+        return UINT32_MAX;
+    }
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool.get(), queryCount);
+    zones.push_back({track, name, queryCount});
+    queryCount += 2;
+    return static_cast<uint32_t>(zones.size() - 1);
+}
+
+void VulkanContext::DeviceWrapper::GpuProfilerWrapper::endZone(vk::CommandBuffer commandBuffer, uint32_t zone) {
+    if (zone == UINT32_MAX) {
+        return;
+    }
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool.get(), zones[zone].query + 1);
+}
+
+//フレーム完了後に呼ぶ（waitForFrameでフェンスの待機が済んでいる前提）
+void VulkanContext::DeviceWrapper::GpuProfilerWrapper::collect() {
+    if (!active || queryCount == 0) {
+        active = false;
+        return;
+    }
+    active = false;
+
+    std::array<uint64_t, kMaxQueries> timestamps{};
+    vk::Result result = deviceWrapper.device->getQueryPoolResults(queryPool.get(), 0, queryCount, queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+
+    // 有効なビット数が64未満のキューでは値が折り返すため、差もマスクしてから時間にする
+    for (const Zone& zone : zones) {
+        uint64_t ticks = (timestamps[zone.query + 1] - timestamps[zone.query]) & timestampMask;
+        zoneMilliseconds.push_back(ticks * timestampPeriod * 1e-6);
+    }
+
+    if (!traced) {
+        return;
+    }
+    // 長時間の記録でもずれないよう、回収のたびに較正し直す
+    if (calibrated) {
+        calibrate();
+    }
+    for (const Zone& zone : zones) {
+        render::profiler::recordGpuZone(zone.track, zone.name, toHostNanoseconds(timestamps[zone.query]), toHostNanoseconds(timestamps[zone.query + 1]));
+    }
+}
+
+bool VulkanContext::DeviceWrapper::GpuProfilerWrapper::getZoneMilliseconds(uint32_t zone, double& milliseconds) const {
+    if (zone >= zoneMilliseconds.size()) {
+        return false;
+    }
+    milliseconds = zoneMilliseconds[zone];
+    return true;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// シェーダ側（shader/meshletCommon.glsl）と同じレイアウト
+struct GpuInstance {
+    uint32_t transformIndex;
+    uint32_t materialIndex;
+    uint32_t pad0;
+    uint32_t pad1;
+};
+
+struct GpuMaterial {
+    glm::vec4 baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float pad0;
+    float pad1;
+};
+
+// 連続して変更された要素の範囲（要素単位）
+struct DirtyRange {
+    uint32_t first;
+    uint32_t count;
+};
+
+struct SceneUploadStatistics {
+    uint64_t bytes = 0;//書き込んだバイト数
+    uint32_t ranges = 0;//書き込んだ範囲の数（memcpyの回数）
+    uint32_t entries = 0;//変更された要素数
+
+    void add(const SceneUploadStatistics& other) {
+        bytes += other.bytes;
+        ranges += other.ranges;
+        entries += other.entries;
+    }
+};
+
+// GPUに常駐する表のCPU側の写しと変更の記録
+// set()で値が変わった要素だけを記録し、flush()で変更された範囲だけをGPUのバッファへ書き込む
+template <typename T>
+class DirtyTable {
+    public:
+        // mergeGap: この要素数以下の隙間なら、変更されていない要素ごと1つの範囲にまとめる
+        explicit DirtyTable(uint32_t mergeGap = 0) : mergeGap(mergeGap) {}
+
+        // 中身を入れ替える（次のflush()で全体を書き込む）
+        void assign(std::vector<T> values) {
+            entries = std::move(values);
+            dirtyFlags.assign(entries.size(), 0);
+            dirtyIndices.clear();
+            allDirty = true;
+        }
+
+        // 値が変わった場合のみ記録してtrueを返す
+        bool set(uint32_t index, const T& value) {
+            if (std::memcmp(&entries[index], &value, sizeof(T)) == 0) {
+                return false;
+            }
+            entries[index] = value;
+            if (!dirtyFlags[index]) {
+                dirtyFlags[index] = 1;
+                dirtyIndices.push_back(index);
+            }
+            return true;
+        }
+
+        const T& operator[](size_t index) const { return entries[index]; }
+        size_t size() const { return entries.size(); }
+        size_t dirtyCount() const { return allDirty ? entries.size() : dirtyIndices.size(); }
+        vk::DeviceSize byteSize() const { return entries.size() * sizeof(T); }
+
+        // 変更された要素を範囲にまとめる（呼び出し後の範囲はgetRanges()で参照できる）
+        const std::vector<DirtyRange>& collectRanges() {
+            ranges.clear();
+            if (allDirty) {
+                if (!entries.empty()) {
+                    ranges.push_back({0, static_cast<uint32_t>(entries.size())});
+                }
+            } else if (dirtyIndices.size() * 4 >= entries.size()) {
+                // 変更が多い場合は、番号をソートするより印を順に見た方が速い
+                for (uint32_t i = 0; i < dirtyFlags.size(); i++) {
+                    if (dirtyFlags[i]) {
+                        appendIndex(i);
+                    }
+                }
+            } else {
+                std::sort(dirtyIndices.begin(), dirtyIndices.end());
+                for (uint32_t index : dirtyIndices) {
+                    appendIndex(index);
+                }
+            }
+            for (uint32_t index : dirtyIndices) {
+                dirtyFlags[index] = 0;
+            }
+            dirtyIndices.clear();
+            allDirty = false;
+            return ranges;
+        }
+        const std::vector<DirtyRange>& getRanges() const { return ranges; }
+
+        // 変更された範囲をmapped（表の先頭）へ書き込み、記録を消す
+        SceneUploadStatistics flush(void* mapped) {
+            SceneUploadStatistics stats;
+            stats.entries = static_cast<uint32_t>(dirtyCount());
+            for (const DirtyRange& range : collectRanges()) {
+                std::memcpy(static_cast<std::byte*>(mapped) + range.first * sizeof(T), &entries[range.first], range.count * sizeof(T));
+                stats.bytes += range.count * sizeof(T);
+                stats.ranges++;
+            }
+            return stats;
+        }
+
+    private:
+        std::vector<T> entries;
+        std::vector<uint8_t> dirtyFlags;
+        std::vector<uint32_t> dirtyIndices;//変更された要素の番号（記録順）
+        std::vector<DirtyRange> ranges;//容量は使い回す
+        uint32_t mergeGap;
+        bool allDirty = false;
+
+        void appendIndex(uint32_t index) {
+            if (!ranges.empty() && index <= ranges.back().first + ranges.back().count + mergeGap) {
+                ranges.back().count = index + 1 - ranges.back().first;
+            } else {
+                ranges.push_back({index, 1});
+            }
+        }
+};
+
+// GPUに常駐するシーンの表（トランスフォーム・インスタンス・マテリアル）
+// インスタンスは描画単位（ノードとプリミティブの組）で、トランスフォームとマテリアルを番号で参照する
+class GpuScene {
+    public:
+        // 隙間を埋めて書き込む量より、範囲を分けるコストの方が大きい程度の要素数
+        DirtyTable<glm::mat4> transforms{4};
+        DirtyTable<GpuInstance> instances{8};
+        DirtyTable<GpuMaterial> materials{8};
+
+        // 3つの表の変更をそれぞれのバッファへ書き込む
+        SceneUploadStatistics flush(void* transformData, void* instanceData, void* materialData) {
+            SceneUploadStatistics stats = transforms.flush(transformData);
+            stats.add(instances.flush(instanceData));
+            stats.add(materials.flush(materialData));
+            return stats;
+        }
+};
+
+}
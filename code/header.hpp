@@ -1,28 +1,48 @@
-#include <iostream>
-#include <vector>
-#include <map>
-#include <unordered_map>
-#include <set>
-#include <fstream>
-#include <filesystem>
-#include <string>
-#include <sstream>
-#include <chrono>
-#include <thread>
-#include <algorithm>
-#include <locale>
-
-// #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
-#include <vulkan/vulkan.hpp>
-
-#include <GLFW/glfw3.h>
-
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/transform.hpp>
-#include <glm/gtx/matrix_decompose.hpp>
-#include <glm/gtx/log_base.hpp>
-
-#include <tiny_gltf.h>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cstdlib>
+#include <array>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <barrier>
+#include <bit>
+#include <memory_resource>
+#include <limits>
+#include <random>
+#include <iomanip>
+#include <locale>
+
+// #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/log_base.hpp>
+
+#include <tiny_gltf.h>
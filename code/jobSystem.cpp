@@ -0,0 +1,317 @@
+#include "jobSystem.hpp"
+#include "profiler.hpp"
+
+namespace render {
+
+namespace {
+
+constexpr uint32_t kUnregisteredThread = UINT32_MAX;
+constexpr uint32_t kIdleSpins = 64;//眠るまでに譲る回数
+constexpr size_t kMaxSplits = 64;//範囲は半分ずつ切り出すため、size_tの範囲ならこれを超えない
+
+thread_local uint32_t threadIndex = kUnregisteredThread;
+thread_local uint32_t stealSeed = 0x9e3779b9u;
+
+uint32_t nextRandom() {
+    // xorshift32（盗む相手の開始位置をばらけさせる）
+    stealSeed ^= stealSeed << 13;
+    stealSeed ^= stealSeed >> 17;
+    stealSeed ^= stealSeed << 5;
+    return stealSeed;
+}
+
+} // namespace
+
+// Chase-Levの両端キュー（固定長）
+// 末尾への追加と取り出しは所有スレッドのみ、先頭からの盗み出しは任意のスレッドから行う
+class JobSystem::WorkDeque {
+    public:
+        static constexpr int64_t kCapacity = 1024;
+
+        // 満杯ならfalse（呼び出し側がその場で実行する）
+        bool push(Job* job) {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            if (b - t >= kCapacity) {
+                return false;
+            }
+            jobs[b & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        Job* pop() {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            Job* job = jobs[b & (kCapacity - 1)].load(std::memory_order_relaxed);
+            if (t == b) {
+                // 最後の1つは盗みと競合するため、先頭を進められた側が取る
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    job = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+
+        // 競合で失敗した場合もnullptrを返す
+        Job* steal() {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) {
+                return nullptr;
+            }
+            Job* job = jobs[t & (kCapacity - 1)].load(std::memory_order_relaxed);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return job;
+        }
+
+        bool empty() const {
+            return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        std::array<std::atomic<Job*>, kCapacity> jobs{};
+};
+
+JobSystem& JobSystem::instance() {
+    static JobSystem system;
+    return system;
+}
+
+JobSystem::JobSystem() : mainThreadId(std::this_thread::get_id()) {
+    threadIndex = 0;
+    startWorkers(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+}
+
+JobSystem::~JobSystem() {
+    stopWorkers();
+}
+
+void JobSystem::setThreadCount(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if (threadCount == getThreadCount()) {
+        return;
+    }
+    stopWorkers();
+    startWorkers(threadCount - 1);
+}
+
+void JobSystem::startWorkers(uint32_t workerCount) {
+    deques.clear();
+    for (uint32_t i = 0; i <= workerCount; i++) {
+        deques.push_back(std::make_unique<WorkDeque>());
+    }
+    for (uint32_t i = 1; i <= workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::stopWorkers() {
+    stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_all();
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    stopping.store(false);
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    threadIndex = index;
+    stealSeed ^= index * 0x85ebca6bu;
+    profiler::setThreadName("job worker " + std::to_string(index));
+
+    uint32_t idleSpins = 0;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        if (Job* job = findJob(index)) {
+            execute(*job);
+            idleSpins = 0;
+            continue;
+        }
+        if (++idleSpins < kIdleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // 待機中の数を増やしてから数え直す（投入側は増やした後に待機中の数を見る）
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        wake.wait(lock, [&]() { return stopping.load() || queuedJobs.load() > 0; });
+        sleepingWorkers.fetch_sub(1);
+        idleSpins = 0;
+    }
+}
+
+void JobSystem::notifyQueued() {
+    queuedJobs.fetch_add(1);
+    if (sleepingWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+}
+
+void JobSystem::run(Job& job, JobCounter& counter) {
+    job.counter = &counter;
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    if (threadIndex < deques.size()) {
+        if (!deques[threadIndex]->push(&job)) {
+            execute(job);
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedJobs.push_back(&job);
+        sharedJobCount.fetch_add(1);
+    }
+    notifyQueued();
+}
+
+bool JobSystem::hasQueuedJobs(uint32_t index) const {
+    if (index < deques.size()) {
+        return !deques[index]->empty();
+    }
+    return sharedJobCount.load(std::memory_order_relaxed) > 0;
+}
+
+// 自分のキュー → 共有のキュー → 他のスレッドのキューの順に探す
+Job* JobSystem::findJob(uint32_t index) {
+    Job* job = nullptr;
+    if (index < deques.size()) {
+        job = deques[index]->pop();
+    }
+    if (job == nullptr && sharedJobCount.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!sharedJobs.empty()) {
+            job = sharedJobs.front();
+            sharedJobs.pop_front();
+            sharedJobCount.fetch_sub(1);
+        }
+    }
+    if (job == nullptr) {
+        uint32_t count = static_cast<uint32_t>(deques.size());
+        uint32_t start = nextRandom() % count;
+        for (uint32_t i = 0; i < count && job == nullptr; i++) {
+            uint32_t victim = (start + i) % count;
+            if (victim != index) {
+                job = deques[victim]->steal();
+            }
+        }
+    }
+    if (job != nullptr) {
+        queuedJobs.fetch_sub(1);
+    }
+    return job;
+}
+
+// 完了を数えた後は待つ側がジョブを破棄してよいため、以降はjobに触れない
+void JobSystem::execute(Job& job) {
+    JobCounter* counter = job.counter;
+    job.function();
+    counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    uint32_t index = threadIndex;
+    while (!counter.isDone()) {
+        if (index == 0) {
+            pumpMainThread();
+        }
+        if (Job* job = findJob(index)) {
+            execute(*job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::runOnMainThread(Job& job, JobCounter& counter) {
+    if (isMainThread()) {
+        job.function();
+        return;
+    }
+    job.counter = &counter;
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mainThreadMutex);
+    mainThreadJobs.push_back(&job);
+    hasMainThreadJobs.store(true);
+}
+
+void JobSystem::pumpMainThread() {
+    if (!hasMainThreadJobs.load()) {
+        return;
+    }
+    std::vector<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        jobs.swap(mainThreadJobs);
+        hasMainThreadJobs.store(false);
+    }
+    for (Job* job : jobs) {
+        execute(*job);
+    }
+}
+
+// 遅延二分割：自分のキューが空（＝前に切り出した分が盗まれた）のときだけ残りの半分を切り出す
+// 切り出した分は自分のスタックに置き、戻る前に完了を待つ
+void JobSystem::processRange(const RangeFunctionRef& func, size_t begin, size_t end, size_t grain) {
+    if (workers.empty() || end - begin <= grain * 2) {
+        for (size_t current = begin; current < end; current += grain) {
+            func(current, std::min(current + grain, end));
+        }
+        return;
+    }
+
+    struct RangeJob {
+        Job job;
+        const RangeFunctionRef* func;
+        size_t begin;
+        size_t end;
+        size_t grain;
+    };
+    std::array<RangeJob, kMaxSplits> splits;
+    size_t splitCount = 0;
+    JobCounter counter;
+    uint32_t index = threadIndex;
+
+    size_t current = begin;
+    while (current < end) {
+        if (end - current > grain * 2 && splitCount < kMaxSplits && !hasQueuedJobs(index)) {
+            size_t middle = current + (end - current) / 2;
+            RangeJob& split = splits[splitCount++];
+            split.func = &func;
+            split.begin = middle;
+            split.end = end;
+            split.grain = grain;
+            split.job.function = [&split]() {
+                JobSystem::instance().processRange(*split.func, split.begin, split.end, split.grain);
+            };
+            run(split.job, counter);
+            end = middle;
+            continue;
+        }
+        size_t chunkEnd = std::min(current + grain, end);
+        func(current, chunkEnd);
+        current = chunkEnd;
+    }
+    wait(counter);
+}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 子ジョブの完了を数えるカウンタ（fork-join）
+// run()で数を増やし、ジョブが終わるたびに減らす。wait()は0になるまで他のジョブを手伝いながら待つ
+class JobCounter {
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        std::atomic<uint32_t> pending{0};
+
+        friend class JobSystem;
+};
+
+// ジョブ本体。実行が終わるまで呼び出し側が保持する（fork-joinでは待つ側のスタックに置けばよい）
+// ジョブは例外を投げない
+class Job {
+    public:
+        std::function<void()> function;
+
+        Job() = default;
+        explicit Job(std::function<void()> jobFunction) : function(std::move(jobFunction)) {}
+
+        Job(const Job&) = delete;
+        Job& operator=(const Job&) = delete;
+
+    private:
+        JobCounter* counter = nullptr;
+
+        friend class JobSystem;
+};
+
+// parallelForの範囲処理への参照（std::functionと違い確保をしない）
+class RangeFunctionRef {
+    public:
+        template <typename Func>
+        RangeFunctionRef(Func& func)
+            : object(&func), call([](const void* target, size_t begin, size_t end) { (*static_cast<Func*>(const_cast<void*>(target)))(begin, end); }) {}
+
+        void operator()(size_t begin, size_t end) const { call(object, begin, end); }
+
+    private:
+        const void* object;
+        void (*call)(const void*, size_t, size_t);
+};
+
+// ワークスティーリング方式のジョブスケジューラ（読み込み・フレームの更新・描画で共有する）
+// スレッドごとにChase-Levの両端キューを持ち、自分のキューの末尾から取り出し、空なら他のスレッドの先頭から盗む
+// メインスレッド（最初にinstance()を呼んだスレッド）も番号0のスレッドとして参加する
+// 登録されていないスレッド（描画スレッドなど）から投入したジョブは共有のキューに入る
+class JobSystem {
+    public:
+        static JobSystem& instance();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // メインスレッドを含めたスレッド数を変える（0でハードウェアスレッド数、1ならワーカースレッドを使わない）
+        // メインスレッドから、ジョブが実行されていない間に呼ぶ
+        void setThreadCount(uint32_t threadCount);
+        // メインスレッドを含めたスレッド数
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+        // ジョブを投入し、counterに数える
+        void run(Job& job, JobCounter& counter);
+        // counterが0になるまで、他のジョブ（メインスレッドではメインスレッド専用のジョブも）を実行しながら待つ
+        void wait(JobCounter& counter);
+
+        // メインスレッドでしか呼べない処理（GLFWなど）をメインスレッドで実行する
+        // メインスレッドから呼んだ場合はその場で実行する
+        void runOnMainThread(Job& job, JobCounter& counter);
+        // メインスレッド専用のジョブを実行する（毎フレームのイベント処理から呼ぶ）
+        void pumpMainThread();
+        bool isMainThread() const { return std::this_thread::get_id() == mainThreadId; }
+
+        // [0, count) をgrain個以上のまとまりに分けて並列に処理する（呼び出したスレッドも処理に加わる）
+        // 自分のキューが空のときだけ残りの半分を切り出すため、他のスレッドが暇なほど細かく分かれる
+        template <typename Func>
+        void parallelFor(size_t count, size_t grain, Func&& func) {
+            processRange(RangeFunctionRef(func), 0, count, std::max<size_t>(grain, 1));
+        }
+
+    private:
+        JobSystem();
+        ~JobSystem();
+
+        class WorkDeque;
+
+        std::vector<std::unique_ptr<WorkDeque>> deques;//0はメインスレッド
+        std::vector<std::thread> workers;
+        std::thread::id mainThreadId;
+        std::atomic<bool> stopping{false};
+
+        // 登録されていないスレッドから投入されたジョブ
+        std::mutex sharedMutex;
+        std::deque<Job*> sharedJobs;
+        std::atomic<uint32_t> sharedJobCount{0};
+
+        std::mutex mainThreadMutex;
+        std::vector<Job*> mainThreadJobs;
+        std::atomic<bool> hasMainThreadJobs{false};
+
+        // 眠っているワーカーを起こすための数（キューにあるジョブ数と待機中のワーカー数）
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        std::atomic<int64_t> queuedJobs{0};
+        std::atomic<uint32_t> sleepingWorkers{0};
+
+        void startWorkers(uint32_t workerCount);
+        void stopWorkers();
+        void workerLoop(uint32_t index);
+
+        bool hasQueuedJobs(uint32_t index) const;
+        Job* findJob(uint32_t index);
+        void execute(Job& job);
+        void notifyQueued();
+        void processRange(const RangeFunctionRef& func, size_t begin, size_t end, size_t grain);
+};
+
+}
@@ -0,0 +1,72 @@
+#include "lightCluster.hpp"
+
+namespace render {
+
+void collectLights(const geometry::Model& model, const glm::mat4& rootMatrix, std::vector<SceneLight>& lights) {
+    for (const auto& node : model.nodes) {
+        if (node.lightIndex < 0 || node.lightIndex >= static_cast<int32_t>(model.lights.size())) {
+            continue;
+        }
+        const geometry::Light& light = model.lights[node.lightIndex];
+        glm::mat4 worldMatrix = rootMatrix * node.globalMatrix;
+        SceneLight sceneLight;
+        sceneLight.type = light.type;
+        sceneLight.position = glm::vec3(worldMatrix[3]);
+        sceneLight.direction = glm::normalize(glm::mat3(worldMatrix) * glm::vec3(0.0f, 0.0f, -1.0f));
+        sceneLight.color = light.color;
+        sceneLight.intensity = light.intensity;
+        sceneLight.range = light.range;
+        sceneLight.innerConeAngle = light.innerConeAngle;
+        sceneLight.outerConeAngle = light.outerConeAngle;
+        lights.push_back(sceneLight);
+    }
+}
+
+float effectiveLightRange(const SceneLight& light) {
+    if (light.type == geometry::LightType::Directional) {
+        return 0.0f;
+    }
+    if (light.range > 0.0f) {
+        return light.range;
+    }
+    // 逆二乗で減衰した放射照度がkLightCutoffになる距離
+    float brightest = std::max(std::max(light.color.x, light.color.y), light.color.z) * light.intensity;
+    return std::sqrt(std::max(brightest, 0.0f) / kLightCutoff);
+}
+
+uint32_t packLights(const std::vector<SceneLight>& lights, std::vector<GpuLight>& packed) {
+    packed.clear();
+    auto pack = [&](const SceneLight& light) {
+        if (packed.size() >= kMaxLights) {
+            return;
+        }
+        // glTFの推奨どおり、内側の角度から外側の角度へcosで補間する
+        glm::vec2 spot(0.0f, 1.0f);
+        if (light.type == geometry::LightType::Spot) {
+            float cosOuter = std::cos(light.outerConeAngle);
+            float scale = 1.0f / std::max(0.001f, std::cos(light.innerConeAngle) - cosOuter);
+            spot = glm::vec2(scale, -cosOuter * scale);
+        }
+        packed.push_back({
+            glm::vec4(light.position, effectiveLightRange(light)),
+            glm::vec4(light.direction, static_cast<float>(light.type)),
+            glm::vec4(light.color * light.intensity, 0.0f),
+            glm::vec4(spot, 0.0f, 0.0f)
+        });
+    };
+
+    for (const SceneLight& light : lights) {
+        if (light.type == geometry::LightType::Directional) {
+            pack(light);
+        }
+    }
+    uint32_t directionalCount = static_cast<uint32_t>(packed.size());
+    for (const SceneLight& light : lights) {
+        if (light.type != geometry::LightType::Directional) {
+            pack(light);
+        }
+    }
+    return directionalCount;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace render {
+
+// クラスタの分割（画面をx×yのタイルに、視錐台の奥行きをzの指数分割に分ける）
+constexpr uint32_t kClusterGridX = 16;
+constexpr uint32_t kClusterGridY = 9;
+constexpr uint32_t kClusterGridZ = 24;
+constexpr uint32_t kClusterCount = kClusterGridX * kClusterGridY * kClusterGridZ;
+constexpr uint32_t kMaxLightsPerCluster = 256;//超えた分は割り当てない
+constexpr uint32_t kMaxLights = 4096;
+constexpr float kLightCutoff = 0.01f;//rangeの無いライトは放射照度がこれを下回る距離で打ち切る
+
+// ワールド空間に置いたライト
+struct SceneLight {
+    geometry::LightType type = geometry::LightType::Point;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);//光の進む向き
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;
+    float range = 0.0f;
+    float innerConeAngle = 0.0f;
+    float outerConeAngle = 0.7853981634f;
+};
+
+// シェーダ側（shader/meshletLights.glsl）と同じレイアウト
+struct GpuLight {
+    glm::vec4 positionRange;//xyz: ワールド位置, w: 影響範囲（平行光源は0）
+    glm::vec4 directionType;//xyz: 光の進む向き, w: 種類（geometry::LightType）
+    glm::vec4 radiance;//rgb: 色 × 強度
+    glm::vec4 spotScaleOffset;//x: 角度のcosに掛ける値, y: 足す値（スポット以外は減衰させない）
+};
+
+// モデル内のライトを持つノードを追加する（collectDrawRecordsと同じくrootMatrixを掛ける）
+void collectLights(const geometry::Model& model, const glm::mat4& rootMatrix, std::vector<SceneLight>& lights);
+
+// 影響範囲（rangeが無ければ強度と色から求める）
+float effectiveLightRange(const SceneLight& light);
+
+// 平行光源を先頭に並べてシェーダ用に詰める（kMaxLightsを超えた分は捨てる）。戻り値は平行光源の数
+uint32_t packLights(const std::vector<SceneLight>& lights, std::vector<GpuLight>& packed);
+
+}
@@ -0,0 +1,183 @@
+#include "vulkanContext.hpp"
+
+namespace {
+
+constexpr uint32_t kClusterWorkgroupSize = 128;//shader/lightCluster.comp（1スレッドが1クラスタを受け持つ）
+
+} // namespace
+
+//ライト・クラスタのバッファと割り当てのパイプラインを作る
+//ライトとクラスタごとのライト数はホストから見えるメモリに置く（ライトの入れ替えと統計の読み出しのため）
+void VulkanContext::DeviceWrapper::LightClusterWrapper::initLightClusters() {
+    PROFILE_ZONE("initLightClusters");
+    commandBufWrapper.initCommandBuf(deviceWrapper.computeQueueWrapper);
+
+    vk::MemoryPropertyFlags hostVisible = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    paramsBuffer = deviceWrapper.createBuffer(sizeof(ClusterParams), vk::BufferUsageFlagBits::eUniformBuffer, hostVisible);
+    lightBuffer = deviceWrapper.createBuffer(sizeof(render::GpuLight) * render::kMaxLights, vk::BufferUsageFlagBits::eStorageBuffer, hostVisible);
+    gridBuffer = deviceWrapper.createBuffer(sizeof(uint32_t) * render::kClusterCount, vk::BufferUsageFlagBits::eStorageBuffer, hostVisible);
+    std::memset(gridBuffer.mapped, 0, sizeof(uint32_t) * render::kClusterCount);
+    indexBuffer = deviceWrapper.createBuffer(sizeof(uint32_t) * render::kClusterCount * render::kMaxLightsPerCluster, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // binding 15: パラメータ, 16: ライト, 17: クラスタごとのライト数, 18: ライト番号（描画側のディスクリプタと同じ番号）
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+        vk::DescriptorSetLayoutBinding(15, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(16, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(17, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(18, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+    };
+    descriptorSetLayout = deviceWrapper.device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 1),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 3)
+    };
+    descriptorPool = deviceWrapper.device->createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, 1, poolSizes));
+    descriptorSet = deviceWrapper.device->allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), 1, &descriptorSetLayout.get())).front();
+
+    std::array<vk::DescriptorBufferInfo, 4> bufferInfos = {
+        vk::DescriptorBufferInfo(paramsBuffer.buffer.get(), 0, VK_WHOLE_SIZE),
+        vk::DescriptorBufferInfo(lightBuffer.buffer.get(), 0, VK_WHOLE_SIZE),
+        vk::DescriptorBufferInfo(gridBuffer.buffer.get(), 0, VK_WHOLE_SIZE),
+        vk::DescriptorBufferInfo(indexBuffer.buffer.get(), 0, VK_WHOLE_SIZE)
+    };
+    std::vector<vk::WriteDescriptorSet> writes;
+    for (uint32_t i = 0; i < bufferInfos.size(); i++) {
+        writes.push_back(vk::WriteDescriptorSet(
+            descriptorSet,//dstSet
+            15 + i,//dstBinding
+            0,//dstArrayElement
+            1,//descriptorCount
+            i == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer,//descriptorType
+            nullptr,//pImageInfo
+            &bufferInfos[i]//pBufferInfo
+        ));
+    }
+    deviceWrapper.device->updateDescriptorSets(writes, {});
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+        {},//flags
+        1,//setLayoutCount
+        &descriptorSetLayout.get(),//pSetLayouts
+        0,//pushConstantRangeCount
+        nullptr//pPushConstantRanges
+    );
+    pipelineLayout = deviceWrapper.device->createPipelineLayoutUnique(pipelineLayoutInfo);
+
+    vk::UniqueShaderModule shaderModule = deviceWrapper.pipelineWrapper.initShaderModule("./shader/compiled/lightCluster.comp.spv");
+    vk::ComputePipelineCreateInfo computeCreateInfo(
+        {},//flags
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModule.get(), "main"),//stage
+        pipelineLayout.get()//layout
+    );
+    pipeline = deviceWrapper.device->createComputePipelineUnique(VK_NULL_HANDLE, computeCreateInfo).value;
+
+    semaphore = deviceWrapper.device->createSemaphoreUnique(vk::SemaphoreCreateInfo{});
+
+    ready = true;
+    updateParams();
+    std::cout << "クラスタライティング: " << render::kClusterGridX << "x" << render::kClusterGridY << "x" << render::kClusterGridZ << " クラスタ, "
+              << "最大 " << render::kMaxLights << " ライト (1クラスタ " << render::kMaxLightsPerCluster << ")" << std::endl;
+}
+
+void VulkanContext::DeviceWrapper::LightClusterWrapper::setLights(const std::vector<render::SceneLight>& lights) {
+    if (!ready) {
+        return;
+    }
+    std::vector<render::GpuLight> packed;
+    directionalCount = render::packLights(lights, packed);
+    lightCount = static_cast<uint32_t>(packed.size());
+    if (!packed.empty()) {
+        std::memcpy(lightBuffer.mapped, packed.data(), sizeof(render::GpuLight) * packed.size());
+    }
+    if (lights.size() > packed.size()) {
+        std::cout << "ライトが上限を超えたため " << lights.size() - packed.size() << " 個を無視しました" << std::endl;
+    }
+    std::cout << "ライト: 平行光源 " << directionalCount << ", 点・スポット " << lightCount - directionalCount << std::endl;
+}
+
+//フレームごとのカメラからクラスタの奥行きの分割を決める（フレームは同期しているため直接書き込む）
+void VulkanContext::DeviceWrapper::LightClusterWrapper::updateParams() {
+    const glm::mat4& projection = deviceWrapper.context.projectionMatrix;
+    // glm::perspective（深度-1..1）の係数から手前と奥の距離を求める
+    float zNear = std::max(projection[3][2] / (projection[2][2] - 1.0f), 0.01f);
+    float zFar = std::max(projection[3][2] / (projection[2][2] + 1.0f), zNear * 2.0f);
+    float logRange = std::log(zFar / zNear);
+
+    ClusterParams params{};
+    params.view = deviceWrapper.context.viewMatrix;
+    params.gridSize = glm::uvec4(render::kClusterGridX, render::kClusterGridY, render::kClusterGridZ, render::kMaxLightsPerCluster);
+    vk::Extent2D renderExtent = deviceWrapper.dynamicResolutionWrapper.getRenderExtent();
+    params.screenSize = glm::vec2(static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height));
+    params.projectionScale = glm::vec2(projection[0][0], projection[1][1]);
+    params.zNear = zNear;
+    params.zFar = zFar;
+    params.sliceScale = render::kClusterGridZ / logRange;
+    params.sliceBias = -render::kClusterGridZ * std::log(zNear) / logRange;
+    params.lightCount = lightCount;
+    params.directionalCount = directionalCount;
+    params.clustered = active ? 1 : 0;
+    std::memcpy(paramsBuffer.mapped, &params, sizeof(params));
+}
+
+//点・スポットが無ければ割り当てず、描画は平行光源のみを計算する
+bool VulkanContext::DeviceWrapper::LightClusterWrapper::dispatch(QueueWrapper& queueWrapper) {
+    active = ready && enabled && lightCount > directionalCount;
+    clusterZone = UINT32_MAX;
+    if (!ready) {
+        return false;
+    }
+    updateParams();
+    if (!active) {
+        return false;
+    }
+
+    PROFILE_ZONE("lightCluster.dispatch");
+    vk::CommandBuffer commandBuffer = commandBufWrapper.getCommandBuffer();
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    clusterZone = deviceWrapper.gpuProfilerWrapper.beginZone(commandBuffer, "compute queue", "lightCluster");
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.get());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 0, descriptorSet, {});
+    commandBuffer.dispatch((render::kClusterCount + kClusterWorkgroupSize - 1) / kClusterWorkgroupSize, 1, 1);
+    deviceWrapper.gpuProfilerWrapper.endZone(commandBuffer, clusterZone);
+    commandBuffer.end();
+
+    QueueWrapper::Submission submission(deviceWrapper.context.frameArena.getThreadResource());
+    submission.commandBuffers.push_back(commandBufWrapper.getCommandBufferSubmitInfo());
+    submission.signalSemaphores.push_back(vk::SemaphoreSubmitInfo(semaphore.get(), 0, vk::PipelineStageFlagBits2::eAllCommands));
+    queueWrapper.enqueue(std::move(submission));
+    return true;
+}
+
+//フレーム完了後に呼ぶ（waitForFrameでフェンスの待機が済んでいる前提）
+void VulkanContext::DeviceWrapper::LightClusterWrapper::collectStatistics() {
+    if (!active) {
+        return;
+    }
+    statistics.frames++;
+    statistics.lights += lightCount - directionalCount;
+    const uint32_t* grid = static_cast<const uint32_t*>(gridBuffer.mapped);
+    for (uint32_t cluster = 0; cluster < render::kClusterCount; cluster++) {
+        statistics.assignedLights += grid[cluster];
+        statistics.maxClusterLights = std::max(statistics.maxClusterLights, grid[cluster]);
+        if (grid[cluster] >= render::kMaxLightsPerCluster) {
+            statistics.saturatedClusters++;
+        }
+    }
+
+    // GPU時間はプロファイラのゾーンから読む（タイムスタンプの有効ビットでマスク済み）
+    double milliseconds = 0.0;
+    if (deviceWrapper.gpuProfilerWrapper.getZoneMilliseconds(clusterZone, milliseconds)) {
+        statistics.clusterMilliseconds += milliseconds;
+    }
+
+    // 一定フレームごとに平均を出力
+    if (++frameCounter % 120 != 0 || !deviceWrapper.context.statisticsOutput) {
+        return;
+    }
+    double frames = static_cast<double>(statistics.frames);
+    std::cout << "クラスタライティング: ライト " << statistics.lights / frames
+              << ", 平均 " << statistics.lightsPerCluster() << " 個/クラスタ, 最大 " << statistics.maxClusterLights << " 個"
+              << " (上限に達したクラスタ " << statistics.saturatedClusters / frames << "/フレーム), "
+              << "割り当て " << statistics.clusterMilliseconds / frames << " ms" << std::endl;
+}
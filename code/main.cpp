@@ -1,20 +1,36 @@
-#include "app.hpp"
-
-int main() {
-    // UTF-8出力のための設定
-    std::ios_base::sync_with_stdio(false);
-    std::locale::global(std::locale(".UTF-8"));
-    
-    // 日本語ロケールの設定
-    setlocale(LC_ALL, "ja_JP.UTF-8");
-
-    try {
-        Application app;
-        app.run();
-    } catch (const std::exception& e) {
-        std::cerr << "エラーが発生しました: " << e.what() << std::endl;
-        return EXIT_FAILURE;
-    }
-    return EXIT_SUCCESS;
-
-}
+#include "app.hpp"
+#include "jobSystem.hpp"
+
+int main(int argc, char** argv) {
+    // UTF-8出力のための設定
+    std::ios_base::sync_with_stdio(false);
+    std::locale::global(std::locale(".UTF-8"));
+    
+    // 日本語ロケールの設定
+    setlocale(LC_ALL, "ja_JP.UTF-8");
+
+    try {
+        // メインスレッドをジョブシステムに登録し、ワーカースレッドを起動する
+        render::JobSystem::instance();
+
+        Application::Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--stats") {
+                options.statisticsOutput = true;
+            } else {
+                std::cout << "使い方: vkrenderkit [--stats]" << std::endl;
+                std::cout << "  --stats 120フレームごとの統計（描画リスト・カリング・影・ライト・遅延など）と選択結果を出力する" << std::endl;
+                return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+        }
+
+        Application app(options);
+        app.run();
+    } catch (const std::exception& e) {
+        std::cerr << "エラーが発生しました: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+
+}
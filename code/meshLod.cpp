@@ -0,0 +1,447 @@
+#include "meshLod.hpp"
+#include "meshOptimizer.hpp"
+#include "profiler.hpp"
+
+namespace geometry {
+
+namespace {
+
+// 平面二乗距離の和を表す対称4x4行列
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0;
+    double yy = 0, yz = 0, yw = 0;
+    double zz = 0, zw = 0;
+    double ww = 0;
+
+    void addPlane(const glm::vec3& n, float d) {
+        xx += n.x * n.x; xy += n.x * n.y; xz += n.x * n.z; xw += n.x * d;
+        yy += n.y * n.y; yz += n.y * n.z; yw += n.y * d;
+        zz += n.z * n.z; zw += n.z * d;
+        ww += static_cast<double>(d) * d;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        xx += o.xx; xy += o.xy; xz += o.xz; xw += o.xw;
+        yy += o.yy; yz += o.yz; yw += o.yw;
+        zz += o.zz; zw += o.zw;
+        ww += o.ww;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double error = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+                     + yy * y * y + 2 * yz * y * z + 2 * yw * y
+                     + zz * z * z + 2 * zw * z
+                     + ww;
+        return std::max(error, 0.0);
+    }
+};
+
+// 法線とUVの差（属性誤差）
+float attributeDistanceSq(const StaticVertexAttributes& a, const StaticVertexAttributes& b) {
+    glm::vec3 dn = a.normal - b.normal;
+    glm::vec2 duv = a.texCoord - b.texCoord;
+    return glm::dot(dn, dn) + glm::dot(duv, duv);
+}
+
+glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+    return glm::cross(p1 - p0, p2 - p0);
+}
+
+// 位置が同一の頂点をまとめた代表インデックス
+std::vector<uint32_t> buildPositionRemap(const std::vector<StaticVertexAttributes>& vertices) {
+    struct PositionHash {
+        size_t operator()(const glm::vec3& p) const {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> firstVertex;
+    firstVertex.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    for (uint32_t i = 0; i < vertices.size(); i++) {
+        remap[i] = firstVertex.try_emplace(vertices[i].position, i).first->second;
+    }
+    return remap;
+}
+
+uint32_t dominantJoint(const StaticVertexAttributes& vertex) {
+    uint32_t best = 0;
+    for (int i = 1; i < 4; i++) {
+        if (vertex.weight[i] > vertex.weight[best]) {
+            best = i;
+        }
+    }
+    return vertex.joint[best];
+}
+
+} // namespace
+
+std::vector<uint8_t> computeLockedVertices(const Primitive& primitive, bool lockSkinningBorders) {
+    const auto& vertices = primitive.vertices;
+    const auto& indices = primitive.indices;
+    std::vector<uint8_t> locked(vertices.size(), 0);
+    std::vector<uint32_t> positionRemap = buildPositionRemap(vertices);
+
+    // UVシーム: 同じ位置に属性の異なる頂点が存在する
+    std::vector<uint32_t> wedgeCount(vertices.size(), 0);
+    for (uint32_t i = 0; i < vertices.size(); i++) {
+        wedgeCount[positionRemap[i]]++;
+    }
+
+    // 開いた境界: 逆向きの辺が存在しない辺
+    std::unordered_set<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            uint64_t a = positionRemap[indices[i + k]];
+            uint64_t b = positionRemap[indices[i + (k + 1) % 3]];
+            edges.insert((a << 32) | b);
+        }
+    }
+    std::vector<uint8_t> borderPosition(vertices.size(), 0);
+    for (uint64_t edge : edges) {
+        uint64_t a = edge >> 32;
+        uint64_t b = edge & 0xffffffffull;
+        if (!edges.contains((b << 32) | a)) {
+            borderPosition[a] = 1;
+            borderPosition[b] = 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < vertices.size(); i++) {
+        uint32_t representative = positionRemap[i];
+        if (wedgeCount[representative] > 1 || borderPosition[representative]) {
+            locked[i] = 1;
+        }
+    }
+
+    // スキニング境界: 辺の両端で支配ジョイントが異なる
+    if (lockSkinningBorders && primitive.attributes.hasJoints && primitive.attributes.hasWeights) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = indices[i + k];
+                uint32_t b = indices[i + (k + 1) % 3];
+                if (dominantJoint(vertices[a]) != dominantJoint(vertices[b])) {
+                    locked[a] = 1;
+                    locked[b] = 1;
+                }
+            }
+        }
+    }
+    return locked;
+}
+
+std::vector<uint32_t> simplifyIndices(const std::vector<StaticVertexAttributes>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint8_t>& locked, size_t targetIndexCount, float maxError, float attributeWeight, float& resultError) {
+    const size_t vertexCount = vertices.size();
+    std::vector<uint32_t> result = indices;
+    resultError = 0.0f;
+
+    // 各頂点に隣接三角形の平面を蓄積
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        const glm::vec3& p0 = vertices[result[i]].position;
+        const glm::vec3& p1 = vertices[result[i + 1]].position;
+        const glm::vec3& p2 = vertices[result[i + 2]].position;
+        glm::vec3 n = triangleNormal(p0, p1, p2);
+        float length = glm::length(n);
+        if (length <= 0.0f) {
+            continue;
+        }
+        n /= length;
+        float d = -glm::dot(n, p0);
+        for (int k = 0; k < 3; k++) {
+            quadrics[result[i + k]].addPlane(n, d);
+        }
+    }
+
+    const double maxErrorSq = static_cast<double>(maxError) * maxError;
+    const double attributeScale = attributeWeight * maxErrorSq;
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> adjacencyOffsets;
+    std::vector<uint32_t> adjacency;
+    std::vector<uint8_t> touched;
+    std::vector<uint32_t> remap;
+
+    while (result.size() > targetIndexCount) {
+        // 頂点→三角形の隣接リスト
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // 縮約候補（from を to へ寄せる半辺縮約）
+        candidates.clear();
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = result[i + k];
+                uint32_t b = result[i + (k + 1) % 3];
+                for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+                    if (locked[from]) {
+                        continue;
+                    }
+                    Quadric q = quadrics[from];
+                    q += quadrics[to];
+                    double cost = q.evaluate(vertices[to].position) + attributeScale * attributeDistanceSq(vertices[from], vertices[to]);
+                    candidates.push_back({from, to, cost});
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        touched.assign(vertexCount, 0);
+        remap.resize(vertexCount);
+        std::iota(remap.begin(), remap.end(), 0u);
+
+        size_t triangleCount = result.size() / 3;
+        size_t removedTriangles = 0;
+        size_t collapses = 0;
+        for (const Collapse& c : candidates) {
+            if (c.cost > maxErrorSq || (triangleCount - removedTriangles) * 3 <= targetIndexCount) {
+                break;
+            }
+            if (touched[c.from] || touched[c.to]) {
+                continue;
+            }
+
+            // 縮約によって面が裏返らないか確認
+            bool flipped = false;
+            size_t sharedTriangles = 0;
+            for (uint32_t k = adjacencyOffsets[c.from]; k < adjacencyOffsets[c.from + 1] && !flipped; k++) {
+                uint32_t t = adjacency[k];
+                uint32_t i0 = result[t * 3], i1 = result[t * 3 + 1], i2 = result[t * 3 + 2];
+                if (i0 == c.to || i1 == c.to || i2 == c.to) {
+                    sharedTriangles++;
+                    continue;
+                }
+                glm::vec3 before = triangleNormal(vertices[i0].position, vertices[i1].position, vertices[i2].position);
+                glm::vec3 p0 = vertices[i0 == c.from ? c.to : i0].position;
+                glm::vec3 p1 = vertices[i1 == c.from ? c.to : i1].position;
+                glm::vec3 p2 = vertices[i2 == c.from ? c.to : i2].position;
+                glm::vec3 after = triangleNormal(p0, p1, p2);
+                flipped = glm::dot(before, after) <= 0.0f;
+            }
+            if (flipped) {
+                continue;
+            }
+
+            remap[c.from] = c.to;
+            quadrics[c.to] += quadrics[c.from];
+            resultError = std::max(resultError, static_cast<float>(std::sqrt(c.cost)));
+            removedTriangles += sharedTriangles;
+            collapses++;
+
+            // 同じパス内で1リング近傍を再度動かさない
+            for (uint32_t k = adjacencyOffsets[c.from]; k < adjacencyOffsets[c.from + 1]; k++) {
+                uint32_t t = adjacency[k];
+                touched[result[t * 3]] = 1;
+                touched[result[t * 3 + 1]] = 1;
+                touched[result[t * 3 + 2]] = 1;
+            }
+        }
+        if (collapses == 0) {
+            break;
+        }
+
+        // インデックスを張り替えて縮退三角形を除去
+        size_t writeIndex = 0;
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            uint32_t i0 = remap[result[i]], i1 = remap[result[i + 1]], i2 = remap[result[i + 2]];
+            if (i0 == i1 || i1 == i2 || i2 == i0) {
+                continue;
+            }
+            result[writeIndex++] = i0;
+            result[writeIndex++] = i1;
+            result[writeIndex++] = i2;
+        }
+        result.resize(writeIndex);
+    }
+    return result;
+}
+
+void generatePrimitiveLods(Primitive& primitive, const LodSettings& settings) {
+    primitive.lods.clear();
+    if (primitive.topology != vk::PrimitiveTopology::eTriangleList || primitive.indices.size() / 3 < settings.minTriangles || primitive.boundsRadius <= 0.0f) {
+        return;
+    }
+
+    std::vector<uint8_t> locked = computeLockedVertices(primitive, settings.lockSkinningBorders);
+    const float maxError = settings.maxError * primitive.boundsRadius;
+
+    const std::vector<uint32_t>* source = &primitive.indices;
+    float previousError = 0.0f;
+    for (uint32_t level = 1; level < settings.maxLodCount; level++) {
+        size_t targetTriangles = static_cast<size_t>(source->size() / 3 * settings.reductionRatio);
+        if (targetTriangles < settings.minTriangles) {
+            break;
+        }
+
+        float error = 0.0f;
+        std::vector<uint32_t> lodIndices = simplifyIndices(primitive.vertices, *source, locked, targetTriangles * 3, maxError, settings.attributeWeight, error);
+
+        // ほとんど削減できなければそれ以上のレベルは作らない
+        if (lodIndices.size() > source->size() * 9 / 10) {
+            break;
+        }
+
+        optimizeVertexCache(lodIndices, primitive.vertices.size());
+        previousError = std::max(previousError, error / primitive.boundsRadius);
+        primitive.lods.push_back({std::move(lodIndices), previousError});
+        source = &primitive.lods.back().indices;
+    }
+}
+
+void Model::generateLods(const LodSettings& settings) {
+    PROFILE_ZONE("generateLods");
+    if (!settings.enabled) {
+        return;
+    }
+
+    std::vector<Primitive*> primitives;
+    for (auto& mesh : meshes) {
+        for (auto& primitive : mesh.primitives) {
+            primitives.push_back(&primitive);
+        }
+    }
+
+    parallelFor(primitives.size(), [&](size_t i) {
+        generatePrimitiveLods(*primitives[i], settings);
+    });
+
+    uint64_t lodTriangles = 0;
+    uint64_t lodLevels = 0;
+    for (const Primitive* primitive : primitives) {
+        lodLevels += primitive->lods.size();
+        for (const auto& lod : primitive->lods) {
+            lodTriangles += lod.indices.size() / 3;
+        }
+    }
+    std::cout << "LOD生成: プリミティブ数 " << primitives.size()
+              << ", 生成したLOD数 " << lodLevels
+              << ", LODの三角形数合計 " << lodTriangles << std::endl;
+}
+
+uint32_t LodSelector::select(size_t instanceIndex, const Primitive& primitive, const glm::mat4& worldMatrix, const LodSelectionParams& params) {
+    uint32_t levelCount = lodCount(primitive);
+    uint32_t current = std::min<uint32_t>(currentLods[instanceIndex], levelCount - 1);
+
+    // ワールド空間のバウンディング球
+    glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(primitive.boundsCenter, 1.0f));
+    float scale = std::max({glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2]))});
+    float radius = primitive.boundsRadius * scale;
+    float distance = glm::distance(center, params.cameraPosition);
+
+    uint32_t selected = 0;
+    if (distance > radius) {
+        // 投影半径（ピクセル）とLOD誤差から、閾値を満たす最も粗いレベルを選ぶ
+        float projectedRadius = radius * params.projectionScale * params.viewportHeight * 0.5f / distance;
+        auto pixelError = [&](uint32_t level) { return lodError(primitive, level) * projectedRadius; };
+
+        uint32_t candidate = 0;
+        for (uint32_t level = 1; level < levelCount; level++) {
+            if (pixelError(level) <= params.pixelErrorThreshold) {
+                candidate = level;
+            }
+        }
+
+        // 切り替えは1フレームに1段まで（急に近づいたときのポップを数フレームに分ける）
+        selected = current;
+        if (candidate > current) {
+            // 粗くする方向は次の段の誤差が閾値より十分小さいときのみ
+            if (pixelError(current + 1) <= params.pixelErrorThreshold * (1.0f - params.hysteresis)) {
+                selected = current + 1;
+            }
+        } else if (candidate < current) {
+            // 細かくする方向は現在の誤差が閾値を十分超えたとき
+            if (pixelError(current) > params.pixelErrorThreshold * (1.0f + params.hysteresis)) {
+                selected = current - 1;
+            }
+        }
+    } else if (current > 0) {
+        // バウンディング球の内側では最も細かいレベルへ1段ずつ戻す
+        selected = current - 1;
+    }
+
+    currentLods[instanceIndex] = static_cast<uint8_t>(selected);
+    return selected;
+}
+
+LodCrowdStatistics measureCrowdTriangles(const Model& model, uint32_t gridSize, LodSelectionParams params, uint32_t warmupFrames, uint32_t frameCount) {
+    LodCrowdStatistics stats;
+
+    std::vector<const Primitive*> primitives;
+    uint32_t maxLevels = 1;
+    float modelRadius = 0.0f;
+    for (const auto& mesh : model.meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            primitives.push_back(&primitive);
+            maxLevels = std::max(maxLevels, lodCount(primitive));
+            modelRadius = std::max(modelRadius, glm::length(primitive.boundsCenter) + primitive.boundsRadius);
+        }
+    }
+    stats.instanceCount = static_cast<uint64_t>(gridSize) * gridSize;
+    stats.frameCount = frameCount;
+    stats.instancesPerLevel.assign(maxLevels, 0);
+    if (frameCount == 0) {
+        return stats;
+    }
+
+    // カメラはグリッドの手前から奥へ、計測の間に1列分だけ進む
+    float spacing = modelRadius * 3.0f;
+    glm::vec3 startPosition((gridSize - 1) * spacing * 0.5f, modelRadius, spacing);
+    float step = spacing / static_cast<float>(frameCount);
+
+    LodSelector selector;
+    selector.resize(static_cast<size_t>(gridSize) * gridSize * primitives.size());
+
+    // 選択器は1フレームに1段しか動かないため、最初のwarmupFrames回は計上しない
+    for (uint32_t frame = 0; frame < warmupFrames + frameCount; frame++) {
+        bool measured = frame >= warmupFrames;
+        float advance = measured ? static_cast<float>(frame - warmupFrames) * step : 0.0f;
+        params.cameraPosition = startPosition - glm::vec3(0.0f, 0.0f, advance);
+
+        size_t instanceIndex = 0;
+        for (uint32_t z = 0; z < gridSize; z++) {
+            for (uint32_t x = 0; x < gridSize; x++) {
+                glm::mat4 worldMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(x * spacing, 0.0f, -(z * spacing)));
+                for (const Primitive* primitive : primitives) {
+                    uint32_t level = selector.select(instanceIndex++, *primitive, worldMatrix, params);
+                    if (measured) {
+                        stats.trianglesWithoutLod += primitive->indices.size() / 3;
+                        stats.trianglesWithLod += lodIndices(*primitive, level).size() / 3;
+                        stats.instancesPerLevel[level]++;
+                    }
+                }
+            }
+        }
+    }
+
+    // 1フレームあたりの平均にする
+    stats.trianglesWithoutLod /= frameCount;
+    stats.trianglesWithLod /= frameCount;
+    for (uint64_t& count : stats.instancesPerLevel) {
+        count /= frameCount;
+    }
+    return stats;
+}
+
+}
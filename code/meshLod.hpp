@@ -0,0 +1,64 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace geometry {
+
+// エッジ縮約（QEM）による簡略化
+// 頂点は移動せず、インデックスのみを書き換える（LOD間で頂点バッファを共有するため）
+// locked[v] != 0 の頂点は縮約されない。resultErrorには適用した最大誤差（距離）が入る
+std::vector<uint32_t> simplifyIndices(const std::vector<StaticVertexAttributes>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint8_t>& locked, size_t targetIndexCount, float maxError, float attributeWeight, float& resultError);
+
+// UVシーム・開いた境界・スキニング境界の頂点を固定対象として求める
+std::vector<uint8_t> computeLockedVertices(const Primitive& primitive, bool lockSkinningBorders);
+
+// 1プリミティブ分のLODチェーンを生成
+void generatePrimitiveLods(Primitive& primitive, const LodSettings& settings);
+
+// LODレベルの参照（レベル0は元のインデックス）
+inline uint32_t lodCount(const Primitive& primitive) {
+    return static_cast<uint32_t>(primitive.lods.size()) + 1;
+}
+inline const std::vector<uint32_t>& lodIndices(const Primitive& primitive, uint32_t level) {
+    return level == 0 ? primitive.indices : primitive.lods[level - 1].indices;
+}
+inline float lodError(const Primitive& primitive, uint32_t level) {
+    return level == 0 ? 0.0f : primitive.lods[level - 1].error;
+}
+
+struct LodSelectionParams {
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float projectionScale = 1.0f;       // 1 / tan(fovY / 2)
+    float viewportHeight = 600.0f;
+    float pixelErrorThreshold = 1.0f;   // 許容する画面上の誤差（ピクセル）
+    float hysteresis = 0.25f;           // LOD切り替えのヒステリシス幅（閾値に対する比率）
+};
+
+// 投影されたバウンディング球の大きさからLODを選択する
+// インスタンスごとに直前のLODを保持し、閾値付近でのちらつきを防ぐ
+// 1回の選択で動くのは1段まで（目標のレベルへは数フレームかけて近づく）
+class LodSelector {
+    public:
+        void resize(size_t instanceCount) {
+            currentLods.assign(instanceCount, 0);
+        }
+
+        uint32_t select(size_t instanceIndex, const Primitive& primitive, const glm::mat4& worldMatrix, const LodSelectionParams& params);
+
+    private:
+        std::vector<uint8_t> currentLods;
+};
+
+// 群衆（同じモデルのグリッド配置）に対するLOD有効/無効時の描画三角形数（1フレームあたりの平均）
+// 間隔はモデルのバウンディング半径の3倍、カメラはグリッド手前の中央から奥へ1列分進む
+struct LodCrowdStatistics {
+    uint64_t instanceCount = 0;
+    uint64_t frameCount = 0;
+    uint64_t trianglesWithoutLod = 0;
+    uint64_t trianglesWithLod = 0;
+    std::vector<uint64_t> instancesPerLevel;
+};
+
+// 最初のwarmupFramesフレームは選択が落ち着くまでの分として計上しない
+LodCrowdStatistics measureCrowdTriangles(const Model& model, uint32_t gridSize, LodSelectionParams params, uint32_t warmupFrames, uint32_t frameCount);
+
+}
@@ -0,0 +1,408 @@
+#include "meshOptimizer.hpp"
+#include "profiler.hpp"
+
+namespace geometry {
+
+// 重複頂点の判定はmemcmpで行うため、パディングが無いことを保証する
+static_assert(sizeof(StaticVertexAttributes) == 96, "StaticVertexAttributesにパディングが含まれています");
+
+namespace {
+
+// Forsyth法のパラメータ（"Linear-Speed Vertex Cache Optimisation" の推奨値）
+constexpr uint32_t kForsythCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+float forsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;//もう使われない頂点
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            //直前の三角形で使われた頂点は一定スコア
+            score = kLastTriangleScore;
+        } else {
+            float scaler = 1.0f / (kForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+        }
+    }
+    //残り三角形が少ない頂点を優先して使い切る
+    score += kValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -kValenceBoostPower);
+    return score;
+}
+
+// FNV-1aで頂点のバイト列をハッシュ
+struct VertexBytesHash {
+    size_t operator()(const StaticVertexAttributes* vertex) const {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertex);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(StaticVertexAttributes); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct VertexBytesEqual {
+    bool operator()(const StaticVertexAttributes* a, const StaticVertexAttributes* b) const {
+        return std::memcmp(a, b, sizeof(StaticVertexAttributes)) == 0;
+    }
+};
+
+} // namespace
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStatistics stats;
+    stats.triangleCount = indices.size() / 3;
+
+    // タイムスタンプ差がキャッシュサイズ以内ならFIFOキャッシュにヒットしている
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t timestamp = cacheSize + 1;
+
+    for (uint32_t index : indices) {
+        if (timestamp - timestamps[index] > cacheSize) {
+            timestamps[index] = timestamp++;
+            stats.vertexTransforms++;
+        }
+        if (!referenced[index]) {
+            referenced[index] = true;
+            stats.vertexCount++;
+        }
+    }
+    return stats;
+}
+
+size_t deduplicateVertices(std::vector<StaticVertexAttributes>& vertices, std::vector<uint32_t>& indices) {
+    std::unordered_map<const StaticVertexAttributes*, uint32_t, VertexBytesHash, VertexBytesEqual> uniqueIndices;
+    uniqueIndices.reserve(vertices.size());
+
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<StaticVertexAttributes> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto [it, inserted] = uniqueIndices.try_emplace(&vertices[i], static_cast<uint32_t>(uniqueVertices.size()));
+        if (inserted) {
+            uniqueVertices.push_back(vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+
+    size_t removed = vertices.size() - uniqueVertices.size();
+    vertices.swap(uniqueVertices);
+    return removed;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // 頂点→隣接三角形のリスト（先頭remaining[v]個が未出力の三角形）
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacencyOffsets[index + 1]++;
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        uint32_t v = indices[i];
+        adjacency[adjacencyOffsets[v] + remaining[v]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    uint32_t bestTriangle = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[bestTriangle]) {
+            bestTriangle = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    std::array<uint32_t, kForsythCacheSize + 3> cache;
+    std::array<uint32_t, kForsythCacheSize + 3> newCache;
+    size_t cacheCount = 0;
+    size_t scanCursor = 0;
+
+    auto updateVertexScore = [&](uint32_t v, int32_t position) {
+        float newScore = forsythVertexScore(position, remaining[v]);
+        float delta = newScore - vertexScore[v];
+        vertexScore[v] = newScore;
+        for (uint32_t k = adjacencyOffsets[v]; k < adjacencyOffsets[v] + remaining[v]; k++) {
+            triangleScore[adjacency[k]] += delta;
+        }
+    };
+
+    while (bestTriangle != UINT32_MAX) {
+        const uint32_t triangle[3] = {
+            indices[bestTriangle * 3],
+            indices[bestTriangle * 3 + 1],
+            indices[bestTriangle * 3 + 2]
+        };
+        emitted[bestTriangle] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // 出力した三角形を各頂点の隣接リストから取り除く
+        size_t newCount = 0;
+        for (uint32_t v : triangle) {
+            uint32_t begin = adjacencyOffsets[v];
+            uint32_t end = begin + remaining[v];
+            auto it = std::find(adjacency.begin() + begin, adjacency.begin() + end, bestTriangle);
+            std::iter_swap(it, adjacency.begin() + end - 1);
+            remaining[v]--;
+
+            if (std::find(newCache.begin(), newCache.begin() + newCount, v) == newCache.begin() + newCount) {
+                newCache[newCount++] = v;
+            }
+        }
+
+        // LRUキャッシュの更新（三角形の頂点を先頭に置く）
+        for (size_t i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+        for (size_t i = kForsythCacheSize; i < newCount; i++) {
+            cachePosition[newCache[i]] = -1;
+            updateVertexScore(newCache[i], -1);
+        }
+        cacheCount = std::min<size_t>(newCount, kForsythCacheSize);
+        std::swap(cache, newCache);
+
+        for (size_t i = 0; i < cacheCount; i++) {
+            cachePosition[cache[i]] = static_cast<int32_t>(i);
+            updateVertexScore(cache[i], static_cast<int32_t>(i));
+        }
+
+        // 次の三角形はキャッシュ内頂点に隣接するものから選ぶ
+        bestTriangle = UINT32_MAX;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            for (uint32_t k = adjacencyOffsets[v]; k < adjacencyOffsets[v] + remaining[v]; k++) {
+                uint32_t t = adjacency[k];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        // 候補が無ければ未出力の三角形を先頭から探す
+        if (bestTriangle == UINT32_MAX) {
+            while (scanCursor < triangleCount && emitted[scanCursor]) {
+                scanCursor++;
+            }
+            if (scanCursor < triangleCount) {
+                bestTriangle = static_cast<uint32_t>(scanCursor);
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<StaticVertexAttributes>& vertices, uint32_t cacheSize, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // 3頂点とも全てキャッシュミスする三角形をクラスタの境界とする
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t timestamp = cacheSize + 1;
+    uint64_t baselineTransforms = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        uint32_t misses = 0;
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t index = indices[t * 3 + k];
+            if (timestamp - timestamps[index] > cacheSize) {
+                timestamps[index] = timestamp++;
+                misses++;
+            }
+        }
+        if (misses == 3 || t == 0) {
+            clusterStarts.push_back(static_cast<uint32_t>(t));
+        }
+        baselineTransforms += misses;
+    }
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+
+    // 三角形の面積加重でメッシュ全体の重心を求める
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const glm::vec3& p0 = vertices[indices[t * 3]].position;
+        const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea <= 0.0f) {
+        return;
+    }
+    meshCentroid /= meshArea;
+
+    // クラスタごとに外向き度合い（重心からの距離×法線）を求める
+    struct Cluster {
+        uint32_t begin;
+        uint32_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+    clusters.reserve(clusterStarts.size());
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        Cluster cluster{clusterStarts[c], c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : static_cast<uint32_t>(triangleCount), 0.0f};
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = cluster.begin; t < cluster.end; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(n);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f) {
+            centroid /= area;
+            normal /= normalLength;
+            cluster.sortKey = glm::dot(centroid - meshCentroid, normal);
+        }
+        clusters.push_back(cluster);
+    }
+
+    // 外向きのクラスタ（手前に来やすい面）を先に描画する
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        reordered.insert(reordered.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+
+    // キャッシュ効率が許容範囲を超えて悪化する場合は採用しない
+    VertexCacheStatistics reorderedStats = analyzeVertexCache(reordered, vertices.size(), cacheSize);
+    if (reorderedStats.vertexTransforms <= baselineTransforms * threshold) {
+        indices.swap(reordered);
+    }
+}
+
+void optimizeVertexFetch(std::vector<StaticVertexAttributes>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<StaticVertexAttributes> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+MeshOptimizeResult optimizePrimitive(Primitive& primitive, const MeshOptimizeSettings& settings) {
+    MeshOptimizeResult result;
+    result.before = analyzeVertexCache(primitive.indices, primitive.vertices.size(), settings.cacheSize);
+
+    // 三角形リスト以外は並べ替えの対象外
+    if (primitive.topology != vk::PrimitiveTopology::eTriangleList || primitive.indices.size() < 3) {
+        result.after = result.before;
+        return result;
+    }
+
+    // モーフターゲットは頂点番号で差分を指すため、頂点の統合・並べ替えはしない
+    bool keepVertexOrder = !primitive.morphTargets.empty();
+    if (settings.deduplicateVertices && !keepVertexOrder) {
+        result.removedVertices = deduplicateVertices(primitive.vertices, primitive.indices);
+    }
+    if (settings.optimizeVertexCache) {
+        optimizeVertexCache(primitive.indices, primitive.vertices.size());
+    }
+    if (settings.optimizeOverdraw) {
+        optimizeOverdraw(primitive.indices, primitive.vertices, settings.cacheSize, settings.overdrawThreshold);
+    }
+    if (settings.optimizeVertexFetch && !keepVertexOrder) {
+        optimizeVertexFetch(primitive.vertices, primitive.indices);
+    }
+
+    primitive.indexCount = static_cast<uint32_t>(primitive.indices.size());
+    result.after = analyzeVertexCache(primitive.indices, primitive.vertices.size(), settings.cacheSize);
+    return result;
+}
+
+void Model::optimizeMeshes(const MeshOptimizeSettings& settings) {
+    PROFILE_ZONE("optimizeMeshes");
+    if (!settings.enabled) {
+        return;
+    }
+
+    std::vector<Primitive*> primitives;
+    for (auto& mesh : meshes) {
+        for (auto& primitive : mesh.primitives) {
+            primitives.push_back(&primitive);
+        }
+    }
+    if (primitives.empty()) {
+        return;
+    }
+
+    // プリミティブ単位で並列に最適化
+    std::vector<MeshOptimizeResult> results(primitives.size());
+    parallelFor(primitives.size(), [&](size_t i) {
+        results[i] = optimizePrimitive(*primitives[i], settings);
+    });
+
+    // 最適化前後の統計を出力
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+    size_t removedVertices = 0;
+    for (const auto& result : results) {
+        before += result.before;
+        after += result.after;
+        removedVertices += result.removedVertices;
+    }
+    std::cout << "メッシュ最適化: プリミティブ数 " << primitives.size()
+              << ", 統合した頂点数 " << removedVertices << std::endl;
+    std::cout << "  ACMR: " << before.acmr() << " -> " << after.acmr()
+              << ", ATVR: " << before.atvr() << " -> " << after.atvr()
+              << ", 頂点シェーダ実行数: " << before.vertexTransforms << " -> " << after.vertexTransforms << std::endl;
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace geometry {
+
+// 頂点キャッシュの統計
+// ACMR: 三角形あたりの頂点シェーダ実行数（理想値 0.5 前後）
+// ATVR: 頂点あたりの頂点シェーダ実行数（理想値 1.0）
+struct VertexCacheStatistics {
+    uint64_t vertexTransforms = 0;
+    uint64_t triangleCount = 0;
+    uint64_t vertexCount = 0;
+
+    float acmr() const { return triangleCount ? static_cast<float>(vertexTransforms) / triangleCount : 0.0f; }
+    float atvr() const { return vertexCount ? static_cast<float>(vertexTransforms) / vertexCount : 0.0f; }
+
+    VertexCacheStatistics& operator+=(const VertexCacheStatistics& other) {
+        vertexTransforms += other.vertexTransforms;
+        triangleCount += other.triangleCount;
+        vertexCount += other.vertexCount;
+        return *this;
+    }
+};
+
+// 1プリミティブ分の最適化結果
+struct MeshOptimizeResult {
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+    size_t removedVertices = 0;
+};
+
+// FIFOキャッシュをシミュレートしてACMR/ATVRを計測
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+
+// ビット単位で同一の頂点を統合し、インデックスを張り替える。削除した頂点数を返す
+size_t deduplicateVertices(std::vector<StaticVertexAttributes>& vertices, std::vector<uint32_t>& indices);
+
+// Forsyth法による三角形の並べ替え（頂点キャッシュ局所性）
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// キャッシュ最適化済みの順序をクラスタに分割し、外向きのクラスタから描画されるよう並べ替え
+// ACMRの悪化が threshold 倍を超える場合は元の順序を維持する
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<StaticVertexAttributes>& vertices, uint32_t cacheSize, float threshold);
+
+// インデックスの初出順に頂点を並べ替え（フェッチ局所性）。未参照の頂点は削除される
+void optimizeVertexFetch(std::vector<StaticVertexAttributes>& vertices, std::vector<uint32_t>& indices);
+
+// 1プリミティブに対して設定に従い全ての最適化を適用
+MeshOptimizeResult optimizePrimitive(Primitive& primitive, const MeshOptimizeSettings& settings);
+
+}
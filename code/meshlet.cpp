@@ -0,0 +1,170 @@
+#include "meshlet.hpp"
+#include "profiler.hpp"
+
+namespace geometry {
+
+namespace {
+
+// Ritter法による近似最小包含球
+void computeBoundingSphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius) {
+    // 最も離れていそうな2点から初期球を作る
+    const glm::vec3& first = points[0];
+    size_t farthest = 0;
+    for (size_t i = 1; i < points.size(); i++) {
+        if (glm::distance(points[i], first) > glm::distance(points[farthest], first)) {
+            farthest = i;
+        }
+    }
+    size_t opposite = farthest;
+    for (size_t i = 0; i < points.size(); i++) {
+        if (glm::distance(points[i], points[farthest]) > glm::distance(points[opposite], points[farthest])) {
+            opposite = i;
+        }
+    }
+    center = (points[farthest] + points[opposite]) * 0.5f;
+    radius = glm::distance(points[farthest], points[opposite]) * 0.5f;
+
+    // はみ出した点を含むよう球を広げる
+    for (const glm::vec3& p : points) {
+        float d = glm::distance(p, center);
+        if (d > radius) {
+            float newRadius = (radius + d) * 0.5f;
+            center += (p - center) * ((newRadius - radius) / d);
+            radius = newRadius;
+        }
+    }
+}
+
+void computeMeshletBounds(const Primitive& primitive, Meshlet& meshlet) {
+    std::vector<glm::vec3> points(meshlet.vertexCount);
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        points[i] = primitive.vertices[primitive.meshletVertices[meshlet.vertexOffset + i]].position;
+    }
+    computeBoundingSphere(points, meshlet.center, meshlet.radius);
+
+    // 三角形法線の平均をコーン軸とする
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    glm::vec3 axis(0.0f);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const uint8_t* triangle = &primitive.meshletTriangles[(meshlet.triangleOffset + t) * 3];
+        const glm::vec3& p0 = points[triangle[0]];
+        const glm::vec3& p1 = points[triangle[1]];
+        const glm::vec3& p2 = points[triangle[2]];
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(n);
+        if (length <= 0.0f) {
+            continue;
+        }
+        normals.push_back(n / length);
+        corners.push_back(p0);
+        axis += normals.back();
+    }
+
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals) {
+        minDot = std::min(minDot, glm::dot(n, axis));
+    }
+    // 法線のばらつきが大きい場合はコーンカリングを無効にする
+    if (minDot <= 0.1f) {
+        return;
+    }
+
+    // 全ての三角形平面の裏側に入るようコーンの頂点を軸方向に下げる
+    float maxT = 0.0f;
+    for (size_t i = 0; i < normals.size(); i++) {
+        float t = glm::dot(meshlet.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+        maxT = std::max(maxT, t);
+    }
+
+    meshlet.coneApex = meshlet.center - axis * maxT;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+} // namespace
+
+void buildMeshlets(Primitive& primitive) {
+    primitive.meshlets.clear();
+    primitive.meshletVertices.clear();
+    primitive.meshletTriangles.clear();
+    if (primitive.topology != vk::PrimitiveTopology::eTriangleList || primitive.indices.size() < 3) {
+        return;
+    }
+
+    // 頂点キャッシュ最適化済みの順序をそのまま走査し、上限に達したら区切る
+    std::vector<int16_t> localIndex(primitive.vertices.size(), -1);
+    Meshlet current{};
+
+    auto finishMeshlet = [&]() {
+        if (current.triangleCount == 0) {
+            return;
+        }
+        for (uint32_t i = 0; i < current.vertexCount; i++) {
+            localIndex[primitive.meshletVertices[current.vertexOffset + i]] = -1;
+        }
+        computeMeshletBounds(primitive, current);
+        primitive.meshlets.push_back(current);
+
+        current = Meshlet{};
+        current.vertexOffset = static_cast<uint32_t>(primitive.meshletVertices.size());
+        current.triangleOffset = static_cast<uint32_t>(primitive.meshletTriangles.size() / 3);
+    };
+
+    for (size_t i = 0; i + 2 < primitive.indices.size(); i += 3) {
+        const uint32_t triangle[3] = {primitive.indices[i], primitive.indices[i + 1], primitive.indices[i + 2]};
+
+        uint32_t newVertices = 0;
+        for (int k = 0; k < 3; k++) {
+            bool duplicate = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+            if (localIndex[triangle[k]] < 0 && !duplicate) {
+                newVertices++;
+            }
+        }
+        if (current.vertexCount + newVertices > kMeshletMaxVertices || current.triangleCount + 1 > kMeshletMaxTriangles) {
+            finishMeshlet();
+        }
+
+        for (uint32_t v : triangle) {
+            if (localIndex[v] < 0) {
+                localIndex[v] = static_cast<int16_t>(current.vertexCount++);
+                primitive.meshletVertices.push_back(v);
+            }
+            primitive.meshletTriangles.push_back(static_cast<uint8_t>(localIndex[v]));
+        }
+        current.triangleCount++;
+    }
+    finishMeshlet();
+}
+
+void Model::buildMeshlets() {
+    PROFILE_ZONE("buildMeshlets");
+    std::vector<Primitive*> primitives;
+    for (auto& mesh : meshes) {
+        for (auto& primitive : mesh.primitives) {
+            primitives.push_back(&primitive);
+        }
+    }
+
+    parallelFor(primitives.size(), [&](size_t i) {
+        geometry::buildMeshlets(*primitives[i]);
+    });
+
+    size_t meshletCount = 0;
+    for (const Primitive* primitive : primitives) {
+        meshletCount += primitive->meshlets.size();
+    }
+    std::cout << "メッシュレット構築: " << meshletCount << " 個" << std::endl;
+}
+
+}
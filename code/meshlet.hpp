@@ -0,0 +1,18 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace geometry {
+
+// メッシュシェーダ向けの上限（NVIDIA推奨値）
+constexpr uint32_t kMeshletMaxVertices = 64;
+constexpr uint32_t kMeshletMaxTriangles = 124;
+
+// Primitiveをメッシュレットに分割し、バウンディング球と法線コーンを計算する
+void buildMeshlets(Primitive& primitive);
+
+// 法線コーンで背面カリングできるか（apexから見た方向とaxisの内積がcutoff以上なら全面が裏向き）
+inline bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition) {
+    return glm::dot(glm::normalize(meshlet.coneApex - cameraPosition), meshlet.coneAxis) >= meshlet.coneCutoff;
+}
+
+}
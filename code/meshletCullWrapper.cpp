@@ -0,0 +1,629 @@
+#include "vulkanContext.hpp"
+#include "geometry.hpp"
+
+namespace {
+
+// シェーダ側（shader/meshletCommon.glsl）と同じレイアウト
+struct GpuMeshlet {
+    glm::vec4 sphere;       // xyz: 中心, w: 半径
+    glm::vec4 coneApex;     // xyz: コーン頂点, w: cutoff
+    glm::vec4 coneAxis;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t resident;      // 0ならジオメトリが退避されているため描画しない
+    uint32_t meshletVertexOffset;
+    uint32_t meshletTriangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+struct CullParams {
+    glm::mat4 viewProj;
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition;
+    uint32_t workItemCount;
+    uint32_t cullingEnabled;
+    uint32_t compactDraws;
+    uint32_t occlusionEnabled;
+    glm::vec2 depthSize;
+    uint32_t pyramidLevelCount;
+    uint32_t pad0;
+};
+
+struct GpuCullStatistics {
+    uint32_t drawCount[2];//1回目・2回目の描画数
+    uint32_t visibleTriangles;
+    uint32_t visibleMeshlets;
+    uint32_t testedMeshlets;
+    uint32_t occludedMeshlets;
+    uint32_t pad0;
+    uint32_t pad1;
+};
+
+// 頂点プルの頂点シェーダへ渡すプッシュ定数（shader/meshletPull.vertと同じレイアウト）
+// カリングのフェーズ（オフセット0）とは別の範囲に置く
+struct VertexPullConstants {
+    vk::DeviceAddress vertexAddress;
+    geometry::VertexPullLayout layout;
+};
+constexpr uint32_t kVertexPullConstantOffset = 16;
+
+constexpr uint32_t kCullWorkgroupSize = 64;
+constexpr uint32_t kTaskWorkgroupSize = 32;
+
+const char* const kStatisticsModeNames[] = {"無効", "視錐台・背面", "視錐台・背面・遮蔽"};
+
+} // namespace
+
+//共有ジオメトリのメッシュレットをGPUへ転送し、カリング用のパイプラインを作成
+//頂点・インデックスはGeometryBufferWrapperのプールを参照する
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::initMeshletCull(const geometry::World& world) {
+    PROFILE_ZONE("initMeshletCull");
+    std::vector<GpuMeshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    std::vector<glm::uvec2> workItems;//x: メッシュレット, y: インスタンス
+    std::vector<glm::mat4> transforms;
+    std::vector<render::GpuInstance> instances;
+    std::vector<render::GpuMaterial> materials;
+    meshletLocalFirstIndex.clear();
+    totalTriangles = 0;
+
+    // 共有ジオメトリごとのメッシュレットの開始位置（同一内容のメッシュはメッシュレットも共有する）
+    const std::vector<geometry::GeometryRange>& geometries = world.getGeometries();
+    geometryMeshletBase.assign(geometries.size() + 1, 0);
+    for (size_t geometryIndex = 0; geometryIndex < geometries.size(); geometryIndex++) {
+        const geometry::Primitive& primitive = *geometries[geometryIndex].source;
+        const GeometryBufferWrapper::Placement& placement = deviceWrapper.geometryBufferWrapper.getPlacement(static_cast<uint32_t>(geometryIndex));
+        geometryMeshletBase[geometryIndex] = static_cast<uint32_t>(meshlets.size());
+
+        // 共有インデックスはメッシュレット順に並んでいる
+        uint32_t localFirstIndex = 0;
+        for (const auto& meshlet : primitive.meshlets) {
+            GpuMeshlet gpuMeshlet{};
+            gpuMeshlet.sphere = glm::vec4(meshlet.center, meshlet.radius);
+            gpuMeshlet.coneApex = glm::vec4(meshlet.coneApex, meshlet.coneCutoff);
+            gpuMeshlet.coneAxis = glm::vec4(meshlet.coneAxis, 0.0f);
+            gpuMeshlet.firstIndex = placement.firstIndex + localFirstIndex;
+            gpuMeshlet.indexCount = meshlet.triangleCount * 3;
+            gpuMeshlet.vertexOffset = static_cast<int32_t>(placement.vertexOffset);
+            gpuMeshlet.resident = placement.resident ? 1 : 0;
+            gpuMeshlet.meshletVertexOffset = static_cast<uint32_t>(meshletVertices.size());
+            gpuMeshlet.meshletTriangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+            gpuMeshlet.vertexCount = meshlet.vertexCount;
+            gpuMeshlet.triangleCount = meshlet.triangleCount;
+            meshlets.push_back(gpuMeshlet);
+            meshletLocalFirstIndex.push_back(localFirstIndex);
+            localFirstIndex += gpuMeshlet.indexCount;
+
+            meshletVertices.insert(meshletVertices.end(),
+                primitive.meshletVertices.begin() + meshlet.vertexOffset,
+                primitive.meshletVertices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+            for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+                const uint8_t* triangle = &primitive.meshletTriangles[(meshlet.triangleOffset + t) * 3];
+                meshletTriangles.push_back(triangle[0] | (triangle[1] << 8) | (triangle[2] << 16));
+            }
+        }
+    }
+    geometryMeshletBase[geometries.size()] = static_cast<uint32_t>(meshlets.size());
+
+    // メッシュを持つノードのプリミティブをインスタンスとして登録（番号は描画レコードと同じ）
+    // マテリアルはモデルごとに先頭をマテリアル無し（glTFの既定値）とし、続けてglTFの順に並べる
+    // 半透明のインスタンスはTransparencyWrapperが描くため、メッシュレットを登録しない
+    for (const geometry::Model* model : world.getModels()) {
+        uint32_t materialBase = static_cast<uint32_t>(materials.size());
+        materials.push_back({glm::vec4(1.0f), 1.0f, 1.0f, 0.0f, 0.0f});
+        for (const auto& material : model->materials) {
+            materials.push_back({material.baseColorFactor, material.metallicFactor, material.roughnessFactor, 0.0f, 0.0f});
+        }
+
+        for (const auto& node : model->nodes) {
+            auto it = model->gltfToMesh.find(node.meshIndex);
+            if (it == model->gltfToMesh.end()) {
+                continue;
+            }
+            uint32_t transformIndex = static_cast<uint32_t>(transforms.size());
+            transforms.push_back(node.globalMatrix);
+
+            for (const auto& primitive : model->meshes[it->second].primitives) {
+                uint32_t instanceIndex = static_cast<uint32_t>(instances.size());
+                auto material = model->gltfToMaterial.find(primitive.materialIndex);
+                instances.push_back({transformIndex, material == model->gltfToMaterial.end() ? materialBase : materialBase + 1 + material->second, 0, 0});
+                if (primitive.isTransparent) {
+                    continue;
+                }
+                for (size_t m = 0; m < primitive.meshlets.size(); m++) {
+                    workItems.push_back({geometryMeshletBase[primitive.geometryIndex] + static_cast<uint32_t>(m), instanceIndex});
+                    totalTriangles += primitive.meshlets[m].triangleCount;
+                }
+            }
+        }
+    }
+
+    workItemCount = static_cast<uint32_t>(workItems.size());
+    if (instances.empty()) {
+        return;
+    }
+    useMeshShader = deviceWrapper.context.capabilities.meshShader;
+
+    // 2回目のカリングはグラフィックスキューで行う
+    std::vector<vk::QueueFamilyProperties> queueProps = deviceWrapper.context.physicalDevice.getQueueFamilyProperties();
+    occlusionSupported = deviceWrapper.depthPyramidWrapper.isSupported()
+                      && (queueProps[deviceWrapper.graphicsQueueWrapper.queueFamilyIndex].queueFlags & vk::QueueFlagBits::eCompute);
+
+    // バッファの作成と転送
+    vk::MemoryPropertyFlags hostMemory = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    auto upload = [&](BufferResource& target, const void* data, size_t size, vk::BufferUsageFlags usage) {
+        target = deviceWrapper.createBuffer(std::max<size_t>(size, 16), usage, hostMemory);
+        if (data != nullptr) {
+            std::memcpy(target.mapped, data, size);
+        }
+    };
+    upload(meshletBuffer, meshlets.data(), meshlets.size() * sizeof(GpuMeshlet), vk::BufferUsageFlagBits::eStorageBuffer);
+    upload(meshletVertexBuffer, meshletVertices.data(), meshletVertices.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+    upload(meshletTriangleBuffer, meshletTriangles.data(), meshletTriangles.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+    upload(workItemBuffer, workItems.data(), workItems.size() * sizeof(glm::uvec2), vk::BufferUsageFlagBits::eStorageBuffer);
+    // 最初のフレームはすべて前フレームで可視だったものとして1回目に描画する
+    upload(visibilityBuffer, nullptr, workItems.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer);
+    std::fill_n(static_cast<uint32_t*>(visibilityBuffer.mapped), workItems.size(), 1u);
+    // フェーズごとにworkItemCount個の領域を持つ
+    upload(drawCommandBuffer, nullptr, 2 * workItems.size() * sizeof(vk::DrawIndexedIndirectCommand), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
+    upload(statisticsBuffer, nullptr, sizeof(GpuCullStatistics), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
+    upload(paramsBuffer, nullptr, sizeof(CullParams), vk::BufferUsageFlagBits::eUniformBuffer);
+
+    // シーンの表は常駐させ、以降は変更された要素だけを書き込む（最初のフレームで全体を書き込む）
+    scene.transforms.assign(std::move(transforms));
+    scene.instances.assign(std::move(instances));
+    scene.materials.assign(std::move(materials));
+    upload(transformBuffer, nullptr, scene.transforms.byteSize(), vk::BufferUsageFlagBits::eStorageBuffer);
+    upload(instanceBuffer, nullptr, scene.instances.byteSize(), vk::BufferUsageFlagBits::eStorageBuffer);
+    upload(materialBuffer, nullptr, scene.materials.byteSize(), vk::BufferUsageFlagBits::eStorageBuffer);
+
+    createDescriptors();
+    createPipelines();
+
+    cullSemaphore = deviceWrapper.device->createSemaphoreUnique(vk::SemaphoreCreateInfo{});
+
+    ready = true;
+    std::cout << "メッシュレットカリング: " << meshlets.size() << " メッシュレット, "
+              << workItemCount << " インスタンスメッシュレット, "
+              << scene.instances.size() << " インスタンス, "
+              << (useMeshShader ? "メッシュシェーダ" : "コンピュートシェーダ + 間接描画")
+              << (occlusionSupported ? " + 階層Zによる遮蔽カリング" : "") << std::endl;
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::updateGeometryPlacement(uint32_t geometryIndex, const GeometryBufferWrapper::Placement& placement) {
+    if (!ready) {
+        return;
+    }
+    GpuMeshlet* gpuMeshlets = static_cast<GpuMeshlet*>(meshletBuffer.mapped);
+    for (uint32_t m = geometryMeshletBase[geometryIndex]; m < geometryMeshletBase[geometryIndex + 1]; m++) {
+        gpuMeshlets[m].firstIndex = placement.firstIndex + meshletLocalFirstIndex[m];
+        gpuMeshlets[m].vertexOffset = static_cast<int32_t>(placement.vertexOffset);
+        gpuMeshlets[m].resident = placement.resident ? 1 : 0;
+    }
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::setTransform(uint32_t transformIndex, const glm::mat4& matrix) {
+    if (ready) {
+        scene.transforms.set(transformIndex, matrix);
+    }
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::createDescriptors() {
+    vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    if (useMeshShader) {
+        stages |= vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT;
+    }
+
+    // binding 0: パラメータ, 1-9, 11-12: ストレージバッファ（3, 11, 12は常駐するシーンの表）, 10: 階層Z
+    // 13: シャドウマップ, 14: 影のパラメータ（ShadowMapWrapperが持つ）
+    // 15: クラスタのパラメータ, 16-18: ライトとクラスタごとの割り当て（LightClusterWrapperが持つ）
+    ShadowMapWrapper& shadowMap = deviceWrapper.shadowMapWrapper;
+    LightClusterWrapper& lightClusters = deviceWrapper.lightClusterWrapper;
+    std::vector<std::pair<uint32_t, BufferResource*>> uniformBuffers = {
+        {0, &paramsBuffer}, {14, &shadowMap.getParamsBuffer()}, {15, &lightClusters.getParamsBuffer()}
+    };
+    std::vector<std::pair<uint32_t, BufferResource*>> storageBuffers = {
+        {1, &meshletBuffer}, {2, &workItemBuffer}, {3, &transformBuffer}, {4, &drawCommandBuffer}, {5, &statisticsBuffer},
+        {6, &deviceWrapper.geometryBufferWrapper.getVertexBuffer()}, {7, &meshletVertexBuffer}, {8, &meshletTriangleBuffer},
+        {9, &visibilityBuffer}, {11, &instanceBuffer}, {12, &materialBuffer},
+        {16, &lightClusters.getLightBuffer()}, {17, &lightClusters.getGridBuffer()}, {18, &lightClusters.getIndexBuffer()}
+    };
+
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    for (const auto& [binding, buffer] : uniformBuffers) {
+        bindings.push_back(vk::DescriptorSetLayoutBinding(binding, vk::DescriptorType::eUniformBuffer, 1, stages));
+    }
+    for (const auto& [binding, buffer] : storageBuffers) {
+        bindings.push_back(vk::DescriptorSetLayoutBinding(binding, vk::DescriptorType::eStorageBuffer, 1, stages));
+    }
+    bindings.push_back(vk::DescriptorSetLayoutBinding(10, vk::DescriptorType::eCombinedImageSampler, 1, stages));
+    bindings.push_back(vk::DescriptorSetLayoutBinding(13, vk::DescriptorType::eCombinedImageSampler, 1, stages));
+    descriptorSetLayout = deviceWrapper.device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, static_cast<uint32_t>(uniformBuffers.size())),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(storageBuffers.size())),
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2)
+    };
+    descriptorPool = deviceWrapper.device->createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, 1, poolSizes));
+    descriptorSet = deviceWrapper.device->allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), 1, &descriptorSetLayout.get())).front();
+
+    std::vector<uint32_t> bufferBindings;
+    std::vector<vk::DescriptorBufferInfo> bufferInfos;
+    for (const auto& [binding, buffer] : uniformBuffers) {
+        bufferBindings.push_back(binding);
+        bufferInfos.push_back(vk::DescriptorBufferInfo(buffer->buffer.get(), 0, VK_WHOLE_SIZE));
+    }
+    for (const auto& [binding, buffer] : storageBuffers) {
+        bufferBindings.push_back(binding);
+        bufferInfos.push_back(vk::DescriptorBufferInfo(buffer->buffer.get(), 0, VK_WHOLE_SIZE));
+    }
+    std::vector<vk::WriteDescriptorSet> writes;
+    for (uint32_t i = 0; i < bufferInfos.size(); i++) {
+        writes.push_back(vk::WriteDescriptorSet(
+            descriptorSet,//dstSet
+            bufferBindings[i],//dstBinding
+            0,//dstArrayElement
+            1,//descriptorCount
+            i < uniformBuffers.size() ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer,//descriptorType
+            nullptr,//pImageInfo
+            &bufferInfos[i]//pBufferInfo
+        ));
+    }
+    vk::DescriptorImageInfo shadowInfo(shadowMap.getSampler(), shadowMap.getShadowView(), vk::ImageLayout::eShaderReadOnlyOptimal);
+    writes.push_back(vk::WriteDescriptorSet(descriptorSet, 13, 0, 1, vk::DescriptorType::eCombinedImageSampler, &shadowInfo, nullptr));
+    deviceWrapper.device->updateDescriptorSets(writes, {});
+    updatePyramidDescriptor();
+
+    // set 1: フレームごとのカメラ（オブジェクトの範囲は使わない）
+    // プッシュ定数: カリングのフェーズ（カリングを行うステージのみ）と、頂点プルのレイアウト（頂点シェーダ）
+    std::vector<vk::DescriptorSetLayout> setLayouts = {descriptorSetLayout.get(), deviceWrapper.frameRingWrapper.getDescriptorSetLayout()};
+    std::vector<vk::PushConstantRange> pushConstantRanges = {
+        vk::PushConstantRange(useMeshShader ? vk::ShaderStageFlagBits::eTaskEXT : vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t))
+    };
+    if (!useMeshShader) {
+        pushConstantRanges.push_back(vk::PushConstantRange(vk::ShaderStageFlagBits::eVertex, kVertexPullConstantOffset, sizeof(VertexPullConstants)));
+    }
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+        {},//flags
+        static_cast<uint32_t>(setLayouts.size()),//setLayoutCount
+        setLayouts.data(),//pSetLayouts
+        static_cast<uint32_t>(pushConstantRanges.size()),//pushConstantRangeCount
+        pushConstantRanges.data()//pPushConstantRanges
+    );
+    pipelineLayout = deviceWrapper.device->createPipelineLayoutUnique(pipelineLayoutInfo);
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::updatePyramidDescriptor() {
+    if (!descriptorSet) {
+        return;
+    }
+    DepthPyramidWrapper& depthPyramid = deviceWrapper.depthPyramidWrapper;
+    vk::DescriptorImageInfo pyramidInfo(depthPyramid.getSampler(), depthPyramid.getPyramidView(), vk::ImageLayout::eGeneral);
+    vk::WriteDescriptorSet write(descriptorSet, 10, 0, 1, vk::DescriptorType::eCombinedImageSampler, &pyramidInfo, nullptr);
+    deviceWrapper.device->updateDescriptorSets(write, {});
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::createPipelines() {
+    PipelineWrapper& pipelineWrapper = deviceWrapper.pipelineWrapper;
+
+    // コンピュートカリング（メッシュシェーダ非対応時のみ使用）
+    if (!useMeshShader) {
+        vk::UniqueShaderModule cullShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshletCull.comp.spv");
+        vk::ComputePipelineCreateInfo computeCreateInfo(
+            {},//flags
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, cullShaderModule.get(), "main"),//stage
+            pipelineLayout.get()//layout
+        );
+        cullPipeline = deviceWrapper.device->createComputePipelineUnique(VK_NULL_HANDLE, computeCreateInfo).value;
+    }
+
+    // 描画パイプライン
+    vk::UniqueShaderModule fragmentShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshlet.frag.spv");
+    vk::PipelineShaderStageCreateInfo fragmentStage({}, vk::ShaderStageFlagBits::eFragment, fragmentShaderModule.get(), "main");
+    if (useMeshShader) {
+        vk::UniqueShaderModule taskShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshlet.task.spv");
+        vk::UniqueShaderModule meshShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshlet.mesh.spv");
+        drawPipeline = createDrawPipeline({
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eTaskEXT, taskShaderModule.get(), "main"),
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eMeshEXT, meshShaderModule.get(), "main"),
+            fragmentStage
+        }, nullptr, true);
+        return;
+    }
+
+    vk::VertexInputBindingDescription bindingDescription = geometry::StaticVertexAttributes::getBindingDescription();
+    auto attributeDescriptions = geometry::StaticVertexAttributes::getAttributeDescriptions();
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo(
+        {},//flags
+        1,//vertexBindingDescriptionCount
+        &bindingDescription,//pVertexBindingDescriptions
+        2,//vertexAttributeDescriptionCount（位置と法線のみ使用）
+        attributeDescriptions.data()//pVertexAttributeDescriptions
+    );
+    vk::UniqueShaderModule vertexShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshlet.vert.spv");
+    drawPipeline = createDrawPipeline({
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShaderModule.get(), "main"),
+        fragmentStage
+    }, &vertexInputInfo, true);
+
+    // 頂点プル: 頂点入力を持たず、頂点の形式はプッシュ定数で渡すため1つのパイプラインですべてのレイアウトを描ける
+    if (deviceWrapper.context.capabilities.bufferDeviceAddress && deviceWrapper.geometryBufferWrapper.getVertexBuffer().address != 0) {
+        vk::PipelineVertexInputStateCreateInfo emptyVertexInput{};
+        vk::UniqueShaderModule pullShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshletPull.vert.spv");
+        pullDrawPipeline = createDrawPipeline({
+            vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, pullShaderModule.get(), "main"),
+            fragmentStage
+        }, &emptyVertexInput, true);
+    }
+
+    // 深度のみ: 位置だけを読む。プールの頂点（間隔96バイト）を読むものと、位置ストリームだけを読むもの
+    GeometryBufferWrapper& geometryBuffer = deviceWrapper.geometryBufferWrapper;
+    vk::UniqueShaderModule depthShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/meshletDepth.vert.spv");
+    std::vector<vk::PipelineShaderStageCreateInfo> depthStages = {
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, depthShaderModule.get(), "main")
+    };
+    vk::VertexInputAttributeDescription interleavedPosition(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(geometry::StaticVertexAttributes, position));
+    vk::PipelineVertexInputStateCreateInfo interleavedInput({}, 1, &bindingDescription, 1, &interleavedPosition);
+    depthInterleavedPipeline = createDrawPipeline(depthStages, &interleavedInput, false);
+
+    vk::VertexInputBindingDescription positionBinding(0, static_cast<uint32_t>(geometryBuffer.getPositionStride()), vk::VertexInputRate::eVertex);
+    vk::VertexInputAttributeDescription splitPosition(0, 0, geometryBuffer.getPositionFormat(), 0);
+    vk::PipelineVertexInputStateCreateInfo splitInput({}, 1, &positionBinding, 1, &splitPosition);
+    depthSplitPipeline = createDrawPipeline(depthStages, &splitInput, false);
+}
+
+//メッシュシェーダではvertexInputにnullptrを渡す
+//writeColorがfalseなら色を書かない（色のアタッチメントの形式は描画と揃える）
+vk::UniquePipeline VulkanContext::DeviceWrapper::MeshletCullWrapper::createDrawPipeline(const std::vector<vk::PipelineShaderStageCreateInfo>& shaderStages, const vk::PipelineVertexInputStateCreateInfo* vertexInput, bool writeColor) {
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+    vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);
+    vk::PipelineRasterizationStateCreateInfo rasterizer(
+        {},//flags
+        VK_FALSE,//depthClampEnable
+        VK_FALSE,//rasterizerDiscardEnable
+        vk::PolygonMode::eFill,//polygonMode
+        vk::CullModeFlagBits::eBack,//cullMode
+        vk::FrontFace::eCounterClockwise,//frontFace
+        VK_FALSE,//depthBiasEnable
+        0.0f,//depthBiasConstantFactor
+        0.0f,//depthBiasClamp
+        0.0f,//depthBiasSlopeFactor
+        1.0f//lineWidth
+    );
+    vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1);
+    vk::PipelineDepthStencilStateCreateInfo depthStencil(
+        {},//flags
+        VK_TRUE,//depthTestEnable
+        VK_TRUE,//depthWriteEnable
+        vk::CompareOp::eLess,//depthCompareOp
+        VK_FALSE,//depthBoundsTestEnable
+        VK_FALSE//stencilTestEnable
+    );
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+    if (writeColor) {
+        colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+    }
+    vk::PipelineColorBlendStateCreateInfo colorBlending({}, VK_FALSE, vk::LogicOp::eCopy, 1, &colorBlendAttachment);
+
+    std::vector<vk::DynamicState> dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor
+    };
+    vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates);
+
+    std::vector<vk::Format> colorAttachmentFormats = {deviceWrapper.swapchainWrapper.getFormat()};
+    vk::PipelineRenderingCreateInfo renderingCreateInfo(
+        0,//viewMask
+        colorAttachmentFormats.size(),//colorAttachmentCount
+        colorAttachmentFormats.data(),//pColorAttachmentFormats
+        DepthPyramidWrapper::kDepthFormat,//depthAttachmentFormat
+        vk::Format::eUndefined//stencilAttachmentFormat
+    );
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo(
+        {},//flags
+        shaderStages.size(),//stageCount
+        shaderStages.data(),//pStages
+        vertexInput,//pVertexInputState
+        vertexInput != nullptr ? &inputAssembly : nullptr,//pInputAssemblyState
+        nullptr,//pTessellationState
+        &viewportState,//pViewportState
+        &rasterizer,//pRasterizationState
+        &multisampling,//pMultisampleState
+        &depthStencil,//pDepthStencilState
+        &colorBlending,//pColorBlendState
+        &dynamicState,//pDynamicState
+        pipelineLayout.get()//layout
+    );
+    pipelineCreateInfo.setPNext(&renderingCreateInfo);
+    return deviceWrapper.device->createGraphicsPipelineUnique(VK_NULL_HANDLE, pipelineCreateInfo).value;
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::updateParams() {
+    CullParams params{};
+    params.viewProj = deviceWrapper.context.projectionMatrix * deviceWrapper.context.viewMatrix;
+    geometry::Frustum frustum = geometry::Frustum::fromMatrix(params.viewProj);
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), params.frustumPlanes);
+    params.cameraPosition = glm::vec4(deviceWrapper.context.cameraPosition, 1.0f);
+    params.workItemCount = workItemCount;
+    params.cullingEnabled = cullingEnabled ? 1 : 0;
+    params.compactDraws = deviceWrapper.context.capabilities.drawIndirectCount ? 1 : 0;
+    occlusionActive = cullingEnabled && occlusionEnabled && occlusionSupported;
+    params.occlusionEnabled = occlusionActive ? 1 : 0;
+    vk::Extent2D depthExtent = deviceWrapper.depthPyramidWrapper.getRenderExtent();
+    params.depthSize = glm::vec2(depthExtent.width, depthExtent.height);
+    params.pyramidLevelCount = deviceWrapper.depthPyramidWrapper.getLevelCount();
+    std::memcpy(paramsBuffer.mapped, &params, sizeof(CullParams));
+
+    // シーンの表は変更された範囲だけを書き込む（前フレームは完了済みのため直接書き換えてよい）
+    {
+        PROFILE_ZONE("gpuScene.flush");
+        uploadStatistics = scene.flush(transformBuffer.mapped, instanceBuffer.mapped, materialBuffer.mapped);
+    }
+
+    // 前フレームは完了済みなのでホストから統計をリセットする
+    std::memset(statisticsBuffer.mapped, 0, sizeof(GpuCullStatistics));
+    cullZone = UINT32_MAX;
+    drawZones = {UINT32_MAX, UINT32_MAX};
+}
+
+bool VulkanContext::DeviceWrapper::MeshletCullWrapper::dispatchCull(CommandBufWrapper& commandBufWrapper, QueueWrapper& queueWrapper) {
+    updateParams();
+    if (useMeshShader) {
+        return false;//タスクシェーダでカリングする
+    }
+
+    PROFILE_ZONE("meshletCull.dispatch");
+    vk::CommandBuffer commandBuffer = commandBufWrapper.getCommandBuffer();
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    cullZone = deviceWrapper.gpuProfilerWrapper.beginZone(commandBuffer, "compute queue", "meshletCull");
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline.get());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 0, descriptorSet, {});
+    std::array<uint32_t, 2> dynamicOffsets = {deviceWrapper.frameRingWrapper.getCameraOffset(), 0};
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 1, deviceWrapper.frameRingWrapper.getDescriptorSet(), dynamicOffsets);
+    uint32_t phase = 0;
+    commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t), &phase);
+    commandBuffer.dispatch((workItemCount + kCullWorkgroupSize - 1) / kCullWorkgroupSize, 1, 1);
+    deviceWrapper.gpuProfilerWrapper.endZone(commandBuffer, cullZone);
+    commandBuffer.end();
+
+    QueueWrapper::Submission submission(deviceWrapper.context.frameArena.getThreadResource());
+    submission.commandBuffers.push_back(commandBufWrapper.getCommandBufferSubmitInfo());
+    submission.signalSemaphores.push_back(vk::SemaphoreSubmitInfo(cullSemaphore.get(), 0, vk::PipelineStageFlagBits2::eAllCommands));
+    queueWrapper.enqueue(std::move(submission));
+    return true;
+}
+
+//2回目の描画引数を書き出す（メッシュシェーダではタスクシェーダが判定するため、1回目の可視情報の読み取りを待つだけ）
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::recordLateCull(vk::CommandBuffer commandBuffer) {
+    if (useMeshShader) {
+        vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTaskShaderEXT, vk::PipelineStageFlagBits::eTaskShaderEXT, {}, barrier, {}, {});
+        return;
+    }
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline.get());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 0, descriptorSet, {});
+    std::array<uint32_t, 2> dynamicOffsets = {deviceWrapper.frameRingWrapper.getCameraOffset(), 0};
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 1, deviceWrapper.frameRingWrapper.getDescriptorSet(), dynamicOffsets);
+    uint32_t phase = 1;
+    commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t), &phase);
+    commandBuffer.dispatch((workItemCount + kCullWorkgroupSize - 1) / kCullWorkgroupSize, 1, 1);
+
+    vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {}, barrier, {}, {});
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::recordDraw(vk::CommandBuffer commandBuffer, uint32_t phase) {
+    vk::Extent2D renderExtent = deviceWrapper.dynamicResolutionWrapper.getRenderExtent();
+    uint32_t width = renderExtent.width;
+    uint32_t height = renderExtent.height;
+
+    bool depthOnly = depthOnlyLayout != DepthOnlyLayout::Off && depthSplitPipeline;
+    bool pullVertices = !depthOnly && vertexPullingEnabled && pullDrawPipeline;
+    vk::Pipeline pipeline = drawPipeline.get();
+    if (depthOnly) {
+        pipeline = depthOnlyLayout == DepthOnlyLayout::Split ? depthSplitPipeline.get() : depthInterleavedPipeline.get();
+    } else if (pullVertices) {
+        pipeline = pullDrawPipeline.get();
+    }
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, descriptorSet, {});
+    std::array<uint32_t, 2> dynamicOffsets = {deviceWrapper.frameRingWrapper.getCameraOffset(), 0};
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 1, deviceWrapper.frameRingWrapper.getDescriptorSet(), dynamicOffsets);
+    commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f));
+    commandBuffer.setScissor(0, vk::Rect2D({0, 0}, {width, height}));
+
+    if (useMeshShader) {
+        commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eTaskEXT, 0, sizeof(uint32_t), &phase);
+        commandBuffer.drawMeshTasksEXT((workItemCount + kTaskWorkgroupSize - 1) / kTaskWorkgroupSize, 1, 1, deviceWrapper.dispatchLoader);
+    } else {
+        if (pullVertices) {
+            // プールの頂点はすべて同じレイアウト
+            VertexPullConstants constants{deviceWrapper.geometryBufferWrapper.getVertexBuffer().address, geometry::StaticVertexAttributes::getPullLayout()};
+            commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eVertex, kVertexPullConstantOffset, sizeof(VertexPullConstants), &constants);
+            deviceWrapper.geometryBufferWrapper.bindIndices(commandBuffer);
+        } else if (depthOnly && depthOnlyLayout == DepthOnlyLayout::Split) {
+            deviceWrapper.geometryBufferWrapper.bindPositions(commandBuffer);
+        } else {
+            deviceWrapper.geometryBufferWrapper.bind(commandBuffer);
+        }
+        vk::DeviceSize commandOffset = phase * workItemCount * sizeof(vk::DrawIndexedIndirectCommand);
+        if (deviceWrapper.context.capabilities.drawIndirectCount) {
+            // 可視メッシュレットのみ詰めて書き出されている
+            vk::DeviceSize countOffset = offsetof(GpuCullStatistics, drawCount) + phase * sizeof(uint32_t);
+            commandBuffer.drawIndexedIndirectCount(drawCommandBuffer.buffer.get(), commandOffset, statisticsBuffer.buffer.get(), countOffset, workItemCount, sizeof(vk::DrawIndexedIndirectCommand));
+        } else if (deviceWrapper.context.capabilities.multiDrawIndirect) {
+            // 不可視のメッシュレットはinstanceCount=0で書き出されている
+            commandBuffer.drawIndexedIndirect(drawCommandBuffer.buffer.get(), commandOffset, workItemCount, sizeof(vk::DrawIndexedIndirectCommand));
+        } else {
+            // drawCount > 1 が使えないため、コマンドを1つずつ描く
+            for (uint32_t i = 0; i < workItemCount; i++) {
+                commandBuffer.drawIndexedIndirect(drawCommandBuffer.buffer.get(), commandOffset + i * sizeof(vk::DrawIndexedIndirectCommand), 1, sizeof(vk::DrawIndexedIndirectCommand));
+            }
+        }
+    }
+}
+
+//フレーム完了後、GpuProfilerWrapper::collect()の後に呼ぶ（waitForFrameでフェンスの待機が済んでいる前提）
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::collectStatistics() {
+    const GpuCullStatistics* gpuStatistics = static_cast<const GpuCullStatistics*>(statisticsBuffer.mapped);
+    CullStatistics& current = statistics[getStatisticsMode()];
+    current.frames++;
+    current.visibleTriangles += gpuStatistics->visibleTriangles;
+    current.testedMeshlets += gpuStatistics->testedMeshlets;
+    current.occludedMeshlets += gpuStatistics->occludedMeshlets;
+
+    // GPU時間はプロファイラのゾーンから読む（タイムスタンプの有効ビットでマスク済み）
+    const GpuProfilerWrapper& profiler = deviceWrapper.gpuProfilerWrapper;
+    double milliseconds = 0.0;
+    if (profiler.getZoneMilliseconds(cullZone, milliseconds)) {
+        current.cullMilliseconds += milliseconds;
+    }
+    for (uint32_t zone : drawZones) {
+        if (profiler.getZoneMilliseconds(zone, milliseconds)) {
+            current.drawMilliseconds += milliseconds;
+        }
+    }
+
+    // 一定フレームごとに平均を出力
+    if (++frameCounter % 120 != 0 || !deviceWrapper.context.statisticsOutput) {
+        return;
+    }
+    for (int mode = 2; mode >= 0; mode--) {
+        const CullStatistics& s = statistics[mode];
+        if (s.frames == 0) {
+            continue;
+        }
+        double visible = static_cast<double>(s.visibleTriangles) / s.frames;
+        std::cout << "メッシュレットカリング[" << kStatisticsModeNames[mode] << "]: "
+                  << "可視三角形 " << static_cast<uint64_t>(visible) << " / " << totalTriangles
+                  << " (カリング " << (totalTriangles ? 100.0 * (1.0 - visible / totalTriangles) : 0.0) << "%), "
+                  << "カリング " << s.cullMilliseconds / s.frames << " ms, "
+                  << "描画 " << s.drawMilliseconds / s.frames << " ms";
+        if (mode == 2) {
+            std::cout << ", 遮蔽 " << 100.0 * s.occludedRatio() << "%";
+        }
+        std::cout << std::endl;
+    }
+    // 直前のモードとの差（カリング無効 → 視錐台・背面 → 遮蔽）
+    for (int mode = 1; mode <= 2; mode++) {
+        const CullStatistics& before = statistics[mode - 1];
+        const CullStatistics& after = statistics[mode];
+        if (before.frames > 0 && after.frames > 0) {
+            double saved = (before.drawMilliseconds + before.cullMilliseconds) / before.frames
+                         - (after.drawMilliseconds + after.cullMilliseconds) / after.frames;
+            std::cout << "  GPU時間の削減[" << kStatisticsModeNames[mode] << "]: " << saved << " ms/フレーム" << std::endl;
+        }
+    }
+}
+
+void VulkanContext::DeviceWrapper::MeshletCullWrapper::resetStatistics() {
+    for (CullStatistics& s : statistics) {
+        s = CullStatistics{};
+    }
+}
@@ -0,0 +1,101 @@
+#include "morphTarget.hpp"
+#include "profiler.hpp"
+#include "jobSystem.hpp"
+
+namespace geometry {
+
+namespace {
+
+constexpr size_t kVerticesPerJob = 4096;
+
+// floatの連続した並びとして扱う（密な足し込みをコンパイラのベクトル化に任せるため）
+static_assert(sizeof(DynamicVertexAttributes) == sizeof(glm::vec3));
+static_assert(sizeof(glm::vec3) == sizeof(float) * 3);
+
+float weightOf(const std::vector<float>& weights, size_t target) {
+    return target < weights.size() ? weights[target] : 0.0f;
+}
+
+void copyBasePositions(const Primitive& primitive, std::vector<DynamicVertexAttributes>& positions, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        positions[i].position = primitive.vertices[i].position;
+    }
+}
+
+} // namespace
+
+MorphTarget makeSparseMorphTarget(const std::vector<glm::vec3>& deltas) {
+    MorphTarget target;
+    for (uint32_t i = 0; i < deltas.size(); i++) {
+        if (deltas[i] != glm::vec3(0.0f)) {
+            target.vertices.push_back(i);
+            target.positionDeltas.push_back(deltas[i]);
+        }
+    }
+    return target;
+}
+
+MorphBlendStatistics blendMorphTargets(const Primitive& primitive, const std::vector<float>& weights, std::vector<DynamicVertexAttributes>& positions) {
+    PROFILE_ZONE("morph.blend");
+    MorphBlendStatistics stats;
+    positions.resize(primitive.vertices.size());
+
+    struct ActiveTarget {
+        const MorphTarget* target;
+        float weight;
+    };
+    std::vector<ActiveTarget> active;
+    for (size_t i = 0; i < primitive.morphTargets.size(); i++) {
+        float weight = weightOf(weights, i);
+        if (weight != 0.0f && !primitive.morphTargets[i].vertices.empty()) {
+            active.push_back({&primitive.morphTargets[i], weight});
+            stats.appliedDeltas += primitive.morphTargets[i].vertices.size();
+        }
+    }
+    stats.activeTargets = static_cast<uint32_t>(active.size());
+
+    render::JobSystem::instance().parallelFor(positions.size(), kVerticesPerJob, [&](size_t begin, size_t end) {
+        copyBasePositions(primitive, positions, begin, end);
+        for (const ActiveTarget& entry : active) {
+            const std::vector<uint32_t>& vertices = entry.target->vertices;
+            size_t k = std::lower_bound(vertices.begin(), vertices.end(), static_cast<uint32_t>(begin)) - vertices.begin();
+            for (; k < vertices.size() && vertices[k] < end; k++) {
+                positions[vertices[k]].position += entry.weight * entry.target->positionDeltas[k];
+            }
+        }
+    });
+    return stats;
+}
+
+std::vector<glm::vec3> expandMorphTargets(const Primitive& primitive) {
+    size_t vertexCount = primitive.vertices.size();
+    std::vector<glm::vec3> denseDeltas(primitive.morphTargets.size() * vertexCount, glm::vec3(0.0f));
+    for (size_t t = 0; t < primitive.morphTargets.size(); t++) {
+        const MorphTarget& target = primitive.morphTargets[t];
+        for (size_t k = 0; k < target.vertices.size(); k++) {
+            denseDeltas[t * vertexCount + target.vertices[k]] = target.positionDeltas[k];
+        }
+    }
+    return denseDeltas;
+}
+
+void blendMorphTargetsDense(const Primitive& primitive, const std::vector<glm::vec3>& denseDeltas, const std::vector<float>& weights, std::vector<DynamicVertexAttributes>& positions) {
+    PROFILE_ZONE("morph.blendDense");
+    size_t vertexCount = primitive.vertices.size();
+    positions.resize(vertexCount);
+
+    render::JobSystem::instance().parallelFor(vertexCount, kVerticesPerJob, [&](size_t begin, size_t end) {
+        copyBasePositions(primitive, positions, begin, end);
+        float* out = &positions[begin].position.x;
+        size_t floatCount = (end - begin) * 3;
+        for (size_t t = 0; t < primitive.morphTargets.size(); t++) {
+            float weight = weightOf(weights, t);
+            const float* delta = &denseDeltas[t * vertexCount + begin].x;
+            for (size_t k = 0; k < floatCount; k++) {
+                out[k] += weight * delta[k];
+            }
+        }
+    });
+}
+
+}
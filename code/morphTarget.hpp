@@ -0,0 +1,24 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace geometry {
+
+// 全頂点分の差分から、動く頂点だけを残した疎な差分を作る
+MorphTarget makeSparseMorphTarget(const std::vector<glm::vec3>& deltas);
+
+struct MorphBlendStatistics {
+    uint32_t activeTargets = 0;//重みが0でないターゲット数
+    uint64_t appliedDeltas = 0;//足した差分の数
+};
+
+// 基本位置に重みが0でないターゲットの差分を足してpositions（動的な位置ストリーム）に書き込む
+// 頂点の範囲ごとにジョブで並列化する（差分は頂点番号の昇順のため、範囲の先頭を二分探索で求める）
+// weightsがターゲット数より短い場合、足りない分は0とみなす
+MorphBlendStatistics blendMorphTargets(const Primitive& primitive, const std::vector<float>& weights, std::vector<DynamicVertexAttributes>& positions);
+
+// 比較用の密な表現：ターゲットごとに全頂点分の差分をターゲット順に連結する
+std::vector<glm::vec3> expandMorphTargets(const Primitive& primitive);
+// 比較用：重みに関係なく全ターゲットの全頂点分を足す
+void blendMorphTargetsDense(const Primitive& primitive, const std::vector<glm::vec3>& denseDeltas, const std::vector<float>& weights, std::vector<DynamicVertexAttributes>& positions);
+
+}
@@ -0,0 +1,272 @@
+#include "profiler.hpp"
+
+namespace render {
+
+namespace profiler {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+struct ZoneEvent {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+constexpr size_t kChunkEvents = 4096;
+constexpr size_t kMaxChunks = 256;//1スレッドあたり約100万ゾーンまで
+
+struct Chunk {
+    std::array<ZoneEvent, kChunkEvents> events;
+};
+
+// 書き込むのは所有スレッドのみ。countをreleaseで進めて書き出し側へ公開する
+struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::string name;//Registry::mutexで保護
+    std::array<std::atomic<Chunk*>, kMaxChunks> chunks{};
+    std::atomic<size_t> count{0};
+    std::atomic<uint64_t> dropped{0};
+
+    ~ThreadBuffer() {
+        for (auto& chunk : chunks) {
+            delete chunk.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+struct GpuZoneEvent {
+    uint32_t track;
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// バッファは終了したスレッドから回収して再利用する（毎フレーム作られるワーカースレッドでも増え続けない）
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<ThreadBuffer*> freeBuffers;
+    std::vector<std::string> gpuTracks;
+    std::vector<GpuZoneEvent> gpuEvents;
+};
+
+// スレッド終了時のデストラクタから参照するため破棄しない
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct ThreadSlot {
+    ThreadBuffer* buffer = nullptr;
+
+    ~ThreadSlot() {
+        if (buffer != nullptr) {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            buffer->name.clear();
+            reg.freeBuffers.push_back(buffer);
+        }
+    }
+};
+
+thread_local ThreadSlot threadSlot;
+
+ThreadBuffer& acquireBuffer() {
+    if (threadSlot.buffer != nullptr) {
+        return *threadSlot.buffer;
+    }
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if (!reg.freeBuffers.empty()) {
+        threadSlot.buffer = reg.freeBuffers.back();
+        reg.freeBuffers.pop_back();
+    } else {
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+        reg.buffers.back()->threadId = static_cast<uint32_t>(reg.buffers.size());
+        threadSlot.buffer = reg.buffers.back().get();
+    }
+    return *threadSlot.buffer;
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped += ' ';
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// ナノ秒をトレースの時刻（マイクロ秒）として書く
+void writeMicroseconds(std::ostream& out, uint64_t nanoseconds) {
+    out << nanoseconds / 1000 << "." << std::setw(3) << std::setfill('0') << nanoseconds % 1000 << std::setfill(' ');
+}
+
+constexpr uint32_t kCpuProcessId = 1;
+constexpr uint32_t kGpuProcessId = 2;
+
+} // namespace
+
+void setEnabled(bool enabled) {
+#ifdef VKRENDERKIT_PROFILE
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+#else
+    (void)enabled;
+#endif
+}
+
+void setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = acquireBuffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.name = name;
+}
+
+void recordZone(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds) {
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = acquireBuffer();
+    size_t index = buffer.count.load(std::memory_order_relaxed);
+    size_t chunkIndex = index / kChunkEvents;
+    if (chunkIndex >= kMaxChunks) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Chunk* chunk = buffer.chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new Chunk;
+        buffer.chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+    chunk->events[index % kChunkEvents] = {name, beginNanoseconds, endNanoseconds};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+// GPUのゾーンはフレームごとに数件のため、ロックを取ってまとめて保持する
+void recordGpuZone(const char* track, const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds) {
+    if (!isEnabled()) {
+        return;
+    }
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = std::find(reg.gpuTracks.begin(), reg.gpuTracks.end(), track);
+    if (it == reg.gpuTracks.end()) {
+        it = reg.gpuTracks.insert(it, track);
+    }
+    reg.gpuEvents.push_back({static_cast<uint32_t>(it - reg.gpuTracks.begin()), name, beginNanoseconds, endNanoseconds});
+}
+
+void clear() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto& buffer : reg.buffers) {
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+    reg.gpuEvents.clear();
+}
+
+size_t getZoneCount() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t count = reg.gpuEvents.size();
+    for (auto& buffer : reg.buffers) {
+        count += std::min(buffer->count.load(std::memory_order_acquire), kChunkEvents * kMaxChunks);
+    }
+    return count;
+}
+
+uint64_t getDroppedZoneCount() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    uint64_t dropped = 0;
+    for (auto& buffer : reg.buffers) {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void writeChromeTrace(std::ostream& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // 公開済みの件数だけを読む（記録中のスレッドがあっても読み出しは安全）
+    std::vector<size_t> counts;
+    uint64_t origin = UINT64_MAX;
+    for (auto& buffer : reg.buffers) {
+        counts.push_back(buffer->count.load(std::memory_order_acquire));
+        for (size_t i = 0; i < counts.back(); i++) {
+            const ZoneEvent& event = buffer->chunks[i / kChunkEvents].load(std::memory_order_acquire)->events[i % kChunkEvents];
+            origin = std::min(origin, event.begin);
+        }
+    }
+    for (const GpuZoneEvent& event : reg.gpuEvents) {
+        origin = std::min(origin, event.begin);
+    }
+    if (origin == UINT64_MAX) {
+        origin = 0;
+    }
+
+    bool first = true;
+    auto separator = [&]() -> std::ostream& {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    separator() << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << kCpuProcessId << ",\"args\":{\"name\":\"CPU\"}}";
+    separator() << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << kGpuProcessId << ",\"args\":{\"name\":\"GPU\"}}";
+
+    for (size_t b = 0; b < reg.buffers.size(); b++) {
+        const ThreadBuffer& buffer = *reg.buffers[b];
+        if (counts[b] == 0) {
+            continue;
+        }
+        std::string name = buffer.name.empty() ? "thread " + std::to_string(buffer.threadId) : buffer.name;
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << kCpuProcessId << ",\"tid\":" << buffer.threadId
+                    << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+        for (size_t i = 0; i < counts[b]; i++) {
+            const ZoneEvent& event = buffer.chunks[i / kChunkEvents].load(std::memory_order_acquire)->events[i % kChunkEvents];
+            separator() << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":" << kCpuProcessId << ",\"tid\":" << buffer.threadId << ",\"ts\":";
+            writeMicroseconds(out, event.begin - origin);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.end - event.begin);
+            out << "}";
+        }
+    }
+
+    for (size_t track = 0; track < reg.gpuTracks.size(); track++) {
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << kGpuProcessId << ",\"tid\":" << track + 1
+                    << ",\"args\":{\"name\":\"" << escapeJson(reg.gpuTracks[track]) << "\"}}";
+    }
+    for (const GpuZoneEvent& event : reg.gpuEvents) {
+        separator() << "{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":" << kGpuProcessId << ",\"tid\":" << event.track + 1 << ",\"ts\":";
+        writeMicroseconds(out, event.begin - origin);
+        out << ",\"dur\":";
+        writeMicroseconds(out, event.end > event.begin ? event.end - event.begin : 0);
+        out << "}";
+    }
+    out << "\n]}\n";
+}
+
+void writeChromeTrace(const std::filesystem::path& path) {
+    std::ofstream file(path);
+    writeChromeTrace(file);
+    if (!file) {
+        throw std::runtime_error("トレースの書き込みに失敗しました: " + path.string());
+    }
+}
+
+}
+
+}
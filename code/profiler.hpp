@@ -0,0 +1,76 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 読み込み・初期化・フレームの各段階のタイムライン計測
+// ゾーンは終了時に呼び出したスレッド専用のバッファへ1件書き込むだけで、ロックは取らない
+// 記録はsetEnabled(true)まで行わず、無効時のコストはフラグの読み込み1回のみ
+// VKRENDERKIT_PROFILEを定義せずにビルドした場合はPROFILE_ZONEが空になる
+// 書き出しはChrome trace-event形式のJSON（Perfetto・chrome://tracingで開ける）
+namespace profiler {
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+// steady_clockのナノ秒（LinuxではCLOCK_MONOTONIC、WindowsではQueryPerformanceCounterと同じ時間軸）
+inline uint64_t now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// VKRENDERKIT_PROFILEを定義せずにビルドした場合は常に無効のまま
+void setEnabled(bool enabled);
+inline bool isEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// 呼び出したスレッドのトレース上の表示名
+void setThreadName(const std::string& name);
+
+// nameは文字列リテラルなど、書き出しまで有効なものを渡す
+void recordZone(const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+
+// GPUのゾーン（trackごとに別の行として表示する。時刻はnow()と同じ時間軸に変換済みのもの）
+void recordGpuZone(const char* track, const char* name, uint64_t beginNanoseconds, uint64_t endNanoseconds);
+
+// 記録済みのゾーンを破棄する（他のスレッドがゾーンを記録していない間に呼ぶ）
+void clear();
+
+size_t getZoneCount();
+// スレッドごとの上限を超えて捨てたゾーンの数
+uint64_t getDroppedZoneCount();
+
+void writeChromeTrace(std::ostream& out);
+void writeChromeTrace(const std::filesystem::path& path);
+
+// スコープの開始から終了までを1つのゾーンとして記録する
+class Zone {
+    public:
+        explicit Zone(const char* zoneName) : name(zoneName), begin(isEnabled() ? now() : 0) {}
+        ~Zone() {
+            if (begin != 0) {
+                recordZone(name, begin, now());
+            }
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* name;
+        uint64_t begin;
+};
+
+}
+
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef VKRENDERKIT_PROFILE
+#define PROFILE_ZONE(name) ::render::profiler::Zone PROFILE_CONCAT(profileZone, __COUNTER__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
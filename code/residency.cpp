@@ -0,0 +1,272 @@
+#include "residency.hpp"
+#include "profiler.hpp"
+#include "jobSystem.hpp"
+
+namespace render {
+
+const char* assetKindName(AssetKind kind) {
+    switch (kind) {
+        case AssetKind::Mesh:
+            return "メッシュ";
+        case AssetKind::TextureMip:
+            return "テクスチャミップ";
+        case AssetKind::Material:
+            return "マテリアル";
+        default:
+            return "不明";
+    }
+}
+
+void RangeAllocator::reset(uint64_t capacityBytes) {
+    freeRanges.clear();
+    capacity = capacityBytes;
+    usedBytes = 0;
+    if (capacity > 0) {
+        freeRanges.emplace(0, capacity);
+    }
+}
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment) {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        uint64_t rangeBegin = it->first;
+        uint64_t rangeEnd = it->first + it->second;
+        uint64_t offset = (rangeBegin + alignment - 1) / alignment * alignment;
+        if (offset + size > rangeEnd) {
+            continue;
+        }
+
+        // 前後の余りを空きとして残す
+        freeRanges.erase(it);
+        if (offset > rangeBegin) {
+            freeRanges.emplace(rangeBegin, offset - rangeBegin);
+        }
+        if (offset + size < rangeEnd) {
+            freeRanges.emplace(offset + size, rangeEnd - offset - size);
+        }
+        usedBytes += size;
+        return offset;
+    }
+    return kInvalidOffset;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size) {
+    usedBytes -= size;
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+    if (next != freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        freeRanges.erase(next);
+    }
+    freeRanges.emplace(offset, size);
+}
+
+uint64_t RangeAllocator::getLargestFreeRange() const {
+    uint64_t largest = 0;
+    for (const auto& [offset, size] : freeRanges) {
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
+
+namespace {
+
+// 読み込み中のジョブ。カウンタが0になればジョブは触られないので破棄してよい
+struct LoadJob {
+    Job job;
+    JobCounter counter;
+};
+
+} // namespace
+
+struct ResidencyManager::StreamLoads {
+    std::mutex mutex;
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> completed;
+    std::deque<std::unique_ptr<LoadJob>> jobs;
+    LoadFunction load;
+
+    // 終わったジョブを破棄する（投入したスレッドからのみ呼ぶ）
+    void reap() {
+        std::erase_if(jobs, [](const std::unique_ptr<LoadJob>& loadJob) { return loadJob->counter.isDone(); });
+    }
+
+    // 依頼済みの読み込みがすべて終わるまで待つ
+    void waitIdle() {
+        for (std::unique_ptr<LoadJob>& loadJob : jobs) {
+            JobSystem::instance().wait(loadJob->counter);
+        }
+        jobs.clear();
+    }
+
+    ~StreamLoads() {
+        waitIdle();
+    }
+};
+
+ResidencyManager::ResidencyManager() : loads(std::make_unique<StreamLoads>()) {}
+ResidencyManager::~ResidencyManager() = default;
+ResidencyManager::ResidencyManager(ResidencyManager&&) noexcept = default;
+ResidencyManager& ResidencyManager::operator=(ResidencyManager&&) noexcept = default;
+
+void ResidencyManager::clear() {
+    loads->waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(loads->mutex);
+        loads->completed.clear();
+    }
+    assets.clear();
+    residentBytes = 0;
+    residentBytesByKind.fill(0);
+    pendingLoads = 0;
+}
+
+void ResidencyManager::setLoader(LoadFunction loadFunction) {
+    std::lock_guard<std::mutex> lock(loads->mutex);
+    loads->load = std::move(loadFunction);
+}
+
+uint32_t ResidencyManager::addAsset(AssetKind kind, uint64_t bytes, bool resident) {
+    assets.push_back({kind, State::NonResident, bytes, 0});
+    uint32_t asset = static_cast<uint32_t>(assets.size() - 1);
+    if (resident) {
+        setState(asset, State::Resident);
+    }
+    return asset;
+}
+
+void ResidencyManager::beginFrame(uint64_t frameNumber, double elapsedSeconds) {
+    currentFrame = frameNumber;
+    statistics.seconds += elapsedSeconds;
+}
+
+bool ResidencyManager::request(uint32_t asset) {
+    Asset& entry = assets[asset];
+    if (entry.lastUsedFrame != currentFrame) {
+        entry.lastUsedFrame = currentFrame;
+        statistics.requests++;
+        statistics.hits += entry.state == State::Resident ? 1 : 0;
+    }
+    if (entry.state != State::NonResident) {
+        return entry.state == State::Resident;
+    }
+
+    setState(asset, State::Loading);
+    pendingLoads++;
+
+    LoadFunction loadFunction;
+    {
+        std::lock_guard<std::mutex> lock(loads->mutex);
+        loadFunction = loads->load;
+    }
+    StreamLoads* target = loads.get();
+    loads->reap();
+    LoadJob& loadJob = *loads->jobs.emplace_back(std::make_unique<LoadJob>());
+    loadJob.job.function = [target, asset, loadFunction = std::move(loadFunction)]() {
+        std::vector<uint8_t> data;
+        {
+            PROFILE_ZONE("residency.load");
+            loadFunction(asset, data);
+        }
+        std::lock_guard<std::mutex> lock(target->mutex);
+        target->completed.emplace_back(asset, std::move(data));
+    };
+
+    // ワーカーが居なければ誰も取り出さないので、その場で読み込む
+    if (JobSystem::instance().getThreadCount() == 1) {
+        loadJob.job.function();
+        loads->jobs.pop_back();
+    } else {
+        JobSystem::instance().run(loadJob.job, loadJob.counter);
+    }
+    return false;
+}
+
+void ResidencyManager::update(const MakeResidentFunction& makeResident, const EvictFunction& evict) {
+    PROFILE_ZONE("residency.update");
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> loaded;
+    {
+        std::lock_guard<std::mutex> lock(loads->mutex);
+        loaded.swap(loads->completed);
+    }
+    loads->reap();
+
+    // 予算が下がった場合はその分を先に退避する
+    evictFor(0, evict);
+
+    for (auto& [asset, data] : loaded) {
+        pendingLoads--;
+        if (assets[asset].state != State::Loading) {
+            continue;
+        }
+
+        // 予算内でも断片化で置けない場合は、さらに古いものを退避してやり直す
+        bool resident = evictFor(assets[asset].bytes, evict) && makeResident(asset, data);
+        while (!resident && evictOldest(evict)) {
+            resident = evictFor(assets[asset].bytes, evict) && makeResident(asset, data);
+        }
+
+        if (resident) {
+            setState(asset, State::Resident);
+            statistics.streamIns++;
+        } else {
+            // 次に要求されたときに読み込み直す
+            setState(asset, State::NonResident);
+            statistics.deferredLoads++;
+        }
+    }
+    statistics.peakResidentBytes = std::max(statistics.peakResidentBytes, residentBytes);
+}
+
+void ResidencyManager::resetStatistics() {
+    statistics = ResidencyStatistics{};
+    statistics.peakResidentBytes = residentBytes;
+}
+
+void ResidencyManager::setState(uint32_t asset, State state) {
+    Asset& entry = assets[asset];
+    if (entry.state == State::Resident) {
+        residentBytes -= entry.bytes;
+        residentBytesByKind[static_cast<size_t>(entry.kind)] -= entry.bytes;
+    }
+    entry.state = state;
+    if (entry.state == State::Resident) {
+        residentBytes += entry.bytes;
+        residentBytesByKind[static_cast<size_t>(entry.kind)] += entry.bytes;
+    }
+}
+
+bool ResidencyManager::evictFor(uint64_t bytes, const EvictFunction& evict) {
+    while (residentBytes + bytes > budgetBytes) {
+        if (!evictOldest(evict)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ResidencyManager::evictOldest(const EvictFunction& evict) {
+    uint32_t candidate = UINT32_MAX;
+    uint64_t oldestFrame = currentFrame;
+    for (uint32_t i = 0; i < assets.size(); i++) {
+        if (assets[i].state == State::Resident && assets[i].lastUsedFrame < oldestFrame) {
+            oldestFrame = assets[i].lastUsedFrame;
+            candidate = i;
+        }
+    }
+    if (candidate == UINT32_MAX) {
+        return false;
+    }
+    evict(candidate);
+    statistics.evictions++;
+    statistics.evictedBytes += assets[candidate].bytes;
+    setState(candidate, State::NonResident);
+    return true;
+}
+
+}
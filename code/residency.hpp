@@ -0,0 +1,136 @@
+#pragma once
+#include "header.hpp"
+
+namespace render {
+
+// 常駐管理の対象の種類
+enum class AssetKind {
+    Mesh,
+    TextureMip,
+    Material,
+    Count
+};
+
+const char* assetKindName(AssetKind kind);
+
+// 1つのバッファ内の範囲を割り当てる（先頭から最初に収まる空きを使い、解放時に隣接する空きと結合する）
+class RangeAllocator {
+    public:
+        static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+        void reset(uint64_t capacityBytes);
+
+        // 収まる空きが無ければkInvalidOffsetを返す
+        uint64_t allocate(uint64_t size, uint64_t alignment);
+        void free(uint64_t offset, uint64_t size);
+
+        uint64_t getCapacity() const { return capacity; }
+        uint64_t getUsedBytes() const { return usedBytes; }
+        uint64_t getLargestFreeRange() const;
+
+    private:
+        std::map<uint64_t, uint64_t> freeRanges;//オフセット → サイズ
+        uint64_t capacity = 0;
+        uint64_t usedBytes = 0;
+};
+
+struct ResidencyStatistics {
+    uint64_t requests = 0;//描画のために常駐を要求した回数
+    uint64_t hits = 0;//要求時に常駐していた回数
+    uint64_t streamIns = 0;
+    uint64_t evictions = 0;
+    uint64_t evictedBytes = 0;
+    uint64_t deferredLoads = 0;//読み込みが終わったが空きが作れず捨てた回数
+    uint64_t peakResidentBytes = 0;
+    double seconds = 0.0;
+
+    double hitRate() const {
+        return requests == 0 ? 1.0 : static_cast<double>(hits) / requests;
+    }
+    double evictionsPerSecond() const {
+        return seconds > 0.0 ? evictions / seconds : 0.0;
+    }
+};
+
+// GPUに置くアセットの常駐管理
+// 予算を超えたら最後に使われたフレームが古いものから退避し、退避したものは再び要求されたときに
+// ジョブシステムで読み込んでからメインスレッドで転送する（要求したフレームには間に合わない）
+// 読み込み・転送・退避の実際の処理は呼び出し側が関数として渡す
+class ResidencyManager {
+    public:
+        // ジョブシステムのスレッドで呼ばれ（複数の読み込みが並行しうる）、アセットの内容をdataへ書き込む
+        using LoadFunction = std::function<void(uint32_t asset, std::vector<uint8_t>& data)>;
+        // メインスレッドで呼ばれる。空きが無く転送できなかった場合はfalseを返す
+        using MakeResidentFunction = std::function<bool(uint32_t asset, const std::vector<uint8_t>& data)>;
+        using EvictFunction = std::function<void(uint32_t asset)>;
+
+        ResidencyManager();
+        ~ResidencyManager();
+
+        ResidencyManager(const ResidencyManager&) = delete;
+        ResidencyManager& operator=(const ResidencyManager&) = delete;
+        ResidencyManager(ResidencyManager&&) noexcept;
+        ResidencyManager& operator=(ResidencyManager&&) noexcept;
+
+        // 読み込み中のものを待ってから全アセットの登録を消す
+        void clear();
+        void setLoader(LoadFunction loadFunction);
+
+        // residentは登録時点で既に転送済みかどうか
+        uint32_t addAsset(AssetKind kind, uint64_t bytes, bool resident);
+
+        void setBudget(uint64_t bytes) { budgetBytes = bytes; }
+        uint64_t getBudget() const { return budgetBytes; }
+
+        // フレームの最初に呼ぶ（elapsedSecondsは前のフレームからの経過時間）
+        void beginFrame(uint64_t frameNumber, double elapsedSeconds);
+
+        // このフレームで使うことを記録し、常駐していればtrueを返す
+        // 常駐していなければ読み込みを依頼する
+        bool request(uint32_t asset);
+
+        // 読み込みが終わったものを転送し、予算を超えた分を退避する（GPUがアセットを参照していない間に呼ぶ）
+        // このフレームで要求されたものは退避しない
+        void update(const MakeResidentFunction& makeResident, const EvictFunction& evict);
+
+        bool isResident(uint32_t asset) const { return assets[asset].state == State::Resident; }
+        uint64_t getResidentBytes() const { return residentBytes; }
+        uint64_t getResidentBytes(AssetKind kind) const { return residentBytesByKind[static_cast<size_t>(kind)]; }
+        size_t getAssetCount() const { return assets.size(); }
+        uint32_t getPendingLoadCount() const { return pendingLoads; }
+
+        const ResidencyStatistics& getStatistics() const { return statistics; }
+        void resetStatistics();
+
+    private:
+        enum class State : uint8_t {
+            NonResident,
+            Loading,
+            Resident
+        };
+        struct Asset {
+            AssetKind kind;
+            State state;
+            uint64_t bytes;
+            uint64_t lastUsedFrame;
+        };
+        std::vector<Asset> assets;
+        uint64_t residentBytes = 0;
+        std::array<uint64_t, static_cast<size_t>(AssetKind::Count)> residentBytesByKind{};
+        uint64_t budgetBytes = UINT64_MAX;
+        uint64_t currentFrame = 0;
+        uint32_t pendingLoads = 0;
+        ResidencyStatistics statistics;
+
+        // 実行中の読み込みジョブと完了のキュー
+        struct StreamLoads;
+        std::unique_ptr<StreamLoads> loads;
+
+        void setState(uint32_t asset, State state);
+        // bytes分の空きを作るために退避する。予算内に収まればtrue
+        bool evictFor(uint64_t bytes, const EvictFunction& evict);
+        // このフレームで使っていない常駐アセットのうち最も古いものを1つ退避する。候補が無ければfalse
+        bool evictOldest(const EvictFunction& evict);
+};
+
+}
@@ -0,0 +1,508 @@
+#include "sceneBvh.hpp"
+#include "profiler.hpp"
+#include "jobSystem.hpp"
+
+namespace geometry {
+
+namespace {
+
+constexpr uint32_t kBinCount = 16;
+constexpr uint32_t kMaxLeafSize = 4;
+constexpr uint32_t kForceSplitSize = 16;//これより多い場合はSAHに関わらず分割する
+constexpr uint32_t kParallelThreshold = 8192;//これより大きい部分木は別のジョブで構築する
+// SAHの分割が偏り続けても深さを抑えるため、この深さからは重心の中央値で半分に分ける
+// 半分ずつ分ければ32段でuint32_tの個数を葉まで分けきれるため、深さはkMaxDepthを超えない
+constexpr uint32_t kMedianSplitDepth = 32;
+constexpr uint32_t kMaxDepth = kMedianSplitDepth + 32;
+// 走査のスタックには経路上の各段で後回しにした子が1つずつ積まれる
+constexpr uint32_t kTraversalStackSize = kMaxDepth + 2;
+constexpr float kTraversalCost = 1.0f;
+
+enum class FrustumTest {
+    Outside,
+    Intersect,
+    Inside
+};
+
+FrustumTest classify(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    FrustumTest result = FrustumTest::Inside;
+    for (const glm::vec4& plane : frustum.planes) {
+        glm::vec3 normal(plane);
+        glm::vec3 positive(plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y, plane.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(normal, positive) + plane.w < 0.0f) {
+            return FrustumTest::Outside;
+        }
+        glm::vec3 negative(plane.x >= 0.0f ? boxMin.x : boxMax.x, plane.y >= 0.0f ? boxMin.y : boxMax.y, plane.z >= 0.0f ? boxMin.z : boxMax.z);
+        if (glm::dot(normal, negative) + plane.w < 0.0f) {
+            result = FrustumTest::Intersect;
+        }
+    }
+    return result;
+}
+
+Aabb nodeBounds(const BvhNode& node) {
+    return {node.boundsMin, node.boundsMax};
+}
+
+// 構築用のインスタンス情報。分割時にこの配列自体を並べ替え、ノードの範囲を連続したメモリで走査する
+struct BuildPrimitive {
+    Aabb bounds;
+    glm::vec3 centroid;
+    uint32_t instance;
+};
+
+// 構築中の共有データ
+struct BuildContext {
+    std::vector<BvhNode>& nodes;
+    std::vector<uint32_t>& parents;
+    std::vector<BuildPrimitive> primitives;
+    std::atomic<uint32_t> nodeCount{1};
+};
+
+void computeBounds(BuildContext& ctx, BvhNode& node, uint32_t first, uint32_t count) {
+    Aabb box;
+    for (uint32_t i = first; i < first + count; i++) {
+        box.grow(ctx.primitives[i].bounds);
+    }
+    node.boundsMin = box.min;
+    node.boundsMax = box.max;
+}
+
+// 重心の広がりが最大の軸で中央値を境に半分に分ける。左の個数を返す
+uint32_t partitionMedian(BuildContext& ctx, uint32_t first, uint32_t count) {
+    BuildPrimitive* begin = ctx.primitives.data() + first;
+    BuildPrimitive* end = begin + count;
+    Aabb centroidBounds;
+    for (const BuildPrimitive* primitive = begin; primitive != end; primitive++) {
+        centroidBounds.grow(primitive->centroid);
+    }
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    BuildPrimitive* middle = begin + count / 2;
+    std::nth_element(begin, middle, end, [axis](const BuildPrimitive& a, const BuildPrimitive& b) {
+        return a.centroid[axis] < b.centroid[axis];
+    });
+    return count / 2;
+}
+
+// ビン分割SAHで分け、左の個数をleftCountに入れる。葉のままにする方が安ければfalseを返す
+bool partitionSah(BuildContext& ctx, const BvhNode& node, uint32_t first, uint32_t count, uint32_t& leftCount) {
+    const BuildPrimitive* primitives = ctx.primitives.data() + first;
+    Aabb centroidBounds;
+    for (uint32_t i = 0; i < count; i++) {
+        centroidBounds.grow(primitives[i].centroid);
+    }
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; axis++) {
+        scale[axis] = extent[axis] > 0.0f ? kBinCount / extent[axis] : 0.0f;
+    }
+    auto binOf = [&](const glm::vec3& centroid, int axis) {
+        return std::min(kBinCount - 1, static_cast<uint32_t>((centroid[axis] - centroidBounds.min[axis]) * scale[axis]));
+    };
+
+    // 1回の走査で3軸ぶんのビンに振り分ける
+    std::array<std::array<Aabb, kBinCount>, 3> binBounds;
+    std::array<std::array<uint32_t, kBinCount>, 3> binCounts{};
+    for (uint32_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            uint32_t bin = binOf(primitives[i].centroid, axis);
+            binCounts[axis][bin]++;
+            binBounds[axis][bin].grow(primitives[i].bounds);
+        }
+    }
+
+    // 左右から累積して各分割面のSAHコストを求め、最小のものを選ぶ
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (extent[axis] <= 0.0f) {
+            continue;
+        }
+        std::array<float, kBinCount - 1> leftArea, rightArea;
+        std::array<uint32_t, kBinCount - 1> leftCount, rightCount;
+        Aabb leftBox, rightBox;
+        uint32_t leftSum = 0, rightSum = 0;
+        for (uint32_t i = 0; i < kBinCount - 1; i++) {
+            leftSum += binCounts[axis][i];
+            leftCount[i] = leftSum;
+            leftBox.grow(binBounds[axis][i]);
+            leftArea[i] = leftBox.surfaceArea();
+
+            rightSum += binCounts[axis][kBinCount - 1 - i];
+            rightCount[kBinCount - 2 - i] = rightSum;
+            rightBox.grow(binBounds[axis][kBinCount - 1 - i]);
+            rightArea[kBinCount - 2 - i] = rightBox.surfaceArea();
+        }
+        for (uint32_t i = 0; i < kBinCount - 1; i++) {
+            if (leftCount[i] == 0 || rightCount[i] == 0) {
+                continue;
+            }
+            float cost = leftArea[i] * leftCount[i] + rightArea[i] * rightCount[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    float nodeArea = nodeBounds(node).surfaceArea();
+    float leafCost = static_cast<float>(count);
+    float splitCost = nodeArea > 0.0f ? kTraversalCost + bestCost / nodeArea : leafCost;
+    if (count <= kForceSplitSize && (bestAxis < 0 || (count <= kMaxLeafSize && splitCost >= leafCost))) {
+        return false;
+    }
+
+    BuildPrimitive* begin = ctx.primitives.data() + first;
+    BuildPrimitive* end = begin + count;
+    BuildPrimitive* middle;
+    if (bestAxis >= 0) {
+        middle = std::partition(begin, end, [&](const BuildPrimitive& primitive) {
+            return binOf(primitive.centroid, bestAxis) <= bestSplit;
+        });
+    } else {
+        // 重心が全て同じ位置にある場合は半分に分ける
+        middle = begin + count / 2;
+    }
+    leftCount = static_cast<uint32_t>(middle - begin);
+    if (leftCount == 0 || leftCount == count) {
+        leftCount = count / 2;
+    }
+    return true;
+}
+
+void subdivide(BuildContext& ctx, uint32_t nodeIndex, uint32_t depth) {
+    BvhNode& node = ctx.nodes[nodeIndex];
+    const uint32_t first = node.leftFirst;
+    const uint32_t count = node.count;
+    if (count <= 2 || depth >= kMaxDepth) {
+        return;
+    }
+
+    uint32_t leftCount;
+    if (depth >= kMedianSplitDepth) {
+        if (count <= kMaxLeafSize) {
+            return;
+        }
+        leftCount = partitionMedian(ctx, first, count);
+    } else if (!partitionSah(ctx, node, first, count, leftCount)) {
+        return;
+    }
+
+    uint32_t leftIndex = ctx.nodeCount.fetch_add(2);
+    BvhNode& left = ctx.nodes[leftIndex];
+    BvhNode& right = ctx.nodes[leftIndex + 1];
+    left.leftFirst = first;
+    left.count = leftCount;
+    right.leftFirst = first + leftCount;
+    right.count = count - leftCount;
+    computeBounds(ctx, left, left.leftFirst, left.count);
+    computeBounds(ctx, right, right.leftFirst, right.count);
+    ctx.parents[leftIndex] = nodeIndex;
+    ctx.parents[leftIndex + 1] = nodeIndex;
+    node.leftFirst = leftIndex;
+    node.count = 0;
+
+    if (count >= kParallelThreshold) {
+        render::JobSystem& jobs = render::JobSystem::instance();
+        render::JobCounter counter;
+        render::Job leftJob([&ctx, leftIndex, depth]() {
+            PROFILE_ZONE("sceneBvh.subtree");
+            subdivide(ctx, leftIndex, depth + 1);
+        });
+        jobs.run(leftJob, counter);
+        subdivide(ctx, leftIndex + 1, depth + 1);
+        jobs.wait(counter);
+    } else {
+        subdivide(ctx, leftIndex, depth + 1);
+        subdivide(ctx, leftIndex + 1, depth + 1);
+    }
+}
+
+} // namespace
+
+Aabb Aabb::transform(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& matrix) {
+    Aabb result;
+    result.min = glm::vec3(matrix[3]);
+    result.max = glm::vec3(matrix[3]);
+    for (int column = 0; column < 3; column++) {
+        for (int row = 0; row < 3; row++) {
+            float a = matrix[column][row] * localMin[column];
+            float b = matrix[column][row] * localMax[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;//left
+    frustum.planes[1] = row3 - row0;//right
+    frustum.planes[2] = row3 + row1;//bottom
+    frustum.planes[3] = row3 - row1;//top
+    frustum.planes[4] = row2;//near
+    frustum.planes[5] = row3 - row2;//far
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+Ray Ray::fromScreen(const glm::vec2& cursor, const glm::vec2& viewportSize, const glm::mat4& viewProj) {
+    // 射影行列でYを反転しているため、NDCのYは画面の下向きと一致する
+    glm::vec2 ndc = cursor / viewportSize * 2.0f - 1.0f;
+    glm::mat4 inverseViewProj = glm::inverse(viewProj);
+    glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndc.x, ndc.y, 0.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProj * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+    return {origin, glm::normalize(target - origin)};
+}
+
+bool intersectRayAabb(const Ray& ray, const glm::vec3& inverseDirection, const Aabb& box, float tMax, float& tNear) {
+    glm::vec3 t0 = (box.min - ray.origin) * inverseDirection;
+    glm::vec3 t1 = (box.max - ray.origin) * inverseDirection;
+    glm::vec3 tSmall = glm::min(t0, t1);
+    glm::vec3 tLarge = glm::max(t0, t1);
+    float enter = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+    float exit = std::min(std::min(tLarge.x, tLarge.y), std::min(tLarge.z, tMax));
+    tNear = enter;
+    return enter <= exit;
+}
+
+bool intersectRayTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t) {
+    // Möller–Trumbore（両面）
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::abs(det) < 1e-8f) {
+        return false;
+    }
+    float inverseDet = 1.0f / det;
+    glm::vec3 s = ray.origin - v0;
+    float u = glm::dot(s, p) * inverseDet;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.direction, q) * inverseDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    t = glm::dot(edge2, q) * inverseDet;
+    return t >= 0.0f;
+}
+
+void SceneBvh::build(const std::vector<Aabb>& instanceBounds) {
+    PROFILE_ZONE("sceneBvh.build");
+    bounds = instanceBounds;
+    const uint32_t count = static_cast<uint32_t>(bounds.size());
+    nodes.clear();
+    nodeCount = 0;
+    if (count == 0) {
+        return;
+    }
+
+    // 葉は最低1インスタンスを持つため、ノード数は2N-1以下
+    nodes.assign(2 * static_cast<size_t>(count) - 1, BvhNode{});
+    parents.assign(nodes.size(), UINT32_MAX);
+
+    BuildContext ctx{nodes, parents, std::vector<BuildPrimitive>(count), 1};
+    for (uint32_t i = 0; i < count; i++) {
+        ctx.primitives[i] = {bounds[i], bounds[i].center(), i};
+    }
+
+    nodes[0].leftFirst = 0;
+    nodes[0].count = count;
+    computeBounds(ctx, nodes[0], 0, count);
+    subdivide(ctx, 0, 0);
+    nodeCount = ctx.nodeCount.load();
+
+    instanceIndices.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        instanceIndices[i] = ctx.primitives[i].instance;
+    }
+    instanceLeaf.resize(count);
+    for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
+        const BvhNode& node = nodes[nodeIndex];
+        for (uint32_t i = 0; i < node.count; i++) {
+            instanceLeaf[instanceIndices[node.leftFirst + i]] = nodeIndex;
+        }
+    }
+}
+
+void SceneBvh::updateNodeBounds(uint32_t nodeIndex) {
+    BvhNode& node = nodes[nodeIndex];
+    Aabb box;
+    if (node.isLeaf()) {
+        for (uint32_t i = 0; i < node.count; i++) {
+            box.grow(bounds[instanceIndices[node.leftFirst + i]]);
+        }
+    } else {
+        box.grow(nodeBounds(nodes[node.leftFirst]));
+        box.grow(nodeBounds(nodes[node.leftFirst + 1]));
+    }
+    node.boundsMin = box.min;
+    node.boundsMax = box.max;
+}
+
+void SceneBvh::refit(const std::vector<Aabb>& instanceBounds) {
+    bounds = instanceBounds;
+    for (size_t i = nodeCount; i-- > 0;) {
+        updateNodeBounds(static_cast<uint32_t>(i));
+    }
+}
+
+void SceneBvh::refitInstances(const std::vector<uint32_t>& changedInstances, const std::vector<Aabb>& instanceBounds) {
+    for (uint32_t instance : changedInstances) {
+        bounds[instance] = instanceBounds[instance];
+    }
+    for (uint32_t instance : changedInstances) {
+        uint32_t nodeIndex = instanceLeaf[instance];
+        while (nodeIndex != UINT32_MAX) {
+            BvhNode& node = nodes[nodeIndex];
+            glm::vec3 oldMin = node.boundsMin;
+            glm::vec3 oldMax = node.boundsMax;
+            updateNodeBounds(nodeIndex);
+            // 境界が変わらなければ祖先も変わらない
+            if (node.boundsMin == oldMin && node.boundsMax == oldMax) {
+                break;
+            }
+            nodeIndex = parents[nodeIndex];
+        }
+    }
+}
+
+void SceneBvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& result) const {
+    if (nodeCount == 0) {
+        return;
+    }
+
+    // 下位ビットに「完全に内側」フラグを持たせたスタック
+    std::array<uint32_t, kTraversalStackSize> stack;
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        uint32_t entry = stack[--stackSize];
+        uint32_t nodeIndex = entry >> 1;
+        bool inside = entry & 1;
+        const BvhNode& node = nodes[nodeIndex];
+
+        if (!inside) {
+            FrustumTest test = classify(frustum, node.boundsMin, node.boundsMax);
+            if (test == FrustumTest::Outside) {
+                continue;
+            }
+            inside = test == FrustumTest::Inside;
+        }
+
+        if (node.isLeaf()) {
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t instance = instanceIndices[node.leftFirst + i];
+                if (inside || node.count == 1 || frustum.intersects(bounds[instance])) {
+                    result.push_back(instance);
+                }
+            }
+        } else {
+            stack[stackSize++] = (node.leftFirst << 1) | (inside ? 1 : 0);
+            stack[stackSize++] = ((node.leftFirst + 1) << 1) | (inside ? 1 : 0);
+        }
+    }
+}
+
+void SceneBvh::queryOverlap(const Aabb& box, std::vector<uint32_t>& result) const {
+    if (nodeCount == 0) {
+        return;
+    }
+
+    std::array<uint32_t, kTraversalStackSize> stack;
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = nodes[stack[--stackSize]];
+        if (!box.overlaps(nodeBounds(node))) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t instance = instanceIndices[node.leftFirst + i];
+                if (box.overlaps(bounds[instance])) {
+                    result.push_back(instance);
+                }
+            }
+        } else {
+            stack[stackSize++] = node.leftFirst;
+            stack[stackSize++] = node.leftFirst + 1;
+        }
+    }
+}
+
+uint32_t SceneBvh::raycast(const Ray& ray, float& tHit, const std::function<bool(uint32_t instance, float& t)>& intersectInstance) const {
+    uint32_t hitInstance = UINT32_MAX;
+    tHit = std::numeric_limits<float>::max();
+    if (nodeCount == 0) {
+        return hitInstance;
+    }
+
+    glm::vec3 inverseDirection = 1.0f / ray.direction;
+    float tNear;
+    if (!intersectRayAabb(ray, inverseDirection, nodeBounds(nodes[0]), tHit, tNear)) {
+        return hitInstance;
+    }
+
+    std::array<uint32_t, kTraversalStackSize> stack;
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = nodes[stack[--stackSize]];
+
+        if (node.isLeaf()) {
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t instance = instanceIndices[node.leftFirst + i];
+                float t;
+                if (!intersectRayAabb(ray, inverseDirection, bounds[instance], tHit, t)) {
+                    continue;
+                }
+                if (intersectInstance) {
+                    t = tHit;
+                    if (!intersectInstance(instance, t) || t >= tHit) {
+                        continue;
+                    }
+                }
+                tHit = t;
+                hitInstance = instance;
+            }
+            continue;
+        }
+
+        // 近い子を後に積んで先に調べる（遠い子は後でtHitにより枝刈りされやすい）
+        uint32_t children[2] = {node.leftFirst, node.leftFirst + 1};
+        float distances[2];
+        bool hits[2];
+        for (int c = 0; c < 2; c++) {
+            hits[c] = intersectRayAabb(ray, inverseDirection, nodeBounds(nodes[children[c]]), tHit, distances[c]);
+        }
+        if (hits[0] && hits[1]) {
+            bool leftFirst = distances[0] <= distances[1];
+            stack[stackSize++] = leftFirst ? children[1] : children[0];
+            stack[stackSize++] = leftFirst ? children[0] : children[1];
+        } else if (hits[0]) {
+            stack[stackSize++] = children[0];
+        } else if (hits[1]) {
+            stack[stackSize++] = children[1];
+        }
+    }
+    return hitInstance;
+}
+
+}
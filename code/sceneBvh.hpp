@@ -0,0 +1,114 @@
+#pragma once
+#include "header.hpp"
+
+namespace geometry {
+
+struct Aabb {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    void grow(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void grow(const Aabb& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+    float surfaceArea() const {
+        glm::vec3 d = max - min;
+        return d.x < 0.0f ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+    bool overlaps(const Aabb& other) const {
+        return min.x <= other.max.x && max.x >= other.min.x
+            && min.y <= other.max.y && max.y >= other.min.y
+            && min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    // ローカル空間のAABBを行列で変換したもの（8頂点ではなく軸ごとに最小・最大を取る）
+    static Aabb transform(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& matrix);
+};
+
+// ビュー射影行列から抽出した6平面（法線は内向き、深度0..1）
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProj);
+
+    bool intersects(const Aabb& box) const {
+        for (const glm::vec4& plane : planes) {
+            // 平面の法線方向に最も遠い頂点が裏側なら完全に外
+            glm::vec3 p(plane.x >= 0.0f ? box.max.x : box.min.x,
+                        plane.y >= 0.0f ? box.max.y : box.min.y,
+                        plane.z >= 0.0f ? box.max.z : box.min.z);
+            if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+
+    // スクリーン座標（ピクセル、左上原点）からワールド空間のレイを作る
+    static Ray fromScreen(const glm::vec2& cursor, const glm::vec2& viewportSize, const glm::mat4& viewProj);
+};
+
+// レイとAABBの交差（スラブ法）。交差すれば入射距離をtNearに入れる
+bool intersectRayAabb(const Ray& ray, const glm::vec3& inverseDirection, const Aabb& box, float tMax, float& tNear);
+// レイと三角形の交差。交差すれば距離をtに入れる
+bool intersectRayTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t);
+
+// インスタンスのワールドAABBに対するBVH
+// ノードは32バイトで、子は常に隣り合って格納される（左の子 = leftFirst, 右の子 = leftFirst + 1）
+// 子は親より後ろに確保されるため、末尾から順に処理すれば全体をリフィットできる
+struct BvhNode {
+    glm::vec3 boundsMin;
+    uint32_t leftFirst;//内部ノード: 左の子, 葉: instanceIndices内の開始位置
+    glm::vec3 boundsMax;
+    uint32_t count;//葉のインスタンス数（0なら内部ノード）
+
+    bool isLeaf() const { return count > 0; }
+};
+static_assert(sizeof(BvhNode) == 32);
+
+class SceneBvh {
+    public:
+        // ビン分割SAHで構築する。大きな部分木は別のジョブで構築する
+        void build(const std::vector<Aabb>& instanceBounds);
+
+        // 全インスタンスの境界を更新してリフィットする（トポロジは変えない）
+        void refit(const std::vector<Aabb>& instanceBounds);
+        // 変化したインスタンスのみ更新し、親へ向かって境界が変わらなくなるまで辿る
+        void refitInstances(const std::vector<uint32_t>& changedInstances, const std::vector<Aabb>& instanceBounds);
+
+        // 視錐台と交差するインスタンス（完全に内側の部分木は判定を省く）
+        void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& result) const;
+        // 指定AABBと重なるインスタンス
+        void queryOverlap(const Aabb& box, std::vector<uint32_t>& result) const;
+        // 最も近いヒット。intersectInstanceが指定されていれば詳細判定に使う（trueでtを更新）
+        // 見つからなければUINT32_MAXを返す
+        uint32_t raycast(const Ray& ray, float& tHit, const std::function<bool(uint32_t instance, float& t)>& intersectInstance = nullptr) const;
+
+        bool empty() const { return nodes.empty(); }
+        size_t getNodeCount() const { return nodeCount; }
+        const Aabb& getInstanceBounds(uint32_t instance) const { return bounds[instance]; }
+
+    private:
+        std::vector<BvhNode> nodes;
+        size_t nodeCount = 0;
+        std::vector<uint32_t> instanceIndices;//葉から参照するインスタンス番号
+        std::vector<Aabb> bounds;//インスタンスのAABB（構築時にコピー）
+        std::vector<uint32_t> parents;//ノードの親（根はUINT32_MAX）
+        std::vector<uint32_t> instanceLeaf;//インスタンスを含む葉ノード
+
+        void updateNodeBounds(uint32_t nodeIndex);
+};
+
+}
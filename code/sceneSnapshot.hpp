@@ -0,0 +1,86 @@
+#pragma once
+#include "drawList.hpp"
+#include "framePacer.hpp"
+
+namespace render {
+
+// 1生産者・1消費者のロックフリー三重バッファ
+// 生産者は書き込み用、消費者は読み出し用のバッファを専有し、残りの1つ（中間）を原子的な交換で受け渡す
+// 消費者が取り出す前に次が公開された場合は、古い方を破棄（上書き）して数える
+template <typename T>
+class TripleBuffer {
+    public:
+        TripleBuffer() = default;
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        // 生産者のみ
+        T& getWriteBuffer() { return buffers[writeIndex]; }
+        void publish() {
+            uint8_t previous = middle.exchange(static_cast<uint8_t>(writeIndex | kFreshBit), std::memory_order_acq_rel);
+            if (previous & kFreshBit) {
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            writeIndex = previous & kIndexMask;
+        }
+
+        // 消費者のみ。新しいものが公開されていれば読み出し用と入れ替えてtrueを返す
+        bool acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & kFreshBit)) {
+                return false;
+            }
+            uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+            readIndex = previous & kIndexMask;
+            return true;
+        }
+        const T& getReadBuffer() const { return buffers[readIndex]; }
+
+        // 読まれずに上書きされた数（どちらのスレッドからも読める）
+        uint64_t getDroppedCount() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint8_t kIndexMask = 0x3;
+        static constexpr uint8_t kFreshBit = 0x4;
+
+        std::array<T, 3> buffers{};
+        uint8_t writeIndex = 0;
+        uint8_t readIndex = 1;
+        std::atomic<uint8_t> middle{2};
+        std::atomic<uint64_t> droppedCount{0};
+};
+
+// 更新スレッドが作り、描画スレッドが読むシーンの状態（公開後は書き換えない）
+// カメラと可視判定・ソート済みの描画リスト、動くインスタンスの変換を持つ
+struct SceneSnapshot {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t sequence = 0;//作成順の番号（0は未作成）
+    Clock::time_point sampledAt;//入力を取得した時刻（表示までの遅延の起点）
+
+    glm::mat4 viewMatrix = glm::mat4(1.0f);
+    glm::mat4 projectionMatrix = glm::mat4(1.0f);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+
+    // 視錐台内の描画レコードの番号と、そのうち半透明のもののソート済みキー（容量は使い回す）
+    // 不透明はメッシュレットの間接描画が作業の順に描くため、キーを作らない
+    std::vector<uint32_t> visibleRecords;
+    DrawList drawList;
+
+    // 動くインスタンスのトランスフォーム（表の番号と行列。毎回すべてを書くため、途中のスナップショットが破棄されても失われない）
+    std::vector<std::pair<uint32_t, glm::mat4>> transforms;
+
+    // 描画スレッドで反映する設定（値で持つため、途中のスナップショットが破棄されても失われない）
+    bool meshletCulling = true;
+    bool occlusionCulling = true;
+    bool vertexPulling = false;
+    bool shadowCaching = true;
+    bool clusteredLighting = true;
+    bool dynamicResolution = false;
+    bool orderIndependentTransparency = false;
+    bool framePacing = true;
+    bool frameArena = true;
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+    uint32_t traceRequest = 0;//Tキーを押すたびに増える
+};
+
+}
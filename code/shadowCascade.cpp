@@ -0,0 +1,112 @@
+#include "shadowCascade.hpp"
+
+namespace render {
+
+namespace {
+
+constexpr float kRadiusQuantum = 1.0f / 16.0f;//半径の丸め（浮動小数点の誤差でページの大きさが揺れないように）
+constexpr float kDepthPadding = 0.5f;//ライト空間の奥行きの両端に足す余白
+
+} // namespace
+
+std::array<CascadeBounds, kMaxShadowCascades> fitCascades(const glm::mat4& view, const glm::mat4& projection, const ShadowSettings& settings) {
+    glm::mat4 inverseViewProj = glm::inverse(projection * view);
+    glm::mat4 inverseView = glm::inverse(view);
+    glm::vec3 eye = glm::vec3(inverseView[3]);
+    glm::vec3 forward = -glm::normalize(glm::vec3(inverseView[2]));
+
+    // 手前と奥の平面の4隅（各隅を結ぶ直線上では、前方向の距離は位置に比例する）
+    std::array<glm::vec3, 4> nearCorners;
+    std::array<glm::vec3, 4> farCorners;
+    for (uint32_t i = 0; i < 4; i++) {
+        glm::vec2 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+        glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+        glm::vec4 farPoint = inverseViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+        nearCorners[i] = glm::vec3(nearPoint) / nearPoint.w;
+        farCorners[i] = glm::vec3(farPoint) / farPoint.w;
+    }
+    float nearDistance = glm::dot(nearCorners[0] - eye, forward);
+    float farDistance = glm::dot(farCorners[0] - eye, forward);
+    float maxDistance = std::min(farDistance, settings.shadowDistance);
+    auto cornerAt = [&](uint32_t corner, float distance) {
+        return glm::mix(nearCorners[corner], farCorners[corner], (distance - nearDistance) / (farDistance - nearDistance));
+    };
+
+    // 対数分割と等間隔分割をsplitLambdaで混ぜる
+    uint32_t cascadeCount = std::clamp<uint32_t>(settings.cascadeCount, 1, kMaxShadowCascades);
+    std::array<CascadeBounds, kMaxShadowCascades> cascades{};
+    float splitNear = nearDistance;
+    for (uint32_t c = 0; c < cascadeCount; c++) {
+        float ratio = static_cast<float>(c + 1) / cascadeCount;
+        float logarithmic = nearDistance * std::pow(maxDistance / nearDistance, ratio);
+        float uniform = nearDistance + (maxDistance - nearDistance) * ratio;
+        float splitFar = glm::mix(uniform, logarithmic, settings.splitLambda);
+
+        std::array<glm::vec3, 8> corners;
+        glm::vec3 center(0.0f);
+        for (uint32_t i = 0; i < 4; i++) {
+            corners[i] = cornerAt(i, splitNear);
+            corners[i + 4] = cornerAt(i, splitFar);
+            center += corners[i] + corners[i + 4];
+        }
+        center /= 8.0f;
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        cascades[c] = {center, std::ceil(radius / kRadiusQuantum) * kRadiusQuantum, splitFar};
+        splitNear = splitFar;
+    }
+    return cascades;
+}
+
+glm::mat4 makeLightView(const glm::vec3& lightDirection) {
+    // 真上・真下からの光ではyを上にできないため、zを上にする
+    glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), -lightDirection, up);
+}
+
+glm::vec2 lightDepthRange(const geometry::Aabb& casterBounds, const glm::mat4& lightView) {
+    geometry::Aabb lightBounds = geometry::Aabb::transform(casterBounds.min, casterBounds.max, lightView);
+    return glm::vec2(lightBounds.min.z, lightBounds.max.z);
+}
+
+ShadowPage makeShadowPage(const CascadeBounds& bounds, const glm::vec3& lightDirection, const geometry::Aabb& casterBounds, float margin, uint32_t resolution) {
+    ShadowPage page;
+    page.lightView = makeLightView(lightDirection);
+    page.lightDirection = lightDirection;
+    page.halfExtent = bounds.radius * margin;
+
+    float texel = 2.0f * page.halfExtent / resolution;
+    glm::vec3 center = glm::vec3(page.lightView * glm::vec4(bounds.center, 1.0f));
+    page.center = glm::floor(glm::vec2(center) / texel) * texel;
+
+    // ライトへ向かう向きが+zのため、ライトに近い投影元ほどzが大きい（近い側を手前の平面にする）
+    glm::vec2 depthRange = lightDepthRange(casterBounds, page.lightView);
+    page.depthRange = glm::vec2(depthRange.x - kDepthPadding, depthRange.y + kDepthPadding);
+    glm::mat4 projection = glm::orthoRH_ZO(
+        page.center.x - page.halfExtent, page.center.x + page.halfExtent,
+        page.center.y - page.halfExtent, page.center.y + page.halfExtent,
+        -page.depthRange.y, -page.depthRange.x);
+    page.viewProj = projection * page.lightView;
+    return page;
+}
+
+bool isShadowPageReusable(const ShadowPage& page, const CascadeBounds& bounds, const glm::vec3& lightDirection, const geometry::Aabb& casterBounds, const ShadowSettings& settings) {
+    if (glm::dot(page.lightDirection, lightDirection) < std::cos(settings.lightAngleThreshold)) {
+        return false;
+    }
+    // 投影の変更などで区間が小さくなった場合は、解像度を無駄にしないよう作り直す
+    if (page.halfExtent > 2.0f * bounds.radius * settings.cacheMargin) {
+        return false;
+    }
+    glm::vec2 center = glm::vec2(page.lightView * glm::vec4(bounds.center, 1.0f));
+    glm::vec2 offset = glm::abs(center - page.center);
+    if (std::max(offset.x, offset.y) + bounds.radius > page.halfExtent) {
+        return false;
+    }
+    glm::vec2 depthRange = lightDepthRange(casterBounds, page.lightView);
+    return depthRange.x >= page.depthRange.x && depthRange.y <= page.depthRange.y;
+}
+
+}
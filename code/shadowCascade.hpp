@@ -0,0 +1,53 @@
+#pragma once
+#include "header.hpp"
+#include "sceneBvh.hpp"
+
+namespace render {
+
+constexpr uint32_t kMaxShadowCascades = 4;
+
+// カスケードシャドウマップの設定
+struct ShadowSettings {
+    uint32_t cascadeCount = 4;
+    uint32_t resolution = 2048;//カスケード1枚の一辺（テクセル）
+    float shadowDistance = 60.0f;//カメラからこの距離までに影を付ける
+    float splitLambda = 0.75f;//対数分割の比率（0で等間隔）
+    float cacheMargin = 1.25f;//キャッシュするページを区間より広げる倍率（カメラが少し動いても描き直さずに済む）
+    float lightAngleThreshold = 0.01f;//ライトの向きの変化がこれ（ラジアン）を超えたら描き直す
+};
+
+// カメラの視錐台を奥行きで区切った1区間を囲む球
+struct CascadeBounds {
+    glm::vec3 center;
+    float radius;
+    float splitFar;//区間の奥側の境界（カメラの前方向の距離）
+};
+
+// カメラの視錐台（深度0..1。Frustum::fromMatrixと同じ）をshadowDistanceまでで区切り、区間ごとに囲む球を求める
+// 半径は区間の形だけで決まるため、カメラが回転してもページの大きさは変わらない
+std::array<CascadeBounds, kMaxShadowCascades> fitCascades(const glm::mat4& view, const glm::mat4& projection, const ShadowSettings& settings);
+
+// ライト空間の正射影で描く1枚（カスケード1段分のシャドウマップ）
+struct ShadowPage {
+    glm::mat4 lightView = glm::mat4(1.0f);//回転のみ（zがライトへ向かう向き）
+    glm::vec3 lightDirection = glm::vec3(0.0f);
+    glm::vec2 center = glm::vec2(0.0f);//ライト空間での中心（テクセルの格子に合わせる）
+    float halfExtent = 0.0f;
+    glm::vec2 depthRange = glm::vec2(0.0f);//ライト空間のzの範囲（投影元をすべて含む）
+    glm::mat4 viewProj = glm::mat4(1.0f);
+};
+
+// lightDirectionはライトへ向かう向き
+glm::mat4 makeLightView(const glm::vec3& lightDirection);
+// 投影元のAABBをライト空間へ移したときのzの範囲（x: 最小, y: 最大）
+glm::vec2 lightDepthRange(const geometry::Aabb& casterBounds, const glm::mat4& lightView);
+
+// 区間の球を半径 × marginの正方形で囲むページを作る
+// 中心はテクセルの格子に合わせるため、カメラが動いても影の輪郭は揺れない
+ShadowPage makeShadowPage(const CascadeBounds& bounds, const glm::vec3& lightDirection, const geometry::Aabb& casterBounds, float margin, uint32_t resolution);
+
+// 描き直さずに使えるか
+// ライトの向きの変化が閾値以内で、区間の球と投影元がページの範囲に収まり、ページが区間に対して大きすぎないこと
+bool isShadowPageReusable(const ShadowPage& page, const CascadeBounds& bounds, const glm::vec3& lightDirection, const geometry::Aabb& casterBounds, const ShadowSettings& settings);
+
+}
@@ -0,0 +1,436 @@
+#include "vulkanContext.hpp"
+#include "jobSystem.hpp"
+
+namespace {
+
+constexpr float kDepthBiasConstant = 1.25f;
+constexpr float kDepthBiasSlope = 1.75f;
+
+vk::ImageMemoryBarrier layerBarrier(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+                                    vk::AccessFlags srcAccess, vk::AccessFlags dstAccess, uint32_t baseLayer, uint32_t layerCount) {
+    return vk::ImageMemoryBarrier(
+        srcAccess,//srcAccessMask
+        dstAccess,//dstAccessMask
+        oldLayout,//oldLayout
+        newLayout,//newLayout
+        VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+        image,//image
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, baseLayer, layerCount)//subresourceRange
+    );
+}
+
+constexpr vk::PipelineStageFlags kDepthStages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+constexpr vk::AccessFlags kDepthAccess = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+} // namespace
+
+//シャドウマップ・ページ・描画パイプラインを作る
+//カリングのディスクリプタから常に参照されるため、影を描かない場合もシャドウマップを読める状態にしておく
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::initShadowMaps() {
+    PROFILE_ZONE("initShadowMaps");
+    ready = false;
+    cascadeCount = std::clamp<uint32_t>(settings.cascadeCount, 1, render::kMaxShadowCascades);
+    createImages();
+
+    // 深度の比較を行うサンプラー（線形補間できる形式なら2x2の比較結果を混ぜる）
+    vk::FormatProperties formatProperties = deviceWrapper.context.physicalDevice.getFormatProperties(kShadowFormat);
+    vk::Filter filter = (formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) ? vk::Filter::eLinear : vk::Filter::eNearest;
+    vk::SamplerCreateInfo samplerCreateInfo(
+        {},//flags
+        filter,//magFilter
+        filter,//minFilter
+        vk::SamplerMipmapMode::eNearest,//mipmapMode
+        vk::SamplerAddressMode::eClampToBorder,//addressModeU
+        vk::SamplerAddressMode::eClampToBorder,//addressModeV
+        vk::SamplerAddressMode::eClampToBorder,//addressModeW
+        0.0f,//mipLodBias
+        VK_FALSE,//anisotropyEnable
+        1.0f,//maxAnisotropy
+        VK_TRUE,//compareEnable
+        vk::CompareOp::eLessOrEqual,//compareOp
+        0.0f,//minLod
+        0.0f,//maxLod
+        vk::BorderColor::eFloatOpaqueWhite//borderColor（範囲外は影にしない）
+    );
+    sampler = deviceWrapper.device->createSamplerUnique(samplerCreateInfo);
+
+    paramsBuffer = deviceWrapper.createBuffer(sizeof(ShadowParams), vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    ShadowParams params{};
+    params.lightDirection = glm::vec4(lightDirection, 0.0f);
+    std::memcpy(paramsBuffer.mapped, &params, sizeof(params));
+
+    createPipeline();
+
+    // シャドウマップは毎フレームの終わりにShaderReadOnlyへ戻すため、作成時にもその状態にしておく
+    CommandBufWrapper& commandBufWrapper = deviceWrapper.graphicsCommandBufWrapper;
+    vk::CommandBuffer commandBuffer = commandBufWrapper.getCommandBuffer();
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    vk::ImageMemoryBarrier barrier = layerBarrier(shadowMap.image.get(), vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                                  {}, vk::AccessFlagBits::eShaderRead, 0, cascadeCount);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, barrier);
+    commandBuffer.end();
+    QueueWrapper::Submission submission;
+    submission.commandBuffers.push_back(commandBufWrapper.getCommandBufferSubmitInfo());
+    deviceWrapper.graphicsQueueWrapper.submit(std::move(submission));
+    deviceWrapper.graphicsQueueWrapper.waitIdle();
+
+    invalidate();
+    ready = true;
+    std::cout << "シャドウマップ: " << cascadeCount << " カスケード, " << settings.resolution << "x" << settings.resolution
+              << (filter == vk::Filter::eLinear ? ", 比較サンプラーの線形補間" : "") << std::endl;
+}
+
+//staticPagesは描き直したカスケードの複製元、shadowMapはページの複製に動的な投影元を重ねて描画で参照する
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::createImages() {
+    staticLayerViews.clear();
+    shadowLayerViews.clear();
+    vk::Extent2D extent(settings.resolution, settings.resolution);
+    staticPages = deviceWrapper.createImage(extent, 1, kShadowFormat, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                                            vk::ImageAspectFlagBits::eDepth, cascadeCount, vk::ImageViewType::e2DArray);
+    shadowMap = deviceWrapper.createImage(extent, 1, kShadowFormat,
+                                          vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                                          vk::ImageAspectFlagBits::eDepth, cascadeCount, vk::ImageViewType::e2DArray);
+
+    // カスケードごとに描画先にするビュー
+    auto layerView = [&](vk::Image image, uint32_t layer) {
+        vk::ImageViewCreateInfo imageViewCreateInfo(
+            {},
+            image,
+            vk::ImageViewType::e2D,
+            kShadowFormat,
+            vk::ComponentMapping(),
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, layer, 1)
+        );
+        return deviceWrapper.device->createImageViewUnique(imageViewCreateInfo);
+    };
+    for (uint32_t layer = 0; layer < cascadeCount; layer++) {
+        staticLayerViews.push_back(layerView(staticPages.image.get(), layer));
+        shadowLayerViews.push_back(layerView(shadowMap.image.get(), layer));
+    }
+}
+
+//位置ストリームだけを読み、ライトのビュー射影とワールド行列を掛けたものをプッシュ定数で受け取る
+//薄い投影元の裏面も影を落とすようにカリングはしない
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::createPipeline() {
+    GeometryBufferWrapper& geometryBuffer = deviceWrapper.geometryBufferWrapper;
+    vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4));
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+        {},//flags
+        0,//setLayoutCount
+        nullptr,//pSetLayouts
+        1,//pushConstantRangeCount
+        &pushConstantRange//pPushConstantRanges
+    );
+    pipelineLayout = deviceWrapper.device->createPipelineLayoutUnique(pipelineLayoutInfo);
+
+    vk::UniqueShaderModule vertexShaderModule = deviceWrapper.pipelineWrapper.initShaderModule("./shader/compiled/shadowCaster.vert.spv");
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShaderModule.get(), "main")
+    };
+
+    vk::VertexInputBindingDescription positionBinding(0, static_cast<uint32_t>(geometryBuffer.getPositionStride()), vk::VertexInputRate::eVertex);
+    vk::VertexInputAttributeDescription position(0, 0, geometryBuffer.getPositionFormat(), 0);
+    vk::PipelineVertexInputStateCreateInfo vertexInput({}, 1, &positionBinding, 1, &position);
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+    vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);
+    vk::PipelineRasterizationStateCreateInfo rasterizer(
+        {},//flags
+        VK_FALSE,//depthClampEnable
+        VK_FALSE,//rasterizerDiscardEnable
+        vk::PolygonMode::eFill,//polygonMode
+        vk::CullModeFlagBits::eNone,//cullMode
+        vk::FrontFace::eCounterClockwise,//frontFace
+        VK_TRUE,//depthBiasEnable（自己遮蔽による縞を抑える）
+        kDepthBiasConstant,//depthBiasConstantFactor
+        0.0f,//depthBiasClamp
+        kDepthBiasSlope,//depthBiasSlopeFactor
+        1.0f//lineWidth
+    );
+    vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1);
+    vk::PipelineDepthStencilStateCreateInfo depthStencil(
+        {},//flags
+        VK_TRUE,//depthTestEnable
+        VK_TRUE,//depthWriteEnable
+        vk::CompareOp::eLess,//depthCompareOp
+        VK_FALSE,//depthBoundsTestEnable
+        VK_FALSE//stencilTestEnable
+    );
+    vk::PipelineColorBlendStateCreateInfo colorBlending({}, VK_FALSE, vk::LogicOp::eCopy, 0, nullptr);
+
+    std::vector<vk::DynamicState> dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor
+    };
+    vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates);
+
+    vk::PipelineRenderingCreateInfo renderingCreateInfo(
+        0,//viewMask
+        0,//colorAttachmentCount
+        nullptr,//pColorAttachmentFormats
+        kShadowFormat,//depthAttachmentFormat
+        vk::Format::eUndefined//stencilAttachmentFormat
+    );
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo(
+        {},//flags
+        shaderStages.size(),//stageCount
+        shaderStages.data(),//pStages
+        &vertexInput,//pVertexInputState
+        &inputAssembly,//pInputAssemblyState
+        nullptr,//pTessellationState
+        &viewportState,//pViewportState
+        &rasterizer,//pRasterizationState
+        &multisampling,//pMultisampleState
+        &depthStencil,//pDepthStencilState
+        &colorBlending,//pColorBlendState
+        &dynamicState,//pDynamicState
+        pipelineLayout.get()//layout
+    );
+    pipelineCreateInfo.setPNext(&renderingCreateInfo);
+    pipeline = deviceWrapper.device->createGraphicsPipelineUnique(VK_NULL_HANDLE, pipelineCreateInfo).value;
+}
+
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::setCasters(std::vector<Caster> newCasters, const geometry::Aabb& bounds) {
+    casters = std::move(newCasters);
+    casterBounds = bounds;
+
+    staticCasterGeometry.clear();
+    for (const Caster& caster : casters) {
+        if (!caster.enabled || caster.dynamic) {
+            continue;
+        }
+        if (caster.geometryIndex >= staticCasterGeometry.size()) {
+            staticCasterGeometry.resize(caster.geometryIndex + 1, 0);
+        }
+        staticCasterGeometry[caster.geometryIndex] = 1;
+    }
+    for (uint32_t c = 0; c < render::kMaxShadowCascades; c++) {
+        visibleCasters[c].reserve(casters.size());
+        staticDrawList[c].reserve(casters.size());
+        dynamicDrawList[c].reserve(casters.size());
+    }
+    invalidate();
+}
+
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::setCasterMatrix(uint32_t casterIndex, const glm::mat4& matrix) {
+    Caster& caster = casters[casterIndex];
+    if (caster.worldMatrix == matrix) {
+        return;
+    }
+    caster.worldMatrix = matrix;
+    if (caster.enabled && !caster.dynamic) {
+        invalidate();
+    }
+}
+
+//常駐していないジオメトリは描かないため、常駐状態が変わればページの内容も変わる
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::invalidateGeometry(uint32_t geometryIndex) {
+    if (geometryIndex < staticCasterGeometry.size() && staticCasterGeometry[geometryIndex]) {
+        invalidate();
+    }
+}
+
+//キャッシュ有効: ページを使い回せるカスケードでは静的な投影元を描かず、動的な投影元だけを選ぶ
+//キャッシュ無効: 余白を取らずに区間へ合わせ、毎フレームすべての投影元を描く
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::update(const glm::mat4& view, const glm::mat4& projection) {
+    frameStatistics = ShadowStatistics{};
+    shadowZone = UINT32_MAX;
+    active = ready && enabled && !casters.empty();
+    cachedFrame = cachingEnabled;
+
+    ShadowParams params{};
+    params.lightDirection = glm::vec4(lightDirection, 0.0f);
+    if (!active) {
+        if (ready) {
+            std::memcpy(paramsBuffer.mapped, &params, sizeof(params));
+        }
+        return;
+    }
+    PROFILE_ZONE("shadow.update");
+
+    std::array<render::CascadeBounds, render::kMaxShadowCascades> bounds = render::fitCascades(view, projection, settings);
+    for (uint32_t c = 0; c < cascadeCount; c++) {
+        if (cachedFrame) {
+            renderStatic[c] = !pageValid[c] || !render::isShadowPageReusable(pages[c], bounds[c], lightDirection, casterBounds, settings);
+            if (renderStatic[c]) {
+                pages[c] = render::makeShadowPage(bounds[c], lightDirection, casterBounds, settings.cacheMargin, settings.resolution);
+                pageValid[c] = true;
+            }
+            cascades[c] = pages[c];
+        } else {
+            // ページは描かないため、キャッシュを有効に戻したときは描き直す
+            cascades[c] = render::makeShadowPage(bounds[c], lightDirection, casterBounds, 1.0f, settings.resolution);
+            renderStatic[c] = true;
+            pageValid[c] = false;
+        }
+        params.cascadeViewProj[c] = cascades[c].viewProj;
+        params.splitDepths[c] = bounds[c].splitFar;
+    }
+    params.cascadeCount = cascadeCount;
+    params.texelSize = 1.0f / settings.resolution;
+    std::memcpy(paramsBuffer.mapped, &params, sizeof(params));
+
+    // カスケードは互いに独立しているため、1つずつジョブにしてBVHで投影元を選ぶ
+    {
+        PROFILE_ZONE("shadow.cull");
+        const geometry::SceneBvh& sceneBvh = deviceWrapper.context.sceneBvh;
+        render::JobSystem::instance().parallelFor(cascadeCount, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                visibleCasters[c].clear();
+                staticDrawList[c].clear();
+                dynamicDrawList[c].clear();
+                sceneBvh.queryFrustum(geometry::Frustum::fromMatrix(cascades[c].viewProj), visibleCasters[c]);
+                for (uint32_t index : visibleCasters[c]) {
+                    const Caster& caster = casters[index];
+                    if (!caster.enabled) {
+                        continue;
+                    }
+                    if (caster.dynamic) {
+                        dynamicDrawList[c].push_back(index);
+                    } else if (renderStatic[c]) {
+                        staticDrawList[c].push_back(index);
+                    }
+                }
+            }
+        });
+    }
+}
+
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::record(vk::CommandBuffer commandBuffer) {
+    if (!active) {
+        return;
+    }
+    shadowZone = deviceWrapper.gpuProfilerWrapper.beginZone(commandBuffer, "graphics queue", "shadows");
+
+    if (cachedFrame) {
+        // 描き直すページだけをクリアして静的な投影元を描く（前のフレームの複製は表示前の待機で終わっている）
+        for (uint32_t c = 0; c < cascadeCount; c++) {
+            if (!renderStatic[c]) {
+                continue;
+            }
+            vk::ImageMemoryBarrier toAttachment = layerBarrier(staticPages.image.get(), vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthAttachmentOptimal,
+                                                               {}, kDepthAccess, c, 1);
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, kDepthStages, {}, {}, {}, toAttachment);
+            beginLayer(commandBuffer, staticLayerViews[c].get(), vk::AttachmentLoadOp::eClear);
+            drawCasters(commandBuffer, cascades[c], staticDrawList[c], frameStatistics.staticDraws);
+            commandBuffer.endRendering();
+            vk::ImageMemoryBarrier toSource = layerBarrier(staticPages.image.get(), vk::ImageLayout::eDepthAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                                                           vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eTransferRead, c, 1);
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, toSource);
+            frameStatistics.pageUpdates++;
+        }
+
+        // ページを複製し、その上に動的な投影元を重ねる（前の内容は全て上書きする）
+        vk::ImageMemoryBarrier toDestination = layerBarrier(shadowMap.image.get(), vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                                                            {}, vk::AccessFlagBits::eTransferWrite, 0, cascadeCount);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, toDestination);
+        vk::ImageSubresourceLayers layers(vk::ImageAspectFlagBits::eDepth, 0, 0, cascadeCount);
+        vk::ImageCopy region(layers, vk::Offset3D(0, 0, 0), layers, vk::Offset3D(0, 0, 0), vk::Extent3D(shadowMap.extent, 1));
+        commandBuffer.copyImage(staticPages.image.get(), vk::ImageLayout::eTransferSrcOptimal, shadowMap.image.get(), vk::ImageLayout::eTransferDstOptimal, region);
+        vk::ImageMemoryBarrier toAttachment = layerBarrier(shadowMap.image.get(), vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eDepthAttachmentOptimal,
+                                                           vk::AccessFlagBits::eTransferWrite, kDepthAccess, 0, cascadeCount);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, kDepthStages, {}, {}, {}, toAttachment);
+
+        for (uint32_t c = 0; c < cascadeCount; c++) {
+            if (dynamicDrawList[c].empty()) {
+                continue;
+            }
+            beginLayer(commandBuffer, shadowLayerViews[c].get(), vk::AttachmentLoadOp::eLoad);
+            drawCasters(commandBuffer, cascades[c], dynamicDrawList[c], frameStatistics.dynamicDraws);
+            commandBuffer.endRendering();
+        }
+    } else {
+        vk::ImageMemoryBarrier toAttachment = layerBarrier(shadowMap.image.get(), vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthAttachmentOptimal,
+                                                           {}, kDepthAccess, 0, cascadeCount);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, kDepthStages, {}, {}, {}, toAttachment);
+        for (uint32_t c = 0; c < cascadeCount; c++) {
+            beginLayer(commandBuffer, shadowLayerViews[c].get(), vk::AttachmentLoadOp::eClear);
+            drawCasters(commandBuffer, cascades[c], staticDrawList[c], frameStatistics.staticDraws);
+            drawCasters(commandBuffer, cascades[c], dynamicDrawList[c], frameStatistics.dynamicDraws);
+            commandBuffer.endRendering();
+        }
+        frameStatistics.pageUpdates += cascadeCount;
+    }
+
+    vk::ImageMemoryBarrier toShaderRead = layerBarrier(shadowMap.image.get(), vk::ImageLayout::eDepthAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                                       vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead, 0, cascadeCount);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, toShaderRead);
+
+    deviceWrapper.gpuProfilerWrapper.endZone(commandBuffer, shadowZone);
+}
+
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::beginLayer(vk::CommandBuffer commandBuffer, vk::ImageView view, vk::AttachmentLoadOp loadOp) {
+    vk::Extent2D extent = shadowMap.extent;
+    vk::RenderingAttachmentInfo depthAttachment(
+        view,//imageView
+        vk::ImageLayout::eDepthAttachmentOptimal,//imageLayout
+        vk::ResolveModeFlagBits::eNone,//resolveMode
+        {},//resolveImageView
+        vk::ImageLayout::eUndefined,//resolveImageLayout
+        loadOp,//loadOp
+        vk::AttachmentStoreOp::eStore,//storeOp
+        vk::ClearDepthStencilValue(1.0f, 0)//clearValue
+    );
+    vk::RenderingInfo renderingInfo({}, vk::Rect2D({0, 0}, extent), 1, 0, 0, nullptr, &depthAttachment, nullptr);
+    commandBuffer.beginRendering(renderingInfo);
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline.get());
+    commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f));
+    commandBuffer.setScissor(0, vk::Rect2D({0, 0}, extent));
+    deviceWrapper.geometryBufferWrapper.bindPositions(commandBuffer);
+}
+
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::drawCasters(vk::CommandBuffer commandBuffer, const render::ShadowPage& cascade, const std::vector<uint32_t>& drawList, uint64_t& drawCount) {
+    GeometryBufferWrapper& geometryBuffer = deviceWrapper.geometryBufferWrapper;
+    for (uint32_t index : drawList) {
+        const Caster& caster = casters[index];
+        const GeometryBufferWrapper::Placement& placement = geometryBuffer.getPlacement(caster.geometryIndex);
+        if (!placement.resident) {
+            continue;
+        }
+        glm::mat4 lightWorldViewProj = cascade.viewProj * caster.worldMatrix;
+        commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4), &lightWorldViewProj);
+        commandBuffer.drawIndexed(caster.indexCount, 1, placement.firstIndex, placement.vertexOffset, 0);
+        drawCount++;
+    }
+}
+
+//フレーム完了後に呼ぶ（waitForFrameでフェンスの待機が済んでいる前提）
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::collectStatistics() {
+    if (!active) {
+        return;
+    }
+    ShadowStatistics& current = statistics[cachedFrame ? 1 : 0];
+    current.frames++;
+    current.staticDraws += frameStatistics.staticDraws;
+    current.dynamicDraws += frameStatistics.dynamicDraws;
+    current.pageUpdates += frameStatistics.pageUpdates;
+
+    // GPU時間はプロファイラのゾーンから読む（タイムスタンプの有効ビットでマスク済み）
+    double milliseconds = 0.0;
+    if (deviceWrapper.gpuProfilerWrapper.getZoneMilliseconds(shadowZone, milliseconds)) {
+        current.gpuMilliseconds += milliseconds;
+    }
+
+    // 一定フレームごとに平均を出力
+    if (++frameCounter % 120 != 0 || !deviceWrapper.context.statisticsOutput) {
+        return;
+    }
+    for (int mode = 1; mode >= 0; mode--) {
+        const ShadowStatistics& s = statistics[mode];
+        if (s.frames == 0) {
+            continue;
+        }
+        double frames = static_cast<double>(s.frames);
+        std::cout << "影[" << (mode == 1 ? "キャッシュ有効" : "キャッシュ無効") << "]: "
+                  << "描画 " << s.draws() / frames << " 件/フレーム (静的 " << s.staticDraws / frames << ", 動的 " << s.dynamicDraws / frames << "), "
+                  << "ページ更新 " << s.pageUpdates / frames << " 枚/フレーム, "
+                  << "GPU " << s.gpuMilliseconds / frames << " ms" << std::endl;
+    }
+}
+
+void VulkanContext::DeviceWrapper::ShadowMapWrapper::resetStatistics() {
+    for (ShadowStatistics& s : statistics) {
+        s = ShadowStatistics{};
+    }
+}
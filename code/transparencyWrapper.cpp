@@ -0,0 +1,467 @@
+#include "vulkanContext.hpp"
+#include "geometry.hpp"
+
+namespace {
+
+constexpr vk::ColorComponentFlags kColorComponents = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+// (色, α)をαで重ねる（合成先のαは1 - 透過率の積になる）
+vk::PipelineColorBlendAttachmentState overBlend() {
+    return vk::PipelineColorBlendAttachmentState(
+        VK_TRUE,//blendEnable
+        vk::BlendFactor::eSrcAlpha,//srcColorBlendFactor
+        vk::BlendFactor::eOneMinusSrcAlpha,//dstColorBlendFactor
+        vk::BlendOp::eAdd,//colorBlendOp
+        vk::BlendFactor::eOne,//srcAlphaBlendFactor
+        vk::BlendFactor::eOneMinusSrcAlpha,//dstAlphaBlendFactor
+        vk::BlendOp::eAdd,//alphaBlendOp
+        kColorComponents//colorWriteMask
+    );
+}
+
+vk::ImageMemoryBarrier colorBarrier(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess) {
+    return vk::ImageMemoryBarrier(
+        srcAccess,//srcAccessMask
+        dstAccess,//dstAccessMask
+        oldLayout,//oldLayout
+        newLayout,//newLayout
+        VK_QUEUE_FAMILY_IGNORED,//srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,//dstQueueFamilyIndex
+        image,//image
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)//subresourceRange
+    );
+}
+
+} // namespace
+
+//面を入れ替え、蓄積先・ディスクリプタ・パイプラインを作る
+//半透明のインスタンスはメッシュレットの描画から外れているため、ここで描かなければ表示されない
+void VulkanContext::DeviceWrapper::TransparencyWrapper::initTransparency(std::vector<Surface> newSurfaces) {
+    PROFILE_ZONE("initTransparency");
+    ready = false;
+    surfaces = std::move(newSurfaces);
+    transparentCount = 0;
+    uint32_t geometryCount = 0;
+    for (const Surface& surface : surfaces) {
+        if (surface.enabled) {
+            transparentCount++;
+            geometryCount = std::max(geometryCount, surface.geometryIndex + 1);
+        }
+    }
+    geometryBatch.assign(geometryCount, UINT32_MAX);
+    batches.reserve(transparentCount);
+    if (transparentCount == 0 || !deviceWrapper.meshletCullWrapper.isReady()) {
+        return;
+    }
+
+    drawInstanceBuffer = deviceWrapper.createBuffer(transparentCount * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer,
+                                                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    // 蓄積先は画素の位置で読むため補間しない
+    vk::SamplerCreateInfo samplerCreateInfo(
+        {},//flags
+        vk::Filter::eNearest,//magFilter
+        vk::Filter::eNearest,//minFilter
+        vk::SamplerMipmapMode::eNearest,//mipmapMode
+        vk::SamplerAddressMode::eClampToEdge,//addressModeU
+        vk::SamplerAddressMode::eClampToEdge,//addressModeV
+        vk::SamplerAddressMode::eClampToEdge//addressModeW
+    );
+    sampler = deviceWrapper.device->createSamplerUnique(samplerCreateInfo);
+
+    // set 2, binding 0: 描くインスタンスの番号, 1: 累積色, 2: 透過率
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment)
+    };
+    descriptorSetLayout = deviceWrapper.device->createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1),
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2)
+    };
+    descriptorPool = deviceWrapper.device->createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, 1, poolSizes));
+    descriptorSet = deviceWrapper.device->allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), 1, &descriptorSetLayout.get())).front();
+    vk::DescriptorBufferInfo instanceInfo(drawInstanceBuffer.buffer.get(), 0, VK_WHOLE_SIZE);
+    deviceWrapper.device->updateDescriptorSets(vk::WriteDescriptorSet(descriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &instanceInfo), {});
+    createTargets(deviceWrapper.swapchainWrapper.swapchainExtent);
+
+    // set 0, 1はメッシュレットの描画と共通（シーンの表・影・ライト・カメラ）
+    std::vector<vk::DescriptorSetLayout> setLayouts = {
+        deviceWrapper.meshletCullWrapper.getDescriptorSetLayout(),
+        deviceWrapper.frameRingWrapper.getDescriptorSetLayout(),
+        descriptorSetLayout.get()
+    };
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+        {},//flags
+        static_cast<uint32_t>(setLayouts.size()),//setLayoutCount
+        setLayouts.data(),//pSetLayouts
+        0,//pushConstantRangeCount
+        nullptr//pPushConstantRanges
+    );
+    pipelineLayout = deviceWrapper.device->createPipelineLayoutUnique(pipelineLayoutInfo);
+    createPipelines();
+
+    ready = true;
+    std::cout << "半透明: " << transparentCount << " インスタンス, " << geometryCount << " ジオメトリ中" << std::endl;
+}
+
+//累積色と透過率（スワップチェインと同じ大きさで、描画範囲の分だけを使う）
+void VulkanContext::DeviceWrapper::TransparencyWrapper::createTargets(vk::Extent2D extent) {
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled;
+    accumulationImage = deviceWrapper.createImage(extent, 1, kAccumulationFormat, usage, vk::ImageAspectFlagBits::eColor);
+    revealageImage = deviceWrapper.createImage(extent, 1, kRevealageFormat, usage, vk::ImageAspectFlagBits::eColor);
+
+    vk::DescriptorImageInfo accumulationInfo(sampler.get(), accumulationImage.view.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorImageInfo revealageInfo(sampler.get(), revealageImage.view.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::vector<vk::WriteDescriptorSet> writes = {
+        vk::WriteDescriptorSet(descriptorSet, 1, 0, 1, vk::DescriptorType::eCombinedImageSampler, &accumulationInfo, nullptr),
+        vk::WriteDescriptorSet(descriptorSet, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &revealageInfo, nullptr)
+    };
+    deviceWrapper.device->updateDescriptorSets(writes, {});
+}
+
+void VulkanContext::DeviceWrapper::TransparencyWrapper::createPipelines() {
+    PipelineWrapper& pipelineWrapper = deviceWrapper.pipelineWrapper;
+    vk::Format sceneFormat = deviceWrapper.swapchainWrapper.getFormat();
+
+    // 半透明の面はプールの頂点（位置と法線）を読む
+    vk::VertexInputBindingDescription bindingDescription = geometry::StaticVertexAttributes::getBindingDescription();
+    auto attributeDescriptions = geometry::StaticVertexAttributes::getAttributeDescriptions();
+    vk::PipelineVertexInputStateCreateInfo vertexInput(
+        {},//flags
+        1,//vertexBindingDescriptionCount
+        &bindingDescription,//pVertexBindingDescriptions
+        2,//vertexAttributeDescriptionCount（位置と法線のみ使用）
+        attributeDescriptions.data()//pVertexAttributeDescriptions
+    );
+    vk::UniqueShaderModule vertexShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/transparent.vert.spv");
+    vk::PipelineShaderStageCreateInfo vertexStage({}, vk::ShaderStageFlagBits::eVertex, vertexShaderModule.get(), "main");
+
+    // ソート: シーンの色へ直接重ねる
+    vk::UniqueShaderModule sortedShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/transparentSorted.frag.spv");
+    sortedPipeline = createPipeline({
+        vertexStage,
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, sortedShaderModule.get(), "main")
+    }, vertexInput, {overBlend()}, {sceneFormat}, true);
+
+    // 重み付きOIT: 累積色は加算、透過率は(1 - α)を掛ける
+    vk::PipelineColorBlendAttachmentState accumulationBlend(
+        VK_TRUE,//blendEnable
+        vk::BlendFactor::eOne,//srcColorBlendFactor
+        vk::BlendFactor::eOne,//dstColorBlendFactor
+        vk::BlendOp::eAdd,//colorBlendOp
+        vk::BlendFactor::eOne,//srcAlphaBlendFactor
+        vk::BlendFactor::eOne,//dstAlphaBlendFactor
+        vk::BlendOp::eAdd,//alphaBlendOp
+        kColorComponents//colorWriteMask
+    );
+    vk::PipelineColorBlendAttachmentState revealageBlend(
+        VK_TRUE,//blendEnable
+        vk::BlendFactor::eZero,//srcColorBlendFactor
+        vk::BlendFactor::eOneMinusSrcColor,//dstColorBlendFactor
+        vk::BlendOp::eAdd,//colorBlendOp
+        vk::BlendFactor::eZero,//srcAlphaBlendFactor
+        vk::BlendFactor::eOne,//dstAlphaBlendFactor
+        vk::BlendOp::eAdd,//alphaBlendOp
+        vk::ColorComponentFlagBits::eR//colorWriteMask
+    );
+    vk::UniqueShaderModule accumulateShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/transparentOit.frag.spv");
+    accumulatePipeline = createPipeline({
+        vertexStage,
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, accumulateShaderModule.get(), "main")
+    }, vertexInput, {accumulationBlend, revealageBlend}, {kAccumulationFormat, kRevealageFormat}, true);
+
+    // 合成: 全画面の三角形で、蓄積を平均してシーンの色へ重ねる
+    vk::PipelineVertexInputStateCreateInfo emptyVertexInput{};
+    vk::UniqueShaderModule resolveVertexShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/oitResolve.vert.spv");
+    vk::UniqueShaderModule resolveFragmentShaderModule = pipelineWrapper.initShaderModule("./shader/compiled/oitResolve.frag.spv");
+    resolvePipeline = createPipeline({
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, resolveVertexShaderModule.get(), "main"),
+        vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, resolveFragmentShaderModule.get(), "main")
+    }, emptyVertexInput, {overBlend()}, {sceneFormat}, false);
+}
+
+//depthTestがtrueなら不透明の深度で判定する（半透明はいずれも深度を書かない）
+//薄い面の裏側も見えるようにカリングはしない
+vk::UniquePipeline VulkanContext::DeviceWrapper::TransparencyWrapper::createPipeline(const std::vector<vk::PipelineShaderStageCreateInfo>& shaderStages, const vk::PipelineVertexInputStateCreateInfo& vertexInput,
+                                                                                    const std::vector<vk::PipelineColorBlendAttachmentState>& blendAttachments, const std::vector<vk::Format>& colorFormats, bool depthTest) {
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly({}, vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+    vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);
+    vk::PipelineRasterizationStateCreateInfo rasterizer(
+        {},//flags
+        VK_FALSE,//depthClampEnable
+        VK_FALSE,//rasterizerDiscardEnable
+        vk::PolygonMode::eFill,//polygonMode
+        vk::CullModeFlagBits::eNone,//cullMode
+        vk::FrontFace::eCounterClockwise,//frontFace
+        VK_FALSE,//depthBiasEnable
+        0.0f,//depthBiasConstantFactor
+        0.0f,//depthBiasClamp
+        0.0f,//depthBiasSlopeFactor
+        1.0f//lineWidth
+    );
+    vk::PipelineMultisampleStateCreateInfo multisampling({}, vk::SampleCountFlagBits::e1);
+    vk::PipelineDepthStencilStateCreateInfo depthStencil(
+        {},//flags
+        depthTest ? VK_TRUE : VK_FALSE,//depthTestEnable
+        VK_FALSE,//depthWriteEnable
+        vk::CompareOp::eLess,//depthCompareOp
+        VK_FALSE,//depthBoundsTestEnable
+        VK_FALSE//stencilTestEnable
+    );
+    vk::PipelineColorBlendStateCreateInfo colorBlending({}, VK_FALSE, vk::LogicOp::eCopy, blendAttachments);
+
+    std::vector<vk::DynamicState> dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor
+    };
+    vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates);
+
+    // 合成はシーンの描画（深度を含む）の中で行うため、深度の形式は常に指定する
+    vk::PipelineRenderingCreateInfo renderingCreateInfo(
+        0,//viewMask
+        colorFormats.size(),//colorAttachmentCount
+        colorFormats.data(),//pColorAttachmentFormats
+        DepthPyramidWrapper::kDepthFormat,//depthAttachmentFormat
+        vk::Format::eUndefined//stencilAttachmentFormat
+    );
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo(
+        {},//flags
+        shaderStages.size(),//stageCount
+        shaderStages.data(),//pStages
+        &vertexInput,//pVertexInputState
+        &inputAssembly,//pInputAssemblyState
+        nullptr,//pTessellationState
+        &viewportState,//pViewportState
+        &rasterizer,//pRasterizationState
+        &multisampling,//pMultisampleState
+        &depthStencil,//pDepthStencilState
+        &colorBlending,//pColorBlendState
+        &dynamicState,//pDynamicState
+        pipelineLayout.get()//layout
+    );
+    pipelineCreateInfo.setPNext(&renderingCreateInfo);
+    return deviceWrapper.device->createGraphicsPipelineUnique(VK_NULL_HANDLE, pipelineCreateInfo).value;
+}
+
+//ソート: 奥から手前へ並べ、同じジオメトリが続く範囲だけを1回の描画にまとめる
+//OIT: 順序は問わないため、ジオメトリごとに数えてから詰める（ソートしない）
+//インスタンスの番号はそのまま描画レコードの番号
+void VulkanContext::DeviceWrapper::TransparencyWrapper::update(const render::DrawList& drawList) {
+    frameStatistics = TransparencyStatistics{};
+    batches.clear();
+    instanceCount = 0;
+    transparencyZone = UINT32_MAX;
+    active = ready;
+    orderIndependentFrame = orderIndependent;
+    if (!active) {
+        return;
+    }
+    PROFILE_ZONE("transparency.update");
+    auto start = std::chrono::steady_clock::now();
+    uint32_t* drawInstances = static_cast<uint32_t*>(drawInstanceBuffer.mapped);
+
+    // 描画リストの半透明のキーは奥から手前の順に並ぶ（不透明のキーを含む場合はその前に並ぶ）
+    const std::vector<render::DrawKey>& keys = drawList.getKeys();
+    auto transparentBegin = std::partition_point(keys.begin(), keys.end(), [](const render::DrawKey& key) { return !render::isTransparentSortKey(key.key); });
+
+    if (orderIndependentFrame) {
+        for (auto it = transparentBegin; it != keys.end(); ++it) {
+            const Surface& surface = surfaces[it->drawIndex];
+            if (!surface.enabled) {
+                continue;
+            }
+            uint32_t& batchIndex = geometryBatch[surface.geometryIndex];
+            if (batchIndex == UINT32_MAX) {
+                batchIndex = static_cast<uint32_t>(batches.size());
+                batches.push_back({surface.geometryIndex, surface.indexCount, 0, 0});
+            }
+            batches[batchIndex].instanceCount++;
+        }
+        for (Batch& batch : batches) {
+            batch.firstInstance = instanceCount;
+            instanceCount += batch.instanceCount;
+            batch.instanceCount = 0;
+        }
+        for (auto it = transparentBegin; it != keys.end(); ++it) {
+            const Surface& surface = surfaces[it->drawIndex];
+            if (!surface.enabled) {
+                continue;
+            }
+            Batch& batch = batches[geometryBatch[surface.geometryIndex]];
+            drawInstances[batch.firstInstance + batch.instanceCount++] = it->drawIndex;
+        }
+        for (const Batch& batch : batches) {
+            geometryBatch[batch.geometryIndex] = UINT32_MAX;
+        }
+    } else {
+        // 並び順はそのまま使い、同じジオメトリが続く範囲を1回の描画にまとめる
+        for (auto it = transparentBegin; it != keys.end(); ++it) {
+            const Surface& surface = surfaces[it->drawIndex];
+            if (!surface.enabled) {
+                continue;
+            }
+            if (batches.empty() || batches.back().geometryIndex != surface.geometryIndex) {
+                batches.push_back({surface.geometryIndex, surface.indexCount, instanceCount, 0});
+            }
+            batches.back().instanceCount++;
+            drawInstances[instanceCount++] = it->drawIndex;
+        }
+    }
+
+    frameStatistics.instances = instanceCount;
+    frameStatistics.cpuMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void VulkanContext::DeviceWrapper::TransparencyWrapper::record(vk::CommandBuffer commandBuffer, const vk::RenderingInfo& renderingInfo) {
+    if (!active || batches.empty()) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    transparencyZone = deviceWrapper.gpuProfilerWrapper.beginZone(commandBuffer, "graphics queue", "transparency");
+    vk::Extent2D extent = renderingInfo.renderArea.extent;
+
+    if (!orderIndependentFrame) {
+        drawBatches(commandBuffer, sortedPipeline.get(), extent);
+    } else {
+        commandBuffer.endRendering();
+        // リサイズ後は蓄積先を作り直す（前のフレームは完了済み）
+        vk::Extent2D swapchainExtent = deviceWrapper.swapchainWrapper.swapchainExtent;
+        if (accumulationImage.extent != swapchainExtent) {
+            createTargets(swapchainExtent);
+        }
+
+        // 不透明の深度の書き込みを、蓄積の深度テストより前に終える
+        std::array<vk::ImageMemoryBarrier, 2> toAttachment = {
+            colorBarrier(accumulationImage.image.get(), vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal, {}, vk::AccessFlagBits::eColorAttachmentWrite),
+            colorBarrier(revealageImage.image.get(), vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal, {}, vk::AccessFlagBits::eColorAttachmentWrite)
+        };
+        vk::MemoryBarrier depthBarrier(vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eDepthStencilAttachmentRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eLateFragmentTests,
+                                      vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+                                      {}, depthBarrier, {}, toAttachment);
+
+        std::array<vk::RenderingAttachmentInfo, 2> targets = {
+            vk::RenderingAttachmentInfo(
+                accumulationImage.view.get(),//imageView
+                vk::ImageLayout::eColorAttachmentOptimal,//imageLayout
+                vk::ResolveModeFlagBits::eNone,//resolveMode
+                {},//resolveImageView
+                vk::ImageLayout::eUndefined,//resolveImageLayout
+                vk::AttachmentLoadOp::eClear,//loadOp
+                vk::AttachmentStoreOp::eStore,//storeOp
+                vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f})//clearValue
+            ),
+            vk::RenderingAttachmentInfo(
+                revealageImage.view.get(),//imageView
+                vk::ImageLayout::eColorAttachmentOptimal,//imageLayout
+                vk::ResolveModeFlagBits::eNone,//resolveMode
+                {},//resolveImageView
+                vk::ImageLayout::eUndefined,//resolveImageLayout
+                vk::AttachmentLoadOp::eClear,//loadOp
+                vk::AttachmentStoreOp::eStore,//storeOp
+                vk::ClearColorValue(std::array<float, 4>{1.0f, 0.0f, 0.0f, 0.0f})//clearValue（何も描かなければすべて透過）
+            )
+        };
+        vk::RenderingAttachmentInfo depthAttachment = *renderingInfo.pDepthAttachment;
+        depthAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+        vk::RenderingInfo accumulationInfo(
+            {},//flags
+            renderingInfo.renderArea,//renderArea
+            1,//layerCount
+            0,//viewMask
+            targets.size(),//colorAttachmentCount
+            targets.data(),//pColorAttachments
+            &depthAttachment,//pDepthAttachment
+            nullptr//pStencilAttachment
+        );
+        commandBuffer.beginRendering(accumulationInfo);
+        drawBatches(commandBuffer, accumulatePipeline.get(), extent);
+        commandBuffer.endRendering();
+
+        // 蓄積を合成で読み、シーンの色へ重ねる
+        std::array<vk::ImageMemoryBarrier, 2> toShaderRead = {
+            colorBarrier(accumulationImage.image.get(), vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                         vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead),
+            colorBarrier(revealageImage.image.get(), vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                         vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead)
+        };
+        vk::MemoryBarrier sceneColorBarrier(vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                      vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader,
+                                      {}, sceneColorBarrier, {}, toShaderRead);
+
+        commandBuffer.beginRendering(renderingInfo);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, resolvePipeline.get());
+        commandBuffer.draw(3, 1, 0, 0);
+        frameStatistics.draws++;
+    }
+
+    deviceWrapper.gpuProfilerWrapper.endZone(commandBuffer, transparencyZone);
+    frameStatistics.cpuMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//ディスクリプタとビューポートを設定してまとめた描画を行う（常駐していないジオメトリは描かない）
+void VulkanContext::DeviceWrapper::TransparencyWrapper::drawBatches(vk::CommandBuffer commandBuffer, vk::Pipeline pipeline, vk::Extent2D extent) {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, deviceWrapper.meshletCullWrapper.getDescriptorSet(), {});
+    std::array<uint32_t, 2> dynamicOffsets = {deviceWrapper.frameRingWrapper.getCameraOffset(), 0};
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 1, deviceWrapper.frameRingWrapper.getDescriptorSet(), dynamicOffsets);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 2, descriptorSet, {});
+    commandBuffer.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f));
+    commandBuffer.setScissor(0, vk::Rect2D({0, 0}, extent));
+    deviceWrapper.geometryBufferWrapper.bind(commandBuffer);
+
+    GeometryBufferWrapper& geometryBuffer = deviceWrapper.geometryBufferWrapper;
+    for (const Batch& batch : batches) {
+        const GeometryBufferWrapper::Placement& placement = geometryBuffer.getPlacement(batch.geometryIndex);
+        if (!placement.resident) {
+            continue;
+        }
+        commandBuffer.drawIndexed(batch.indexCount, batch.instanceCount, placement.firstIndex, placement.vertexOffset, batch.firstInstance);
+        frameStatistics.draws++;
+    }
+}
+
+//フレーム完了後に呼ぶ（waitForFrameでフェンスの待機が済んでいる前提）
+void VulkanContext::DeviceWrapper::TransparencyWrapper::collectStatistics() {
+    if (!active) {
+        return;
+    }
+    TransparencyStatistics& current = statistics[orderIndependentFrame ? 1 : 0];
+    current.frames++;
+    current.instances += frameStatistics.instances;
+    current.draws += frameStatistics.draws;
+    current.cpuMilliseconds += frameStatistics.cpuMilliseconds;
+
+    // GPU時間はプロファイラのゾーンから読む（タイムスタンプの有効ビットでマスク済み）
+    double milliseconds = 0.0;
+    if (deviceWrapper.gpuProfilerWrapper.getZoneMilliseconds(transparencyZone, milliseconds)) {
+        current.gpuMilliseconds += milliseconds;
+    }
+
+    // 一定フレームごとに平均を出力
+    if (++frameCounter % 120 != 0 || !deviceWrapper.context.statisticsOutput) {
+        return;
+    }
+    for (int mode = 0; mode < 2; mode++) {
+        const TransparencyStatistics& s = statistics[mode];
+        if (s.frames == 0) {
+            continue;
+        }
+        double frames = static_cast<double>(s.frames);
+        std::cout << "半透明[" << (mode == 1 ? "重み付きOIT" : "ソート") << "]: "
+                  << "インスタンス " << s.instances / frames << " 件/フレーム, "
+                  << "描画 " << s.draws / frames << " 回/フレーム, "
+                  << "CPU " << s.cpuMilliseconds / frames << " ms, "
+                  << "GPU " << s.gpuMilliseconds / frames << " ms" << std::endl;
+    }
+}
+
+void VulkanContext::DeviceWrapper::TransparencyWrapper::resetStatistics() {
+    for (TransparencyStatistics& s : statistics) {
+        s = TransparencyStatistics{};
+    }
+}
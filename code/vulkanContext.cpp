@@ -1,106 +1,660 @@
-#include "vulkanContext.hpp"
-
-void VulkanContext::initWindow(uint32_t wInput, uint32_t hInput) {
-    width = wInput;
-    height = hInput;
-
-    if (!glfwInit()) {
-        throw std::runtime_error("GLFWの初期化に失敗しました");
-    }
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-    window = glfwCreateWindow(width, height, "Vulkan", nullptr, nullptr);
-    if (!window) {
-        throw std::runtime_error("ウィンドウの作成に失敗しました");
-    }
-}
-
-void VulkanContext::initVulkan() {
-    // インスタンスの初期化
-
-    vk::ApplicationInfo appInfo{};
-    appInfo.pApplicationName = "Vulkan Application";
-    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.pEngineName = "No Engine";
-    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_3;
-
-    auto requiredLayers = { "VK_LAYER_KHRONOS_validation" };
-    uint32_t instanceExtensionCount = 0;
-    const char** requiredExtensions = glfwGetRequiredInstanceExtensions(&instanceExtensionCount);
-    vk::InstanceCreateInfo instCreateInfo(
-        {},
-        &appInfo,
-        requiredLayers.size(),
-        requiredLayers.begin() ,
-        instanceExtensionCount,
-        requiredExtensions
-    );
-
-    instance = vk::createInstanceUnique(instCreateInfo);
-    // 物理デバイスの初期化
-    deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
-    deviceFeatures.geometryShader = VK_TRUE;
-
-    // 物理デバイスの選択
-    physicalDevice = pickPhysicalDevice(deviceExtensions, deviceFeatures);
-
-    // サーフェスの作成
-    createSurface();
-    
-    // デバイスの初期化
-    deviceWrapper = DeviceWrapper{*this};
-    deviceWrapper.initDevice();
-}
-
-void VulkanContext::cleanup() {
-    glfwDestroyWindow(window);
-    glfwTerminate();
-}
-
-//物理デバイスの選択
-vk::PhysicalDevice VulkanContext::pickPhysicalDevice(const std::vector<const char*>& deviceExtensions, vk::PhysicalDeviceFeatures deviceFeatures) {
-    for (const auto& device : instance->enumeratePhysicalDevices()) {
-        if(checkDeviceExtensionSupport(device, deviceExtensions) && checkDeviceFeatures(device, deviceFeatures)) {
-            return device;
-        }
-    }
-    throw std::runtime_error("適切な物理デバイスが見つかりませんでした");
-}
-
-//物理デバイスのextensionをチェック
-bool VulkanContext::checkDeviceExtensionSupport(vk::PhysicalDevice device,  const std::vector<const char*>& deviceExtensions) {
-    std::set<std::string> requiredExtensions{deviceExtensions.begin(),
-                                             deviceExtensions.end()};
-    for (const auto& extension : device.enumerateDeviceExtensionProperties()) {
-        requiredExtensions.erase(extension.extensionName);
-    }
-    return requiredExtensions.empty();
-}
-
-//物理デバイスのfeaturesをチェック
-bool VulkanContext::checkDeviceFeatures(vk::PhysicalDevice device, vk::PhysicalDeviceFeatures requiredFeatures) {
-    vk::PhysicalDeviceFeatures deviceFeatures = device.getFeatures();
-    if(!deviceFeatures.robustBufferAccess && requiredFeatures.robustBufferAccess) {
-        return false;
-    }
-    else if(!deviceFeatures.geometryShader && requiredFeatures.geometryShader) {
-        return false;
-    }
-    return true;
-}
-
-//サーフェスの作成
-void VulkanContext::createSurface() {
-    auto result = glfwCreateWindowSurface(instance.get(), window, nullptr, &c_surface);
-    if (result != VK_SUCCESS) {
-        const char* err;
-        glfwGetError(&err);
-        std::cout << err << std::endl;
-        glfwTerminate();
-        throw std::runtime_error("サーフェスの作成に失敗しました");
-    }
-    surface = vk::UniqueSurfaceKHR{c_surface, instance.get()};
+#include "vulkanContext.hpp"
+#include "geometry.hpp"
+#include "allocationCounter.hpp"
+#include "jobSystem.hpp"
+
+void VulkanContext::initWindow(uint32_t wInput, uint32_t hInput) {
+    width = wInput;
+    height = hInput;
+
+    if (!glfwInit()) {
+        throw std::runtime_error("GLFWの初期化に失敗しました");
+    }
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    window = glfwCreateWindow(width, height, "Vulkan", nullptr, nullptr);
+    if (!window) {
+        throw std::runtime_error("ウィンドウの作成に失敗しました");
+    }
+
+    // リサイズはスワップチェインの再作成で反映する
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    cachedFramebufferWidth = framebufferWidth;
+    cachedFramebufferHeight = framebufferHeight;
+    glfwSetWindowUserPointer(window, this);
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int framebufferWidth, int framebufferHeight) {
+        VulkanContext* context = static_cast<VulkanContext*>(glfwGetWindowUserPointer(window));
+        context->cachedFramebufferWidth = framebufferWidth;
+        context->cachedFramebufferHeight = framebufferHeight;
+        context->framebufferResized = true;
+    });
+}
+
+void VulkanContext::initHeadless(uint32_t wInput, uint32_t hInput) {
+    width = wInput;
+    height = hInput;
+    headless = true;
+}
+
+void VulkanContext::getFramebufferSize(int& framebufferWidth, int& framebufferHeight) {
+    if (headless) {
+        framebufferWidth = static_cast<int>(width);
+        framebufferHeight = static_cast<int>(height);
+    } else {
+        framebufferWidth = cachedFramebufferWidth.load();
+        framebufferHeight = cachedFramebufferHeight.load();
+    }
+}
+
+void VulkanContext::initVulkan() {
+    PROFILE_ZONE("initVulkan");
+    // インスタンスの初期化
+
+    vk::ApplicationInfo appInfo{};
+    appInfo.pApplicationName = "Vulkan Application";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+
+    // 検証レイヤー（リリースビルドでは既定で無効。VKRENDERKIT_VALIDATIONで切り替える）
+    std::vector<const char*> layers;
+    if (validationProfile != render::ValidationProfile::Off) {
+        bool layerFound = false;
+        for (const auto& layer : vk::enumerateInstanceLayerProperties()) {
+            layerFound = layerFound || std::string(layer.layerName.data()) == "VK_LAYER_KHRONOS_validation";
+        }
+        if (layerFound) {
+            layers.push_back("VK_LAYER_KHRONOS_validation");
+        } else {
+            std::cout << "検証レイヤーが見つからないため無効にします" << std::endl;
+            validationProfile = render::ValidationProfile::Off;
+        }
+    }
+
+    uint32_t instanceExtensionCount = 0;
+    const char** glfwExtensions = headless ? nullptr : glfwGetRequiredInstanceExtensions(&instanceExtensionCount);
+    std::vector<const char*> requiredExtensions(glfwExtensions, glfwExtensions + instanceExtensionCount);
+    if (headless) {
+        requiredExtensions = {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+    }
+    if (validationProfile != render::ValidationProfile::Off) {
+        requiredExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+    vk::InstanceCreateInfo instCreateInfo(
+        {},
+        &appInfo,
+        static_cast<uint32_t>(layers.size()),
+        layers.data(),
+        static_cast<uint32_t>(requiredExtensions.size()),
+        requiredExtensions.data()
+    );
+
+    // 同期の検証はレイヤーの設定で有効にする
+    vk::ValidationFeatureEnableEXT synchronizationValidation = vk::ValidationFeatureEnableEXT::eSynchronizationValidation;
+    vk::ValidationFeaturesEXT validationFeatures{};
+    validationFeatures.enabledValidationFeatureCount = 1;
+    validationFeatures.pEnabledValidationFeatures = &synchronizationValidation;
+    if (validationProfile == render::ValidationProfile::Synchronization) {
+        instCreateInfo.pNext = &validationFeatures;
+    }
+
+    {
+        PROFILE_ZONE("createInstance");
+        instance = vk::createInstanceUnique(instCreateInfo);
+    }
+    instanceLoader = vk::DispatchLoaderDynamic(instance.get(), vkGetInstanceProcAddr);
+    if (validationProfile != render::ValidationProfile::Off) {
+        createDebugMessenger();
+    }
+    std::cout << "検証レイヤー: " << render::validationProfileName(validationProfile) << std::endl;
+
+    // サーフェスの作成（表示できるデバイスだけを候補にするため、デバイスの選択より前に作る）
+    createSurface();
+
+    // 物理デバイスの選択
+    deviceExtensions = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    };
+    physicalDevice = pickPhysicalDevice(deviceExtensions);
+
+    // 使える高速パスを調べて有効にする
+    capabilities = render::probeDeviceCapabilities(physicalDevice);
+    render::appendCapabilityExtensions(capabilities, deviceExtensions);
+    render::printCapabilityReport(std::cout, capabilities);
+
+    // デバイスの初期化
+    deviceWrapper = DeviceWrapper{*this};
+    deviceWrapper.initDevice();
+}
+
+void VulkanContext::loadModels(const std::vector<geometry::Model*>& models, uint32_t spinningModel) {
+    PROFILE_ZONE("loadModels");
+    // 実行中のフレームが読んでいるバッファを作り直すため、完了を待つ
+    deviceWrapper.waitForFrame();
+    // 読み込み中のジオメトリがWorldを参照しているため先に止める
+    residency.clear();
+    world.clear();
+    for (geometry::Model* model : models) {
+        world.addModel(*model);
+    }
+    uint64_t budget = queryResidencyBudget();
+    DeviceWrapper::GeometryBufferWrapper& geometryBuffer = deviceWrapper.geometryBufferWrapper;
+    geometryBuffer.upload(world, budget);
+    deviceWrapper.shadowMapWrapper.initShadowMaps();
+    deviceWrapper.meshletCullWrapper.initMeshletCull(world);
+
+    for (uint32_t i = 0; i < world.getGeometries().size(); i++) {
+        residency.addAsset(render::AssetKind::Mesh, geometryBuffer.getGeometryBytes(i), geometryBuffer.getPlacement(i).resident);
+    }
+    residency.setBudget(std::min<uint64_t>(budget, geometryBuffer.getPoolCapacity()));
+    residency.setLoader([this](uint32_t asset, std::vector<uint8_t>& data) {
+        DeviceWrapper::GeometryBufferWrapper::readGeometry(world, asset, data);
+    });
+    residency.resetStatistics();
+    residencyBudgetFrames = 0;
+    residencyFrameTime = std::chrono::steady_clock::now();
+
+    drawRecords.clear();
+    spinningNodes.clear();
+    spinningRecords.clear();
+    uint32_t materialBase = 0;
+    uint32_t transformIndex = 0;
+    for (uint32_t m = 0; m < models.size(); m++) {
+        const geometry::Model& model = *models[m];
+        uint32_t recordIndex = static_cast<uint32_t>(drawRecords.size());
+        materialBase = render::collectDrawRecords(model, glm::mat4(1.0f), materialBase, drawRecords);
+
+        // トランスフォームの表はメッシュを持つノードごと、描画レコードはそのプリミティブごとに同じ順で並ぶ
+        for (const auto& node : model.nodes) {
+            auto it = model.gltfToMesh.find(node.meshIndex);
+            if (it == model.gltfToMesh.end()) {
+                continue;
+            }
+            if (m == spinningModel) {
+                for (size_t p = 0; p < model.meshes[it->second].primitives.size(); p++) {
+                    spinningRecords.push_back({recordIndex + static_cast<uint32_t>(p), static_cast<uint32_t>(spinningNodes.size())});
+                }
+                spinningNodes.push_back({transformIndex, node.globalMatrix});
+            }
+            recordIndex += static_cast<uint32_t>(model.meshes[it->second].primitives.size());
+            transformIndex++;
+        }
+    }
+
+    std::vector<geometry::Aabb> recordBounds(drawRecords.size());
+    for (size_t i = 0; i < drawRecords.size(); i++) {
+        const geometry::Primitive& primitive = *drawRecords[i].primitive;
+        recordBounds[i] = geometry::Aabb::transform(primitive.boundsMin, primitive.boundsMax, drawRecords[i].worldMatrix);
+    }
+    // 回すモデルはBVHを組み直さずに済むよう、Y軸まわりに一周する分だけ範囲を広げておく
+    for (const auto& [record, node] : spinningRecords) {
+        geometry::Aabb& bounds = recordBounds[record];
+        float radius = 0.0f;
+        for (float x : {bounds.min.x, bounds.max.x}) {
+            for (float z : {bounds.min.z, bounds.max.z}) {
+                radius = std::max(radius, glm::length(glm::vec2(x, z)));
+            }
+        }
+        bounds.min = glm::vec3(-radius, bounds.min.y, -radius);
+        bounds.max = glm::vec3(radius, bounds.max.y, radius);
+    }
+    {
+        PROFILE_ZONE("sceneBvh.build");
+        sceneBvh.build(recordBounds);
+    }
+
+    // 影の投影元はレコードと同じ番号（BVHの検索結果をそのまま使う）
+    // スキニング・モーフターゲットを持つものは形が変わるため、キャッシュするページには描かない
+    std::vector<DeviceWrapper::ShadowMapWrapper::Caster> casters(drawRecords.size());
+    geometry::Aabb casterBounds;
+    for (size_t i = 0; i < drawRecords.size(); i++) {
+        const geometry::Primitive& primitive = *drawRecords[i].primitive;
+        DeviceWrapper::ShadowMapWrapper::Caster& caster = casters[i];
+        caster.worldMatrix = drawRecords[i].worldMatrix;
+        caster.geometryIndex = primitive.geometryIndex;
+        caster.indexCount = world.getGeometries()[primitive.geometryIndex].indexCount;
+        caster.dynamic = !primitive.morphTargets.empty() || primitive.attributes.hasJoints;
+        caster.enabled = primitive.topology == vk::PrimitiveTopology::eTriangleList;
+        casterBounds.grow(recordBounds[i]);
+    }
+    deviceWrapper.shadowMapWrapper.setCasters(std::move(casters), casterBounds);
+
+    // 半透明の面（メッシュレットの描画には含まれない。インスタンスの番号はレコードと同じ）
+    std::vector<DeviceWrapper::TransparencyWrapper::Surface> surfaces(drawRecords.size());
+    for (size_t i = 0; i < drawRecords.size(); i++) {
+        const geometry::Primitive& primitive = *drawRecords[i].primitive;
+        DeviceWrapper::TransparencyWrapper::Surface& surface = surfaces[i];
+        surface.geometryIndex = primitive.geometryIndex;
+        surface.indexCount = world.getGeometries()[primitive.geometryIndex].indexCount;
+        surface.enabled = primitive.isTransparent && primitive.topology == vk::PrimitiveTopology::eTriangleList;
+    }
+    deviceWrapper.transparencyWrapper.initTransparency(std::move(surfaces));
+
+    // KHR_lights_punctualのライト（ノードの変換はレコードと同じく読み込み時に固定する）
+    std::vector<render::SceneLight> lights;
+    for (const geometry::Model* model : models) {
+        render::collectLights(*model, glm::mat4(1.0f), lights);
+    }
+    deviceWrapper.lightClusterWrapper.setLights(lights);
+    frameSnapshot.visibleRecords.reserve(drawRecords.size());
+}
+
+void VulkanContext::spinModel(float angle, render::SceneSnapshot& snapshot) const {
+    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+    snapshot.transforms.clear();
+    for (const auto& [transformIndex, nodeMatrix] : spinningNodes) {
+        snapshot.transforms.push_back({transformIndex, rotation * nodeMatrix});
+    }
+}
+
+bool VulkanContext::getCursorPosition(glm::vec2& cursor) {
+    if (window == nullptr) {
+        return false;
+    }
+    double cursorX, cursorY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    int windowWidth, windowHeight;
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    if (windowWidth == 0 || windowHeight == 0) {
+        return false;
+    }
+    cursor = glm::vec2(static_cast<float>(cursorX) / windowWidth, static_cast<float>(cursorY) / windowHeight);
+    return true;
+}
+
+uint32_t VulkanContext::pickDrawRecord(float& distance) {
+    glm::vec2 cursor;
+    if (!getCursorPosition(cursor)) {
+        return UINT32_MAX;
+    }
+    return pickDrawRecord(cursor, projectionMatrix * viewMatrix, distance);
+}
+
+uint32_t VulkanContext::pickDrawRecord(const glm::vec2& cursor, const glm::mat4& viewProjection, float& distance) const {
+    geometry::Ray ray = geometry::Ray::fromScreen(cursor, glm::vec2(1.0f), viewProjection);
+
+    // AABBに当たったレコードはローカル空間の三角形で詳細判定する（方向は正規化しないのでtはワールドと共通）
+    return sceneBvh.raycast(ray, distance, [&](uint32_t index, float& t) {
+        const render::DrawRecord& record = drawRecords[index];
+        const geometry::Primitive& primitive = *record.primitive;
+        if (primitive.topology != vk::PrimitiveTopology::eTriangleList) {
+            float tNear;
+            if (!geometry::intersectRayAabb(ray, 1.0f / ray.direction, sceneBvh.getInstanceBounds(index), t, tNear)) {
+                return false;
+            }
+            t = tNear;
+            return true;
+        }
+
+        glm::mat4 inverseWorld = glm::inverse(record.worldMatrix);
+        geometry::Ray localRay{glm::vec3(inverseWorld * glm::vec4(ray.origin, 1.0f)), glm::vec3(inverseWorld * glm::vec4(ray.direction, 0.0f))};
+        bool hit = false;
+        for (size_t i = 0; i + 2 < primitive.indices.size(); i += 3) {
+            float triangleT;
+            if (geometry::intersectRayTriangle(localRay,
+                    primitive.vertices[primitive.indices[i]].position,
+                    primitive.vertices[primitive.indices[i + 1]].position,
+                    primitive.vertices[primitive.indices[i + 2]].position, triangleT) && triangleT < t) {
+                t = triangleT;
+                hit = true;
+            }
+        }
+        return hit;
+    });
+}
+
+std::vector<double> VulkanContext::measureObjectUpload(uint32_t objectCount, uint32_t iterations) {
+    using ObjectConstants = DeviceWrapper::FrameRingWrapper::ObjectConstants;
+    DeviceWrapper::FrameRingWrapper& frameRing = deviceWrapper.frameRingWrapper;
+    std::vector<double> samples;
+    if (objectCount * sizeof(ObjectConstants) > frameRing.getPartitionSize()) {
+        return samples;
+    }
+    // 書き込む領域を実行中のフレームが読んでいないように完了を待つ
+    deviceWrapper.waitForFrame();
+
+    std::vector<ObjectConstants> objects(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        objects[i].world = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i % 256), 0.0f, static_cast<float>(i / 256)));
+    }
+
+    // 書き込みはmemcpyのみで、ディスクリプタの更新は発生しない
+    for (uint32_t i = 0; i < iterations; i++) {
+        frameRing.beginFrame(frameNumber);
+        auto start = std::chrono::steady_clock::now();
+        frameRing.writeObjects(objects.data(), objects.size());
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    frameRing.beginFrame(frameNumber);
+    return samples;
+}
+
+void VulkanContext::pollEvents() {
+    {
+        PROFILE_ZONE("waitForNextFrame");
+        framePacer.waitForNextFrame();
+    }
+    // 空きイメージの待ちは入力の取得より前に済ませる
+    deviceWrapper.acquireFrame();
+    if (window != nullptr) {
+        PROFILE_ZONE("pollEvents");
+        glfwPollEvents();
+    }
+    // 他のスレッドから依頼されたGLFWなどの処理
+    render::JobSystem::instance().pumpMainThread();
+    framePacer.markInputSampled();
+}
+
+void VulkanContext::waitEvents(double timeoutSeconds) {
+    if (window != nullptr) {
+        PROFILE_ZONE("waitEvents");
+        glfwWaitEventsTimeout(timeoutSeconds);
+    }
+    render::JobSystem::instance().pumpMainThread();
+}
+
+void VulkanContext::waitForNextFrame() {
+    {
+        PROFILE_ZONE("waitForNextFrame");
+        framePacer.waitForNextFrame();
+    }
+    deviceWrapper.acquireFrame();
+    framePacer.markInputSampled();
+}
+
+void VulkanContext::setPresentPolicy(render::PresentPolicy policy) {
+    deviceWrapper.swapchainWrapper.setPresentPolicy(policy);
+    framePacer.reset();
+}
+
+void VulkanContext::draw() {
+    PROFILE_ZONE("frame");
+    // 同じスロットを使った前回のフレームは、直前のフレームの記録前にフェンスで完了を待っているため再利用できる
+    frameArena.beginFrame(frameNumber++);
+    uint64_t allocationsBefore = render::getAllocationCount();
+
+    frameSnapshot.viewMatrix = viewMatrix;
+    frameSnapshot.projectionMatrix = projectionMatrix;
+    frameSnapshot.cameraPosition = cameraPosition;
+    buildSnapshot(frameSnapshot, frameArena.getThreadResource());
+    renderFrame(frameSnapshot, allocationsBefore);
+}
+
+void VulkanContext::draw(const render::SceneSnapshot& snapshot) {
+    PROFILE_ZONE("frame");
+    frameArena.beginFrame(frameNumber++);
+    uint64_t allocationsBefore = render::getAllocationCount();
+
+    setCamera(snapshot.viewMatrix, snapshot.projectionMatrix, snapshot.cameraPosition);
+    renderFrame(snapshot, allocationsBefore);
+}
+
+void VulkanContext::buildSnapshot(render::SceneSnapshot& snapshot, std::pmr::memory_resource* resource) const {
+    // BVHで視錐台内のレコードを選び、そのうち半透明のものだけを描画リストに積む
+    // 不透明の並び順はメッシュレットの間接描画では使われないため、ソートはbenchのdrawList/*でのみ行う
+    {
+        PROFILE_ZONE("frustumCull");
+        snapshot.visibleRecords.clear();
+        sceneBvh.queryFrustum(geometry::Frustum::fromMatrix(snapshot.projectionMatrix * snapshot.viewMatrix), snapshot.visibleRecords);
+    }
+    {
+        PROFILE_ZONE("drawList.build");
+        snapshot.drawList.buildTransparent(drawRecords, snapshot.visibleRecords, snapshot.viewMatrix);
+    }
+    snapshot.drawList.sort(0, resource);
+}
+
+void VulkanContext::renderFrame(const render::SceneSnapshot& snapshot, uint64_t allocationsBefore) {
+    // 常駐管理と半透明の更新はGPUが読むバッファを書き換えるため、前のフレームの完了を先に待つ
+    deviceWrapper.waitForFrame();
+    const render::DrawList& drawList = snapshot.drawList;
+    visibleRecordTotal += snapshot.visibleRecords.size();
+    drawSortMilliseconds += drawList.getSortMilliseconds();
+    updateResidency(snapshot.visibleRecords);
+    deviceWrapper.transparencyWrapper.update(drawList);
+
+    // 回すモデルの変換（値が変わった要素だけが次の転送でシーンの表へ書き込まれる）
+    if (snapshot.transforms.size() == spinningNodes.size()) {
+        for (const auto& [transformIndex, matrix] : snapshot.transforms) {
+            deviceWrapper.meshletCullWrapper.setTransform(transformIndex, matrix);
+        }
+        for (const auto& [record, node] : spinningRecords) {
+            deviceWrapper.shadowMapWrapper.setCasterMatrix(record, snapshot.transforms[node].second);
+        }
+    }
+
+    deviceWrapper.draw();
+    frameRingBytes += deviceWrapper.frameRingWrapper.getFrameBytes();
+    sceneUploads.add(deviceWrapper.meshletCullWrapper.getUploadStatistics());
+
+    // 下の統計出力による確保は数えない
+    size_t arenaIndex = frameArena.isEnabled() ? 1 : 0;
+    frameAllocations[arenaIndex] += render::getAllocationCount() - allocationsBefore;
+    frameAllocationFrames[arenaIndex]++;
+
+    if (++drawSortFrames == 120 && statisticsOutput) {
+        render::DrawListStatistics stats = drawList.computeStatistics();
+        std::cout << "描画リスト: 半透明 " << stats.transparentDraws << " 件 (不透明 " << snapshot.visibleRecords.size() - stats.transparentDraws << " 件はメッシュレットで描画), "
+                  << "パイプライン切替 " << stats.pipelineChanges << " 回, マテリアル切替 " << stats.materialChanges << " 回, "
+                  << "ソート " << drawSortMilliseconds / drawSortFrames << " ms, "
+                  << "視錐台内 " << visibleRecordTotal / drawSortFrames << " / " << drawRecords.size() << " 件" << std::endl;
+        std::cout << "リングバッファ: " << frameRingBytes / 120 << " バイト/フレーム" << std::endl;
+        std::cout << "シーンの表: " << sceneUploads.bytes / 120 << " バイト/フレーム, "
+                  << "変更 " << sceneUploads.entries / 120.0 << " 件/フレーム, 範囲 " << sceneUploads.ranges / 120.0 << " 個/フレーム" << std::endl;
+        if (residency.getAssetCount() > 0) {
+            const render::ResidencyStatistics& residencyStats = residency.getStatistics();
+            std::cout << "常駐: ヒット率 " << residencyStats.hitRate() * 100.0 << " %, "
+                      << "退避 " << residencyStats.evictionsPerSecond() << " 回/秒, "
+                      << "読み込み " << residencyStats.streamIns << " 件（待ち " << residency.getPendingLoadCount() << " 件）, "
+                      << "使用量 " << (residency.getResidentBytes() >> 10) << " / 予算 " << (residency.getBudget() >> 10) << " KiB, "
+                      << "最大 " << (residencyStats.peakResidentBytes >> 10) << " KiB" << std::endl;
+        }
+        if (render::isAllocationCountingEnabled()) {
+            for (size_t i = 0; i < 2; i++) {
+                if (frameAllocationFrames[i] == 0) {
+                    continue;
+                }
+                std::cout << "フレームあたりのoperator new (アリーナ" << (i ? "有効" : "無効") << "): "
+                          << static_cast<double>(frameAllocations[i]) / frameAllocationFrames[i] << " 回" << std::endl;
+            }
+            std::cout << "  アリーナ使用量: " << frameArena.getUsedBytes() << " バイト" << std::endl;
+        }
+    }
+    if (drawSortFrames == 120) {
+        drawSortMilliseconds = 0.0;
+        drawSortFrames = 0;
+        frameRingBytes = 0;
+        sceneUploads = render::SceneUploadStatistics{};
+        visibleRecordTotal = 0;
+    }
+
+    double latency = framePacer.markPresented();
+    LatencyStatistics& stats = latencyStatistics[static_cast<size_t>(getPresentPolicy())][framePacer.isEnabled() ? 1 : 0];
+    stats.frames++;
+    stats.totalMilliseconds += latency;
+    stats.maxMilliseconds = std::max(stats.maxMilliseconds, latency);
+    if (++latencyFrameCounter == 120) {
+        if (statisticsOutput) {
+            reportLatency();
+        }
+        latencyFrameCounter = 0;
+    }
+}
+
+// 常駐管理の予算
+// VK_EXT_memory_budgetがあれば、プールを置くヒープの予算から他の確保（他のプロセスを含む）を除いた量の9割
+// 無ければヒープサイズの半分とする
+uint64_t VulkanContext::queryResidencyBudget() {
+    if (residencyBudgetOverride != 0) {
+        return residencyBudgetOverride;
+    }
+    if (const char* value = std::getenv("VKRENDERKIT_RESIDENCY_BUDGET_MB")) {
+        return std::stoull(value) << 20;
+    }
+
+    uint32_t heapIndex = deviceWrapper.geometryBufferWrapper.getHeapIndex();
+    if (capabilities.memoryBudget) {
+        auto memoryProperties = physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const vk::PhysicalDeviceMemoryBudgetPropertiesEXT& memoryBudget = memoryProperties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        // プールは容量分を確保済みのため、使用量からはプール全体を除く
+        uint64_t poolBytes = deviceWrapper.geometryBufferWrapper.getPoolCapacity();
+        uint64_t otherUsage = memoryBudget.heapUsage[heapIndex] > poolBytes ? memoryBudget.heapUsage[heapIndex] - poolBytes : 0;
+        uint64_t available = memoryBudget.heapBudget[heapIndex] > otherUsage ? memoryBudget.heapBudget[heapIndex] - otherUsage : 0;
+        return available / 10 * 9;
+    }
+    return physicalDevice.getMemoryProperties().memoryHeaps[heapIndex].size / 2;
+}
+
+// 視錐台内のジオメトリを要求し、読み込みの終わったものの転送と予算を超えた分の退避を行う
+// 前のフレームはrenderFrameの先頭で完了を待っているため、プールとメッシュレットをホストから書き換えられる
+void VulkanContext::updateResidency(const std::vector<uint32_t>& visibleRecords) {
+    if (residency.getAssetCount() == 0) {
+        return;
+    }
+    PROFILE_ZONE("residency");
+    auto now = std::chrono::steady_clock::now();
+    residency.beginFrame(frameNumber, std::chrono::duration<double>(now - residencyFrameTime).count());
+    residencyFrameTime = now;
+
+    // 予算の問い合わせは一定フレームごと
+    if (residencyBudgetFrames++ % 30 == 0) {
+        residency.setBudget(std::min<uint64_t>(queryResidencyBudget(), deviceWrapper.geometryBufferWrapper.getPoolCapacity()));
+    }
+
+    // カリング無効時は全インスタンスを描くため、すべてを要求する
+    if (getMeshletCulling()) {
+        for (uint32_t record : visibleRecords) {
+            residency.request(drawRecords[record].primitive->geometryIndex);
+        }
+    } else {
+        for (const render::DrawRecord& record : drawRecords) {
+            residency.request(record.primitive->geometryIndex);
+        }
+    }
+
+    DeviceWrapper::GeometryBufferWrapper& geometryBuffer = deviceWrapper.geometryBufferWrapper;
+    DeviceWrapper::MeshletCullWrapper& meshletCull = deviceWrapper.meshletCullWrapper;
+    DeviceWrapper::ShadowMapWrapper& shadowMap = deviceWrapper.shadowMapWrapper;
+    residency.update(
+        [&](uint32_t asset, const std::vector<uint8_t>& data) {
+            if (!geometryBuffer.makeResident(asset, data)) {
+                return false;
+            }
+            meshletCull.updateGeometryPlacement(asset, geometryBuffer.getPlacement(asset));
+            shadowMap.invalidateGeometry(asset);
+            return true;
+        },
+        [&](uint32_t asset) {
+            geometryBuffer.evict(asset);
+            meshletCull.updateGeometryPlacement(asset, geometryBuffer.getPlacement(asset));
+            shadowMap.invalidateGeometry(asset);
+        }
+    );
+}
+
+// 入力の取得から表示の要求までの遅延を方式ごとに表示
+void VulkanContext::reportLatency() {
+    std::cout << "入力から表示までの遅延 (" << vk::to_string(deviceWrapper.swapchainWrapper.getPresentMode()) << "):" << std::endl;
+    for (size_t policy = 0; policy < static_cast<size_t>(render::PresentPolicy::Count); policy++) {
+        for (size_t pacing = 0; pacing < 2; pacing++) {
+            const LatencyStatistics& stats = latencyStatistics[policy][pacing];
+            if (stats.frames == 0) {
+                continue;
+            }
+            std::cout << "  " << render::presentPolicyName(static_cast<render::PresentPolicy>(policy))
+                      << (pacing ? " + ペーシング" : "") << ": 平均 " << stats.totalMilliseconds / stats.frames
+                      << " ms, 最大 " << stats.maxMilliseconds << " ms (" << stats.frames << " フレーム)" << std::endl;
+        }
+    }
+}
+
+void VulkanContext::cleanup() {
+    // 実行中のフレームと表示の完了を待ってから破棄する
+    if (deviceWrapper.device) {
+        deviceWrapper.waitForFrame();
+        deviceWrapper.device->waitIdle();
+    }
+    if (window != nullptr) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+//物理デバイスの選択（必須条件を満たすもののうちスコアが最大のもの）
+vk::PhysicalDevice VulkanContext::pickPhysicalDevice(const std::vector<const char*>& requiredExtensions) {
+    // 環境変数 VKRENDERKIT_DEVICE に名前の一部を指定すると、一致するデバイスを優先する
+    const char* preferredName = std::getenv("VKRENDERKIT_DEVICE");
+    auto isPreferred = [&](const render::DeviceCandidate& candidate) {
+        return preferredName != nullptr && candidate.name.find(preferredName) != std::string::npos;
+    };
+
+    std::vector<render::DeviceCandidate> candidates;
+    for (const auto& device : instance->enumeratePhysicalDevices()) {
+        candidates.push_back(render::evaluateDevice(device, surface.get(), requiredExtensions));
+    }
+
+    const render::DeviceCandidate* best = nullptr;
+    std::cout << "物理デバイス:" << std::endl;
+    for (const render::DeviceCandidate& candidate : candidates) {
+        std::cout << "  " << candidate.name << " (" << vk::to_string(candidate.type) << ", "
+                  << (candidate.deviceLocalBytes >> 20) << " MiB): ";
+        if (!candidate.rejectReason.empty()) {
+            std::cout << "除外 - " << candidate.rejectReason << std::endl;
+            continue;
+        }
+        std::cout << "スコア " << candidate.score << std::endl;
+        if (best == nullptr || (isPreferred(candidate) && !isPreferred(*best))
+            || (isPreferred(candidate) == isPreferred(*best) && candidate.score > best->score)) {
+            best = &candidate;
+        }
+    }
+    if (best == nullptr) {
+        throw std::runtime_error("適切な物理デバイスが見つかりませんでした");
+    }
+    std::cout << "選択: " << best->name << std::endl;
+    return best->device;
+}
+
+//検証レイヤーのメッセージを標準エラーへ出力する
+void VulkanContext::createDebugMessenger() {
+    VkDebugUtilsMessengerCreateInfoEXT createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+    createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    createInfo.pfnUserCallback = [](VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT, const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void*) -> VkBool32 {
+        std::cerr << (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? "[検証エラー] " : "[検証] ") << callbackData->pMessage << std::endl;
+        return VK_FALSE;
+    };
+
+    VkDebugUtilsMessengerEXT messenger = VK_NULL_HANDLE;
+    if (instanceLoader.vkCreateDebugUtilsMessengerEXT(instance.get(), &createInfo, nullptr, &messenger) != VK_SUCCESS) {
+        throw std::runtime_error("デバッグメッセンジャーの作成に失敗しました");
+    }
+    debugMessenger = vk::UniqueHandle<vk::DebugUtilsMessengerEXT, vk::DispatchLoaderDynamic>(
+        messenger,
+        vk::ObjectDestroy<vk::Instance, vk::DispatchLoaderDynamic>(instance.get(), nullptr, instanceLoader)
+    );
+}
+
+//サーフェスの作成
+void VulkanContext::createSurface() {
+    PROFILE_ZONE("createSurface");
+    if (headless) {
+        // 拡張の関数はローダーから取得する
+        c_surface = static_cast<VkSurfaceKHR>(instance->createHeadlessSurfaceEXT(vk::HeadlessSurfaceCreateInfoEXT{}, nullptr, instanceLoader));
+        surface = vk::UniqueSurfaceKHR{c_surface, instance.get()};
+        return;
+    }
+
+    auto result = glfwCreateWindowSurface(instance.get(), window, nullptr, &c_surface);
+    if (result != VK_SUCCESS) {
+        const char* err;
+        glfwGetError(&err);
+        std::cout << err << std::endl;
+        glfwTerminate();
+        throw std::runtime_error("サーフェスの作成に失敗しました");
+    }
+    surface = vk::UniqueSurfaceKHR{c_surface, instance.get()};
 }
\ No newline at end of file
@@ -1,220 +1,1597 @@
-#include "header.hpp"
-
-class VulkanContext {
-    public:
-        VulkanContext() : deviceWrapper(*this) {}
-
-        // ムーブは許可
-        VulkanContext(VulkanContext&&) noexcept = default;
-        VulkanContext& operator=(VulkanContext&&) noexcept = default;
-
-        void initWindow(uint32_t wInput, uint32_t hInput);
-        void initVulkan();
-        void cleanup();
-
-        bool windowShouldClose() {
-            return glfwWindowShouldClose(window);
-        }
-
-        void draw() {
-            deviceWrapper.draw();
-        }
-
-    private:
-        uint32_t width;
-        uint32_t height;
-        GLFWwindow* window;
-
-        vk::UniqueInstance instance;
-
-        std::vector<const char*> deviceExtensions;
-        vk::PhysicalDeviceFeatures deviceFeatures;
-        vk::PhysicalDevice physicalDevice;
-
-        VkSurfaceKHR c_surface;
-        vk::UniqueSurfaceKHR surface;
-
-        // 物理デバイスの選択
-        vk::PhysicalDevice pickPhysicalDevice(const std::vector<const char*>& deviceExtensions, vk::PhysicalDeviceFeatures deviceFeatures);
-        bool checkDeviceExtensionSupport(vk::PhysicalDevice device,  const std::vector<const char*>& deviceExtensions);
-        bool checkDeviceFeatures(vk::PhysicalDevice device, vk::PhysicalDeviceFeatures requiredFeatures);
-        
-        // サーフェスの作成
-        void createSurface();
-
-        class DeviceWrapper{
-            friend class VulkanContext;
-            public:
-                DeviceWrapper(VulkanContext& ctx) 
-                    : context(ctx)
-                    , graphicsQueueWrapper(*this)
-                    , computeQueueWrapper(*this)
-                    , graphicsCommandBufWrapper(*this)
-                    , computeCommandBufWrapper(*this)
-                    , swapchainWrapper(*this)
-                    , pipelineWrapper(*this) {}
-
-                //ムーブ代入演算子
-                DeviceWrapper& operator=(DeviceWrapper&& other) noexcept {
-                    if(this != &other) {
-                        device = std::move(other.device);
-                        graphicsQueueWrapper = std::move(other.graphicsQueueWrapper);
-                        computeQueueWrapper = std::move(other.computeQueueWrapper);
-                        graphicsCommandBufWrapper = std::move(other.graphicsCommandBufWrapper);
-                        computeCommandBufWrapper = std::move(other.computeCommandBufWrapper);
-                        swapchainWrapper = std::move(other.swapchainWrapper);
-                    }
-                    return *this;
-                }
-                
-                void initDevice();
-
-                void draw();
-
-            private:
-                VulkanContext& context;//VulkanContextの参照を持つ
-
-                vk::UniqueDevice device;
-                
-                class QueueWrapper{
-                    friend class DeviceWrapper;
-                    public:
-                        enum class QueueType{
-                            Graphics,
-                            Compute,
-                            Count
-                        };
-
-                        QueueWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
-                        
-                        //ムーブ代入演算子
-                        QueueWrapper& operator=(QueueWrapper&& other) noexcept {
-                            if(this != &other) {
-                                queueType = std::move(other.queueType);
-                                queueFamilyIndex = std::move(other.queueFamilyIndex);
-                                queuePriorities = std::move(other.queuePriorities);
-                                queues = std::move(other.queues);
-                            }
-                            return *this;
-                        }
-
-
-                        void findQueues(QueueType queueType);//キューを探す
-                        std::map<uint32_t, vk::DeviceQueueCreateInfo> getQueueCreateInfos(){return queueCreateInfos;};//queueCreateInfosを取得
-                        //論理デバイスの初期化を挟む
-                        void initQueues();//queueを初期化
-
-                        void submit(vk::SubmitInfo submitInfo);
-                        void present(vk::PresentInfoKHR presentInfo);
-        
-                    private:
-                        DeviceWrapper& deviceWrapper;
-                        QueueType queueType;
-                        uint32_t queueFamilyIndex;
-                        static std::vector<uint32_t> usedQueueFamilyIndices;
-                        static std::map<uint32_t, vk::DeviceQueueCreateInfo> queueCreateInfos;
-                        
-                        std::vector<float> queuePriorities{};
-                        std::vector<vk::Queue> queues;
-                };
-                QueueWrapper graphicsQueueWrapper;
-                QueueWrapper computeQueueWrapper;
-
-                class CommandBufWrapper{
-                    friend class DeviceWrapper;
-                    public:
-                       
-                        CommandBufWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
-                        
-                        //ムーブ代入演算子
-                        CommandBufWrapper& operator=(CommandBufWrapper&& other) noexcept {
-                            if(this != &other) {
-                                commandPool = std::move(other.commandPool);
-                                commandBuffers = std::move(other.commandBuffers);
-                            }
-                            return *this;
-                        }
-
-                        void initCommandBuf(QueueWrapper& queues);//コマンドバッファを初期化
-
-                        void startRendering(vk::RenderingInfo renderingInfo);
-                        void endRendering(vk::ImageMemoryBarrier imageMemoryBarrier);
-
-                        vk::SubmitInfo getSubmitInfo();
-
-                    private:
-                        DeviceWrapper& deviceWrapper;
-                        vk::UniqueCommandPool commandPool;
-                        std::vector<vk::UniqueCommandBuffer> commandBuffers;
-                };
-                CommandBufWrapper graphicsCommandBufWrapper;
-                CommandBufWrapper computeCommandBufWrapper;
-
-                class SwapchainWrapper{
-                    friend class DeviceWrapper;
-                    
-                    public:
-                        SwapchainWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
-                        
-                        //ムーブ代入演算子
-                        SwapchainWrapper& operator=(SwapchainWrapper&& other) noexcept {
-                            if(this != &other) {
-                                swapchain = std::move(other.swapchain);
-                                swapchainImages = std::move(other.swapchainImages);
-                                swapchainImageViews = std::move(other.swapchainImageViews);
-                            }
-                            return *this;
-                        }
-
-                        void initSwapchain();
-
-                        vk::ImageView getNextImage();
-                        vk::PresentInfoKHR getPresentInfo();
-                        vk::ImageMemoryBarrier getImageMemoryBarrier(vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
-                        
-                    private:
-                        DeviceWrapper& deviceWrapper;
-                        vk::UniqueSwapchainKHR swapchain;
-                        std::vector<vk::Image> swapchainImages;
-                        std::vector<vk::UniqueImageView> swapchainImageViews;
-
-                        vk::UniqueFence swapchainImgFence;
-                        uint32_t imageIndex;
-                };
-                SwapchainWrapper swapchainWrapper;
-
-                class PipelineWrapper{
-                    friend class DeviceWrapper;
-                    public:
-                        PipelineWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
-
-                        //ムーブ代入演算子
-                        PipelineWrapper& operator=(PipelineWrapper&& other) noexcept {
-                            if(this != &other) {
-                                pipeline = std::move(other.pipeline);
-                                pipelineLayout = std::move(other.pipelineLayout);
-                                shaderModules = std::move(other.shaderModules);
-                            }
-                            return *this;
-                        }
-
-                        void initPipeline();
-                                              
-                        
-                    private:
-                        DeviceWrapper& deviceWrapper;
-                        vk::UniquePipeline pipeline;
-                        vk::UniquePipelineLayout pipelineLayout;
-
-                        vk::UniqueShaderModule vertShaderModule;
-                        vk::UniqueShaderModule fragShaderModule;
-
-                        vk::UniqueShaderModule initShaderModule(std::string filename);
-                        std::vector<vk::UniqueShaderModule> shaderModules;
-                };
-                PipelineWrapper pipelineWrapper;
-
-        };
-        DeviceWrapper deviceWrapper;
-
+#include "header.hpp"
+#include "drawList.hpp"
+#include "sceneSnapshot.hpp"
+#include "framePacer.hpp"
+#include "frameArena.hpp"
+#include "sceneBvh.hpp"
+#include "world.hpp"
+#include "profiler.hpp"
+#include "deviceSelection.hpp"
+#include "residency.hpp"
+#include "gpuScene.hpp"
+#include "shadowCascade.hpp"
+#include "lightCluster.hpp"
+#include "dynamicResolution.hpp"
+
+class VulkanContext {
+    public:
+        // メッシュレットカリングの累積（カリング・遮蔽カリングの設定ごと）
+        struct CullStatistics {
+            uint64_t frames = 0;
+            uint64_t visibleTriangles = 0;//描画した三角形
+            uint64_t testedMeshlets = 0;//視錐台・背面を通過して遮蔽を判定したメッシュレット
+            uint64_t occludedMeshlets = 0;
+            double cullMilliseconds = 0.0;//コンピュートキューでのカリング
+            double drawMilliseconds = 0.0;//グラフィックスキューの処理全体（階層Zの生成と2回目のカリングを含む）
+
+            double occludedRatio() const {
+                return testedMeshlets == 0 ? 0.0 : static_cast<double>(occludedMeshlets) / testedMeshlets;
+            }
+        };
+
+        // シャドウマップの描画の累積（キャッシュの有無ごと）
+        struct ShadowStatistics {
+            uint64_t frames = 0;
+            uint64_t staticDraws = 0;//静的な投影元の描画数
+            uint64_t dynamicDraws = 0;//動的な投影元の描画数
+            uint64_t pageUpdates = 0;//静的な投影元を描き直したカスケードの数
+            double gpuMilliseconds = 0.0;//グラフィックスキューでの影の描画全体
+
+            uint64_t draws() const { return staticDraws + dynamicDraws; }
+        };
+
+        // クラスタ単位のライトの割り当ての累積
+        struct LightStatistics {
+            uint64_t frames = 0;
+            uint64_t lights = 0;//クラスタに割り当てる（平行光源以外の）ライト数
+            uint64_t assignedLights = 0;//全クラスタのライト数の合計
+            uint32_t maxClusterLights = 0;
+            uint64_t saturatedClusters = 0;//上限（kMaxLightsPerCluster）に達したクラスタ数
+            double clusterMilliseconds = 0.0;//コンピュートキューでの割り当て
+
+            double lightsPerCluster() const { return frames == 0 ? 0.0 : static_cast<double>(assignedLights) / (frames * render::kClusterCount); }
+        };
+
+        // 半透明の描画の累積（ソート・重み付きOITごと）
+        struct TransparencyStatistics {
+            uint64_t frames = 0;
+            uint64_t instances = 0;//視錐台内の半透明のインスタンス数
+            uint64_t draws = 0;//描画コマンドの数
+            double cpuMilliseconds = 0.0;//描画の組み立て（ソート済みの描画リストからのまとめ、またはジオメトリごとの振り分け）とコマンドの記録
+            double gpuMilliseconds = 0.0;//グラフィックスキューでの半透明の描画全体（OITは合成を含む）
+        };
+
+        // 深度のみの描画（色を書かない）で位置をどこから読むか。Offなら通常の描画
+        enum class DepthOnlyLayout {
+            Off,
+            Interleaved,//ジオメトリプールの頂点（全属性をまとめた間隔）から読む
+            Split,//位置だけのストリームから読む
+        };
+
+        VulkanContext() : deviceWrapper(*this) {}
+
+        // ムーブは許可
+        VulkanContext(VulkanContext&&) noexcept = default;
+        VulkanContext& operator=(VulkanContext&&) noexcept = default;
+
+        void initWindow(uint32_t wInput, uint32_t hInput);
+        // ウィンドウを作らずVK_EXT_headless_surfaceに描画する（ベンチマーク・CI用）
+        void initHeadless(uint32_t wInput, uint32_t hInput);
+        // 検証レイヤーの設定（initVulkanより前に呼ぶ。既定はdefaultValidationProfile）
+        void setValidationProfile(render::ValidationProfile profile) {
+            validationProfile = profile;
+        }
+        void initVulkan();
+        void cleanup();
+
+        bool windowShouldClose() {
+            return window != nullptr && glfwWindowShouldClose(window);
+        }
+
+        // フレームペーシングの待機とスワップチェインイメージの取得の後にイベントを処理する（入力の取得時刻を記録）
+        void pollEvents();
+        // イベントが来るまで最大timeoutSeconds待って処理する（更新・描画を別スレッドで回すときのメインスレッド用）
+        void waitEvents(double timeoutSeconds);
+        // フレームペーシングの待機とスワップチェインイメージの取得のみ（描画スレッド用。直後に取り出すスナップショットを入力の取得とみなす）
+        void waitForNextFrame();
+
+        // setCameraのカメラで可視判定・ソートをして描画する
+        void draw();
+
+        // 可視判定と描画リストのソートをしてsnapshotに書き込む（カメラはsnapshotに設定済みのもの）
+        // 描画レコードとBVHを読むだけなので、描画と別のスレッドから呼べる
+        void buildSnapshot(render::SceneSnapshot& snapshot, std::pmr::memory_resource* resource) const;
+        // 作成済みのスナップショットを描画する（カメラもsnapshotのものに置き換える）
+        void draw(const render::SceneSnapshot& snapshot);
+
+        // 描画するモデルをGPUへ転送
+        // 全モデルの頂点・インデックスは共有バッファに詰め、同一内容のメッシュは1度だけ格納する
+        // spinningModelの番号のモデルは原点を通るY軸まわりに回せる（BVHと影の範囲は一周する分を含めて広げる）
+        void loadModels(const std::vector<geometry::Model*>& models, uint32_t spinningModel = UINT32_MAX);
+
+        // 回すモデルのトランスフォームをsnapshotに書き込む（更新スレッド用。読み込み時に決めた値を読むだけ）
+        void spinModel(float angle, render::SceneSnapshot& snapshot) const;
+
+        void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) {
+            viewMatrix = view;
+            projectionMatrix = projection;
+            cameraPosition = position;
+        }
+
+        bool isKeyPressed(int key) {
+            return window != nullptr && glfwGetKey(window, key) == GLFW_PRESS;
+        }
+        bool isMouseButtonPressed(int button) {
+            return window != nullptr && glfwGetMouseButton(window, button) == GLFW_PRESS;
+        }
+
+        // ウィンドウに対するカーソルの位置（0〜1）。メインスレッドから呼ぶ
+        bool getCursorPosition(glm::vec2& cursor);
+
+        // カーソル位置のレイで最も手前の描画レコードを選ぶ（BVHで候補を絞り、三角形で判定）
+        // 見つからなければUINT32_MAXを返す
+        uint32_t pickDrawRecord(float& distance);
+        // cursorはウィンドウに対する0〜1の位置。GLFWに触れないため、メインスレッド以外からも呼べる
+        uint32_t pickDrawRecord(const glm::vec2& cursor, const glm::mat4& viewProjection, float& distance) const;
+        const render::DrawRecord& getDrawRecord(uint32_t index) const {
+            return drawRecords[index];
+        }
+
+        // 以下の設定の変更と統計の取得・リセットは、実行中のフレームの完了を待って統計を回収してから行う
+        // （変更前の設定で描いたフレームの統計を変更後の設定に数えないため）
+        void setMeshletCulling(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.meshletCullWrapper.cullingEnabled = enabled;
+        }
+        bool getMeshletCulling() {
+            return deviceWrapper.meshletCullWrapper.cullingEnabled;
+        }
+        // 階層Zによる遮蔽カリング（メッシュレットカリングが有効で、デバイスが対応している場合のみ働く）
+        void setOcclusionCulling(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.meshletCullWrapper.occlusionEnabled = enabled;
+        }
+        bool getOcclusionCulling() {
+            return deviceWrapper.meshletCullWrapper.occlusionEnabled;
+        }
+        // 頂点をシェーダで読み出す経路（固定機能の頂点入力との比較用。対応していなければ固定機能のまま）
+        void setVertexPulling(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.meshletCullWrapper.vertexPullingEnabled = enabled;
+        }
+        bool getVertexPulling() {
+            return deviceWrapper.meshletCullWrapper.vertexPullingEnabled;
+        }
+        bool isVertexPullingSupported() {
+            return deviceWrapper.meshletCullWrapper.isVertexPullingSupported();
+        }
+        // 深度のみの描画（位置のレイアウトによる帯域の比較用。対応していなければ通常の描画のまま）
+        void setDepthOnlyLayout(DepthOnlyLayout layout) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.meshletCullWrapper.depthOnlyLayout = layout;
+        }
+        bool isDepthOnlySupported() {
+            return deviceWrapper.meshletCullWrapper.isDepthOnlySupported();
+        }
+        // 位置ストリームを半精度で持つか（次のloadModelsから反映）
+        void setQuantizedPositions(bool enabled) {
+            deviceWrapper.geometryBufferWrapper.setQuantizedPositions(enabled);
+        }
+        vk::DeviceSize getPositionStride() {
+            return deviceWrapper.geometryBufferWrapper.getPositionStride();
+        }
+        // カスケードシャドウマップ
+        void setShadows(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.shadowMapWrapper.enabled = enabled;
+        }
+        bool getShadows() {
+            return deviceWrapper.shadowMapWrapper.enabled;
+        }
+        // 静的な投影元をカスケードごとのページにキャッシュするか（無効なら毎フレームすべての投影元を描く）
+        void setShadowCaching(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.shadowMapWrapper.cachingEnabled = enabled;
+        }
+        bool getShadowCaching() {
+            return deviceWrapper.shadowMapWrapper.cachingEnabled;
+        }
+        // 平行光源のライトへ向かう向き（変化が閾値を超えるとページを描き直す）
+        void setLightDirection(const glm::vec3& direction) {
+            deviceWrapper.shadowMapWrapper.lightDirection = glm::normalize(direction);
+        }
+        const ShadowStatistics& getShadowStatistics() {
+            deviceWrapper.waitForFrame();
+            return deviceWrapper.shadowMapWrapper.getStatistics();
+        }
+        void resetShadowStatistics() {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.shadowMapWrapper.resetStatistics();
+        }
+        // 点・スポット・平行光源（loadModelsでモデル内のKHR_lights_punctualに置き換わる）
+        void setLights(const std::vector<render::SceneLight>& lights) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.lightClusterWrapper.setLights(lights);
+        }
+        // 無効なら平行光源のみで照らす
+        void setClusteredLighting(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.lightClusterWrapper.enabled = enabled;
+        }
+        bool getClusteredLighting() {
+            return deviceWrapper.lightClusterWrapper.enabled;
+        }
+        const LightStatistics& getLightStatistics() {
+            deviceWrapper.waitForFrame();
+            return deviceWrapper.lightClusterWrapper.getStatistics();
+        }
+        void resetLightStatistics() {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.lightClusterWrapper.resetStatistics();
+        }
+        // 半透明を重み付きブレンドのOIT（順序に依らず蓄積し、全画面パスで合成する）で描くか（無効なら奥から手前へソートして描く）
+        void setOrderIndependentTransparency(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.transparencyWrapper.orderIndependent = enabled;
+        }
+        bool getOrderIndependentTransparency() {
+            return deviceWrapper.transparencyWrapper.orderIndependent;
+        }
+        const TransparencyStatistics& getTransparencyStatistics() {
+            deviceWrapper.waitForFrame();
+            return deviceWrapper.transparencyWrapper.getStatistics();
+        }
+        void resetTransparencyStatistics() {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.transparencyWrapper.resetStatistics();
+        }
+        // 現在の設定での累積
+        const CullStatistics& getCullStatistics() {
+            deviceWrapper.waitForFrame();
+            return deviceWrapper.meshletCullWrapper.getStatistics();
+        }
+        void resetCullStatistics() {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.meshletCullWrapper.resetStatistics();
+        }
+
+        // 動的解像度（縮小した描画先に描いて拡大する。倍率はGPU時間から毎フレーム決める）
+        // 環境変数 VKRENDERKIT_GPU_TARGET_MS で目標時間を指定できる
+        void setDynamicResolution(bool enabled) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.dynamicResolutionWrapper.setEnabled(enabled);
+        }
+        bool getDynamicResolution() {
+            return deviceWrapper.dynamicResolutionWrapper.isEnabled();
+        }
+        bool isDynamicResolutionSupported() {
+            return deviceWrapper.dynamicResolutionWrapper.isSupported();
+        }
+        void setDynamicResolutionSettings(const render::DynamicResolutionSettings& settings) {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.dynamicResolutionWrapper.setSettings(settings);
+        }
+        float getRenderScale() {
+            return deviceWrapper.dynamicResolutionWrapper.getScale();
+        }
+        // フレームごとの倍率とグラフィックスキューの時間（無効なときも記録する）
+        const std::vector<render::ResolutionSample>& getResolutionTrace() {
+            deviceWrapper.waitForFrame();
+            return deviceWrapper.dynamicResolutionWrapper.getTrace();
+        }
+        void resetResolutionTrace() {
+            deviceWrapper.waitForFrame();
+            deviceWrapper.dynamicResolutionWrapper.resetTrace();
+        }
+
+        // 表示方式の切り替え（次のフレームでスワップチェインを作り直す）
+        void setPresentPolicy(render::PresentPolicy policy);
+        render::PresentPolicy getPresentPolicy() {
+            return deviceWrapper.swapchainWrapper.getPresentPolicy();
+        }
+        void setFramePacing(bool enabled) {
+            framePacer.setEnabled(enabled);
+            framePacer.reset();
+        }
+        bool getFramePacing() {
+            return framePacer.isEnabled();
+        }
+
+        // オブジェクト定数をリングバッファへ書き込む時間の計測（反復ごとのミリ秒。1フレームの領域を超える場合は空）
+        std::vector<double> measureObjectUpload(uint32_t objectCount, uint32_t iterations);
+
+        // 120フレームごとの統計（描画リスト・カリング・影・ライト・遅延など）を標準出力へ出すか
+        // 既定は出さない（出力自体がフレーム時間と確保回数に入るため、アプリでは --stats で有効にする）
+        void setStatisticsOutput(bool enabled) {
+            statisticsOutput = enabled;
+        }
+        bool getStatisticsOutput() const {
+            return statisticsOutput;
+        }
+
+        // フレームアリーナの切り替え（確保回数の比較用）
+        void setFrameArena(bool enabled) {
+            frameArena.setEnabled(enabled);
+        }
+        bool getFrameArena() {
+            return frameArena.isEnabled();
+        }
+
+        // ジオメトリの常駐予算（0でVK_EXT_memory_budget、無ければヒープサイズから決める）
+        // 環境変数 VKRENDERKIT_RESIDENCY_BUDGET_MB でも指定できる
+        void setResidencyBudget(uint64_t bytes) {
+            residencyBudgetOverride = bytes;
+            residencyBudgetFrames = 0;
+        }
+        const render::ResidencyManager& getResidency() const {
+            return residency;
+        }
+        void resetResidencyStatistics() {
+            residency.resetStatistics();
+        }
+
+        const render::DeviceCapabilities& getCapabilities() const {
+            return capabilities;
+        }
+
+        std::string getDeviceName() {
+            return physicalDevice.getProperties().deviceName.data();
+        }
+
+        float getAspectRatio() {
+            return static_cast<float>(width) / static_cast<float>(std::max(height, 1u));
+        }
+        // リサイズ直後のフレームバッファの縦横比（スワップチェインの再作成を待たない。最小化中は0）
+        float getFramebufferAspectRatio() {
+            int framebufferWidth, framebufferHeight;
+            getFramebufferSize(framebufferWidth, framebufferHeight);
+            return framebufferHeight > 0 ? static_cast<float>(framebufferWidth) / static_cast<float>(framebufferHeight) : 0.0f;
+        }
+
+    private:
+        uint32_t width;
+        uint32_t height;
+        GLFWwindow* window = nullptr;
+        bool headless = false;
+        std::atomic<bool> framebufferResized{false};
+
+        // メインスレッドのコールバックで更新する（描画スレッドからGLFWを呼ばないため）
+        std::atomic<int> cachedFramebufferWidth{0};
+        std::atomic<int> cachedFramebufferHeight{0};
+
+        // ヘッドレス時はinitHeadlessで指定したサイズを返す
+        void getFramebufferSize(int& framebufferWidth, int& framebufferHeight);
+
+        // 入力から表示までの遅延（表示方式・ペーシング有無ごとの累積）
+        render::FramePacer framePacer;
+        struct LatencyStatistics {
+            uint64_t frames = 0;
+            double totalMilliseconds = 0.0;
+            double maxMilliseconds = 0.0;
+        };
+        LatencyStatistics latencyStatistics[static_cast<size_t>(render::PresentPolicy::Count)][2];
+        uint64_t latencyFrameCounter = 0;
+        void reportLatency();
+        bool statisticsOutput = false;
+
+        // フレーム内の一時的なCPU確保用
+        render::FrameArena frameArena;
+        uint64_t frameNumber = 0;
+        uint64_t frameAllocations[2] = {};//アリーナ無効/有効ごとのoperator new回数
+        uint64_t frameAllocationFrames[2] = {};
+        uint64_t frameRingBytes = 0;//リングバッファへの書き込み量（出力間隔内の累積）
+        render::SceneUploadStatistics sceneUploads;//シーンの表への書き込み量（出力間隔内の累積）
+
+        // カメラ
+        glm::mat4 viewMatrix = glm::mat4(1.0f);
+        glm::mat4 projectionMatrix = glm::mat4(1.0f);
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+
+        // 全モデルの共有ジオメトリ
+        geometry::World world;
+
+        // 描画順序（毎フレームキーを作り直してソート）
+        std::vector<render::DrawRecord> drawRecords;
+        // 回すモデルのノード（トランスフォームの表の番号と回す前の変換）と、描画レコードごとのノードの位置
+        std::vector<std::pair<uint32_t, glm::mat4>> spinningNodes;
+        std::vector<std::pair<uint32_t, uint32_t>> spinningRecords;//（描画レコード, spinningNodesの位置）
+        // draw()で使うスナップショット（可視判定と描画リスト）
+        render::SceneSnapshot frameSnapshot;
+
+        // 共有ジオメトリの常駐管理（アセット番号 = ジオメトリ番号）
+        render::ResidencyManager residency;
+        uint64_t residencyBudgetOverride = 0;
+        uint32_t residencyBudgetFrames = 0;//予算を問い合わせてからのフレーム数
+        std::chrono::steady_clock::time_point residencyFrameTime;
+        uint64_t queryResidencyBudget();
+        void updateResidency(const std::vector<uint32_t>& visibleRecords);
+
+        // 描画レコードのワールドAABBに対するBVH（視錐台カリングとピッキング用）
+        geometry::SceneBvh sceneBvh;
+        uint64_t visibleRecordTotal = 0;
+        double drawSortMilliseconds = 0.0;
+        uint64_t drawSortFrames = 0;
+
+        vk::UniqueInstance instance;
+        vk::DispatchLoaderDynamic instanceLoader;//インスタンス拡張の関数用
+        render::ValidationProfile validationProfile = render::defaultValidationProfile();
+        vk::UniqueHandle<vk::DebugUtilsMessengerEXT, vk::DispatchLoaderDynamic> debugMessenger;
+
+        std::vector<const char*> deviceExtensions;
+        vk::PhysicalDeviceFeatures deviceFeatures;
+        vk::PhysicalDevice physicalDevice;
+
+        // 有効にした高速パス
+        render::DeviceCapabilities capabilities;
+
+        VkSurfaceKHR c_surface;
+        vk::UniqueSurfaceKHR surface;
+
+        // 物理デバイスの選択
+        vk::PhysicalDevice pickPhysicalDevice(const std::vector<const char*>& requiredExtensions);
+        void createDebugMessenger();
+        
+        // サーフェスの作成
+        void createSurface();
+
+        // snapshotを描画して統計を取る（フレームアリーナのbeginFrameの後に呼ぶ）
+        void renderFrame(const render::SceneSnapshot& snapshot, uint64_t allocationsBefore);
+
+        class DeviceWrapper{
+            friend class VulkanContext;
+            public:
+                DeviceWrapper(VulkanContext& ctx) 
+                    : context(ctx)
+                    , graphicsQueueWrapper(*this)
+                    , computeQueueWrapper(*this)
+                    , graphicsCommandBufWrapper(*this)
+                    , computeCommandBufWrapper(*this)
+                    , swapchainWrapper(*this)
+                    , pipelineWrapper(*this)
+                    , frameRingWrapper(*this)
+                    , geometryBufferWrapper(*this)
+                    , gpuProfilerWrapper(*this)
+                    , depthPyramidWrapper(*this)
+                    , dynamicResolutionWrapper(*this)
+                    , shadowMapWrapper(*this)
+                    , lightClusterWrapper(*this)
+                    , meshletCullWrapper(*this)
+                    , transparencyWrapper(*this) {}
+
+                //ムーブ代入演算子
+                DeviceWrapper& operator=(DeviceWrapper&& other) noexcept {
+                    if(this != &other) {
+                        device = std::move(other.device);
+                        queueFamilyPriorities = std::move(other.queueFamilyPriorities);
+                        queueMutexes = std::move(other.queueMutexes);
+                        graphicsQueueWrapper = std::move(other.graphicsQueueWrapper);
+                        computeQueueWrapper = std::move(other.computeQueueWrapper);
+                        graphicsCommandBufWrapper = std::move(other.graphicsCommandBufWrapper);
+                        computeCommandBufWrapper = std::move(other.computeCommandBufWrapper);
+                        swapchainWrapper = std::move(other.swapchainWrapper);
+                        frameRingWrapper = std::move(other.frameRingWrapper);
+                        geometryBufferWrapper = std::move(other.geometryBufferWrapper);
+                        gpuProfilerWrapper = std::move(other.gpuProfilerWrapper);
+                        depthPyramidWrapper = std::move(other.depthPyramidWrapper);
+                        dynamicResolutionWrapper = std::move(other.dynamicResolutionWrapper);
+                        shadowMapWrapper = std::move(other.shadowMapWrapper);
+                        lightClusterWrapper = std::move(other.lightClusterWrapper);
+                        meshletCullWrapper = std::move(other.meshletCullWrapper);
+                        transparencyWrapper = std::move(other.transparencyWrapper);
+                        frameFences = std::move(other.frameFences);
+                        submittedFrames = other.submittedFrames;
+                        framePending = other.framePending;
+                    }
+                    return *this;
+                }
+                
+                void initDevice();
+
+                // 次のフレームのスワップチェインイメージを取得する（入力の取得より前に呼ぶ。取得済みなら何もしない）
+                void acquireFrame();
+                // 直前に提出したフレームの完了をフェンスで待ち、GPU時間などの統計を回収する（完了を回収済みなら何もしない）
+                // ラッパーのホストから書き込むバッファとコマンドバッファは1組のため、次のフレームの記録・書き込みの前に呼ぶ
+                void waitForFrame();
+
+                void draw();
+
+            private:
+                VulkanContext& context;//VulkanContextの参照を持つ
+
+                vk::UniqueDevice device;
+                vk::DispatchLoaderDynamic dispatchLoader;//拡張機能の関数用
+
+                // フレームのスロットごとのフェンス（グラフィックスの提出でシグナルする。作成時はシグナル済み）
+                // コンピュートの提出はグラフィックスの提出がセマフォで待つため、このフェンスで完了を確認できる
+                std::array<vk::UniqueFence, render::kFramesInFlight> frameFences;
+                uint64_t submittedFrames = 0;
+                bool framePending = false;//提出済みで完了を回収していないフレームがある
+                uint32_t getFrameSlot() const { return static_cast<uint32_t>(submittedFrames % render::kFramesInFlight); }
+
+                // バッファとメモリの組
+                struct BufferResource {
+                    vk::UniqueBuffer buffer;
+                    vk::UniqueDeviceMemory memory;
+                    vk::DeviceSize size = 0;
+                    void* mapped = nullptr;//ホストから見える場合はマップ済みのポインタ
+                    vk::DeviceAddress address = 0;//eShaderDeviceAddressで作った場合のデバイスアドレス
+                };
+                BufferResource createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+
+                // デバイスローカルの2Dイメージとメモリ、全ミップ・全レイヤーのビューの組
+                struct ImageResource {
+                    vk::UniqueImage image;
+                    vk::UniqueDeviceMemory memory;
+                    vk::UniqueImageView view;
+                    vk::Extent2D extent;
+                    uint32_t mipLevels = 1;
+                    uint32_t arrayLayers = 1;
+                };
+                ImageResource createImage(vk::Extent2D extent, uint32_t mipLevels, vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect,
+                                          uint32_t arrayLayers = 1, vk::ImageViewType viewType = vk::ImageViewType::e2D);
+                uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties);
+
+                // キューの割り当て（デバイスごとの状態）
+                // 同じファミリーを共有するときは、キューが2つ以上あればグラフィックスとコンピュートで分け合う
+                std::map<uint32_t, std::vector<float>> queueFamilyPriorities;
+                std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<std::mutex>> queueMutexes;//(ファミリー, 番号)ごと
+                std::vector<vk::DeviceQueueCreateInfo> assignQueues();
+                
+                // キューファミリー内の全キューを扱い、複数スレッドからの提出を受け付ける
+                // 主キュー（先頭）は順序が必要な処理と表示に使い、残りは独立した処理に振り分ける
+                // 各キューの排他はDeviceWrapperが持つロックで行う（同じキューを共有する場合も同じロックを使う）
+                class QueueWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        enum class QueueType{
+                            Graphics,
+                            Compute,
+                            Count
+                        };
+
+                        // 1回の提出（VkSubmitInfo2に対応）
+                        // フレームアリーナの領域を使う場合は同じフレーム内に提出すること
+                        struct Submission {
+                            explicit Submission(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+                                : commandBuffers(resource), waitSemaphores(resource), signalSemaphores(resource) {}
+
+                            std::pmr::vector<vk::CommandBufferSubmitInfo> commandBuffers;
+                            std::pmr::vector<vk::SemaphoreSubmitInfo> waitSemaphores;
+                            std::pmr::vector<vk::SemaphoreSubmitInfo> signalSemaphores;
+                        };
+
+                        QueueWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+                        
+                        //ムーブ代入演算子
+                        QueueWrapper& operator=(QueueWrapper&& other) noexcept {
+                            if(this != &other) {
+                                queueType = std::move(other.queueType);
+                                queueFamilyIndex = std::move(other.queueFamilyIndex);
+                                firstQueueIndex = other.firstQueueIndex;
+                                queueCount = other.queueCount;
+                                queues = std::move(other.queues);
+                                queueMutexes = std::move(other.queueMutexes);
+                                pending = std::move(other.pending);
+                                nextQueue.store(other.nextQueue.load());
+                            }
+                            return *this;
+                        }
+
+
+                        void findQueues(QueueType queueType);//キューファミリーを選ぶ
+                        //論理デバイスの初期化を挟む
+                        void initQueues();//queueを初期化
+
+                        // 以下は複数スレッドから呼べる
+                        void enqueue(Submission submission);//溜めておき、flushでまとめて提出する
+                        void flush(vk::Fence fence = {});//溜まった提出を主キューへ1回で提出する
+                        void submit(Submission submission, vk::Fence fence = {});//enqueueとflush
+                        // 他の提出と順序関係の無い処理を主キュー以外へ順に振り分ける（使ったキューの番号を返す）
+                        uint32_t submitIndependent(Submission submission, vk::Fence fence = {});
+                        vk::Result present(vk::PresentInfoKHR presentInfo);//OUT_OF_DATEは例外ではなく戻り値で返す
+                        void waitIdle();
+
+                        uint32_t getQueueFamilyIndex() const { return queueFamilyIndex; }
+                        uint32_t getQueueCount() const { return static_cast<uint32_t>(queues.size()); }
+        
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        QueueType queueType;
+                        uint32_t queueFamilyIndex;
+                        uint32_t firstQueueIndex = 0;//ファミリー内で使うキューの範囲
+                        uint32_t queueCount = 1;
+                        
+                        std::vector<vk::Queue> queues;
+                        std::vector<std::mutex*> queueMutexes;
+
+                        std::mutex pendingMutex;
+                        std::vector<Submission> pending;
+                        std::atomic<uint32_t> nextQueue{0};
+
+                        void submitBatch(uint32_t queue, const std::vector<Submission>& submissions, vk::Fence fence);
+                };
+                QueueWrapper graphicsQueueWrapper;
+                QueueWrapper computeQueueWrapper;
+
+                class CommandBufWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                       
+                        CommandBufWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+                        
+                        //ムーブ代入演算子
+                        CommandBufWrapper& operator=(CommandBufWrapper&& other) noexcept {
+                            if(this != &other) {
+                                commandPool = std::move(other.commandPool);
+                                commandBuffers = std::move(other.commandBuffers);
+                            }
+                            return *this;
+                        }
+
+                        void initCommandBuf(QueueWrapper& queues);//コマンドバッファを初期化
+
+                        // 記録を始め、レイアウトの遷移をしてからレンダリングを始める
+                        void startRendering(vk::RenderingInfo renderingInfo, vk::ArrayProxy<const vk::ImageMemoryBarrier> imageMemoryBarriers);
+                        // startRenderingを2つに分けたもの（レンダリングの前に別のパスを記録する場合）
+                        void begin();
+                        void beginRendering(vk::RenderingInfo renderingInfo, vk::ArrayProxy<const vk::ImageMemoryBarrier> imageMemoryBarriers);
+                        void endRendering(vk::ImageMemoryBarrier imageMemoryBarrier);
+
+                        vk::CommandBuffer getCommandBuffer() { return commandBuffers.at(0).get(); }
+                        vk::CommandBufferSubmitInfo getCommandBufferSubmitInfo() { return vk::CommandBufferSubmitInfo(commandBuffers.at(0).get()); }
+
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        vk::UniqueCommandPool commandPool;
+                        std::vector<vk::UniqueCommandBuffer> commandBuffers;
+                };
+                CommandBufWrapper graphicsCommandBufWrapper;
+                CommandBufWrapper computeCommandBufWrapper;
+
+                class SwapchainWrapper{
+                    friend class DeviceWrapper;
+                    
+                    public:
+                        SwapchainWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+                        
+                        //ムーブ代入演算子
+                        SwapchainWrapper& operator=(SwapchainWrapper&& other) noexcept {
+                            if(this != &other) {
+                                swapchain = std::move(other.swapchain);
+                                swapchainImages = std::move(other.swapchainImages);
+                                swapchainImageViews = std::move(other.swapchainImageViews);
+                                imageAvailableSemaphores = std::move(other.imageAvailableSemaphores);
+                                renderFinishedSemaphores = std::move(other.renderFinishedSemaphores);
+                                imageIndex = other.imageIndex;
+                                acquiredSlot = other.acquiredSlot;
+                                imageAcquired = other.imageAcquired;
+                                swapchainFormat = other.swapchainFormat;
+                                swapchainExtent = other.swapchainExtent;
+                                presentPolicy = other.presentPolicy;
+                                presentMode = other.presentMode;
+                                recreateRequested = other.recreateRequested;
+                                transferDstSupported = other.transferDstSupported;
+                            }
+                            return *this;
+                        }
+
+                        void initSwapchain();
+                        // リサイズ・OUT_OF_DATE・表示方式の変更時に作り直す（古いスワップチェインを引き継ぐ）
+                        void recreateSwapchain();
+
+                        void setPresentPolicy(render::PresentPolicy policy) {
+                            presentPolicy = policy;
+                            recreateRequested = true;
+                        }
+                        render::PresentPolicy getPresentPolicy() const { return presentPolicy; }
+                        vk::PresentModeKHR getPresentMode() const { return presentMode; }
+                        vk::Format getFormat() const { return swapchainFormat.format; }
+                        bool isRecreateRequested() const { return recreateRequested; }
+                        void requestRecreate() { recreateRequested = true; }
+                        vk::Extent2D getExtent() const { return swapchainExtent; }
+                        vk::Image getCurrentImage() const { return swapchainImages.at(imageIndex); }
+                        // 転送先にできる（動的解像度で拡大して書き込む）
+                        bool isTransferDstSupported() const { return transferDstSupported; }
+
+                        // slotの取得セマフォで次のイメージを取得する（取得済みで表示していなければそのイメージを返す）
+                        // セマフォで待つためブロックするのは空きイメージが無いときだけ
+                        vk::ImageView getNextImage(uint32_t slot);
+                        // 描画の提出が待つセマフォ（イメージの取得）とシグナルするセマフォ（表示が待つ）
+                        vk::Semaphore getImageAvailableSemaphore() const { return imageAvailableSemaphores.at(acquiredSlot).get(); }
+                        vk::Semaphore getRenderFinishedSemaphore() const { return renderFinishedSemaphores.at(imageIndex).get(); }
+                        // 描画完了のセマフォを待って表示する（次のgetNextImageで新しいイメージを取得する）
+                        vk::PresentInfoKHR getPresentInfo();
+                        vk::ImageMemoryBarrier getImageMemoryBarrier(vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+                        
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        vk::UniqueSwapchainKHR swapchain;
+                        std::vector<vk::Image> swapchainImages;
+                        std::vector<vk::UniqueImageView> swapchainImageViews;
+
+                        // 取得はフレームのスロットごと、描画完了はイメージごと（表示が終わるまで同じイメージは再取得されない）
+                        std::array<vk::UniqueSemaphore, render::kFramesInFlight> imageAvailableSemaphores;
+                        std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
+                        uint32_t imageIndex = 0;
+                        uint32_t acquiredSlot = 0;
+                        bool imageAcquired = false;
+
+                        vk::SurfaceFormatKHR swapchainFormat;
+                        vk::Extent2D swapchainExtent;
+                        render::PresentPolicy presentPolicy = render::PresentPolicy::LowLatency;
+                        vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+                        bool recreateRequested = false;
+                        bool transferDstSupported = false;
+
+                        void createSwapchain();
+                };
+                SwapchainWrapper swapchainWrapper;
+
+                class PipelineWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        PipelineWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        PipelineWrapper& operator=(PipelineWrapper&& other) noexcept {
+                            if(this != &other) {
+                                pipeline = std::move(other.pipeline);
+                                pipelineLayout = std::move(other.pipelineLayout);
+                                shaderModules = std::move(other.shaderModules);
+                            }
+                            return *this;
+                        }
+
+                        void initPipeline();
+                        vk::UniqueShaderModule initShaderModule(std::string filename);
+                        
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        vk::UniquePipeline pipeline;
+                        vk::UniquePipelineLayout pipelineLayout;
+
+                        vk::UniqueShaderModule vertShaderModule;
+                        vk::UniqueShaderModule fragShaderModule;
+
+                        std::vector<vk::UniqueShaderModule> shaderModules;
+                };
+                PipelineWrapper pipelineWrapper;
+
+                // フレームごとに区切ったユニフォーム/ストレージ用のリングバッファ
+                // 永続的にマップしたバッファへmemcpyし、ダイナミックオフセットで参照するため毎フレームのディスクリプタ更新は不要
+                // set = 1, binding 0: カメラ（UNIFORM_BUFFER_DYNAMIC）, binding 1: オブジェクト（STORAGE_BUFFER_DYNAMIC）
+                class FrameRingWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        // シェーダ側（shader/meshletCommon.glsl）と同じレイアウト
+                        struct CameraConstants {
+                            glm::mat4 view;
+                            glm::mat4 projection;
+                            glm::mat4 viewProj;
+                            glm::vec4 position;
+                        };
+                        struct ObjectConstants {
+                            glm::mat4 world;
+                        };
+
+                        FrameRingWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        FrameRingWrapper& operator=(FrameRingWrapper&& other) noexcept {
+                            if(this != &other) {
+                                ringBuffer = std::move(other.ringBuffer);
+                                descriptorSetLayout = std::move(other.descriptorSetLayout);
+                                descriptorPool = std::move(other.descriptorPool);
+                                descriptorSet = other.descriptorSet;
+                                partitionSize = other.partitionSize;
+                                alignment = other.alignment;
+                            }
+                            return *this;
+                        }
+
+                        void initFrameRing(vk::DeviceSize partitionBytes);
+
+                        // フレームの領域を先頭に戻す（そのフレームのGPU処理が完了している前提）
+                        void beginFrame(uint64_t frameNumber);
+
+                        // 確保した領域のオフセット（ダイナミックオフセットに使う）と書き込み先
+                        struct Allocation {
+                            uint32_t offset;
+                            void* data;
+                        };
+                        Allocation allocate(vk::DeviceSize size);
+
+                        uint32_t writeCamera(const CameraConstants& camera);
+                        uint32_t writeObjects(const ObjectConstants* objects, size_t count);
+
+                        vk::DescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout.get(); }
+                        vk::DescriptorSet getDescriptorSet() { return descriptorSet; }
+                        uint32_t getCameraOffset() const { return cameraOffset; }
+                        vk::DeviceSize getFrameBytes() const { return cursor - frameBegin; }
+                        vk::DeviceSize getPartitionSize() const { return partitionSize; }
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        BufferResource ringBuffer;
+                        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+                        vk::UniqueDescriptorPool descriptorPool;
+                        vk::DescriptorSet descriptorSet;
+
+                        vk::DeviceSize partitionSize = 0;
+                        vk::DeviceSize alignment = 256;//min(Uniform|Storage)BufferOffsetAlignmentの大きい方
+                        vk::DeviceSize frameBegin = 0;
+                        vk::DeviceSize cursor = 0;
+                        uint32_t cameraOffset = 0;
+                };
+                FrameRingWrapper frameRingWrapper;
+
+                // 全モデル共有のジオメトリプール（geometry::Worldの内容を転送する）
+                // 頂点とインデックスを1つのバッファに置き、ジオメトリごとに [頂点][インデックス] の範囲を割り当てる
+                // 範囲は常駐管理（render::ResidencyManager）に従って退避・再転送し、シーン全体を1組のバインドで描画する
+                class GeometryBufferWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        // プール内の位置（頂点・インデックス単位）
+                        struct Placement {
+                            uint32_t vertexOffset = 0;
+                            uint32_t firstIndex = 0;
+                            uint64_t byteOffset = 0;
+                            bool resident = false;
+                        };
+
+                        GeometryBufferWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        GeometryBufferWrapper& operator=(GeometryBufferWrapper&& other) noexcept {
+                            if(this != &other) {
+                                poolBuffer = std::move(other.poolBuffer);
+                                positionBuffer = std::move(other.positionBuffer);
+                                quantizedPositions = other.quantizedPositions;
+                                allocator = std::move(other.allocator);
+                                placements = std::move(other.placements);
+                                geometryBytes = std::move(other.geometryBytes);
+                                vertexCounts = std::move(other.vertexCounts);
+                                stagingBuffer = std::move(other.stagingBuffer);
+                                stagingCursor = other.stagingCursor;
+                                poolCopies = std::move(other.poolCopies);
+                                positionCopies = std::move(other.positionCopies);
+                            }
+                            return *this;
+                        }
+
+                        // poolBytesを上限にプールを作り、先頭のジオメトリから入るだけ転送する（残りは非常駐）
+                        void upload(const geometry::World& world, vk::DeviceSize poolBytes);
+                        void bind(vk::CommandBuffer commandBuffer);
+                        // 頂点をシェーダで読み出す場合はインデックスバッファのみ
+                        void bindIndices(vk::CommandBuffer commandBuffer);
+                        // 位置だけのストリームとインデックスバッファ（深度のみのパス用。頂点番号はプールと共通）
+                        void bindPositions(vk::CommandBuffer commandBuffer);
+
+                        // 位置ストリームを半精度で持つか（次のupload()から反映）
+                        void setQuantizedPositions(bool enabled) { quantizedPositions = enabled; }
+                        bool getQuantizedPositions() const { return quantizedPositions; }
+                        vk::DeviceSize getPositionStride() const;
+                        vk::Format getPositionFormat() const;
+
+                        // ジオメトリの内容（頂点・インデックス・位置だけのストリームの順）を書き出す（ワーカースレッドから呼べる）
+                        static void readGeometry(const geometry::World& world, uint32_t geometryIndex, std::vector<uint8_t>& data);
+                        // 空きが無ければfalse。内容はステージングバッファに書き、プールへの転送はrecordUploadsで記録する
+                        // 前のフレームの完了後、そのフレームの記録より前に呼ぶ
+                        bool makeResident(uint32_t geometryIndex, const std::vector<uint8_t>& data);
+                        void evict(uint32_t geometryIndex);
+                        // makeResidentで溜まったプール・位置ストリームへの転送を記録する（グラフィックスのコマンドバッファの先頭で呼ぶ）
+                        void recordUploads(vk::CommandBuffer commandBuffer);
+
+                        const Placement& getPlacement(uint32_t geometryIndex) const { return placements[geometryIndex]; }
+                        uint64_t getGeometryBytes(uint32_t geometryIndex) const { return geometryBytes[geometryIndex]; }
+                        vk::DeviceSize getPoolCapacity() const { return allocator.getCapacity(); }
+                        uint32_t getHeapIndex();//プールを置くメモリヒープ（デバイスローカル。常駐の予算はこのヒープから決める）
+
+                        BufferResource& getVertexBuffer() { return poolBuffer; }
+                        BufferResource& getIndexBuffer() { return poolBuffer; }
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        BufferResource poolBuffer;
+                        BufferResource positionBuffer;//プールの頂点番号で参照する位置だけのストリーム
+                        bool quantizedPositions = false;
+                        render::RangeAllocator allocator;
+                        std::vector<Placement> placements;
+                        std::vector<uint64_t> geometryBytes;
+                        std::vector<uint32_t> vertexCounts;
+
+                        // デバイスローカルのプールへ送る内容（記録前の転送の領域は1フレームの間使い続ける）
+                        BufferResource stagingBuffer;
+                        vk::DeviceSize stagingCursor = 0;
+                        std::vector<vk::BufferCopy> poolCopies;
+                        std::vector<vk::BufferCopy> positionCopies;
+                        uint8_t* stage(vk::DeviceSize size, vk::DeviceSize& offset);
+                        void flushUploads();
+
+                        void writePositions(uint32_t vertexOffset, const uint8_t* positions, uint32_t vertexCount);
+                };
+                GeometryBufferWrapper geometryBufferWrapper;
+
+                // GPUのタイムスタンプをrender::profilerのゾーンとして記録する
+                // VK_EXT_calibrated_timestampsがあれば回収のたびにデバイスとホストの時刻を対応付け、
+                // 無ければ初期化時に1度だけ合わせる（GPUのゾーンが提出より前に表示されない側へずらす）
+                class GpuProfilerWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        GpuProfilerWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        GpuProfilerWrapper& operator=(GpuProfilerWrapper&& other) noexcept {
+                            if(this != &other) {
+                                queryPool = std::move(other.queryPool);
+                                supported = other.supported;
+                                calibrated = other.calibrated;
+                                hostTimeDomain = other.hostTimeDomain;
+                                timestampPeriod = other.timestampPeriod;
+                                timestampMask = other.timestampMask;
+                                deviceToHostOffset = other.deviceToHostOffset;
+                            }
+                            return *this;
+                        }
+
+                        void initGpuProfiler();
+
+                        // フレームの記録前に呼ぶ（前フレームの結果は回収済みの前提）
+                        void beginFrame();
+                        // 戻り値をendZoneに渡す（記録しない場合はUINT32_MAX）
+                        // trackとnameは文字列リテラルなど、トレースの書き出しまで有効なものを渡す
+                        uint32_t beginZone(vk::CommandBuffer commandBuffer, const char* track, const char* name);
+                        void endZone(vk::CommandBuffer commandBuffer, uint32_t zone);
+                        // キューの完了後に結果を読み、トレースの記録中ならプロファイラへ記録する
+                        void collect();
+                        // collect()で読んだゾーンの時間（beginZoneの戻り値を渡す。計測していなければfalse）
+                        bool getZoneMilliseconds(uint32_t zone, double& milliseconds) const;
+                        // タイムスタンプが使えるか（initGpuProfilerの後に有効）
+                        bool isSupported() const { return supported; }
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        vk::UniqueQueryPool queryPool;
+                        static constexpr uint32_t kMaxQueries = 64;
+                        bool supported = false;
+                        bool calibrated = false;
+                        bool active = false;//このフレームで計測しているか
+                        bool traced = false;//このフレームの結果をトレースへ記録するか
+                        vk::TimeDomainEXT hostTimeDomain = vk::TimeDomainEXT::eDevice;
+                        double timestampPeriod = 1.0;//ナノ秒/tick
+                        uint64_t timestampMask = UINT64_MAX;
+                        int64_t deviceToHostOffset = 0;//ナノ秒
+
+                        struct Zone {
+                            const char* track;
+                            const char* name;
+                            uint32_t query;
+                        };
+                        std::vector<Zone> zones;
+                        std::vector<double> zoneMilliseconds;//collect()で読んだゾーンごとの時間
+                        uint32_t queryCount = 0;
+
+                        uint64_t toHostNanoseconds(uint64_t ticks) const {
+                            return static_cast<uint64_t>(static_cast<int64_t>((ticks & timestampMask) * timestampPeriod) + deviceToHostOffset);
+                        }
+                        void calibrate();
+                        void calibrateBySubmit();
+                };
+                GpuProfilerWrapper gpuProfilerWrapper;
+
+                // 深度バッファと、その深度から作る階層Z（ミップごとに2×2の最大深度を持つピラミッド）
+                // ミップ0は深度の半分の解像度で、各テクセルが深度の 2^(level+1) ピクセル四方を覆う（端は最後のピクセルで補う）
+                // 全ミップをshader/depthPyramid.compの1回のディスパッチで作る
+                class DepthPyramidWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        static constexpr vk::Format kDepthFormat = vk::Format::eD32Sfloat;
+                        static constexpr uint32_t kMaxLevels = 16;
+
+                        DepthPyramidWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        DepthPyramidWrapper& operator=(DepthPyramidWrapper&& other) noexcept {
+                            if(this != &other) {
+                                depthImage = std::move(other.depthImage);
+                                pyramidImage = std::move(other.pyramidImage);
+                                levelViews = std::move(other.levelViews);
+                                sampler = std::move(other.sampler);
+                                counterBuffer = std::move(other.counterBuffer);
+                                descriptorSetLayout = std::move(other.descriptorSetLayout);
+                                descriptorPool = std::move(other.descriptorPool);
+                                descriptorSet = other.descriptorSet;
+                                pipelineLayout = std::move(other.pipelineLayout);
+                                pipeline = std::move(other.pipeline);
+                                supported = other.supported;
+                                renderExtent = other.renderExtent;
+                            }
+                            return *this;
+                        }
+
+                        void initDepthPyramid(vk::Extent2D extent);
+                        // 大きさが変わった場合は作り直してtrueを返す（GPUが使っていない間に呼ぶ）
+                        bool resize(vk::Extent2D extent);
+                        // 深度バッファのうち描画に使う範囲（左上から。動的解像度で縮小したときは一部になる）
+                        void setRenderExtent(vk::Extent2D extent);
+
+                        // 深度バッファを読める状態にして階層Zを作り、深度バッファを描画できる状態へ戻す
+                        // consumerStagesは階層Zを読むステージ
+                        void build(vk::CommandBuffer commandBuffer, vk::PipelineStageFlags consumerStages);
+
+                        bool isSupported() const { return supported; }
+                        vk::Image getDepthImage() { return depthImage.image.get(); }
+                        vk::ImageView getDepthView() { return depthImage.view.get(); }
+                        vk::ImageView getPyramidView() { return pyramidImage.view.get(); }
+                        vk::Sampler getSampler() { return sampler.get(); }
+                        vk::Extent2D getDepthExtent() const { return depthImage.extent; }
+                        vk::Extent2D getRenderExtent() const { return renderExtent; }
+                        uint32_t getLevelCount() const { return pyramidImage.mipLevels; }
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        ImageResource depthImage;
+                        ImageResource pyramidImage;
+                        std::vector<vk::UniqueImageView> levelViews;
+                        vk::UniqueSampler sampler;
+                        BufferResource counterBuffer;//終わったワークグループの数（最後のワークグループが0に戻す）
+
+                        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+                        vk::UniqueDescriptorPool descriptorPool;
+                        vk::DescriptorSet descriptorSet;
+                        vk::UniquePipelineLayout pipelineLayout;
+                        vk::UniquePipeline pipeline;
+                        bool supported = false;
+                        vk::Extent2D renderExtent;
+
+                        void createImages(vk::Extent2D extent);
+                        void initPyramidLayout();
+                };
+                DepthPyramidWrapper depthPyramidWrapper;
+
+                // 動的解像度
+                // 出力と同じ大きさの描画先の左上の一部にシーンを描き、フィルタ付きの転送でスワップチェインのイメージへ拡大する
+                // 描画先を作り直さずに倍率を変えられるよう、深度バッファと階層Zも一部の範囲だけを使う
+                class DynamicResolutionWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        DynamicResolutionWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        DynamicResolutionWrapper& operator=(DynamicResolutionWrapper&& other) noexcept {
+                            if(this != &other) {
+                                targetImage = std::move(other.targetImage);
+                                controller = other.controller;
+                                filter = other.filter;
+                                supported = other.supported;
+                                enabled = other.enabled;
+                                active = other.active;
+                                scale = other.scale;
+                                renderExtent = other.renderExtent;
+                                trace = std::move(other.trace);
+                            }
+                            return *this;
+                        }
+
+                        // スワップチェインの作成後に呼ぶ
+                        void initDynamicResolution();
+                        // このフレームの描画の大きさを決める（有効なら出力と同じ大きさの描画先を用意する）
+                        void beginFrame(vk::Extent2D outputExtent);
+                        // グラフィックスキューのコマンドの最初と最後に記録する（GpuProfilerWrapperのゾーンでフレームのGPU時間を測る）
+                        void beginFrameZone(vk::CommandBuffer commandBuffer);
+                        void endFrameZone(vk::CommandBuffer commandBuffer);
+                        // 描画先を出力の大きさへ拡大し、表示できるレイアウトにする
+                        void recordUpscale(vk::CommandBuffer commandBuffer, vk::Image outputImage, vk::Extent2D outputExtent);
+                        // GpuProfilerWrapper::collect()の後に呼ぶ（GPU時間から次のフレームの倍率を決める）
+                        void collect();
+
+                        void setEnabled(bool value);
+                        bool isEnabled() const { return enabled; }
+                        bool isSupported() const { return supported; }
+                        bool isActive() const { return active; }
+                        void setSettings(const render::DynamicResolutionSettings& settings) { controller.setSettings(settings); }
+                        float getScale() const { return scale; }
+                        vk::Extent2D getRenderExtent() const { return renderExtent; }
+                        vk::ImageView getTargetView() { return targetImage.view.get(); }
+                        vk::Image getTargetImage() { return targetImage.image.get(); }
+                        const std::vector<render::ResolutionSample>& getTrace() const { return trace; }
+                        void resetTrace() { trace.clear(); }
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        ImageResource targetImage;//出力と同じ大きさ（有効にしたときに作る）
+                        render::ResolutionController controller;
+                        uint32_t frameZone = UINT32_MAX;//GPU時間を読むGpuProfilerWrapperのゾーン
+                        vk::Filter filter = vk::Filter::eLinear;
+                        bool supported = false;
+                        bool enabled = false;
+                        bool active = false;//このフレームで描画先に描くか
+                        float scale = 1.0f;//このフレームの倍率
+                        vk::Extent2D renderExtent;
+                        std::vector<render::ResolutionSample> trace;
+                        uint64_t frameCounter = 0;
+                        double printMilliseconds = 0.0;//出力の間隔ごとの累積
+                        float printMinScale = 1.0f;
+                };
+                DynamicResolutionWrapper dynamicResolutionWrapper;
+
+                // 平行光源のカスケードシャドウマップ
+                // 静的な投影元はカスケードごとのページ（staticPages）に描いてキャッシュし、ライトの向きやカスケードの範囲が
+                // ページから外れたときだけ描き直す。毎フレーム、ページをシャドウマップへ複製してから動的な投影元を重ねて描く
+                // キャッシュ無効時は毎フレームすべての投影元をシャドウマップへ直接描く（比較用）
+                // 投影元は描画レコードと同じ番号で、カスケードごとの選別はシーンのBVHを使ってジョブで並列に行う
+                class ShadowMapWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        static constexpr vk::Format kShadowFormat = vk::Format::eD16Unorm;
+
+                        // シェーダ側（shader/meshletShadow.glsl）と同じレイアウト
+                        struct ShadowParams {
+                            glm::mat4 cascadeViewProj[render::kMaxShadowCascades];
+                            glm::vec4 splitDepths;//カスケードの奥側の境界（カメラの前方向の距離）
+                            glm::vec4 lightDirection;//xyz: ライトへ向かう向き
+                            uint32_t cascadeCount;//0なら影を付けない
+                            float texelSize;//テクスチャ座標での1テクセル
+                            uint32_t pad0;
+                            uint32_t pad1;
+                        };
+
+                        // 影を落とす描画レコード
+                        struct Caster {
+                            glm::mat4 worldMatrix;
+                            uint32_t geometryIndex;
+                            uint32_t indexCount;
+                            bool dynamic;//スキニング・モーフターゲットで形が変わるもの（毎フレーム描く）
+                            bool enabled;//三角形リストのみ
+                        };
+
+                        ShadowMapWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        ShadowMapWrapper& operator=(ShadowMapWrapper&& other) noexcept {
+                            if(this != &other) {
+                                staticPages = std::move(other.staticPages);
+                                shadowMap = std::move(other.shadowMap);
+                                staticLayerViews = std::move(other.staticLayerViews);
+                                shadowLayerViews = std::move(other.shadowLayerViews);
+                                sampler = std::move(other.sampler);
+                                paramsBuffer = std::move(other.paramsBuffer);
+                                pipelineLayout = std::move(other.pipelineLayout);
+                                pipeline = std::move(other.pipeline);
+                                casters = std::move(other.casters);
+                                staticCasterGeometry = std::move(other.staticCasterGeometry);
+                                casterBounds = other.casterBounds;
+                                pages = other.pages;
+                                pageValid = other.pageValid;
+                                ready = other.ready;
+                                enabled = other.enabled;
+                                cachingEnabled = other.cachingEnabled;
+                                lightDirection = other.lightDirection;
+                                settings = other.settings;
+                            }
+                            return *this;
+                        }
+
+                        // シャドウマップ・ページ・描画パイプラインを作る（位置ストリームの形式に合わせるため、ジオメトリの転送後に呼ぶ）
+                        void initShadowMaps();
+                        // 投影元を入れ替え、全ページを描き直す。boundsは全投影元を囲むAABB
+                        void setCasters(std::vector<Caster> newCasters, const geometry::Aabb& bounds);
+                        // 投影元を動かす。boundsの内側で動かすこと（静的な投影元なら全ページを描き直す）
+                        void setCasterMatrix(uint32_t casterIndex, const glm::mat4& matrix);
+                        // 静的な投影元が使うジオメトリの常駐状態が変わった場合に全ページを描き直す
+                        void invalidateGeometry(uint32_t geometryIndex);
+                        void invalidate() { pageValid.fill(false); }
+
+                        // カスケードを合わせ、ページを使い回せるか判定し、カスケードごとの投影元を選ぶ（記録の前に呼ぶ）
+                        void update(const glm::mat4& view, const glm::mat4& projection);
+                        // レンダリングの外で記録する。終了時はシャドウマップをフラグメントシェーダから読める状態にする
+                        void record(vk::CommandBuffer commandBuffer);
+                        // GpuProfilerWrapper::collect()の後に呼ぶ
+                        void collectStatistics();
+
+                        vk::ImageView getShadowView() { return shadowMap.view.get(); }
+                        vk::Sampler getSampler() { return sampler.get(); }
+                        BufferResource& getParamsBuffer() { return paramsBuffer; }
+
+                        const ShadowStatistics& getStatistics() const { return statistics[cachingEnabled ? 1 : 0]; }
+                        void resetStatistics();
+
+                        bool enabled = true;
+                        bool cachingEnabled = true;
+                        glm::vec3 lightDirection = glm::normalize(glm::vec3(0.4f, 0.8f, 0.4f));
+                        render::ShadowSettings settings;//initShadowMapsより前に変える
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        ImageResource staticPages;//静的な投影元だけを描いたカスケードごとのページ
+                        ImageResource shadowMap;//ページに動的な投影元を重ねたもの（描画で参照する）
+                        std::vector<vk::UniqueImageView> staticLayerViews;
+                        std::vector<vk::UniqueImageView> shadowLayerViews;
+                        vk::UniqueSampler sampler;//比較サンプラー
+                        BufferResource paramsBuffer;
+                        vk::UniquePipelineLayout pipelineLayout;
+                        vk::UniquePipeline pipeline;
+                        bool ready = false;
+
+                        std::vector<Caster> casters;
+                        std::vector<uint8_t> staticCasterGeometry;//ジオメトリごとに、静的な投影元が使うか
+                        geometry::Aabb casterBounds;
+
+                        // キャッシュしたページと、このフレームで描くカスケード（キャッシュ無効時はページと別に毎フレーム作る）
+                        std::array<render::ShadowPage, render::kMaxShadowCascades> pages;
+                        std::array<bool, render::kMaxShadowCascades> pageValid{};
+                        std::array<render::ShadowPage, render::kMaxShadowCascades> cascades;
+                        std::array<bool, render::kMaxShadowCascades> renderStatic{};//このフレームで静的な投影元を描くか
+                        uint32_t cascadeCount = 0;
+                        bool active = false;//このフレームで描くか
+                        bool cachedFrame = false;//このフレームをキャッシュ有効で描いたか（統計の振り分け）
+
+                        // カスケードごとの選別結果（容量は使い回す）
+                        std::array<std::vector<uint32_t>, render::kMaxShadowCascades> visibleCasters;
+                        std::array<std::vector<uint32_t>, render::kMaxShadowCascades> staticDrawList;
+                        std::array<std::vector<uint32_t>, render::kMaxShadowCascades> dynamicDrawList;
+
+                        // GPU時間を読むGpuProfilerWrapperのゾーン（記録しなかったフレームはUINT32_MAX）
+                        uint32_t shadowZone = UINT32_MAX;
+
+                        // 統計（0: キャッシュ無効, 1: キャッシュ有効）
+                        ShadowStatistics statistics[2];
+                        ShadowStatistics frameStatistics;//記録中のフレーム
+                        uint64_t frameCounter = 0;
+
+                        void createImages();
+                        void createPipeline();
+                        // 1つのカスケードへの描画を始める（loadOpがeClearならクリアする）。終わりはendRendering
+                        void beginLayer(vk::CommandBuffer commandBuffer, vk::ImageView view, vk::AttachmentLoadOp loadOp);
+                        void drawCasters(vk::CommandBuffer commandBuffer, const render::ShadowPage& cascade, const std::vector<uint32_t>& drawList, uint64_t& drawCount);
+                };
+                ShadowMapWrapper shadowMapWrapper;
+
+                // クラスタ単位のライトの割り当て（コンピュートキュー）
+                // 視錐台を画面のタイルと指数分割した奥行きでクラスタに分け、影響範囲の球が重なるライトの番号をクラスタごとに書き出す
+                // フラグメントシェーダは自分のクラスタのライトだけを計算する（平行光源はすべての画素で計算する）
+                class LightClusterWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        // シェーダ側（shader/meshletLights.glsl）と同じレイアウト
+                        struct ClusterParams {
+                            glm::mat4 view;
+                            glm::uvec4 gridSize;//xyz: クラスタ数, w: 1クラスタの最大ライト数
+                            glm::vec2 screenSize;//ピクセル
+                            glm::vec2 projectionScale;//射影行列の[0][0]と[1][1]
+                            float zNear;
+                            float zFar;
+                            float sliceScale;//slice = log(奥行き) * sliceScale + sliceBias
+                            float sliceBias;
+                            uint32_t lightCount;//平行光源を含む
+                            uint32_t directionalCount;//先頭に並べた平行光源の数
+                            uint32_t clustered;//0ならクラスタのライトを読まない
+                            uint32_t pad0;
+                        };
+
+                        LightClusterWrapper(DeviceWrapper& dev) : deviceWrapper(dev), commandBufWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        LightClusterWrapper& operator=(LightClusterWrapper&& other) noexcept {
+                            if(this != &other) {
+                                commandBufWrapper = std::move(other.commandBufWrapper);
+                                paramsBuffer = std::move(other.paramsBuffer);
+                                lightBuffer = std::move(other.lightBuffer);
+                                gridBuffer = std::move(other.gridBuffer);
+                                indexBuffer = std::move(other.indexBuffer);
+                                descriptorSetLayout = std::move(other.descriptorSetLayout);
+                                descriptorPool = std::move(other.descriptorPool);
+                                descriptorSet = other.descriptorSet;
+                                pipelineLayout = std::move(other.pipelineLayout);
+                                pipeline = std::move(other.pipeline);
+                                semaphore = std::move(other.semaphore);
+                                lightCount = other.lightCount;
+                                directionalCount = other.directionalCount;
+                                ready = other.ready;
+                                enabled = other.enabled;
+                            }
+                            return *this;
+                        }
+
+                        // バッファ・パイプラインを作る（カリングのディスクリプタから参照されるため、initMeshletCullより前に呼ぶ）
+                        void initLightClusters();
+                        // ライトを入れ替える（kMaxLightsを超えた分は捨てる）
+                        void setLights(const std::vector<render::SceneLight>& lights);
+                        // パラメータを更新し、割り当てをqueueWrapperに溜める（提出は呼び出し側のflush）。溜めた場合は描画でgetSemaphoreを待つ
+                        bool dispatch(QueueWrapper& queueWrapper);
+                        // GpuProfilerWrapper::collect()の後に呼ぶ
+                        void collectStatistics();
+
+                        vk::Semaphore getSemaphore() { return semaphore.get(); }
+                        BufferResource& getParamsBuffer() { return paramsBuffer; }
+                        BufferResource& getLightBuffer() { return lightBuffer; }
+                        BufferResource& getGridBuffer() { return gridBuffer; }
+                        BufferResource& getIndexBuffer() { return indexBuffer; }
+
+                        const LightStatistics& getStatistics() const { return statistics; }
+                        void resetStatistics() { statistics = LightStatistics{}; }
+
+                        bool enabled = true;
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        CommandBufWrapper commandBufWrapper;//カリングとは別に提出するため専用のものを持つ
+                        BufferResource paramsBuffer;
+                        BufferResource lightBuffer;//GpuLight × kMaxLights
+                        BufferResource gridBuffer;//クラスタごとのライト数（ホストから統計を読む）
+                        BufferResource indexBuffer;//クラスタごとにkMaxLightsPerCluster個のライト番号
+                        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+                        vk::UniqueDescriptorPool descriptorPool;
+                        vk::DescriptorSet descriptorSet;
+                        vk::UniquePipelineLayout pipelineLayout;
+                        vk::UniquePipeline pipeline;
+                        vk::UniqueSemaphore semaphore;
+                        uint32_t lightCount = 0;
+                        uint32_t directionalCount = 0;
+                        bool ready = false;
+                        bool active = false;//このフレームで割り当てを行ったか
+
+                        // GPU時間を読むGpuProfilerWrapperのゾーン（割り当てなかったフレームはUINT32_MAX）
+                        uint32_t clusterZone = UINT32_MAX;
+
+                        LightStatistics statistics;
+                        uint64_t frameCounter = 0;
+
+                        void updateParams();
+                };
+                LightClusterWrapper lightClusterWrapper;
+
+                // メッシュレット単位のカリングと描画
+                // メッシュシェーダ対応時はタスクシェーダで、非対応時はコンピュートキューでカリングする
+                // 遮蔽カリングは2段階で行う（インスタンスメッシュレットごとに前フレームの可視情報を持つ）
+                //   1回目: 前フレームで可視だったものを視錐台・背面だけで判定して描画する
+                //   2回目: 1回目の深度から作った階層Zで全体を判定して可視情報を更新し、1回目で描いていないものを描画する
+                class MeshletCullWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        MeshletCullWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        MeshletCullWrapper& operator=(MeshletCullWrapper&& other) noexcept {
+                            if(this != &other) {
+                                meshletBuffer = std::move(other.meshletBuffer);
+                                meshletVertexBuffer = std::move(other.meshletVertexBuffer);
+                                meshletTriangleBuffer = std::move(other.meshletTriangleBuffer);
+                                workItemBuffer = std::move(other.workItemBuffer);
+                                visibilityBuffer = std::move(other.visibilityBuffer);
+                                geometryMeshletBase = std::move(other.geometryMeshletBase);
+                                meshletLocalFirstIndex = std::move(other.meshletLocalFirstIndex);
+                                scene = std::move(other.scene);
+                                transformBuffer = std::move(other.transformBuffer);
+                                instanceBuffer = std::move(other.instanceBuffer);
+                                materialBuffer = std::move(other.materialBuffer);
+                                drawCommandBuffer = std::move(other.drawCommandBuffer);
+                                statisticsBuffer = std::move(other.statisticsBuffer);
+                                paramsBuffer = std::move(other.paramsBuffer);
+                                descriptorSetLayout = std::move(other.descriptorSetLayout);
+                                descriptorPool = std::move(other.descriptorPool);
+                                descriptorSet = other.descriptorSet;
+                                pipelineLayout = std::move(other.pipelineLayout);
+                                cullPipeline = std::move(other.cullPipeline);
+                                drawPipeline = std::move(other.drawPipeline);
+                                pullDrawPipeline = std::move(other.pullDrawPipeline);
+                                depthInterleavedPipeline = std::move(other.depthInterleavedPipeline);
+                                depthSplitPipeline = std::move(other.depthSplitPipeline);
+                                cullSemaphore = std::move(other.cullSemaphore);
+                                ready = other.ready;
+                            }
+                            return *this;
+                        }
+
+                        void initMeshletCull(const geometry::World& world);
+                        bool isReady() const { return ready; }
+
+                        // ジオメトリのメッシュレットをプール内の位置に合わせて書き換える（非常駐なら描画しない）
+                        void updateGeometryPlacement(uint32_t geometryIndex, const GeometryBufferWrapper::Placement& placement);
+
+                        // トランスフォームを書き換える（値が変わった場合のみ、次のフレームでその範囲だけを書き込む）
+                        void setTransform(uint32_t transformIndex, const glm::mat4& matrix);
+                        // 直前のフレームでシーンの表へ書き込んだ量
+                        const render::SceneUploadStatistics& getUploadStatistics() const { return uploadStatistics; }
+
+                        // 1回目のカリング（コンピュートパスをqueueWrapperに溜めた場合はtrue。提出は呼び出し側のflush）
+                        bool dispatchCull(CommandBufWrapper& commandBufWrapper, QueueWrapper& queueWrapper);
+                        // phaseは0か1（1はisOcclusionActiveのときのみ）
+                        void recordDraw(vk::CommandBuffer commandBuffer, uint32_t phase);
+                        // 階層Zの生成後、2回目の描画の前にグラフィックスキューで記録する
+                        void recordLateCull(vk::CommandBuffer commandBuffer);
+                        // GpuProfilerWrapperのゾーン（1回目の描画と、階層Z・2回目のカリングと描画）を描画時間として集計する
+                        void setDrawZones(uint32_t drawZone, uint32_t lateZone) {
+                            drawZones = {drawZone, lateZone};
+                        }
+                        // GpuProfilerWrapper::collect()の後に呼ぶ
+                        void collectStatistics();
+
+                        // 階層Zを作り直した後に呼ぶ
+                        void updatePyramidDescriptor();
+
+                        vk::Semaphore getCullSemaphore() { return cullSemaphore.get(); }
+                        // 半透明の描画もシーンの表・影・ライトを同じディスクリプタで参照する
+                        vk::DescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout.get(); }
+                        vk::DescriptorSet getDescriptorSet() { return descriptorSet; }
+                        // このフレームで2段階の遮蔽カリングを行うか（dispatchCullで決まる）
+                        bool isOcclusionActive() const { return occlusionActive; }
+
+                        const CullStatistics& getStatistics() const { return statistics[getStatisticsMode()]; }
+                        void resetStatistics();
+
+                        // 頂点をバッファデバイスアドレス経由でシェーダから読み出す経路（間接描画のみ）
+                        bool isVertexPullingSupported() const { return static_cast<bool>(pullDrawPipeline); }
+                        // 深度のみの描画（間接描画のみ）
+                        bool isDepthOnlySupported() const { return static_cast<bool>(depthSplitPipeline); }
+
+                        bool cullingEnabled = true;
+                        bool occlusionEnabled = true;
+                        bool vertexPullingEnabled = false;
+                        DepthOnlyLayout depthOnlyLayout = DepthOnlyLayout::Off;
+
+                    private:
+                        DeviceWrapper& deviceWrapper;
+                        bool ready = false;
+                        bool useMeshShader = false;
+
+                        BufferResource meshletBuffer;
+                        BufferResource meshletVertexBuffer;
+                        BufferResource meshletTriangleBuffer;
+                        BufferResource workItemBuffer;
+                        BufferResource visibilityBuffer;//インスタンスメッシュレットごとの前フレームの可視情報
+                        std::vector<uint32_t> geometryMeshletBase;//ジオメトリごとのメッシュレットの開始位置（末尾に総数）
+                        std::vector<uint32_t> meshletLocalFirstIndex;//ジオメトリ内でのインデックスの開始位置
+                        // 常駐するシーンの表（トランスフォームはメッシュを持つノードごと）
+                        render::GpuScene scene;
+                        BufferResource transformBuffer;
+                        BufferResource instanceBuffer;
+                        BufferResource materialBuffer;
+                        render::SceneUploadStatistics uploadStatistics;
+                        BufferResource drawCommandBuffer;
+                        BufferResource statisticsBuffer;
+                        BufferResource paramsBuffer;
+
+                        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+                        vk::UniqueDescriptorPool descriptorPool;
+                        vk::DescriptorSet descriptorSet;
+                        vk::UniquePipelineLayout pipelineLayout;
+                        vk::UniquePipeline cullPipeline;
+                        vk::UniquePipeline drawPipeline;
+                        vk::UniquePipeline pullDrawPipeline;//頂点入力を持たない描画パイプライン（頂点プル）
+                        vk::UniquePipeline depthInterleavedPipeline;//深度のみ（プールの頂点から位置を読む）
+                        vk::UniquePipeline depthSplitPipeline;//深度のみ（位置ストリームを読む）
+                        vk::UniqueSemaphore cullSemaphore;
+
+                        bool occlusionSupported = false;
+                        bool occlusionActive = false;
+
+                        // このフレームのGpuProfilerWrapperのゾーン（計測しない場合はUINT32_MAX）
+                        uint32_t cullZone = UINT32_MAX;
+                        std::array<uint32_t, 2> drawZones = {UINT32_MAX, UINT32_MAX};
+
+                        uint32_t workItemCount = 0;
+                        uint64_t totalTriangles = 0;
+
+                        // 統計（0: カリング無効, 1: 視錐台・背面, 2: 視錐台・背面・遮蔽）
+                        CullStatistics statistics[3];
+                        uint64_t frameCounter = 0;
+                        size_t getStatisticsMode() const {
+                            return cullingEnabled ? (occlusionEnabled && occlusionSupported ? 2 : 1) : 0;
+                        }
+
+                        void createDescriptors();
+                        void createPipelines();
+                        vk::UniquePipeline createDrawPipeline(const std::vector<vk::PipelineShaderStageCreateInfo>& shaderStages, const vk::PipelineVertexInputStateCreateInfo* vertexInput, bool writeColor);
+                        void updateParams();
+                };
+                MeshletCullWrapper meshletCullWrapper;
+
+                // 半透明のインスタンスの描画（不透明の描画の後に、不透明の深度で判定して深度は書かない）
+                // インスタンスの番号は描画レコードと同じで、変換とマテリアルはメッシュレットの描画と同じシーンの表を参照する
+                //   ソート: 視錐台内のインスタンスを奥から手前へ並べ、同じジオメトリが続く範囲ごとに描いてアルファブレンドで重ねる
+                //   重み付きOIT: ジオメトリごとにまとめてインスタンス描画し、順序に依らない累積色と透過率を全画面パスで合成する
+                class TransparencyWrapper{
+                    friend class DeviceWrapper;
+                    public:
+                        static constexpr vk::Format kAccumulationFormat = vk::Format::eR16G16B16A16Sfloat;
+                        static constexpr vk::Format kRevealageFormat = vk::Format::eR16Sfloat;
+
+                        // 描画レコードごとの半透明の面
+                        struct Surface {
+                            uint32_t geometryIndex;
+                            uint32_t indexCount;
+                            bool enabled;//半透明の三角形リストのみ
+                        };
+
+                        TransparencyWrapper(DeviceWrapper& dev) : deviceWrapper(dev) {};
+
+                        //ムーブ代入演算子
+                        TransparencyWrapper& operator=(TransparencyWrapper&& other) noexcept {
+                            if(this != &other) {
+                                accumulationImage = std::move(other.accumulationImage);
+                                revealageImage = std::move(other.revealageImage);
+                                sampler = std::move(other.sampler);
+                                drawInstanceBuffer = std::move(other.drawInstanceBuffer);
+                                descriptorSetLayout = std::move(other.descriptorSetLayout);
+                                descriptorPool = std::move(other.descriptorPool);
+                                descriptorSet = other.descriptorSet;
+                                pipelineLayout = std::move(other.pipelineLayout);
+                                sortedPipeline = std::move(other.sortedPipeline);
+                                accumulatePipeline = std::move(other.accumulatePipeline);
+                                resolvePipeline = std::move(other.resolvePipeline);
+                                surfaces = std::move(other.surfaces);
+                                transparentCount = other.transparentCount;
+                                ready = other.ready;
+                                orderIndependent = other.orderIndependent;
+                            }
+                            return *this;
+                        }
+
+                        // 面を入れ替え、蓄積先・パイプラインを作る（カリングのディスクリプタを使うため、initMeshletCullの後に呼ぶ）
+                        void initTransparency(std::vector<Surface> newSurfaces);
+                        // スナップショットの描画リスト（視錐台内のレコードをソート済み）の半透明の部分から描画を組み立てる（記録の前に呼ぶ）
+                        void update(const render::DrawList& drawList);
+                        // renderingInfoの描画中に呼び、同じ描画中の状態で戻る（OITでは一度終えて蓄積先へ描き、合成のために開き直す）
+                        // renderingInfoのアタッチメントは読み込み（eLoad）にしておく
+                        void record(vk::CommandBuffer commandBuffer, const vk::RenderingInfo& renderingInfo);
+                        // GpuProfilerWrapper::collect()の後に呼ぶ
+                        void collectStatistics();
+
+                        const TransparencyStatistics& getStatistics() const { return statistics[orderIndependent ? 1 : 0]; }
+                        void resetStatistics();
+
+                        bool orderIndependent = false;
+
+                    private:
+                        // 同じジオメトリのインスタンスをまとめた1回の描画（drawInstanceBufferのfirstInstanceから）
+                        struct Batch {
+                            uint32_t geometryIndex;
+                            uint32_t indexCount;
+                            uint32_t firstInstance;
+                            uint32_t instanceCount;
+                        };
+
+                        DeviceWrapper& deviceWrapper;
+                        ImageResource accumulationImage;//描画範囲はスワップチェインの大きさの左上
+                        ImageResource revealageImage;
+                        vk::UniqueSampler sampler;
+                        BufferResource drawInstanceBuffer;//このフレームで描くインスタンスの番号
+                        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+                        vk::UniqueDescriptorPool descriptorPool;
+                        vk::DescriptorSet descriptorSet;
+                        vk::UniquePipelineLayout pipelineLayout;
+                        vk::UniquePipeline sortedPipeline;
+                        vk::UniquePipeline accumulatePipeline;
+                        vk::UniquePipeline resolvePipeline;
+                        bool ready = false;
+
+                        std::vector<Surface> surfaces;
+                        uint32_t transparentCount = 0;
+
+                        // このフレームの描画（容量は使い回す）
+                        std::vector<Batch> batches;
+                        std::vector<uint32_t> geometryBatch;//ジオメトリごとのbatchesの番号（OITの振り分け中のみ使う）
+                        uint32_t instanceCount = 0;
+                        bool active = false;//このフレームで描くか
+                        bool orderIndependentFrame = false;//このフレームをOITで描くか（統計の振り分け）
+                        uint32_t transparencyZone = UINT32_MAX;//GPU時間を読むGpuProfilerWrapperのゾーン（描かなかったフレームはUINT32_MAX）
+
+                        // 統計（0: ソート, 1: 重み付きOIT）
+                        TransparencyStatistics statistics[2];
+                        TransparencyStatistics frameStatistics;//記録中のフレーム
+                        uint64_t frameCounter = 0;
+
+                        void createTargets(vk::Extent2D extent);
+                        void createPipelines();
+                        vk::UniquePipeline createPipeline(const std::vector<vk::PipelineShaderStageCreateInfo>& shaderStages, const vk::PipelineVertexInputStateCreateInfo& vertexInput,
+                                                          const std::vector<vk::PipelineColorBlendAttachmentState>& blendAttachments, const std::vector<vk::Format>& colorFormats, bool depthTest);
+                        void drawBatches(vk::CommandBuffer commandBuffer, vk::Pipeline pipeline, vk::Extent2D extent);
+                };
+                TransparencyWrapper transparencyWrapper;
+
+        };
+        DeviceWrapper deviceWrapper;
+
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "world.hpp"
+#include "profiler.hpp"
+
+namespace geometry {
+
+namespace {
+
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+bool sameContent(const Primitive& a, const Primitive& b) {
+    return a.vertices.size() == b.vertices.size()
+        && a.indices.size() == b.indices.size()
+        && a.topology == b.topology
+        && std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(StaticVertexAttributes)) == 0
+        && std::memcmp(a.indices.data(), b.indices.data(), a.indices.size() * sizeof(uint32_t)) == 0;
+}
+
+} // namespace
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * kFnvPrime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+void World::addModel(Model& model) {
+    PROFILE_ZONE("world.addModel");
+    models.push_back(&model);
+    for (Mesh& mesh : model.meshes) {
+        for (Primitive& primitive : mesh.primitives) {
+            primitive.geometryIndex = addGeometry(primitive);
+            const GeometryRange& range = geometries[primitive.geometryIndex];
+            primitive.vertexOffset = range.vertexOffset;
+            primitive.firstIndex = range.firstIndex;
+            statistics.primitiveCount++;
+        }
+    }
+}
+
+void World::clear() {
+    models.clear();
+    vertices.clear();
+    indices.clear();
+    geometries.clear();
+    geometryByHash.clear();
+    statistics = {};
+}
+
+uint32_t World::addGeometry(const Primitive& primitive) {
+    size_t vertexBytes = primitive.vertices.size() * sizeof(StaticVertexAttributes);
+    size_t indexBytes = primitive.indices.size() * sizeof(uint32_t);
+    uint64_t hash = hashBytes(primitive.vertices.data(), vertexBytes);
+    hash = hashBytes(primitive.indices.data(), indexBytes, hash);
+
+    // ハッシュが一致した場合も内容を比較してから共有する
+    auto [first, last] = geometryByHash.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        if (sameContent(*geometries[it->second].source, primitive)) {
+            statistics.deduplicatedBytes += vertexBytes + indexBytes;
+            return it->second;
+        }
+    }
+
+    GeometryRange range;
+    range.vertexOffset = static_cast<uint32_t>(vertices.size());
+    range.vertexCount = static_cast<uint32_t>(primitive.vertices.size());
+    range.firstIndex = static_cast<uint32_t>(indices.size());
+    range.hash = hash;
+    range.source = &primitive;
+    vertices.insert(vertices.end(), primitive.vertices.begin(), primitive.vertices.end());
+
+    if (primitive.meshlets.empty()) {
+        indices.insert(indices.end(), primitive.indices.begin(), primitive.indices.end());
+    } else {
+        for (const Meshlet& meshlet : primitive.meshlets) {
+            for (uint32_t t = 0; t < meshlet.triangleCount * 3; t++) {
+                indices.push_back(primitive.meshletVertices[meshlet.vertexOffset + primitive.meshletTriangles[meshlet.triangleOffset * 3 + t]]);
+            }
+        }
+    }
+    range.indexCount = static_cast<uint32_t>(indices.size()) - range.firstIndex;
+
+    uint32_t geometryIndex = static_cast<uint32_t>(geometries.size());
+    geometries.push_back(range);
+    geometryByHash.emplace(hash, geometryIndex);
+
+    statistics.uniqueGeometryCount++;
+    statistics.vertexBytes += vertexBytes;
+    statistics.indexBytes += range.indexCount * sizeof(uint32_t);
+    return geometryIndex;
+}
+
+}
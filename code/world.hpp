@@ -0,0 +1,54 @@
+#pragma once
+#include "geometry.hpp"
+
+namespace geometry {
+
+// 内容ハッシュ（FNV-1aを8バイト単位で適用）
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// 共有バッファ内の1ジオメトリの範囲
+struct GeometryRange {
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint64_t hash;
+    const Primitive* source;//最初に登録したプリミティブ（メッシュレットの参照と内容の比較に使う）
+};
+
+struct WorldStatistics {
+    uint32_t primitiveCount = 0;
+    uint32_t uniqueGeometryCount = 0;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t deduplicatedBytes = 0;//重複排除で格納しなかった量
+};
+
+// 全モデルの頂点・インデックスを1組の共有配列に詰めるレジストリ
+// 内容がバイト単位で同一のプリミティブ（別ファイルのものを含む）は1度だけ格納し、範囲を共有する
+// メッシュレットを持つプリミティブのインデックスはメッシュレット順に並べる（メッシュレットの範囲がそのまま部分範囲になる）
+class World {
+    public:
+        // プリミティブのvertexOffset/firstIndex/geometryIndexを共有配列内の位置に設定する
+        // モデルはWorldより長く生存すること
+        void addModel(Model& model);
+        void clear();
+
+        const std::vector<Model*>& getModels() const { return models; }
+        const std::vector<StaticVertexAttributes>& getVertices() const { return vertices; }
+        const std::vector<uint32_t>& getIndices() const { return indices; }
+        const std::vector<GeometryRange>& getGeometries() const { return geometries; }
+        const WorldStatistics& getStatistics() const { return statistics; }
+
+    private:
+        std::vector<Model*> models;
+        std::vector<StaticVertexAttributes> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<GeometryRange> geometries;
+        std::unordered_multimap<uint64_t, uint32_t> geometryByHash;
+        WorldStatistics statistics;
+
+        uint32_t addGeometry(const Primitive& primitive);
+};
+
+}
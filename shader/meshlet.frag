@@ -0,0 +1,27 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#include "meshletCommon.glsl"
+#include "meshletShadow.glsl"
+#include "meshletLights.glsl"
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) flat in uint inMaterial;
+layout(location = 2) in vec3 inWorldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+// 太陽（影を付ける平行光源）とglTFのライトをGGXで計算する
+void main() {
+    Material material = materials[inMaterial];
+    vec3 albedo = material.baseColorFactor.rgb;
+    vec3 N = normalize(inNormal);
+    vec3 V = normalize(camera.position.xyz - inWorldPosition);
+    float viewDepth = -(camera.view * vec4(inWorldPosition, 1.0)).z;
+
+    vec3 sunDirection = shadow.lightDirection.xyz;
+    float lit = dot(N, sunDirection) > 0.0 ? shadowFactor(inWorldPosition, viewDepth) : 1.0;
+    vec3 color = albedo * 0.2;
+    color += shadeLight(N, V, sunDirection, vec3(0.8 * PI), albedo, material.metallicFactor, material.roughnessFactor) * lit;
+    color += shadePunctualLights(gl_FragCoord.xy, viewDepth, inWorldPosition, N, V, albedo, material.metallicFactor, material.roughnessFactor);
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#include "meshletCommon.glsl"
+
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outMaterial;
+layout(location = 2) out vec3 outWorldPosition;
+
+void main() {
+    // firstInstanceにインスタンス番号が入っている
+    mat4 world = instanceTransform(gl_InstanceIndex);
+    vec4 worldPosition = world * vec4(inPosition, 1.0);
+    gl_Position = camera.viewProj * worldPosition;
+    outWorldPosition = worldPosition.xyz;
+    outNormal = mat3(world) * inNormal;
+    outMaterial = instances[gl_InstanceIndex].materialIndex;
+}
@@ -0,0 +1,107 @@
+// メッシュレットカリング共通定義（code/meshletCullWrapper.cppと同じレイアウト）
+
+struct Meshlet {
+    vec4 sphere;        // xyz: 中心, w: 半径
+    vec4 coneApex;      // xyz: コーン頂点, w: cutoff
+    vec4 coneAxis;
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint resident;      // 0ならジオメトリが退避されているため描画しない
+    uint meshletVertexOffset;
+    uint meshletTriangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+struct CullStatistics {
+    uint drawCount[2];      // 1回目・2回目の描画数
+    uint visibleTriangles;
+    uint visibleMeshlets;
+    uint testedMeshlets;    // 2回目で視錐台・背面を通過したもの
+    uint occludedMeshlets;
+    uint pad0;
+    uint pad1;
+};
+
+// 常駐するシーンの表（code/gpuScene.hppと同じレイアウト）
+struct Instance {
+    uint transformIndex;
+    uint materialIndex;
+    uint pad0;
+    uint pad1;
+};
+
+struct Material {
+    vec4 baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float pad0;
+    float pad1;
+};
+
+// タスクシェーダからメッシュシェーダへ渡す可視メッシュレット
+struct TaskPayload {
+    uint workItems[32];
+};
+
+layout(set = 0, binding = 0) uniform CullParams {
+    mat4 viewProj;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    uint workItemCount;
+    uint cullingEnabled;
+    uint compactDraws;
+    uint occlusionEnabled;
+    vec2 depthSize;         // 階層Zの元になった深度の大きさ（ピクセル）
+    uint pyramidLevelCount;
+    uint pad0;
+} params;
+
+// フレームごとのリングバッファ（ダイナミックオフセット）
+layout(set = 1, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 position;
+} camera;
+
+// シーンの表（変更された要素だけがホストから書き換えられる）
+layout(std430, set = 0, binding = 3) readonly buffer Transforms { mat4 transforms[]; };
+layout(std430, set = 0, binding = 11) readonly buffer Instances { Instance instances[]; };
+layout(std430, set = 0, binding = 12) readonly buffer Materials { Material materials[]; };
+
+mat4 instanceTransform(uint instance) {
+    return transforms[instances[instance].transformIndex];
+}
+
+// 視錐台と法線コーンによる判定
+// 非一様スケールでは法線コーンの変換が近似になる
+bool isMeshletVisible(Meshlet meshlet, mat4 world) {
+    vec3 center = (world * vec4(meshlet.sphere.xyz, 1.0)).xyz;
+    float scale = max(max(length(world[0].xyz), length(world[1].xyz)), length(world[2].xyz));
+    float radius = meshlet.sphere.w * scale;
+
+    for (int i = 0; i < 6; i++) {
+        if (dot(params.frustumPlanes[i].xyz, center) + params.frustumPlanes[i].w < -radius) {
+            return false;
+        }
+    }
+
+    if (meshlet.coneApex.w < 1.0) {
+        vec3 apex = (world * vec4(meshlet.coneApex.xyz, 1.0)).xyz;
+        vec3 axis = normalize(mat3(world) * meshlet.coneAxis.xyz);
+        if (dot(normalize(apex - params.cameraPosition.xyz), axis) >= meshlet.coneApex.w) {
+            return false;
+        }
+    }
+    return true;
+}
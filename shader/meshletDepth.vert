@@ -0,0 +1,11 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#include "meshletCommon.glsl"
+
+// 深度のみのパス。位置だけを読む（位置ストリームでもプールのインターリーブされた頂点でも同じシェーダを使う）
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    // firstInstanceにインスタンス番号が入っている
+    gl_Position = camera.viewProj * instanceTransform(gl_InstanceIndex) * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,110 @@
+// クラスタライティング（code/lightCluster.hppと同じレイアウト）
+// shader/lightCluster.compはLIGHT_GRID_ACCESSを空に、LIGHT_CLUSTER_ONLYを定義してから読み込み、割り当てを書き込む
+
+#ifndef LIGHT_GRID_ACCESS
+#define LIGHT_GRID_ACCESS readonly
+#endif
+
+const uint LIGHT_DIRECTIONAL = 0;
+const uint LIGHT_POINT = 1;
+const uint LIGHT_SPOT = 2;
+
+struct Light {
+    vec4 positionRange;     // xyz: ワールド位置, w: 影響範囲
+    vec4 directionType;     // xyz: 光の進む向き, w: 種類
+    vec4 radiance;          // rgb: 色 × 強度
+    vec4 spotScaleOffset;   // x: 角度のcosに掛ける値, y: 足す値
+};
+
+// code/vulkanContext.hppのLightClusterWrapper::ClusterParamsと同じレイアウト
+layout(set = 0, binding = 15) uniform ClusterParams {
+    mat4 view;
+    uvec4 gridSize;         // xyz: クラスタ数, w: 1クラスタの最大ライト数
+    vec2 screenSize;
+    vec2 projectionScale;   // 射影行列の[0][0]と[1][1]
+    float zNear;
+    float zFar;
+    float sliceScale;       // slice = log(奥行き) * sliceScale + sliceBias
+    float sliceBias;
+    uint lightCount;        // 平行光源を含む
+    uint directionalCount;  // 先頭に並べた平行光源の数
+    uint clustered;         // 0ならクラスタのライトを読まない
+    uint pad0;
+} clusters;
+
+layout(std430, set = 0, binding = 16) readonly buffer Lights { Light lights[]; };
+layout(std430, set = 0, binding = 17) LIGHT_GRID_ACCESS buffer LightGrid { uint lightGrid[]; };
+layout(std430, set = 0, binding = 18) LIGHT_GRID_ACCESS buffer LightIndices { uint lightIndices[]; };
+
+// 画素の位置（ピクセル）とカメラの前方向の距離からクラスタを求める
+uint clusterIndex(vec2 fragCoord, float viewDepth) {
+    uvec2 tile = min(uvec2(fragCoord / clusters.screenSize * vec2(clusters.gridSize.xy)), clusters.gridSize.xy - 1);
+    float slice = log(max(viewDepth, clusters.zNear)) * clusters.sliceScale + clusters.sliceBias;
+    uint z = uint(clamp(slice, 0.0, float(clusters.gridSize.z - 1)));
+    return (z * clusters.gridSize.y + tile.y) * clusters.gridSize.x + tile.x;
+}
+
+#ifndef LIGHT_CLUSTER_ONLY
+
+const float PI = 3.14159265359;
+
+// GGXの鏡面反射とランバートの拡散反射（Lはライトへ向かう向き）
+vec3 shadeLight(vec3 N, vec3 V, vec3 L, vec3 radiance, vec3 albedo, float metallic, float roughness) {
+    float NdotL = max(dot(N, L), 0.0);
+    if (NdotL <= 0.0) {
+        return vec3(0.0);
+    }
+    vec3 H = normalize(V + L);
+    float NdotV = max(dot(N, V), 1e-4);
+    float NdotH = max(dot(N, H), 0.0);
+    float VdotH = max(dot(V, H), 0.0);
+
+    float alpha = max(roughness, 0.045);
+    alpha *= alpha;
+    float alpha2 = alpha * alpha;
+    float denominator = NdotH * NdotH * (alpha2 - 1.0) + 1.0;
+    float D = alpha2 / (PI * denominator * denominator);
+    float k = alpha * 0.5;
+    float G = (NdotV / (NdotV * (1.0 - k) + k)) * (NdotL / (NdotL * (1.0 - k) + k));
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    vec3 F = F0 + (1.0 - F0) * pow(1.0 - VdotH, 5.0);
+
+    vec3 specular = D * G * F / (4.0 * NdotV * NdotL);
+    vec3 diffuse = (1.0 - F) * (1.0 - metallic) * albedo / PI;
+    return (diffuse + specular) * radiance * NdotL;
+}
+
+// 点・スポットの距離と角度による減衰（KHR_lights_punctualの推奨式）
+vec3 punctualRadiance(Light light, vec3 worldPosition, out vec3 L) {
+    vec3 toLight = light.positionRange.xyz - worldPosition;
+    float distanceSquared = max(dot(toLight, toLight), 1e-4);
+    L = toLight * inversesqrt(distanceSquared);
+    float ratio = distanceSquared / (light.positionRange.w * light.positionRange.w);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / distanceSquared;
+    float spot = clamp(dot(light.directionType.xyz, -L) * light.spotScaleOffset.x + light.spotScaleOffset.y, 0.0, 1.0);
+    return light.radiance.rgb * attenuation * spot * spot;
+}
+
+// 平行光源はすべて、点・スポットは画素のクラスタに割り当てられたものだけを足す
+vec3 shadePunctualLights(vec2 fragCoord, float viewDepth, vec3 worldPosition, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness) {
+    vec3 color = vec3(0.0);
+    for (uint i = 0; i < clusters.directionalCount; i++) {
+        color += shadeLight(N, V, -lights[i].directionType.xyz, lights[i].radiance.rgb, albedo, metallic, roughness);
+    }
+    if (clusters.clustered == 0 || clusters.lightCount <= clusters.directionalCount) {
+        return color;
+    }
+    uint cluster = clusterIndex(fragCoord, viewDepth);
+    uint count = lightGrid[cluster];
+    uint base = cluster * clusters.gridSize.w;
+    for (uint i = 0; i < count; i++) {
+        Light light = lights[lightIndices[base + i]];
+        vec3 L;
+        vec3 radiance = punctualRadiance(light, worldPosition, L);
+        color += shadeLight(N, V, L, radiance, albedo, metallic, roughness);
+    }
+    return color;
+}
+
+#endif
@@ -0,0 +1,72 @@
+// 2段階の遮蔽カリング（カリングを行うmeshletCull.compとmeshlet.taskのみ読み込む）
+// meshletCommon.glslの後に読み込む
+
+// 0: 前フレームの可視情報による描画, 1: 階層Zによる判定と描き足し
+layout(push_constant) uniform CullPhase { uint phase; } cullPhase;
+
+layout(std430, set = 0, binding = 9) buffer Visibility { uint visibility[]; };
+layout(set = 0, binding = 10) uniform sampler2D depthPyramid;
+
+// 球を画面へ投影した矩形が2×2テクセルに収まるミップで階層Zの最大深度と比べる
+// 近平面に掛かる球は遮蔽されていないものとする
+bool isSphereOccluded(vec3 center, float radius) {
+    vec3 c = (camera.view * vec4(center, 1.0)).xyz;
+    float nearestZ = c.z + radius;//カメラは-z方向を向く
+    vec4 nearestClip = camera.projection * vec4(0.0, 0.0, nearestZ, 1.0);
+    if (nearestZ >= 0.0 || nearestClip.z < 0.0) {
+        return false;
+    }
+    float nearestDepth = nearestClip.z / nearestClip.w;
+
+    // 接線による画面上の範囲（2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere）
+    float depth = -c.z;
+    float czr2 = depth * depth - radius * radius;
+    float vx = sqrt(c.x * c.x + czr2);
+    float vy = sqrt(c.y * c.y + czr2);
+    vec4 tangents = vec4(
+        (vx * c.x - radius * depth) / (vx * depth + radius * c.x),
+        (vy * c.y - radius * depth) / (vy * depth + radius * c.y),
+        (vx * c.x + radius * depth) / (vx * depth - radius * c.x),
+        (vy * c.y + radius * depth) / (vy * depth - radius * c.y)
+    );
+    vec4 ndc = tangents * vec4(camera.projection[0][0], camera.projection[1][1], camera.projection[0][0], camera.projection[1][1]);
+    vec4 uv = clamp(vec4(min(ndc.xy, ndc.zw), max(ndc.xy, ndc.zw)) * 0.5 + 0.5, 0.0, 1.0);
+
+    // 深度のピクセル範囲 → ミップiのテクセルは 2^(i+1) ピクセル四方
+    vec4 pixels = min(uv * params.depthSize.xyxy, params.depthSize.xyxy - 1.0);
+    float extent = max(pixels.z - pixels.x, pixels.w - pixels.y);
+    int level = clamp(int(ceil(log2(max(extent, 1.0)))) - 1, 0, int(params.pyramidLevelCount) - 1);
+    float scale = exp2(-float(level + 1));
+    ivec2 lo = ivec2(pixels.xy * scale);
+    ivec2 hi = ivec2(pixels.zw * scale);
+    float farthest = max(max(texelFetch(depthPyramid, lo, level).r, texelFetch(depthPyramid, ivec2(hi.x, lo.y), level).r),
+                         max(texelFetch(depthPyramid, ivec2(lo.x, hi.y), level).r, texelFetch(depthPyramid, hi, level).r));
+    return nearestDepth > farthest;
+}
+
+bool isMeshletOccluded(Meshlet meshlet, mat4 world) {
+    vec3 center = (world * vec4(meshlet.sphere.xyz, 1.0)).xyz;
+    float scale = max(max(length(world[0].xyz), length(world[1].xyz)), length(world[2].xyz));
+    return isSphereOccluded(center, meshlet.sphere.w * scale);
+}
+
+// 2段階のカリングでこのフェーズに描画するか
+// 1回目は前フレームで可視だったもの、2回目は可視のうち1回目で描いていないもの（可視情報を更新する）
+// testedとoccludedは2回目の統計用
+bool shouldDrawWorkItem(uint id, Meshlet meshlet, mat4 world, out bool tested, out bool occluded) {
+    tested = false;
+    occluded = false;
+    bool visible = meshlet.resident != 0 && (params.cullingEnabled == 0 || isMeshletVisible(meshlet, world));
+    if (cullPhase.phase == 0) {
+        return visible && (params.occlusionEnabled == 0 || visibility[id] != 0);
+    }
+
+    if (visible) {
+        tested = true;
+        occluded = isMeshletOccluded(meshlet, world);
+        visible = !occluded;
+    }
+    bool drawn = visibility[id] != 0;//視錐台・背面で落ちていればvisibleも偽になる
+    visibility[id] = visible ? 1 : 0;
+    return visible && !drawn;
+}
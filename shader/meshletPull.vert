@@ -0,0 +1,55 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#include "meshletCommon.glsl"
+
+// 頂点プル: 頂点入力を使わず、ジオメトリプールをバッファデバイスアドレスで読み出して復元する
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexWords { uint words[]; };
+
+// code/geometry.hppのVertexPullLayout・VertexFormatと同じ（オフセットと間隔は4バイト単位）
+const uint kFormatNone = 0;
+const uint kFormatFloat3 = 1;
+const uint kFormatSnorm8x4 = 2;
+
+layout(push_constant) uniform VertexPull {
+    layout(offset = 16) uvec2 vertexAddress;
+    uint stride;
+    uint positionOffset;
+    uint normalOffset;
+    uint normalFormat;
+} pull;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outMaterial;
+layout(location = 2) out vec3 outWorldPosition;
+
+vec3 readFloat3(VertexWords vertices, uint word) {
+    return uintBitsToFloat(uvec3(vertices.words[word], vertices.words[word + 1], vertices.words[word + 2]));
+}
+
+vec3 readNormal(VertexWords vertices, uint base) {
+    if (pull.normalFormat == kFormatFloat3) {
+        return readFloat3(vertices, base + pull.normalOffset);
+    }
+    if (pull.normalFormat == kFormatSnorm8x4) {
+        return unpackSnorm4x8(vertices.words[base + pull.normalOffset]).xyz;
+    }
+    return vec3(0.0, 0.0, 1.0);
+}
+
+void main() {
+    // gl_VertexIndexには描画コマンドのvertexOffsetが足されている（プールの先頭からの頂点番号）
+    VertexWords vertices = VertexWords(pull.vertexAddress);
+    uint base = uint(gl_VertexIndex) * pull.stride;
+    vec3 position = readFloat3(vertices, base + pull.positionOffset);
+    vec3 normal = readNormal(vertices, base);
+
+    // firstInstanceにインスタンス番号が入っている
+    mat4 world = instanceTransform(gl_InstanceIndex);
+    vec4 worldPosition = world * vec4(position, 1.0);
+    gl_Position = camera.viewProj * worldPosition;
+    outWorldPosition = worldPosition.xyz;
+    outNormal = mat3(world) * normal;
+    outMaterial = instances[gl_InstanceIndex].materialIndex;
+}
@@ -0,0 +1,40 @@
+// カスケードシャドウマップの参照（フラグメントシェーダのみ読み込む）
+// meshletCommon.glslの後に読み込む
+
+// code/vulkanContext.hppのShadowMapWrapper::ShadowParamsと同じレイアウト
+layout(set = 0, binding = 13) uniform sampler2DArrayShadow shadowMap;
+layout(set = 0, binding = 14) uniform ShadowParams {
+    mat4 cascadeViewProj[4];
+    vec4 splitDepths;       // カスケードの奥側の境界（カメラの前方向の距離）
+    vec4 lightDirection;    // xyz: ライトへ向かう向き
+    uint cascadeCount;      // 0なら影を付けない
+    float texelSize;
+    uint pad0;
+    uint pad1;
+} shadow;
+
+// 1なら光が当たる。viewDepthはカメラの前方向の距離
+// 距離でカスケードを選び、3×3の比較結果を平均する
+float shadowFactor(vec3 worldPosition, float viewDepth) {
+    if (shadow.cascadeCount == 0) {
+        return 1.0;
+    }
+    uint cascade = 0;
+    while (cascade < shadow.cascadeCount && viewDepth > shadow.splitDepths[cascade]) {
+        cascade++;
+    }
+    if (cascade == shadow.cascadeCount) {
+        return 1.0;
+    }
+
+    vec4 lightClip = shadow.cascadeViewProj[cascade] * vec4(worldPosition, 1.0);
+    vec3 coord = lightClip.xyz / lightClip.w;
+    vec2 uv = coord.xy * 0.5 + 0.5;
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * shadow.texelSize, float(cascade), coord.z));
+        }
+    }
+    return lit / 9.0;
+}
@@ -0,0 +1,23 @@
+#version 460
+
+// 重み付きOITの蓄積（code/transparencyWrapper.cppが描画範囲と同じ位置に書き込む）
+layout(set = 2, binding = 1) uniform sampler2D accumulationTexture;
+layout(set = 2, binding = 2) uniform sampler2D revealageTexture;
+
+layout(location = 0) out vec4 outColor;
+
+// 累積した色を重みの和で割った平均を、(1 - 透過率)の不透明度で不透明な描画の上へ重ねる
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(revealageTexture, texel, 0).r;
+    if (revealage >= 1.0) {
+        discard;// 半透明が描かれていない画素
+    }
+    vec4 accumulation = texelFetch(accumulationTexture, texel, 0);
+    // 半精度の上限を超えた場合は色を飽和させる
+    if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b)))) {
+        accumulation.rgb = vec3(accumulation.a);
+    }
+    vec3 average = accumulation.rgb / max(accumulation.a, 1e-5);
+    outColor = vec4(average, 1.0 - revealage);
+}
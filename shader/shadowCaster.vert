@@ -0,0 +1,12 @@
+#version 460
+
+// 影を落とす投影元の深度だけを描く（位置ストリームのみを読む）
+layout(location = 0) in vec3 inPosition;
+
+layout(push_constant) uniform Caster {
+    mat4 lightWorldViewProj;
+} caster;
+
+void main() {
+    gl_Position = caster.lightWorldViewProj * vec4(inPosition, 1.0);
+}
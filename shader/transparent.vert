@@ -0,0 +1,25 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#include "meshletCommon.glsl"
+
+
+// 描くインスタンスの番号（ソート時は奥から手前の順、重み付きOITではジオメトリごとにまとめた順）
+layout(std430, set = 2, binding = 0) readonly buffer DrawInstances { uint drawInstances[]; };
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) flat out uint outMaterial;
+layout(location = 2) out vec3 outWorldPosition;
+
+void main() {
+    // gl_InstanceIndexはfirstInstanceからの並びの位置
+    uint instance = drawInstances[gl_InstanceIndex];
+    mat4 world = instanceTransform(instance);
+    vec4 worldPosition = world * vec4(inPosition, 1.0);
+    gl_Position = camera.viewProj * worldPosition;
+    outWorldPosition = worldPosition.xyz;
+    outNormal = mat3(world) * inNormal;
+    outMaterial = instances[instance].materialIndex;
+}
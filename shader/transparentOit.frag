@@ -0,0 +1,21 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#include "meshletCommon.glsl"
+#include "meshletShadow.glsl"
+#include "meshletLights.glsl"
+#include "transparentShading.glsl"
+
+layout(location = 0) out vec4 outAccumulation;
+layout(location = 1) out float outRevealage;
+
+// 重み付きブレンドのOIT（McGuire, Bavoil 2013）
+// 累積には(色 × α, α) × 重みを加算し、透過率には(1 - α)を乗算する（ブレンドの設定で行う）
+// 重みは手前で不透明に近いものほど大きくし、描く順序に依らず手前のものが勝つようにする
+void main() {
+    vec4 color = shadeTransparent();
+    float alpha = color.a;
+    float z = transparentViewDepth();
+    float weight = alpha * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0)), 1e-2, 3e3);
+    outAccumulation = vec4(color.rgb * alpha, alpha) * weight;
+    outRevealage = alpha;
+}
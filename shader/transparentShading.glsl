@@ -0,0 +1,27 @@
+// 半透明の面の照明（meshlet.fragと同じ計算で、アルファはbaseColorFactorのa）
+// meshletCommon.glsl・meshletShadow.glsl・meshletLights.glslの後に読み込む
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) flat in uint inMaterial;
+layout(location = 2) in vec3 inWorldPosition;
+
+float transparentViewDepth() {
+    return -(camera.view * vec4(inWorldPosition, 1.0)).z;
+}
+
+vec4 shadeTransparent() {
+    Material material = materials[inMaterial];
+    vec3 albedo = material.baseColorFactor.rgb;
+    vec3 V = normalize(camera.position.xyz - inWorldPosition);
+    // 裏面も描くため、法線を視点の側へ向ける
+    vec3 N = normalize(inNormal);
+    N = dot(N, V) < 0.0 ? -N : N;
+    float viewDepth = transparentViewDepth();
+
+    vec3 sunDirection = shadow.lightDirection.xyz;
+    float lit = dot(N, sunDirection) > 0.0 ? shadowFactor(inWorldPosition, viewDepth) : 1.0;
+    vec3 color = albedo * 0.2;
+    color += shadeLight(N, V, sunDirection, vec3(0.8 * PI), albedo, material.metallicFactor, material.roughnessFactor) * lit;
+    color += shadePunctualLights(gl_FragCoord.xy, viewDepth, inWorldPosition, N, V, albedo, material.metallicFactor, material.roughnessFactor);
+    return vec4(color, material.baseColorFactor.a);
+}
@@ -0,0 +1,13 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+#include "meshletCommon.glsl"
+#include "meshletShadow.glsl"
+#include "meshletLights.glsl"
+#include "transparentShading.glsl"
+
+layout(location = 0) out vec4 outColor;
+
+// 奥から手前の順に描き、アルファブレンドで重ねる
+void main() {
+    outColor = shadeTransparent();
+}